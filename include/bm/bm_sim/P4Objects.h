@@ -39,6 +39,8 @@
 #include "conditionals.h"
 #include "checksums.h"
 #include "control_flow.h"
+#include "control_flow_graph.h"
+#include "flex_version.h"
 #include "learning.h"
 #include "meters.h"
 #include "counters.h"
@@ -107,6 +109,26 @@ class P4Objects {
                      std::set<header_field_pair>(),
                    const ForceArith &arith_objects = ForceArith());
 
+  // FlexCore: loads only what a runtime reconfiguration plan needs from the
+  // new program. The JSON may be a full bmv2 JSON or a delta JSON with only
+  // the "actions" and "pipelines" sections (plus optionally "calculations"
+  // and "meter_arrays" for the direct meters of the new tables). Only the
+  // tables and conditionals in node_names, the actions and action profiles
+  // they reference and their direct meters are instantiated. The header
+  // layout is always taken from base (the running program), and register,
+  // counter and indirect meter arrays, calculations and extern instances which
+  // are not in the delta are resolved in base, so that the inserted actions
+  // share the state of the running program. base must outlive this object.
+  int init_objects_delta(std::istream *is,
+                         const P4Objects &base,
+                         const std::set<std::string> &node_names,
+                         LookupStructureFactory *lookup_factory,
+                         device_id_t device_id = 0, cxt_id_t cxt_id = 0,
+                         std::shared_ptr<TransportIface> transport = nullptr,
+                         const std::set<header_field_pair> &required_fields =
+                           std::set<header_field_pair>(),
+                         const ForceArith &arith_objects = ForceArith());
+
   P4Objects(const P4Objects &other) = delete;
   P4Objects &operator=(const P4Objects &) = delete;
 
@@ -202,10 +224,14 @@ class P4Objects {
     return conditionals_map.at(name).get();
   }
 
+  Conditional *get_conditional_rt(const std::string &name) const;
+
   ControlFlowNode *get_control_node(const std::string &name) const {
     return control_nodes_map.at(name);
   }
 
+  ControlFlowNode *get_control_node_rt(const std::string &name) const;
+
   Pipeline *get_pipeline(const std::string &name) const {
     return pipelines_map.at(name).get();
   }
@@ -253,6 +279,10 @@ class P4Objects {
   bool field_exists(const std::string &header_name,
                     const std::string &field_name) const;
 
+  // field aliases are resolved; the field must exist (see field_exists())
+  std::tuple<header_id_t, int> field_info(const std::string &header_name,
+                                          const std::string &field_name) const;
+
   bool header_exists(const std::string &header_name) const;
 
   // public to be accessed by test class
@@ -335,6 +365,11 @@ class P4Objects {
   void change_register_array_bitwidth_rt(const std::string& name,
                                          const std::string& new_register_array_bitwidth);
   void flex_trigger_rt(bool on);
+  // FlexCore: same as flex_trigger_rt(), but only for the packets numbered
+  // packet_number and above, or with an ingress timestamp of ts_ms or more (see
+  // FlexVersion); return false if the switch point was already reached
+  bool flex_trigger_at_packet_rt(bool on, uint64_t packet_number);
+  bool flex_trigger_at_time_rt(bool on, uint64_t ts_ms);
   void delete_flex_rt(const std::string &pipeline_name,
                       const std::string &name);
   void delete_conditional_rt(const std::string &pipeline_name,
@@ -342,6 +377,14 @@ class P4Objects {
   void delete_match_table_rt(const std::string &pipeline_name,
                              const std::string &name);
   void delete_register_array_rt(const std::string& name);
+  // FlexCore: the control flow graph changes made by the methods above (node
+  // insertions and deletions, next node changes) are only visible to packets
+  // once this is called, see VersionedControlFlowGraph
+  void publish_control_flow_graph_rt();
+  // number of times the control flow graph was published
+  uint64_t get_control_flow_graph_version_rt() const {
+    return control_flow_graph.get_version();
+  }
 
   void insert_parse_state_rt(std::shared_ptr<P4Objects> p4objects_new,
                              const std::string &parser_name,
@@ -353,7 +396,16 @@ class P4Objects {
 
   void print_cfg(std::ostream &os);
 
-  const Json::Value& get_cfg() {
+  // FlexCore: nullptr if the program was not prepared for flex triggers
+  const ParseState *get_flex_init_state() const {
+    return flex_init_state;
+  }
+
+  const FlexVersion &get_flex_version() const {
+    return flex_version;
+  }
+
+  const Json::Value& get_cfg() const {
     return cfg_root;
   }
 
@@ -497,6 +549,15 @@ class P4Objects {
 
   void parse_config_options(const Json::Value &root);
 
+  int init_objects_from_cfg(
+      const Json::Value &cfg_root, LookupStructureFactory *lookup_factory,
+      device_id_t device_id, cxt_id_t cxt_id,
+      std::shared_ptr<TransportIface> notifications_transport,
+      const std::set<header_field_pair> &required_fields,
+      const ForceArith &arith_objects);
+
+  ControlFlowNode *get_next_node_cfg(const Json::Value &cfg_next_node) const;
+
  private:
   PHVFactory phv_factory{};  // this is probably temporary
 
@@ -637,7 +698,16 @@ class P4Objects {
   std::unordered_map<std::string, int> parseStateIdCount;
   int conditionalNameMax;
 
-  ParseState *flex_init_state;
+  ParseState *flex_init_state{nullptr};
+  // FlexCore: assigns the flexMetadata.version of the packets in flex_start
+  FlexVersion flex_version{};
+
+  // FlexCore: set when loaded with init_objects_delta, objects which are not
+  // part of the delta are looked up in base_objects
+  const P4Objects *base_objects{nullptr};
+  // FlexCore: actions moved to the live objects by insert_match_table_rt, id
+  // in this program -> id in the live program
+  std::unordered_map<p4object_id_t, p4object_id_t> moved_action_ids{};
 
   std::unordered_map<int, Json::Value*> cfg_actions_map{};
   std::unordered_map<std::string, Json::Value*> cfg_pipelines_map{};
@@ -650,14 +720,15 @@ class P4Objects {
   std::unordered_map<std::string, Json::Value*> cfg_parse_states_map{};
   std::unordered_map<std::string, Json::Value*> cfg_register_arrays_map{};
 
+  // declared last so that the deleted nodes it still holds are destroyed first
+  VersionedControlFlowGraph control_flow_graph{};
+
  private:
   int get_field_offset(header_id_t header_id,
                        const std::string &field_name) const;
   size_t get_field_bytes(header_id_t header_id, int field_offset) const;
   size_t get_field_bits(header_id_t header_id, int field_offset) const;
   size_t get_header_bits(header_id_t header_id) const;
-  std::tuple<header_id_t, int> field_info(const std::string &header_name,
-                                          const std::string &field_name) const;
   bool check_required_fields(
       const std::set<header_field_pair> &required_fields);
 
@@ -34,7 +34,6 @@
 #include "calculations.h"
 #include "handle_mgr.h"
 #include "match_error_codes.h"
-#include "ras.h"
 
 namespace bm {
 
@@ -213,10 +212,12 @@ class ActionProfile : public NamedP4Object {
     std::vector<count_t> grp_count{};
   };
 
+  // the members are kept in a sorted vector, so that get_nth(), which
+  // the default member selection calls for every packet, is an array access
   class GroupInfo {
    public:
-    using iterator = RandAccessUIntSet::iterator;
-    using const_iterator = RandAccessUIntSet::const_iterator;
+    using iterator = std::vector<mbr_hdl_t>::const_iterator;
+    using const_iterator = std::vector<mbr_hdl_t>::const_iterator;
 
     MatchErrorCode add_member(mbr_hdl_t mbr);
     MatchErrorCode delete_member(mbr_hdl_t mbr);
@@ -225,16 +226,16 @@ class ActionProfile : public NamedP4Object {
     mbr_hdl_t get_nth(size_t n) const;
 
     // iterators
-    iterator begin() { return mbrs.begin(); }
-    const_iterator begin() const { return mbrs.begin(); }
-    iterator end() { return mbrs.end(); }
-    const_iterator end() const { return mbrs.end(); }
+    iterator begin() { return mbrs.cbegin(); }
+    const_iterator begin() const { return mbrs.cbegin(); }
+    iterator end() { return mbrs.cend(); }
+    const_iterator end() const { return mbrs.cend(); }
 
     void serialize(std::ostream *out) const;
     void deserialize(std::istream *in);
 
    private:
-    RandAccessUIntSet mbrs{};
+    std::vector<mbr_hdl_t> mbrs{};
   };
 
   class GroupMgr : public GroupSelectionIface {
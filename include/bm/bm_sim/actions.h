@@ -77,6 +77,7 @@
 #include <memory>
 #include <string>
 #include <tuple>
+#include <type_traits>
 #include <unordered_map>
 #include <utility>
 #include <vector>
@@ -605,6 +606,26 @@ class ActionPrimitive_ {
     return current_offset + 1;
   }
 
+  // true for the primitives which override get_jump_offset; the offset of the
+  // target primitive is then given by the last parameter
+  virtual bool is_jump() const { return false; }
+
+  // true if the parameter at position param is bound to a non-const reference,
+  // i.e. the primitive may modify it
+  virtual bool is_param_writable(size_t param) const {
+    (void) param;
+    return true;
+  }
+
+  // If the primitive only accesses a single cell of the RegisterArray passed
+  // as parameter array_param, returns the position of the parameter holding
+  // the index of that cell. Otherwise returns -1, in which case the action
+  // needs exclusive access to the whole array.
+  virtual int get_register_index_param(size_t array_param) const {
+    (void) array_param;
+    return -1;
+  }
+
   void _set_p4objects(P4Objects *p4objects) {
     this->p4objects = p4objects;
   }
@@ -646,6 +667,15 @@ class ActionPrimitive :  public ActionPrimitive_ {
   // cannot make it constexpr because it is virtual
   size_t get_num_params() const override { return sizeof...(Args); }
 
+  bool is_param_writable(size_t param) const override {
+    // extra element for primitives with no parameters
+    static const bool writable[] = {
+      (std::is_lvalue_reference<Args>::value &&
+       !std::is_const<typename std::remove_reference<Args>::type>::value)...,
+      false};
+    return writable[param];
+  }
+
   virtual void operator ()(Args...) = 0;
 
  protected:
@@ -695,6 +725,8 @@ class ActionPrimitiveCall {
 
   size_t get_param_offset() const { return param_offset; }
 
+  const ActionPrimitive_ *get_primitive() const { return primitive; }
+
   size_t get_jump_offset(size_t current_offset) const {
     return primitive->get_jump_offset(current_offset);
   }
@@ -757,15 +789,39 @@ class ActionFn :  public NamedP4Object {
 
   void grab_register_accesses(RegisterSync *register_sync) const;
 
+  // Checks whether every register access performed by the action is to a
+  // single cell, whose index does not change during the action. If it is the
+  // case, the action will only lock the stripes of the cells it accesses, and
+  // not the whole register arrays. Has to be called once all the primitives
+  // and their parameters have been pushed.
+  void finalize_register_accesses();
+
   size_t get_num_params() const;
 
  private:
   using ParameterList = std::vector<ActionParam>;
 
+  struct RegisterCellAccess {
+    size_t primitive;  // position in primitives
+    size_t index_param;  // position in params
+    const RegisterArray *array;
+    size_t array_pos;  // position in register_sync.get_register_arrays()
+  };
+
+  bool same_register_index(const ActionParam &p1, const ActionParam &p2) const;
+  bool may_write_register_index(size_t primitive,
+                                const ActionParam &index) const;
+
   std::vector<ActionPrimitiveCall> primitives{};
   ParameterList params{};
   ParameterList sub_params{};
   RegisterSync register_sync{};
+  // only used when register_cells_only is true, sorted by primitive
+  std::vector<RegisterCellAccess> register_cell_accesses{};
+  bool register_cells_only{false};
+  // register accesses from expressions (or REGISTER_GEN parameters) cannot be
+  // restricted to a single cell
+  bool register_accesses_in_expressions{false};
   std::vector<Data> const_values{};
   // should I store the objects in the vector, instead of pointers?
   std::vector<std::unique_ptr<Expression> > expressions{};
@@ -830,6 +886,10 @@ class ActionFnEntry {
   ActionFnEntry &operator=(ActionFnEntry &&other) /*noexcept*/ = default;
 
  private:
+  // if cell_locks is not nullptr, the stripes of the register cells accessed
+  // by the action are locked (and added to cell_locks) before the first access
+  void execute(Packet *pkt, RegisterSync::RegisterLocks *cell_locks) const;
+
   const ActionFn *action_fn{nullptr};
   ActionData action_data{};
 };
@@ -46,8 +46,13 @@ class AgeingMonitorIface {
 
   virtual ~AgeingMonitorIface() { }
 
+  //! Tables can be added and removed while the monitor is running (e.g. by
+  //! runtime reconfiguration). A table has to be removed before it is
+  //! destroyed.
   virtual void add_table(MatchTableAbstract *table) = 0;
 
+  virtual void remove_table(p4object_id_t id) = 0;
+
   virtual void set_sweep_interval(unsigned int ms) = 0;
 
   virtual unsigned int get_sweep_interval() = 0;
@@ -56,9 +61,7 @@ class AgeingMonitorIface {
 
   //! Returns an empty string if table doesn't support idle timeout; this is
   //! useful to decode notifications.
-  //! Not thread-safe but can be called safely after the map has been populated
-  //! by P4Objects::init_objects, including as idle notifications are being
-  //! generated.
+  //! Thread-safe, including as idle notifications are being generated.
   virtual std::string get_table_name_from_id(p4object_id_t id) const = 0;
 
   static std::unique_ptr<AgeingMonitorIface> make(
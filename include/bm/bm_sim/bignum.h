@@ -57,6 +57,12 @@ namespace bignum {
     return mpz_clrbit(v->backend().data(), index);
   }
 
+  // true iff v is non-negative and less than 2^64
+  inline bool fits_uint64(const Bignum &v) {
+    return mpz_sgn(v.backend().data()) >= 0 &&
+        mpz_sizeinbase(v.backend().data(), 2) <= 64;
+  }
+
 }  // namespace bignum
 
 }  // namespace bm
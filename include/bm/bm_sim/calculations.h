@@ -239,19 +239,50 @@ class BufBuilder {
 
   void operator()(const Packet &pkt, ByteContainer *buf) const;
 
+  // true if both build the same buffer
+  bool operator==(const BufBuilder &other) const;
+
+  // true if the buffer can be rebuilt from the headers as they were
+  // extracted from the packet, i.e. it only includes fields and constants, the
+  // headers of these fields which are valid were extracted by the parser and
+  // have not been modified since, and the other ones were not extracted
+  bool is_from_packet(const PHV &phv) const;
+
+  // incremental update (RFC 1624) of a 16-bit ones' complement
+  // checksum of the buffer (csum16), which only looks at the fields of the
+  // modified headers. old_cksum is the checksum of the buffer built from the
+  // headers as they were extracted from the packet, when is_from_packet() was
+  // true. Returns false if the checksum has to be computed from scratch: the
+  // layout of the buffer changed (e.g. a header was removed) or the new buffer
+  // may be all zeros.
+  bool update_csum16(const PHV &phv, uint16_t old_cksum,
+                     uint16_t *cksum) const;
+
  private:
   struct field_t {
     header_id_t header;
     int field_offset;
+
+    bool operator==(const field_t &other) const {
+      return header == other.header && field_offset == other.field_offset;
+    }
   };
 
   struct constant_t {
     ByteContainer v;
     size_t nbits;
+
+    bool operator==(const constant_t &other) const {
+      return v == other.v && nbits == other.nbits;
+    }
   };
 
   struct header_t {
     header_id_t header;
+
+    bool operator==(const header_t &other) const {
+      return header == other.header;
+    }
   };
 
   struct Deparse;  // defined in calculations.cpp
@@ -277,6 +308,10 @@ class Calculation_ {
 
   RawCalculationIface<T> *get_raw_calculation() { return c.get(); }
 
+  const RawCalculationIface<T> *get_raw_calculation() const { return c.get(); }
+
+  const BufBuilder &get_buf_builder() const { return builder; }
+
  protected:
   ~Calculation_() { }
 
@@ -329,6 +364,11 @@ class NamedCalculation : public NamedP4Object, public Calculation_<uint64_t> {
 };
 
 
+// true if the calculation is a 16-bit ones' complement checksum
+// (csum16 or cksum16), which BufBuilder::update_csum16() can update
+bool is_csum16(const RawCalculationIface<uint64_t> &c);
+
+
 //! When implementing an hash operation for a target, this macro needs to be
 //! called to make this module aware of the hash existence.
 //! When calling this macro from an anonymous namespace, some compiler may give
@@ -44,12 +44,22 @@ class Checksum : public NamedP4Object{
 
   bool verify(const Packet &pkt) const;
 
+  // same as verify(), used by the parser; if the checksum was
+  // actually checked and is correct, records it in the header of the target
+  // field (see CalcBasedChecksum)
+  bool verify_and_record(Packet *pkt) const;
+
   void set_checksum_condition(std::unique_ptr<Expression> cksum_condition);
 
  private:
   virtual void update_(Packet *pkt) const = 0;
   virtual bool verify_(const Packet &pkt) const = 0;
 
+  virtual void record_verified(PHV *phv) const { (void) phv; }
+
+  // *checked is set to false if verification is skipped
+  bool check(const Packet &pkt, bool *checked) const;
+
   bool is_checksum_condition_met(const Packet &pkt) const;
 
   bool is_target_field_valid(const Packet &pkt) const;
@@ -74,12 +84,26 @@ class CalcBasedChecksum : public Checksum {
   CalcBasedChecksum(CalcBasedChecksum &&other) = default;
   CalcBasedChecksum &operator=(CalcBasedChecksum &&other) = default;
 
+  // when the calculation is csum16, update() uses the incremental
+  // update of BufBuilder::update_csum16(), starting from the value of the
+  // target field extracted from the packet, if the parser verified it with
+  // verifier. This requires the verifier to have the same target field and an
+  // equivalent calculation; it can be this checksum. Otherwise (or if the
+  // incremental update is not possible for this packet) the checksum is
+  // computed from scratch.
+  void set_verifier(const CalcBasedChecksum *verifier);
+
  private:
   void update_(Packet *pkt) const override;
   bool verify_(const Packet &pkt) const override;
+  void record_verified(PHV *phv) const override;
+
+  bool update_incremental(Packet *pkt) const;
 
  private:
   const NamedCalculation *calculation{nullptr};
+  bool csum16{false};
+  const CalcBasedChecksum *verifier{nullptr};
 };
 
 class IPv4Checksum : public Checksum {
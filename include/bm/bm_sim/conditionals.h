@@ -63,6 +63,13 @@ class Conditional
   // return pointer to next control flow node
   const ControlFlowNode *operator()(Packet *pkt) const override;
 
+  // out-edge 0 is taken if the condition is true, 1 otherwise
+  int apply_edge(Packet *pkt) const override;
+
+  const ControlFlowNode *get_out_edge(int edge) const override {
+    return (edge == 0) ? true_next : false_next;
+  }
+
   Conditional(const Conditional &other) = delete;
   Conditional &operator=(const Conditional &other) = delete;
 
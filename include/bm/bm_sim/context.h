@@ -55,6 +55,7 @@
 #include <mutex>
 #include <set>
 #include <string>
+#include <tuple>
 #include <typeindex>
 #include <unordered_map>
 #include <utility>
@@ -67,6 +68,7 @@
 #include "lookup_structures.h"
 #include "device_id.h"
 #include "runtime_reconfig_error_codes.h"
+#include "runtime_reconfig_plan.h"
 
 namespace bm {
 
@@ -185,6 +187,13 @@ class Context final {
   MatchErrorCode
   mt_clear_entries(const std::string &table_name, bool reset_default_entry);
 
+  MatchErrorCode
+  mt_get_cache_stats(const std::string &table_name,
+                     LookupCacheStats *stats) const;
+
+  MatchErrorCode
+  mt_set_cache_size(const std::string &table_name, size_t size);
+
   MatchErrorCode
   mt_add_entry(const std::string &table_name,
                const std::vector<MatchKeyParam> &match_key,
@@ -210,6 +219,16 @@ class Context final {
                                   const std::set<P4Objects::header_field_pair> &required_fields,
                                   const P4Objects::ForceArith &arith_objects);
 
+  //! Return the latency histograms of the runtime reconfigurations applied to
+  //! this context, one line per step type and per execution phase.
+  std::string mt_runtime_reconfig_get_stats() const {
+    return reconfig_stats.to_string();
+  }
+
+  void mt_runtime_reconfig_reset_stats() {
+    reconfig_stats.reset();
+  }
+
   MatchErrorCode
   mt_set_default_action(const std::string &table_name,
                         const std::string &action_name,
@@ -470,6 +489,11 @@ class Context final {
     return p4objects->field_exists(header_name, field_name);
   }
 
+  std::tuple<header_id_t, int> field_info(const std::string &header_name,
+                                          const std::string &field_name) const {
+    return p4objects->field_info(header_name, field_name);
+  }
+
   PHVFactory &get_phv_factory();
 
   LearnEngineIface *get_learn_engine();
@@ -520,6 +544,22 @@ class Context final {
 
   void send_swap_status_notification(SwapStatus status);
 
+  // FlexCore: a runtime reconfiguration is split in 2 so that the switch can
+  // stop packet processing only for the commit. prepare builds the new
+  // P4Objects, parses the plan and validates it against the running program;
+  // commit validates again (the program may have changed since), applies
+  // all the steps under the exclusive request lock and publishes the new
+  // control flow graph.
+  RuntimeReconfigErrorCode runtime_reconfig_prepare(
+      std::istream *json_file_stream,
+      std::istream *plan_file_stream,
+      LookupStructureFactory *lookup_factory,
+      const std::set<header_field_pair> &required_fields,
+      const ForceArith &arith_objects,
+      ReconfigPlan *plan);
+
+  RuntimeReconfigErrorCode runtime_reconfig_commit(const ReconfigPlan &plan);
+
   void print_runtime_cfg(std::ostream& os) {
     p4objects_rt->print_cfg(os);
   }
@@ -533,6 +573,13 @@ class Context final {
   std::shared_ptr<P4Objects> p4objects_rt{nullptr};
   std::shared_ptr<P4Objects> p4objects_new{nullptr};
 
+  // FlexCore: plan ids ("new_*", "flx_*") of the objects inserted at runtime,
+  // mapped to their name in p4objects_rt; kept across plans so that a plan
+  // can refer to what a previous one inserted
+  std::unordered_map<std::string, std::string> id2newNodeName{};
+
+  ReconfigStats reconfig_stats{};
+
   std::unordered_map<std::type_index, std::shared_ptr<void> > components{};
 
   std::shared_ptr<TransportIface> notifications_transport{nullptr};
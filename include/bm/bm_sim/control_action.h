@@ -44,6 +44,10 @@ class ControlAction : public ControlFlowNode {
 
   const ControlFlowNode *operator()(Packet *pkt) const override;
 
+  const ControlFlowNode *get_out_edge(int edge) const override {
+    return (edge == 0) ? next_node : nullptr;
+  }
+
  private:
   ControlFlowNode *next_node{nullptr};
   ActionFn *action;
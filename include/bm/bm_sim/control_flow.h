@@ -40,6 +40,29 @@ class ControlFlowNode : public NamedP4Object {
       : NamedP4Object(name, id, std::move(source_info)) {}
   virtual ~ControlFlowNode() { }
   virtual const ControlFlowNode *operator()(Packet *pkt) const = 0;
+
+  // FlexCore: pipelines do not follow the next node pointers of the nodes
+  // directly, but the edges of the last published ControlFlowGraph (see
+  // control_flow_graph.h), which are copied from the next node pointers.
+
+  // Applies the node to the packet and returns the index of the out-edge to
+  // follow. The default implementation is for nodes with a single out-edge.
+  virtual int apply_edge(Packet *pkt) const {
+    (*this)(pkt);
+    return 0;
+  }
+
+  // Returns the next node for the given out-edge (0 or 1), or nullptr.
+  virtual const ControlFlowNode *get_out_edge(int edge) const {
+    (void) edge;
+    return nullptr;
+  }
+
+  size_t get_cfg_slot() const { return cfg_slot; }
+  void set_cfg_slot(size_t slot) { cfg_slot = slot; }
+
+ private:
+  size_t cfg_slot{0};
 };
 
 }  // namespace bm
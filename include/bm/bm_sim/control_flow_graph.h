@@ -0,0 +1,125 @@
+/* Copyright 2013-present Barefoot Networks, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//! @file control_flow_graph.h
+
+#ifndef BM_BM_SIM_CONTROL_FLOW_GRAPH_H_
+#define BM_BM_SIM_CONTROL_FLOW_GRAPH_H_
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "control_flow.h"
+#include "published_ptr.h"
+
+namespace bm {
+
+class Pipeline;
+
+// FlexCore: immutable snapshot of the edges of a control flow graph, which is
+// what packets follow. Nodes and pipelines are identified by the slot they were
+// given by VersionedControlFlowGraph.
+class ControlFlowGraph {
+ public:
+  static constexpr int max_out_edges = 2;
+
+  const ControlFlowNode *get_next_node(const ControlFlowNode *node,
+                                       int edge) const {
+    return edges[node->get_cfg_slot()][edge];
+  }
+
+  const ControlFlowNode *get_first_node(size_t pipeline_slot) const {
+    return first_nodes[pipeline_slot];
+  }
+
+  uint64_t get_version() const { return version; }
+
+ private:
+  friend class VersionedControlFlowGraph;
+
+  using Edges = std::array<const ControlFlowNode *, max_out_edges>;
+
+  std::vector<Edges> edges{};
+  std::vector<const ControlFlowNode *> first_nodes{};
+  uint64_t version{0};
+};
+
+// FlexCore: the control flow graph of a P4Objects instance. Runtime
+// reconfiguration still edits the next node pointers of the nodes and the first
+// node of the pipelines, but packets only see these edits once publish() is
+// called: it builds a new ControlFlowGraph aside and makes it current with a
+// single atomic pointer swap. This way, all the edits of a plan become visible
+// at once and a packet never walks a half-wired graph.
+// A packet keeps the snapshot it started a pipeline with. Packet threads
+// register in the current epoch for the duration of a pipeline (see read() and
+// PublishedPtr); publish() moves to the next epoch and waits for the packets of
+// the previous one to be done before releasing the previous snapshot, as well
+// as the nodes which were deleted since the last publish() (see retire()).
+// Packets are never stalled.
+// Apart from read(), methods are not thread-safe and are meant to be called by
+// the control plane with the Context request lock held.
+class VersionedControlFlowGraph {
+ public:
+  using ReadGuard = PublishedPtr<ControlFlowGraph>::ReadGuard;
+
+  VersionedControlFlowGraph() = default;
+
+  // Returns the current snapshot, which remains valid (and so do the nodes it
+  // references) as long as the guard exists. Called by the packet threads, once
+  // per pipeline. publish() has to have been called at least once.
+  ReadGuard read() const;
+
+  void add_node(ControlFlowNode *node);
+  // the node is no longer part of the graph at the next publish(), but packets
+  // may still use it until then, see retire()
+  void remove_node(ControlFlowNode *node);
+
+  // returns the slot of the pipeline
+  size_t add_pipeline(const Pipeline *pipeline);
+
+  // Keeps the object alive until no packet can be using it, i.e. until the next
+  // call to publish() returns.
+  template <typename T>
+  void retire(std::unique_ptr<T> object) {
+    retired.emplace_back(std::move(object));
+  }
+
+  // Builds a new snapshot from the current next node pointers and makes it
+  // current. Returns once the previous snapshot is no longer used by any
+  // packet, which only takes as long as the packets in flight take to exit
+  // their pipeline.
+  void publish();
+
+  // number of snapshots published so far, also the version of the current one
+  uint64_t get_version() const;
+
+  VersionedControlFlowGraph(const VersionedControlFlowGraph &other) = delete;
+  VersionedControlFlowGraph &operator=(
+      const VersionedControlFlowGraph &other) = delete;
+
+ private:
+  std::vector<ControlFlowNode *> nodes{};
+  std::vector<size_t> free_slots{};
+  std::vector<const Pipeline *> pipelines{};
+  PublishedPtr<ControlFlowGraph> current{};
+  std::vector<std::shared_ptr<void> > retired{};
+};
+
+}  // namespace bm
+
+#endif  // BM_BM_SIM_CONTROL_FLOW_GRAPH_H_
@@ -23,12 +23,14 @@
 #ifndef BM_BM_SIM_DATA_H_
 #define BM_BM_SIM_DATA_H_
 
+#include <algorithm>  // for std::min
 #include <iosfwd>
 #include <string>
 #include <type_traits>
 #include <utility>
 #include <vector>
 
+#include <cstdint>
 #include <cstring>
 #include <cassert>
 
@@ -53,9 +55,14 @@ using bignum::Bignum;
 //! d1.add(d1, d2);  // d1 = d1 + d2
 //! @endcode
 //!
-//! Note that Data includes a Bignum (for arbitrary arithmetic). Therefore,
-//! operations involving Data can be rather costly. In particular, constructing
-//! a Data instance involves a heap memory allocation.
+//! Non-negative values which fit in 64 bits (i.e. the vast majority of P4
+//! values) are stored in a `uint64_t` and the operations on them do not
+//! involve the Bignum at all. Other values (negative values, or values wider
+//! than 64 bits) are stored in a Bignum (for arbitrary arithmetic), which makes
+//! operations on them more costly. Switching from one representation to the
+//! other is transparent to the user and happens when an operation needs it
+//! (e.g. when an addition overflows or when a subtraction yields a negative
+//! result).
 class Data {
  public:
   Data() {}
@@ -63,12 +70,13 @@ class Data {
   //! Constructs a Data instance from any integral type
   template<typename T,
            typename std::enable_if<std::is_integral<T>::value, int>::type = 0>
-  explicit Data(T i)
-    : value(i) {}
+  explicit Data(T i) {
+    set_integral(i);
+  }
 
   //! Constructs a Data instance from a byte array. There is no sign support.
   Data(const char *bytes, int nbytes) {
-    bignum::import_bytes(&value, bytes, nbytes);
+    load_bytes(bytes, nbytes);
   }
 
   virtual ~Data() { }
@@ -96,14 +104,16 @@ class Data {
 
   //! Returns a value less than zero if Data is negative, a value greater than
   //! zero if Data is positive, and zero if Data is zero.
-  int sign() const { return value.sign(); }
+  int sign() const {
+    return use_u64 ? (value_u64 != 0) : value.sign();
+  }
 
   // TODO(Antonin): need to figure out what to do with signed values
   //! Set the value of Data from any integral type
   template<typename T,
            typename std::enable_if<std::is_integral<T>::value, int>::type = 0>
   void set(T i) {
-    value = i;
+    set_integral(i);
     export_bytes();
   }
 
@@ -111,29 +121,37 @@ class Data {
   template<typename T,
            typename std::enable_if<std::is_enum<T>::value, int>::type = 0>
   void set(T i) {
-    value = static_cast<int>(i);
+    set_integral(static_cast<int>(i));
     export_bytes();
   }
 
   //! Set the value of Data from a byte array
   void set(const char *bytes, int nbytes) {
-    bignum::import_bytes(&value, bytes, nbytes);
+    load_bytes(bytes, nbytes);
     export_bytes();
   }
 
   //! Set the value of Data from another data instance
   void set(const Data &data) {
-    value = data.value;
+    use_u64 = data.use_u64;
+    if (use_u64)
+      value_u64 = data.value_u64;
+    else
+      value = data.value;
     export_bytes();
   }
 
   void set(Data &&data) {
-    value = std::move(data.value);
+    use_u64 = data.use_u64;
+    if (use_u64)
+      value_u64 = data.value_u64;
+    else
+      value = std::move(data.value);
     export_bytes();
   }
 
   void set(const ByteContainer &bc) {
-    bignum::import_bytes(&value, bc.data(), bc.size());
+    load_bytes(bc.data(), bc.size());
     export_bytes();
   }
 
@@ -175,8 +193,12 @@ class Data {
       bytes.push_back(c);
     }
 
-    bignum::import_bytes(&value, bytes.data(), bytes.size());
-    if (neg) value = -value;
+    load_bytes(bytes.data(), bytes.size());
+    if (neg) {
+      to_bignum();
+      value = -value;
+      bignum_updated();
+    }
     export_bytes();  // not very efficient for fields, we import then export...
   }
 
@@ -185,31 +207,39 @@ class Data {
            typename std::enable_if<std::is_integral<T>::value, int>::type = 0>
   T get() const {
     assert(arith);
-    return value.convert_to<typename std::remove_const<T>::type>();
+    using U = typename std::remove_const<T>::type;
+    if (use_u64) return static_cast<U>(value_u64);
+    return value.convert_to<U>();
   }
 
   //! Get the value of Data has an unsigned integer
   unsigned int get_uint() const {
-    assert(arith);
-    return value.convert_to<unsigned int>();
+    return get<unsigned int>();
   }
 
   //! Get the value of Data has a `uint64_t`
   uint64_t get_uint64() const {
-    assert(arith);
-    return value.convert_to<uint64_t>();
+    return get<uint64_t>();
   }
 
   //! get the value of Data has an integer
   int get_int() const {
-    assert(arith);
-    return value.convert_to<int>();
+    return get<int>();
   }
 
   //! get the binary representation of Data has a string. There is no sign
   //! support.
   std::string get_string() const {
     assert(arith);
+    if (use_u64) {
+      size_t export_size = 1;
+      while (export_size < sizeof(value_u64) &&
+             (value_u64 >> (8 * export_size)) != 0)
+        export_size++;
+      std::string s(export_size, '\x00');
+      store_bytes(&s[0], export_size, value_u64);
+      return s;
+    }
     const size_t export_size = bignum::export_size_in_bytes(value);
     std::string s(export_size, '\x00');
     // this is not technically correct, but works for all compilers
@@ -219,6 +249,7 @@ class Data {
 
   std::string get_string_repr() const {
     assert(arith);
+    if (use_u64) return std::to_string(value_u64);
     return value.convert_to<std::string>();
   }
 
@@ -229,14 +260,27 @@ class Data {
   //! NC
   void add(const Data &src1, const Data &src2) {
     assert(src1.arith && src2.arith);
-    value = src1.value + src2.value;
+    if (src1.use_u64 && src2.use_u64 &&
+        src1.value_u64 + src2.value_u64 >= src1.value_u64) {
+      set_u64(src1.value_u64 + src2.value_u64);
+    } else {
+      Bignum tmp1, tmp2;
+      value = src1.as_bignum(&tmp1) + src2.as_bignum(&tmp2);
+      bignum_updated();
+    }
     export_bytes();
   }
 
   //! NC
   void sub(const Data &src1, const Data &src2) {
     assert(src1.arith && src2.arith);
-    value = src1.value - src2.value;
+    if (src1.use_u64 && src2.use_u64 && src1.value_u64 >= src2.value_u64) {
+      set_u64(src1.value_u64 - src2.value_u64);
+    } else {
+      Bignum tmp1, tmp2;
+      value = src1.as_bignum(&tmp1) - src2.as_bignum(&tmp2);
+      bignum_updated();
+    }
     export_bytes();
   }
 
@@ -244,8 +288,14 @@ class Data {
   //! and \p src2 > 0.
   void mod(const Data &src1, const Data &src2) {
     assert(src1.arith && src2.arith);
-    assert(src1.value >= 0 && src2.value > 0);
-    value = src1.value % src2.value;
+    assert(src1.sign() >= 0 && src2.sign() > 0);
+    if (src1.use_u64 && src2.use_u64) {
+      set_u64(src1.value_u64 % src2.value_u64);
+    } else {
+      Bignum tmp1, tmp2;
+      value = src1.as_bignum(&tmp1) % src2.as_bignum(&tmp2);
+      bignum_updated();
+    }
     export_bytes();
   }
 
@@ -253,73 +303,121 @@ class Data {
   //! 0 and \p src2 > 0.
   void divide(const Data &src1, const Data &src2) {
     assert(src1.arith && src2.arith);
-    assert(src1.value >= 0 && src2.value > 0);
-    value = src1.value / src2.value;
+    assert(src1.sign() >= 0 && src2.sign() > 0);
+    if (src1.use_u64 && src2.use_u64) {
+      set_u64(src1.value_u64 / src2.value_u64);
+    } else {
+      Bignum tmp1, tmp2;
+      value = src1.as_bignum(&tmp1) / src2.as_bignum(&tmp2);
+      bignum_updated();
+    }
     export_bytes();
   }
 
   //! NC
   void multiply(const Data &src1, const Data &src2) {
     assert(src1.arith && src2.arith);
-    value = src1.value * src2.value;
+    // the product of 2 32-bit values cannot overflow
+    if (src1.use_u64 && src2.use_u64 &&
+        ((src1.value_u64 | src2.value_u64) >> 32) == 0) {
+      set_u64(src1.value_u64 * src2.value_u64);
+    } else {
+      Bignum tmp1, tmp2;
+      value = src1.as_bignum(&tmp1) * src2.as_bignum(&tmp2);
+      bignum_updated();
+    }
     export_bytes();
   }
 
   //! NC
   void shift_left(const Data &src1, const Data &src2) {
     assert(src1.arith && src2.arith);
-    assert(src2.value >= 0);
-    value = src1.value << (src2.get_uint());
-    export_bytes();
+    assert(src2.sign() >= 0);
+    shift_left(src1, src2.get_uint());
   }
 
   //! NC
   void shift_right(const Data &src1, const Data &src2) {
     assert(src1.arith && src2.arith);
-    assert(src2.value >= 0);
-    value = src1.value >> (src2.get_uint());
-    export_bytes();
+    assert(src2.sign() >= 0);
+    shift_right(src1, src2.get_uint());
   }
 
   //! NC
   void shift_left(const Data &src1, unsigned int src2) {
     assert(src1.arith);
-    value = src1.value << src2;
+    if (src1.use_u64 && src1.value_u64 == 0) {
+      set_u64(0);
+    } else if (src1.use_u64 && src2 < 64 &&
+               ((src1.value_u64 >> (63 - src2)) >> 1) == 0) {
+      set_u64(src1.value_u64 << src2);
+    } else {
+      Bignum tmp;
+      value = src1.as_bignum(&tmp) << src2;
+      bignum_updated();
+    }
     export_bytes();
   }
 
   //! NC
   void shift_right(const Data &src1, unsigned int src2) {
     assert(src1.arith);
-    value = src1.value >> src2;
+    if (src1.use_u64) {
+      set_u64((src2 < 64) ? (src1.value_u64 >> src2) : 0);
+    } else {
+      value = src1.value >> src2;
+      bignum_updated();
+    }
     export_bytes();
   }
 
   //! NC
   void bit_and(const Data &src1, const Data &src2) {
     assert(src1.arith && src2.arith);
-    value = src1.value & src2.value;
+    if (src1.use_u64 && src2.use_u64) {
+      set_u64(src1.value_u64 & src2.value_u64);
+    } else {
+      Bignum tmp1, tmp2;
+      value = src1.as_bignum(&tmp1) & src2.as_bignum(&tmp2);
+      bignum_updated();
+    }
     export_bytes();
   }
 
   //! NC
   void bit_or(const Data &src1, const Data &src2) {
     assert(src1.arith && src2.arith);
-    value = src1.value | src2.value;
+    if (src1.use_u64 && src2.use_u64) {
+      set_u64(src1.value_u64 | src2.value_u64);
+    } else {
+      Bignum tmp1, tmp2;
+      value = src1.as_bignum(&tmp1) | src2.as_bignum(&tmp2);
+      bignum_updated();
+    }
     export_bytes();
   }
 
   //! NC
   void bit_xor(const Data &src1, const Data &src2) {
     assert(src1.arith && src2.arith);
-    value = src1.value ^ src2.value;
+    if (src1.use_u64 && src2.use_u64) {
+      set_u64(src1.value_u64 ^ src2.value_u64);
+    } else {
+      Bignum tmp1, tmp2;
+      value = src1.as_bignum(&tmp1) ^ src2.as_bignum(&tmp2);
+      bignum_updated();
+    }
     export_bytes();
   }
 
   //! NC
   void bit_neg(const Data &src) {
     assert(src.arith);
-    value = ~src.value;
+    // the result is always negative, it is up to the destination (e.g. Field)
+    // to mask it
+    Bignum tmp;
+    value = ~src.as_bignum(&tmp);
+    bignum_updated();
     export_bytes();
   }
 
@@ -328,16 +426,26 @@ class Data {
   void two_comp_mod(const Data &src, const Data &width) {
     static const Bignum one(1);
     unsigned int uwidth = width.get_uint();
+    // fast path: non-negative value which is already in range
+    if (src.use_u64 && uwidth > 0 && uwidth <= 64 &&
+        src.value_u64 <= (u64_mask(uwidth) >> 1)) {
+      set_u64(src.value_u64);
+      export_bytes();
+      return;
+    }
+    Bignum tmp;
+    const Bignum &src_value = src.as_bignum(&tmp);
     Bignum mask = (one << uwidth) - 1;
     Bignum max = (one << (uwidth - 1)) - 1;
     Bignum min = -(one << (uwidth - 1));
-    if (src.value < min || src.value > max) {
-      value = src.value & mask;
+    if (src_value < min || src_value > max) {
+      value = src_value & mask;
       if (value > max)
         value -= (one << uwidth);
     } else {
-      value = src.value;
+      value = src_value;
     }
+    bignum_updated();
     export_bytes();
   }
 
@@ -347,6 +455,11 @@ class Data {
   void usat_cast(const Data &src, const Data &width) {
     static const Bignum one(1);
     unsigned int uwidth = width.get_uint();
+    if (src.use_u64) {
+      set_u64(std::min(src.value_u64, u64_mask(uwidth)));
+      export_bytes();
+      return;
+    }
     Bignum max = (one << uwidth) - 1;
     if (src.value > max)
       value = max;
@@ -354,6 +467,7 @@ class Data {
       value = 0;
     else
       value = src.value;
+    bignum_updated();
     export_bytes();
   }
 
@@ -363,14 +477,22 @@ class Data {
   void sat_cast(const Data &src, const Data &width) {
     static const Bignum one(1);
     unsigned int uwidth = width.get_uint();
+    if (src.use_u64 && uwidth > 0) {
+      set_u64(std::min(src.value_u64, u64_mask(uwidth - 1)));
+      export_bytes();
+      return;
+    }
+    Bignum tmp;
+    const Bignum &src_value = src.as_bignum(&tmp);
     Bignum max = (one << (uwidth - 1)) - 1;
     Bignum min = -(one << (uwidth - 1));
-    if (src.value > max)
+    if (src_value > max)
       value = max;
-    else if (src.value < min)
+    else if (src_value < min)
       value = min;
     else
-      value = src.value;
+      value = src_value;
+    bignum_updated();
     export_bytes();
   }
 
@@ -378,12 +500,26 @@ class Data {
   template<typename T,
            typename std::enable_if<std::is_integral<T>::value, int>::type = 0>
   bool test_eq(T i) const {
+    if (use_u64)
+      return !is_negative(i) && value_u64 == static_cast<uint64_t>(i);
     return (value == i);
   }
 
+  //! NC
+  // used by compiled expressions, returns false if the value is negative or
+  // does not fit in 64 bits
+  bool get_if_u64(uint64_t *v) const {
+    if (!use_u64) return false;
+    *v = value_u64;
+    return true;
+  }
+
   //! NC
   friend bool operator==(const Data &lhs, const Data &rhs) {
     assert(lhs.arith && rhs.arith);
+    // the representation is canonical, see bignum_updated()
+    if (lhs.use_u64 != rhs.use_u64) return false;
+    if (lhs.use_u64) return lhs.value_u64 == rhs.value_u64;
     return lhs.value == rhs.value;
   }
 
@@ -396,31 +532,42 @@ class Data {
   //! NC
   friend bool operator>(const Data &lhs, const Data &rhs) {
     assert(lhs.arith && rhs.arith);
-    return lhs.value > rhs.value;
+    if (lhs.use_u64 && rhs.use_u64) return lhs.value_u64 > rhs.value_u64;
+    Bignum tmp1, tmp2;
+    return lhs.as_bignum(&tmp1) > rhs.as_bignum(&tmp2);
   }
 
   //! NC
   friend bool operator>=(const Data &lhs, const Data &rhs) {
     assert(lhs.arith && rhs.arith);
-    return lhs.value >= rhs.value;
+    if (lhs.use_u64 && rhs.use_u64) return lhs.value_u64 >= rhs.value_u64;
+    Bignum tmp1, tmp2;
+    return lhs.as_bignum(&tmp1) >= rhs.as_bignum(&tmp2);
   }
 
   //! NC
   friend bool operator<(const Data &lhs, const Data &rhs) {
     assert(lhs.arith && rhs.arith);
-    return lhs.value < rhs.value;
+    if (lhs.use_u64 && rhs.use_u64) return lhs.value_u64 < rhs.value_u64;
+    Bignum tmp1, tmp2;
+    return lhs.as_bignum(&tmp1) < rhs.as_bignum(&tmp2);
   }
 
   //! NC
   friend bool operator<=(const Data &lhs, const Data &rhs) {
     assert(lhs.arith && rhs.arith);
-    return lhs.value <= rhs.value;
+    if (lhs.use_u64 && rhs.use_u64) return lhs.value_u64 <= rhs.value_u64;
+    Bignum tmp1, tmp2;
+    return lhs.as_bignum(&tmp1) <= rhs.as_bignum(&tmp2);
   }
 
   //! NC
   friend std::ostream& operator<<(std::ostream &out, const Data &d) {
     assert(d.arith);
-    out << d.value;
+    if (d.use_u64)
+      out << d.value_u64;
+    else
+      out << d.value;
     return out;
   }
 
@@ -428,7 +575,12 @@ class Data {
   //! NC
   Data(const Data &other)
     : arith(other.arith) {
-    if (other.arith) value = other.value;
+    if (!other.arith) return;
+    use_u64 = other.use_u64;
+    if (use_u64)
+      value_u64 = other.value_u64;
+    else
+      value = other.value;
   }
 
   // Copy assignment operator
@@ -446,8 +598,94 @@ class Data {
   Data &operator=(Data &&other) = default;
 
  protected:
+  // stores the nbytes bytes (big-endian) in the uint64_t representation if
+  // possible, and in the Bignum otherwise
+  void load_bytes(const char *bytes, size_t nbytes) {
+    // leading zero bytes do not change the value
+    while (nbytes > sizeof(value_u64) && *bytes == 0) {
+      bytes++;
+      nbytes--;
+    }
+    if (nbytes > sizeof(value_u64)) {
+      bignum::import_bytes(&value, bytes, nbytes);
+      use_u64 = false;
+      return;
+    }
+    uint64_t v = 0;
+    for (size_t i = 0; i < nbytes; i++)
+      v = (v << 8) | static_cast<unsigned char>(bytes[i]);
+    set_u64(v);
+  }
+
+  // writes v in big-endian order to the nbytes bytes of dst; the caller has to
+  // make sure that v fits
+  static void store_bytes(char *dst, size_t nbytes, uint64_t v) {
+    for (size_t i = nbytes; i > 0; i--) {
+      dst[i - 1] = static_cast<char>(v & 0xff);
+      v >>= 8;
+    }
+  }
+
+  // mask for the nbits least significant bits
+  static uint64_t u64_mask(unsigned int nbits) {
+    return (nbits >= 64) ? ~static_cast<uint64_t>(0) :
+        ((static_cast<uint64_t>(1) << nbits) - 1);
+  }
+
+  void set_u64(uint64_t v) {
+    value_u64 = v;
+    use_u64 = true;
+  }
+
+  // returns a reference to the value as a Bignum, tmp is used if the value is
+  // stored as a uint64_t
+  const Bignum &as_bignum(Bignum *tmp) const {
+    if (!use_u64) return value;
+    *tmp = value_u64;
+    return *tmp;
+  }
+
+  // switches to the Bignum representation, before modifying value in place
+  void to_bignum() {
+    if (!use_u64) return;
+    value = value_u64;
+    use_u64 = false;
+  }
+
+  // has to be called after value was updated, to switch back to the uint64_t
+  // representation if possible; this keeps the representation canonical
+  void bignum_updated() {
+    use_u64 = bignum::fits_uint64(value);
+    if (use_u64) value_u64 = value.convert_to<uint64_t>();
+  }
+
+  // the value is in value_u64 if use_u64 is true, in value otherwise
   Bignum value{0};
+  uint64_t value_u64{0};
+  bool use_u64{true};
   bool arith{true};
+
+ private:
+  template <typename T>
+  static bool is_negative(T i, std::true_type) { return i < 0; }
+
+  template <typename T>
+  static bool is_negative(T, std::false_type) { return false; }
+
+  template <typename T>
+  static bool is_negative(T i) {
+    return is_negative(i, std::is_signed<T>());
+  }
+
+  template <typename T>
+  void set_integral(T i) {
+    if (is_negative(i)) {
+      value = i;
+      use_u64 = false;
+    } else {
+      set_u64(static_cast<uint64_t>(i));
+    }
+  }
 };
 
 }  // namespace bm
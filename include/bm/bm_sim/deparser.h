@@ -75,6 +75,8 @@ class Deparser : public NamedP4Object {
  private:
   size_t get_headers_size(const PHV &phv) const;
 
+  bool deparse_in_place(Packet *pkt) const;
+
   void update_checksums(Packet *pkt) const;
 
  private:
@@ -102,11 +102,18 @@ class DevMgrIface : public PacketDispatcherIface {
     transmit_fn_(port_num, buffer, len);
   }
 
+  void transmit_burst(const BurstPacket *packets, size_t count) {
+    transmit_burst_(packets, count);
+  }
+
   // start the thread that performs packet processing
   void start();
 
   ReturnCode set_packet_handler(const PacketHandler &handler, void *cookie);
 
+  ReturnCode set_burst_handler(const BurstHandler &handler, size_t max_burst,
+                               void *cookie) override;
+
   bool port_is_up(port_t port_num) const;
 
   ReturnCode register_status_cb(const PortStatus &type,
@@ -129,11 +136,18 @@ class DevMgrIface : public PacketDispatcherIface {
 
   virtual void transmit_fn_(port_t port_num, const char *buffer, int len) = 0;
 
+  // default implementation calls transmit_fn_ for each packet
+  virtual void transmit_burst_(const BurstPacket *packets, size_t count);
+
   virtual void start_() = 0;
 
   virtual ReturnCode set_packet_handler_(const PacketHandler &handler,
                                          void *cookie) = 0;
 
+  // default implementation returns UNSUPPORTED
+  virtual ReturnCode set_burst_handler_(const BurstHandler &handler,
+                                        size_t max_burst, void *cookie);
+
   virtual bool port_is_up_(port_t port_num) const = 0;
 
   virtual std::map<port_t, PortInfo> get_port_info_() const = 0;
@@ -198,9 +212,25 @@ class DevMgr : public PacketDispatcherIface {
   //! Transmits a data packet out of port \p port_num
   void transmit_fn(port_t port_num, const char *buffer, int len);
 
+  //! Transmits \p count data packets, each one out of its own port. Backends
+  //! which support it send the whole burst at once (e.g. while holding their
+  //! port lock only once).
+  void transmit_burst(const BurstPacket *packets, size_t count);
+
   ReturnCode set_packet_handler(const PacketHandler &handler, void *cookie)
       override;
 
+  //! If supported by the backend, received packets are handed to \p handler
+  //! in bursts of up to \p max_burst packets. The packet handler is still
+  //! required and used by backends which do not support bursts.
+  ReturnCode set_burst_handler(const BurstHandler &handler, size_t max_burst,
+                               void *cookie) override;
+
+  //! Maximum number of packets per burst, as set by a successful call to
+  //! set_burst_handler(); 1 if the backend does not receive packets in bursts.
+  //! Targets can use it to size their transmit bursts.
+  size_t get_burst_size() const { return burst_size; }
+
   //! Register a callback function to be called every time the status of a port
   //! changes.
   ReturnCode register_status_cb(const PortStatus &type,
@@ -225,6 +255,7 @@ class DevMgr : public PacketDispatcherIface {
   int max_port_count;
 
  private:
+  size_t burst_size{1};
   // Actual implementation (private)
   std::unique_ptr<DevMgrIface> pimp{nullptr};
 };
@@ -22,6 +22,7 @@
 #ifndef BM_BM_SIM_EXPRESSIONS_H_
 #define BM_BM_SIM_EXPRESSIONS_H_
 
+#include <memory>
 #include <unordered_map>
 #include <string>
 #include <vector>
@@ -38,6 +39,7 @@ class RegisterArray;
 class RegisterSync;
 
 struct ExpressionTemps;
+class CompiledExpression;
 
 enum class ExprOpcode {
   LOAD_FIELD, LOAD_HEADER, LOAD_HEADER_STACK, LOAD_LAST_HEADER_STACK_FIELD,
@@ -180,6 +182,14 @@ class Expression {
 
   bool empty() const;
 
+  // whether build() compiled the expression into a specialized
+  // evaluator, see expression_compiler.h
+  bool is_compiled() const;
+
+  // compilation is enabled by default; disabling it only affects the
+  // expressions built afterwards and is meant for testing and benchmarking
+  static void set_compilation_enabled(bool enabled);
+
   // I am authorizing copy for this object
   Expression(const Expression &other) = default;
   Expression &operator=(const Expression &other) = default;
@@ -200,6 +210,8 @@ class Expression {
   std::vector<Data> const_values{};
   int data_registers_cnt{0};
   bool built{false};
+  // shared by the copies of the expression, since it is immutable
+  std::shared_ptr<const CompiledExpression> compiled{};
 
   friend class VLHeaderExpression;
 };
@@ -25,7 +25,7 @@
 
 #include <bm/config.h>
 
-#include <algorithm>  // for std::copy
+#include <algorithm>  // for std::copy, std::min
 
 #include <cassert>
 
@@ -63,16 +63,19 @@ class Field : public Data {
   void set_bytes(const char *src_bytes, int len) {
     assert(len == nbytes);
     std::copy(src_bytes, src_bytes + len, bytes.begin());
+    mark_modified();
     if (arith) sync_value();
   }
 
   void sync_value() {
-    bignum::import_bytes(&value, bytes.data(), nbytes);
-    if (is_signed && bignum::test_bit(value, nbits - 1)) {
+    load_bytes(bytes.data(), nbytes);
+    if (is_signed && sign_bit_set()) {
+      to_bignum();
       bignum::clear_bit(&value, nbits - 1);
       value += min;
     }
     written_to = true;
+    mark_modified();
     // TODO(antonin): should notifications be disabled for hidden fields?
     DEBUGGER_NOTIFY_UPDATE(*packet_id, my_id, bytes.data(), nbits);
   }
@@ -101,6 +104,22 @@ class Field : public Data {
   bool get_arith_flag() const { return arith; }
 
   void export_bytes() override {
+    // fast path, for non-negative values which fit in 64 bits; the Bignum
+    // members (mask, min, max) are not needed in this case
+    if (use_u64 && !is_signed) {
+      const uint64_t mask_u64 = u64_mask(nbits);
+      if (is_saturating)
+        value_u64 = std::min(value_u64, mask_u64);
+      else
+        value_u64 &= mask_u64;
+      store_bytes(bytes.data(), nbytes, value_u64);
+      written_to = true;
+      mark_modified();
+      DEBUGGER_NOTIFY_UPDATE(*packet_id, my_id, bytes.data(), nbits);
+      return;
+    }
+
+    to_bignum();
     std::fill(bytes.begin(), bytes.end(), 0);  // very important !
 
     if (is_saturating) {
@@ -126,7 +145,9 @@ class Field : public Data {
         bignum::export_bytes(bytes.data(), nbytes, value - min - min);
       }
     }
+    bignum_updated();
     written_to = true;
+    mark_modified();
     DEBUGGER_NOTIFY_UPDATE(*packet_id, my_id, bytes.data(), nbits);
   }
 
@@ -136,6 +157,21 @@ class Field : public Data {
   // returns the number of bits extracted
   int extract(const char *data, int hdr_offset);
 
+  // same as extract(), for a field of at most 64 bits whose value was
+  // already read from the packet by the caller (see Header::extract())
+  void extract_u64(uint64_t v) {
+    store_bytes(bytes.data(), nbytes, v);
+    mark_modified();
+    if (!arith) return;
+    if (is_signed) {
+      sync_value();
+      return;
+    }
+    set_u64(v);
+    written_to = true;
+    DEBUGGER_NOTIFY_UPDATE(*packet_id, my_id, bytes.data(), nbits);
+  }
+
   int extract_VL(const char *data, int hdr_offset, int computed_nbits);
 
   // returns the number of bits deparsed
@@ -178,7 +214,24 @@ class Field : public Data {
     return written_to;
   }
 
+  //! Set the bit of \p flags which is set every time the bytes of the field
+  //! are written. The parent header uses it to know which of its fields were
+  //! modified since it was extracted (see Header::is_modified()).
+  void set_modified_flag(uint64_t *flags, uint64_t bit) {
+    modified_flags = flags;
+    modified_bit = bit;
+  }
+
  private:
+  void mark_modified() {
+    if (modified_flags) *modified_flags |= modified_bit;
+  }
+
+  bool sign_bit_set() const {
+    if (!use_u64) return bignum::test_bit(value, nbits - 1);
+    return (nbits > 0 && nbits <= 64) && ((value_u64 >> (nbits - 1)) & 1);
+  }
+
   int nbits;
   int nbytes;
   ByteContainer bytes;
@@ -188,6 +241,8 @@ class Field : public Data {
   bool VL{false};
   bool is_saturating{false};
   bool written_to{false};  // used to keep track of whether a field was modified
+  uint64_t *modified_flags{nullptr};
+  uint64_t modified_bit{0};
   Bignum mask{1};
   Bignum max{1};
   Bignum min{1};
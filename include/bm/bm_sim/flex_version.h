@@ -0,0 +1,130 @@
+/* Copyright 2013-present Barefoot Networks, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//! @file flex_version.h
+
+#ifndef BM_BM_SIM_FLEX_VERSION_H_
+#define BM_BM_SIM_FLEX_VERSION_H_
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace bm {
+
+// FlexCore: the program version packets are processed with, i.e. the value the
+// flex_start parse state writes to flexMetadata.version and which FlexEdges
+// branch on (0 for the old program, 1 for the new one).
+// The whole switching state (current version, pending switch) is a single
+// 64-bit word, so assign() reads it with one atomic load and the control plane
+// replaces it with one atomic store: packets are never stalled and every packet
+// sees either the state before or the state after a switch. A switch can be
+// immediate (set()) or scheduled at a given packet number or ingress timestamp,
+// in which case each packet decides which side of the cut it is on. The
+// packets which are going through flex_start when a switch is published may
+// land on either side of it, whatever the schedule.
+// Packets are counted per version as they go through flex_start, which is what
+// the transition can be measured with. The counters are sharded between the
+// parser threads and summed when read. Packets are only numbered, with a
+// single shared counter, while a switch is scheduled at a packet number.
+// assign() and the getters are thread-safe. The other methods are meant to be
+// called by the control plane with the Context request lock held.
+class FlexVersion {
+ public:
+  using version_t = uint8_t;
+
+  // the old and the new program; set() and the schedule_* methods only accept
+  // versions lower than this
+  static constexpr size_t nb_versions = 2;
+  // largest packet number or timestamp a switch can be scheduled at
+  static constexpr uint64_t max_threshold = (uint64_t(1) << 46) - 1;
+
+  FlexVersion();
+
+  // Called once per packet, with its ingress timestamp (see
+  // Packet::get_ingress_ts_ms()). Returns the version the packet is processed
+  // with and counts the packet for this version.
+  version_t assign(uint64_t ts_ms);
+
+  // Switches to version the packets which go through flex_start from now on.
+  // Cancels the pending switch if any.
+  void set(version_t version);
+
+  // Switches to version the packets seen after get_packet_count() reaches
+  // packet_number. Returns false if it was already reached when the switch was
+  // published. Either way, the packets in flight when the switch is published
+  // may be processed with either version.
+  // Replaces the pending switch if any.
+  bool schedule_at_packet(version_t version, uint64_t packet_number);
+
+  // Switches to version the packets with an ingress timestamp (in ms, see
+  // assign()) of ts_ms or more. Returns false if ts_ms was already in the past
+  // when the switch was published.
+  // Replaces the pending switch if any.
+  bool schedule_at_time(version_t version, uint64_t ts_ms);
+
+  // version of a packet going through flex_start now
+  version_t get_version() const;
+
+  // true if a scheduled switch has not been reached yet
+  bool has_pending_switch() const;
+
+  // number of packets seen so far, which is also the number of the next one
+  uint64_t get_packet_count() const;
+
+  // number of packets processed with this version so far
+  uint64_t get_packet_count(version_t version) const;
+
+ private:
+  enum class Schedule : uint64_t { NONE, AT_PACKET, AT_TIME };
+
+  // bits 0-7: current version, bits 8-15: scheduled version, bits 16-17:
+  // schedule, bits 18-63: sequence number or timestamp of the scheduled switch
+  using state_t = uint64_t;
+
+  // padded to avoid false sharing between threads
+  struct Counters {
+    std::atomic<uint64_t> counts[nb_versions];
+    // packets which were not given a sequence number
+    std::atomic<uint64_t> unsequenced;
+    char padding[64 - (nb_versions + 1) * sizeof(std::atomic<uint64_t>)];
+  };
+
+  static constexpr size_t nb_counter_shards = 16;
+
+  static state_t make_state(version_t current, version_t next,
+                            Schedule schedule, uint64_t threshold);
+  static version_t version_of(state_t state, uint64_t packet_number,
+                              uint64_t ts_ms);
+
+  Counters &get_counters();
+
+  std::atomic<state_t> state{0};
+  // the state is read by every packet but rarely written, so it is kept
+  // away from the sequence number, which is written by every packet while a
+  // switch is scheduled at a packet number
+  char pad_state[64]{};
+  // number of packets which saw a switch scheduled at a packet number; the
+  // threshold of such a switch is a sequence number, and a packet's number is
+  // its sequence number plus the number of unsequenced packets
+  std::atomic<uint64_t> sequence{0};
+  char pad_sequence[64]{};
+  std::array<Counters, nb_counter_shards> counters;
+};
+
+}  // namespace bm
+
+#endif  // BM_BM_SIM_FLEX_VERSION_H_
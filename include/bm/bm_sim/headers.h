@@ -25,6 +25,8 @@
 
 #include <bm/config.h>
 
+#include <algorithm>  // for std::min
+#include <cstdint>
 #include <memory>
 #include <set>
 #include <string>
@@ -43,6 +45,8 @@ class ArithExpression;
 
 class HeaderUnion;
 
+class Checksum;
+
 class HeaderType : public NamedP4Object {
  public:
   // do not specify custome values for enum entries, the value is used directly
@@ -60,6 +64,19 @@ class HeaderType : public NamedP4Object {
     bool is_hidden;
   };
 
+  // position of a (non-hidden) field in the header, when the header
+  // has no VL field. Fields which fit in the 64 bits starting at byte_offset
+  // are read with a single big-endian load, shifted right by shift and masked,
+  // the others with the generic bit-level extraction.
+  struct FieldLayout {
+    int byte_offset;
+    int bit_offset;
+    int nbits;
+    bool fits_u64;
+    int shift;
+    uint64_t mask;
+  };
+
   size_t get_hidden_offset(HiddenF hf) const {
     return fields_info.size() - 1 - static_cast<size_t>(hf);
   }
@@ -134,8 +151,16 @@ class HeaderType : public NamedP4Object {
 
   int get_VL_max_header_bytes() const;
 
+  // one entry per non-hidden field, in order; only valid if the
+  // header has no VL field
+  const std::vector<FieldLayout> &get_layout() const {
+    return layout;
+  }
+
  private:
   std::vector<FInfo> fields_info;
+  std::vector<FieldLayout> layout{};
+  int layout_nbits{0};
   // used for VL headers only
   std::unique_ptr<VLHeaderExpression> VL_expr_raw;
   int VL_offset{-1};
@@ -228,6 +253,38 @@ class Header : public NamedP4Object {
 
   void deparse(char *data) const;
 
+  // the bytes of the header as they were last extracted from the
+  // packet (nullptr for VL headers)
+  const char *get_packet_image() const {
+    return packet_image.empty() ? nullptr : packet_image.data();
+  }
+
+  // true if one of the fields was written since the header was last
+  // extracted
+  bool is_modified() const { return modified != 0; }
+
+  // same for one field; fields beyond the 64th share a flag, so this
+  // may also return true if another one of them was modified
+  bool is_field_modified(int field_offset) const {
+    return (modified & field_modified_bit(field_offset)) != 0;
+  }
+
+  // offset of the header in the bytes removed by the parser from the
+  // packet data, or -1 if the header was not extracted from the packet by the
+  // parser; see Deparser::deparse()
+  int get_packet_offset() const { return packet_offset; }
+
+  void set_packet_offset(int offset) { packet_offset = offset; }
+
+  // checksum of a field of this header which the parser verified
+  // for the values extracted from the packet, or nullptr; see
+  // CalcBasedChecksum
+  const Checksum *get_verified_checksum() const { return verified_checksum; }
+
+  void set_verified_checksum(const Checksum *checksum) {
+    verified_checksum = checksum;
+  }
+
   //! Returns the number of fields in the header
   size_type size() const noexcept { return fields.size(); }
 
@@ -296,6 +353,10 @@ class Header : public NamedP4Object {
   // called by the PHV class
   void set_union_membership(HeaderUnion *header_union, size_t idx);
 
+  static uint64_t field_modified_bit(int field_offset) {
+    return static_cast<uint64_t>(1) << std::min(field_offset, 63);
+  }
+
  private:
   struct UnionMembership {
     UnionMembership(HeaderUnion *header_union, size_t idx);
@@ -314,6 +375,11 @@ class Header : public NamedP4Object {
   Field *valid_field{nullptr};
   bool metadata{false};
   int nbytes_packet{0};
+  std::vector<char> packet_image{};
+  // one bit per non-hidden field
+  uint64_t modified{0};
+  int packet_offset{-1};
+  const Checksum *verified_checksum{nullptr};
   std::unique_ptr<ArithExpression> VL_expr;
   std::unique_ptr<UnionMembership> union_membership{nullptr};
 #ifdef BM_DEBUG_ON
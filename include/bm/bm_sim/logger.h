@@ -112,10 +112,19 @@ class Logger {
 
 }  // namespace bm
 
+// the arguments (packet ids, hex dumps of keys, field names, ...)
+// are only evaluated if the message is going to be logged
+#define BMLOG_IF_ENABLED(level, fn, ...)                            \
+  do {                                                              \
+    auto bm_logger_ = bm::Logger::get();                            \
+    if (bm_logger_->should_log(level)) bm_logger_->fn(__VA_ARGS__); \
+  } while (0)
+
 #ifdef BM_LOG_DEBUG_ON
 //! Preferred way (because can be disabled at compile time) to log a debug
 //! message. Is enabled by preprocessor BM_LOG_DEBUG_ON.
-#define BMLOG_DEBUG(...) bm::Logger::get()->debug(__VA_ARGS__);
+#define BMLOG_DEBUG(...) \
+  BMLOG_IF_ENABLED(spdlog::level::debug, debug, __VA_ARGS__);
 #else
 #define BMLOG_DEBUG(...)
 #endif
@@ -123,7 +132,8 @@ class Logger {
 #ifdef BM_LOG_TRACE_ON
 //! Preferred way (because can be disabled at compile time) to log a trace
 //! message. Is enabled by preprocessor BM_LOG_TRACE_ON.
-#define BMLOG_TRACE(...) bm::Logger::get()->trace(__VA_ARGS__);
+#define BMLOG_TRACE(...) \
+  BMLOG_IF_ENABLED(spdlog::level::trace, trace, __VA_ARGS__);
 #else
 #define BMLOG_TRACE(...)
 #endif
@@ -105,13 +105,27 @@
 #ifndef BM_BM_SIM_LOOKUP_STRUCTURES_H_
 #define BM_BM_SIM_LOOKUP_STRUCTURES_H_
 
+#include <cstdint>
+#include <limits>
 #include <memory>
 
+#include "action_profile.h"
 #include "match_key_types.h"
 #include "bytecontainer.h"
 
 namespace bm {
 
+//! Statistics of the lookup result cache used by some lookup structures
+//! (e.g. the default ones for ternary and range matches).
+struct LookupCacheStats {
+  //! Number of lookup results the cache can hold
+  size_t size{0};
+  uint64_t hits{0};
+  uint64_t misses{0};
+  //! Number of valid cache entries replaced by more recent lookup results
+  uint64_t evictions{0};
+};
+
 //! This class defines an interface for all data structures used
 //! in Match Units to perform lookups. Custom data strucures can
 //! be created by implementing this interface, and creating a
@@ -127,6 +141,15 @@ class LookupStructure {
   virtual bool lookup(const ByteContainer &key_data,
                       internal_handle_t *handle) const = 0;
 
+  //! Look up \p n keys at once, setting `hits[i]` and `handles[i]` like
+  //! lookup() would for `keys[i]`. Some data structures can overlap the memory
+  //! accesses of independent lookups. The default implementation simply calls
+  //! lookup() for each key.
+  virtual void lookup_batch(const ByteContainer *keys, size_t n,
+                            internal_handle_t *handles, bool *hits) const {
+    for (size_t i = 0; i < n; i++) hits[i] = lookup(keys[i], &handles[i]);
+  }
+
   //! Check whether an entry exists. This is distinct from a lookup operation
   //! in that this will also match against the prefix length in the case of
   //! an LPM structure, and against the mask and priority in the case of a
@@ -149,6 +172,21 @@ class LookupStructure {
 
   //! Completely remove all entries from the data structure.
   virtual void clear() = 0;
+
+  //! Retrieve the statistics of the lookup result cache. Returns false if the
+  //! data structure does not have a cache (default).
+  virtual bool get_cache_stats(LookupCacheStats *stats) const {
+    (void) stats;
+    return false;
+  }
+
+  //! Resize the lookup result cache, which also clears it and resets its
+  //! statistics. A size of 0 disables caching. Returns false if the data
+  //! structure does not have a cache (default).
+  virtual bool set_cache_size(size_t size) {
+    (void) size;
+    return false;
+  }
 };
 
 // Convenience alias declarations to simplify the code needed to override
@@ -193,8 +231,44 @@ class LookupStructureFactory {
   virtual std::unique_ptr<RangeLookupStructure>
   create_for_range(size_t size, size_t nbytes_key);
 
+  //! By default, ternary and range lookups scan the list of entries, which is
+  //! fine for small tables but does not scale. Ternary and range tables with a
+  //! size (as declared in the JSON) of at least \p min_size will instead use
+  //! tuple space search: entries are grouped by mask and each group is a hash
+  //! map, so the cost of a lookup depends on the number of distinct masks
+  //! instead of the number of entries. Has no effect on tables which have
+  //! already been created.
+  void set_tuple_space_min_size(size_t min_size);
+
+  //! By default, LPM lookups walk a trie one byte at a time, with a sparse
+  //! array of children in each node. LPM tables with a size (as declared in the
+  //! JSON) of at least \p min_size will instead use a structure in which the
+  //! best match for every key has been precomputed: DIR-24-8 for 32-bit keys
+  //! (e.g. IPv4 routes), which always allocates a 64MB table but takes at most
+  //! 2 memory accesses per lookup, and a compressed multibit trie (Poptrie) for
+  //! other key widths. Has no effect on tables which have already been
+  //! created.
+  void set_multibit_lpm_min_size(size_t min_size);
+
+  //! Create the member selection of an action profile with a selector. By
+  //! default, this returns nullptr and the action profile picks the
+  //! (hash % group size)-th member of the group.
+  virtual std::shared_ptr<ActionProfile::GroupSelectionIface>
+  create_group_selector();
+
+  //! Action profiles with a selector will use resilient hashing with \p
+  //! nb_buckets buckets per group (see bm::ResilientGroupSelection) instead of
+  //! hash % group size, so that adding or removing a member of a group only
+  //! remaps the flows of the buckets which change hands. 0 (the default) keeps
+  //! the default selection. Has no effect on action profiles which have
+  //! already been created.
+  void set_resilient_selector_buckets(size_t nb_buckets);
+
  private:
   bool enable_ternary_cache;
+  size_t tuple_space_min_size{std::numeric_limits<size_t>::max()};
+  size_t multibit_lpm_min_size{std::numeric_limits<size_t>::max()};
+  size_t resilient_selector_buckets{0};
 };
 
 
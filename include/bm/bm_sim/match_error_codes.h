@@ -51,6 +51,7 @@ enum class MatchErrorCode {
   NO_ACTION_PROFILE_SELECTION,
   IMMUTABLE_TABLE_ENTRIES,
   BAD_ACTION_DATA,
+  CACHE_DISABLED,
   ERROR,
 };
 
@@ -111,7 +111,7 @@ class MatchTableAbstract : public NamedP4Object {
   std::unordered_map<p4object_id_t, const ControlFlowNode *> get_next_nodes() 
     { return next_nodes; }
   const ControlFlowNode * get_next_node_hit() { return next_node_hit; }
-  const ControlFlowNode * get_next_node_miss() { return next_node_miss; }
+  const ControlFlowNode * get_next_node_miss() const { return next_node_miss; }
   bool get_has_next_node_hit() { return has_next_node_hit; }
   bool get_has_next_node_miss() { return has_next_node_miss; }
 
@@ -186,6 +186,18 @@ class MatchTableAbstract : public NamedP4Object {
 
   void sweep_entries(std::vector<entry_handle_t> *entries) const;
 
+  //! See MatchUnitAbstract_::get_ttl_updates(), only meant to be called by the
+  //! ageing monitor
+  void get_ttl_updates(std::vector<entry_handle_t> *entries, bool all);
+
+  //! See MatchUnitAbstract_::get_expiry_times()
+  void get_expiry_times(const entry_handle_t *handles, size_t n,
+                        uint64_t *expiry_times_ms) const;
+
+  MatchErrorCode get_cache_stats(LookupCacheStats *stats) const;
+
+  MatchErrorCode set_cache_size(size_t size);
+
   handle_iterator handles_begin() const;
   handle_iterator handles_end() const;
 
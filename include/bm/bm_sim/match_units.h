@@ -289,6 +289,24 @@ class MatchUnitAbstract_ {
 
   void sweep_entries(std::vector<entry_handle_t> *entries) const;
 
+  // Used by the ageing monitor, which keeps track of entry expiry itself
+  // instead of calling sweep_entries(). Appends the entries whose TTL was set
+  // since the last call, or all the entries with a TTL if all is true. The
+  // entries are only recorded once this has been called with all set to true.
+  void get_ttl_updates(std::vector<entry_handle_t> *entries, bool all);
+
+  // For each entry, sets the time (in ms, same clock as Packet::clock) at
+  // which it will expire if it is not hit, or 0 if it has no TTL or if the
+  // handle is no longer valid.
+  void get_expiry_times(const entry_handle_t *handles, size_t n,
+                        uint64_t *expiry_times_ms) const;
+
+  //! See LookupStructure::get_cache_stats()
+  virtual bool get_cache_stats(LookupCacheStats *stats) const;
+
+  //! See LookupStructure::set_cache_size()
+  virtual bool set_cache_size(size_t size);
+
   void dump_key_params(std::ostream *out,
                        const std::vector<MatchKeyParam> &params,
                        int priority = -1) const;
@@ -330,6 +348,9 @@ class MatchUnitAbstract_ {
   HandleMgr handles{};
   MatchKeyBuilder match_key_builder;
   std::vector<MatchUnit::EntryMeta> entry_meta{};
+  // see get_ttl_updates()
+  bool record_ttl_updates{false};
+  std::vector<entry_handle_t> ttl_updates{};
   // non-owning pointer, the meter array still belongs to P4Objects
   MeterArray *direct_meters{nullptr};
 };
@@ -478,6 +499,10 @@ class MatchUnitGeneric : public MatchUnitAbstract<V> {
 
   void reset_state_() override;
 
+  bool get_cache_stats(LookupCacheStats *stats) const override;
+
+  bool set_cache_size(size_t size) override;
+
   MatchUnitLookup lookup_key(const ByteContainer &key) const override;
 
   void serialize_(std::ostream *out) const override;
@@ -170,6 +170,9 @@ class Packet final {
   //! this will point to all the received packet data. After parsing, this will
   //! just be the packet payload. After deparsing, this will be data which needs
   //! to be sent out.
+  //! If the data is shared with clones of the packet, the non-const version
+  //! first makes a private copy of it (see PacketBuffer), so use the const
+  //! version when the data is only read.
   char *data() { return buffer.start(); }
 
   //! @copydoc data
@@ -204,13 +207,56 @@ class Packet final {
     truncated_length = std::min(length, truncated_length);
   }
 
-  char *prepend(size_t bytes) { return buffer.push(bytes); }
+  char *prepend(size_t bytes) {
+    has_parsed_bytes = false;
+    return buffer.push(bytes);
+  }
 
   char *remove(size_t bytes) {
     assert(buffer.get_data_size() >= payload_size + bytes);
+    has_parsed_bytes = false;
     return buffer.pop(bytes);
   }
 
+  //! Same as remove(), but the returned data is read-only, so that it is not
+  //! copied if it is shared with clones of the packet.
+  const char *remove_shared(size_t bytes) {
+    assert(buffer.get_data_size() >= payload_size + bytes);
+    has_parsed_bytes = false;
+    return buffer.pop_shared(bytes);
+  }
+
+  //! Called by the parser to remove the \p bytes it parsed from the packet
+  //! data. These bytes stay in the buffer in front of the data, and as long as
+  //! the data is not moved, restore_parsed() can make them part of the data
+  //! again without copying them. This lets the deparser leave the headers
+  //! which were not modified in place.
+  const char *remove_parsed(size_t bytes) {
+    const char *data = remove_shared(bytes);
+    has_parsed_bytes = true;
+    parsed_bytes = bytes;
+    parsed_data_size = buffer.get_data_size();
+    return data;
+  }
+
+  //! Returns true if the bytes removed by remove_parsed() are still just in
+  //! front of the data, i.e. if prepend() and remove() were not called since
+  //! and the buffer state was not restored to a different one.
+  bool can_restore_parsed() const {
+    return has_parsed_bytes && buffer.get_data_size() == parsed_data_size;
+  }
+
+  size_t get_parsed_bytes() const { return parsed_bytes; }
+
+  //! Makes the bytes removed by remove_parsed() part of the data again. See
+  //! remove_parsed(); this only moves the start of the data, even if the data
+  //! is shared with clones of the packet.
+  void restore_parsed() {
+    assert(can_restore_parsed());
+    has_parsed_bytes = false;
+    buffer.restore_state({parsed_data_size + parsed_bytes});
+  }
+
   //! Get a 64-bit hash of the incoming packet data.
   uint64_t get_signature() const {
     return signature;
@@ -291,6 +337,9 @@ class Packet final {
 
   //! Clone the current packet, along with its PHV. The value of all the fields
   //! (metadata and regular) will remain the same int the clone.
+  //! With all the clone functions, the packet data is not copied: the clone
+  //! shares it with the current packet, and whichever of them modifies it first
+  //! (e.g. when deparsing) gets its own copy, see PacketBuffer::clone_shared().
   Packet clone_with_phv() const;
   //! @copydoc clone_with_phv
   std::unique_ptr<Packet> clone_with_phv_ptr() const;
@@ -325,6 +374,11 @@ class Packet final {
   //! Move assignment operator
   Packet &operator=(Packet &&other) noexcept;
 
+  //! Packet instances allocated on the heap (e.g. by new_packet_ptr() or the
+  //! clone_*_ptr() methods) are recycled through the PacketPool
+  static void *operator new(size_t size);
+  static void operator delete(void *p);
+
   // for tests
   // TODO(antonin): find a better solution, no-one is supposed to use these
   static Packet make_new(PHVSourceIface *phv_source);
@@ -343,8 +397,15 @@ class Packet final {
          copy_id_t copy_id, int ingress_length, PacketBuffer &&buffer,
          PHVSourceIface *phv_source);
 
+  // used by the clone functions: a clone has the signature of the incoming
+  // packet it was cloned from, which saves hashing the packet data again
+  Packet(cxt_id_t cxt_id, port_t ingress_port, packet_id_t id,
+         copy_id_t copy_id, int ingress_length, PacketBuffer &&buffer,
+         PHVSourceIface *phv_source, uint64_t signature);
+
   void update_signature(uint64_t seed = 0);
   void set_ingress_ts();
+  void copy_parsed_bytes(const Packet &src);
 
   cxt_id_t cxt_id{0};
   port_t ingress_port{0};
@@ -364,6 +425,11 @@ class Packet final {
 
   size_t payload_size{0};
 
+  // see remove_parsed()
+  bool has_parsed_bytes{false};
+  size_t parsed_bytes{0};
+  size_t parsed_data_size{0};
+
   size_t truncated_length{std::numeric_limits<size_t>::max()};
 
   clock::time_point ingress_ts{};
@@ -23,11 +23,14 @@
 #ifndef BM_BM_SIM_PACKET_BUFFER_H_
 #define BM_BM_SIM_PACKET_BUFFER_H_
 
+#include <atomic>
 #include <memory>
-#include <algorithm>  // for std::copy
+#include <algorithm>  // for std::copy, std::max
 
 #include <cassert>
 
+#include "packet_pool.h"
+
 namespace bm {
 
 //! This acts as a recipient for the packet data. A PacketBuffer instance will
@@ -45,10 +48,17 @@ namespace bm {
 //! auto packet = new_packet_ptr(port_num, pkt_id++, len,
 //!                              PacketBuffer(2048, buffer, len));
 //! @endcode
+//! The storage for the packet data is obtained from the PacketPool.
+//!
+//! The storage can be shared by several PacketBuffer instances (see
+//! clone_shared()), e.g. by the replicas of a multicast packet, which then
+//! share the packet payload instead of each getting a copy of it. The data is
+//! copied on write: a PacketBuffer whose storage is shared gets its own copy
+//! the first time it is modified, i.e. the first time push() is called or the
+//! data is accessed through a non-const pointer (start(), end()).
 class PacketBuffer {
  public:
   struct state_t {
-    char *head;
     size_t data_size;
   };
 
@@ -58,7 +68,7 @@ class PacketBuffer {
   explicit PacketBuffer(size_t size)
     : size(size),
       data_size(0),
-      buffer(std::unique_ptr<char[]>(new char[size])),
+      buffer(make_storage(size)),
       head(buffer.get() + size) {}
 
   //! Construct a PacketBuffer instance with capacity \p size, and copy the
@@ -77,23 +87,45 @@ class PacketBuffer {
   PacketBuffer(size_t size, const char *data, size_t data_size)
     : size(size),
       data_size(0),
-      buffer(std::unique_ptr<char[]>(new char[size])),
+      buffer(make_storage(size)),
       head(buffer.get() + size) {
     std::copy(data, data + data_size, push(data_size));
   }
 
-  char *start() const { return head; }
+  char *start() {
+    make_private();
+    return head;
+  }
+
+  const char *start() const { return head; }
 
-  char *end() const { return buffer.get() + size; }
+  char *end() {
+    make_private();
+    return buffer.get() + size;
+  }
+
+  const char *end() const { return buffer.get() + size; }
 
   char *push(size_t bytes) {
     assert(data_size + bytes <= size);
+    make_private();
     data_size += bytes;
+    valid_size = std::max(valid_size, data_size);
     head -= bytes;
     return head;
   }
 
   char *pop(size_t bytes) {
+    assert(bytes <= data_size);
+    make_private();
+    data_size -= bytes;
+    head += bytes;
+    return head;
+  }
+
+  //! Same as pop(), but the returned data is read-only, so it does not need to
+  //! be made private if it is shared with another PacketBuffer instance.
+  const char *pop_shared(size_t bytes) {
     assert(bytes <= data_size);
     data_size -= bytes;
     head += bytes;
@@ -101,16 +133,25 @@ class PacketBuffer {
   }
 
   const state_t save_state() const {
-    return {head, data_size};
+    return {data_size};
   }
 
+  // The state is saved as a data size rather than as a pointer, since the data
+  // may have been moved to private storage in the meantime. The bytes which
+  // were popped since the state was saved are still in the buffer, and are
+  // copied along with the data when it is made private.
   void restore_state(const state_t &state) {
-    head = state.head;
+    assert(state.data_size <= valid_size);
     data_size = state.data_size;
+    head = buffer.get() + size - data_size;
   }
 
   size_t get_data_size() const { return data_size; }
 
+  //! Returns true if the storage is currently shared with another PacketBuffer
+  //! instance, i.e. if modifying the data would require copying it.
+  bool is_shared() const { return buffer.use_count() > 1; }
+
   PacketBuffer clone(size_t end_bytes) const {
     assert(end_bytes <= data_size);
     PacketBuffer pb(size);
@@ -118,6 +159,21 @@ class PacketBuffer {
     return pb;
   }
 
+  //! Returns a PacketBuffer with the same data as this one, which shares the
+  //! storage with it instead of copying the data. Each of them gets a private
+  //! copy of the data when it modifies it, as long as the storage is shared.
+  PacketBuffer clone_shared() const {
+    PacketBuffer pb;
+    pb.size = size;
+    pb.data_size = data_size;
+    // the bytes popped by the parser are shared too, so that the clone can
+    // restore them (see Packet::restore_parsed())
+    pb.valid_size = valid_size;
+    pb.buffer = buffer;
+    pb.head = head;
+    return pb;
+  }
+
   PacketBuffer(const PacketBuffer &other) = delete;
   PacketBuffer &operator=(const PacketBuffer &other) = delete;
 
@@ -125,9 +181,62 @@ class PacketBuffer {
   PacketBuffer &operator=(PacketBuffer &&other) /*noexcept*/ = default;
 
  private:
+  struct BufferDeleter {
+    void operator()(char *p) const { PacketPool::release_buffer(p, size); }
+
+    size_t size;
+  };
+
+  // the reference counts of the storage are recycled like Packet instances
+  template <typename T>
+  struct RefCountAllocator {
+    using value_type = T;
+
+    RefCountAllocator() = default;
+    template <typename U>
+    RefCountAllocator(const RefCountAllocator<U> &) { }
+
+    T *allocate(size_t n) {
+      return static_cast<T *>(PacketPool::allocate_packet(n * sizeof(T)));
+    }
+
+    void deallocate(T *p, size_t n) {
+      PacketPool::release_packet(p, n * sizeof(T));
+    }
+
+    template <typename U>
+    bool operator==(const RefCountAllocator<U> &) const { return true; }
+    template <typename U>
+    bool operator!=(const RefCountAllocator<U> &) const { return false; }
+  };
+
+  static std::shared_ptr<char> make_storage(size_t size) {
+    return std::shared_ptr<char>(PacketPool::allocate_buffer(size),
+                                 BufferDeleter{size},
+                                 RefCountAllocator<char>());
+  }
+
+  void make_private() {
+    if (buffer.use_count() <= 1) {
+      // the other owners may have read the data just before releasing it
+      std::atomic_thread_fence(std::memory_order_acquire);
+      return;
+    }
+    auto storage = make_storage(size);
+    char *storage_end = storage.get() + size;
+    std::copy(buffer.get() + size - valid_size, buffer.get() + size,
+              storage_end - valid_size);
+    buffer = std::move(storage);
+    head = storage_end - data_size;
+  }
+
   size_t size{0};
   size_t data_size{0};
-  std::unique_ptr<char[]> buffer{nullptr};
+  // number of bytes at the end of the buffer which hold packet data, including
+  // the bytes popped since, which restore_state() can make part of the data
+  // again
+  size_t valid_size{0};
+  std::shared_ptr<char> buffer{nullptr};
   char *head{nullptr};
 };
 
@@ -16,6 +16,7 @@
 #ifndef BM_BM_SIM_PACKET_HANDLER_H_
 #define BM_BM_SIM_PACKET_HANDLER_H_
 
+#include <cstddef>
 #include <functional>
 
 namespace bm {
@@ -24,6 +25,15 @@ class PacketDispatcherIface {
  public:
   using PacketHandler = std::function<void(int port_num, const char *buffer,
                                            int len, void* cookie)>;
+  // one packet of a burst; the buffer is only valid for the duration of the
+  // BurstHandler call
+  struct BurstPacket {
+    int port_num;
+    const char *buffer;
+    int len;
+  };
+  using BurstHandler = std::function<void(const BurstPacket *packets,
+                                          size_t count, void *cookie)>;
   enum class ReturnCode {
     SUCCESS,
     UNSUPPORTED,
@@ -32,6 +42,17 @@ class PacketDispatcherIface {
 
   virtual ReturnCode set_packet_handler(const PacketHandler &handler,
                                         void* cookie) = 0;
+
+  // Implementations which can receive several packets at once call the burst
+  // handler (when one is set) with up to max_burst packets, instead of calling
+  // the packet handler once per packet.
+  virtual ReturnCode set_burst_handler(const BurstHandler &handler,
+                                       size_t max_burst, void* cookie) {
+    (void) handler;
+    (void) max_burst;
+    (void) cookie;
+    return ReturnCode::UNSUPPORTED;
+  }
 };
 
 class PacketReceiverIface {
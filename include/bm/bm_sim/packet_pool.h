@@ -0,0 +1,74 @@
+/* Copyright 2013-present Barefoot Networks, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//! @file packet_pool.h
+
+#ifndef BM_BM_SIM_PACKET_POOL_H_
+#define BM_BM_SIM_PACKET_POOL_H_
+
+#include <cstddef>
+#include <cstdint>
+
+namespace bm {
+
+//! Recycles the memory used for Packet instances and for the storage of
+//! PacketBuffer instances, so that the packet processing threads do not go
+//! through the heap allocator for every packet (and for every clone).
+//!
+//! Each thread keeps a small cache of free blocks for each size class, backed
+//! by a depot shared by all threads. Packets are often released by a different
+//! thread than the one which allocated them (e.g. received by the ingress
+//! thread, transmitted by the transmit thread): when its cache is full, a
+//! thread moves a batch of blocks to the depot, where the allocating thread
+//! will find them when its own cache is empty.
+//!
+//! You do not need to use this class directly: Packet and PacketBuffer use it
+//! internally.
+class PacketPool {
+ public:
+  struct Stats {
+    //! Number of allocations served from a recycled block
+    uint64_t hits;
+    //! Number of allocations which had to go to the heap allocator
+    uint64_t misses;
+  };
+
+  //! Buffers larger than this are always obtained from the heap allocator
+  static constexpr size_t max_buffer_size = 16384;
+  //! Packet instances larger than this are always obtained from the heap
+  //! allocator
+  static constexpr size_t max_packet_size = 512;
+
+  //! Returns a buffer of at least \p size bytes, to be released with
+  //! release_buffer(), using the same \p size.
+  static char *allocate_buffer(size_t size);
+  static void release_buffer(char *buffer, size_t size);
+
+  //! Returns storage for a Packet instance of \p size bytes, to be released
+  //! with release_packet(), using the same \p size. This is also used for
+  //! other small per-packet objects, such as the reference count of the
+  //! storage of a PacketBuffer.
+  static void *allocate_packet(size_t size);
+  static void release_packet(void *packet, size_t size);
+
+  //! Hits and misses for PacketBuffer storage, across all size classes
+  static Stats get_buffer_stats();
+  //! Hits and misses for Packet instances
+  static Stats get_packet_stats();
+};
+
+}  // namespace bm
+
+#endif  // BM_BM_SIM_PACKET_POOL_H_
@@ -47,6 +47,8 @@ class ActionFn;
 
 class Checksum;
 
+class FlexVersion;
+
 struct field_t {
   header_id_t header;
   int offset;
@@ -261,6 +263,10 @@ class ParseState : public NamedP4Object {
   void add_set_from_expression(header_id_t dst_header, int dst_offset,
                                const ArithExpression &expr);
 
+  // FlexCore: sets the field to the version assigned to the packet by version
+  void add_set_from_flex_version(header_id_t dst_header, int dst_offset,
+                                 FlexVersion *version);
+
   void add_verify(const BoolExpression &condition,
                   const ArithExpression &error_expr);
 
@@ -328,11 +334,6 @@ class ParseState : public NamedP4Object {
   ParseSwitchKeyBuilder key_builder{};
   std::vector<std::unique_ptr<ParseSwitchCaseIface> > parser_switch{};
   const ParseState *default_next_state{nullptr};
-
- public:
-  ParserOp *get_parser_op(int idx) {
-    return parser_ops[idx].get();
-  }
 };
 
 //! Implements a P4 parser.
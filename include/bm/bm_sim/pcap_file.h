@@ -114,7 +114,8 @@ class PcapFileOut :
   // port is not really used
   PcapFileOut(unsigned port, std::string filename);
   virtual ~PcapFileOut();
-  void writePacket(const char *data, unsigned length);
+  void writePacket(const char *data, unsigned length, bool flush = true);
+  void flush();
 
  private:
   pcap_t *pcap;
@@ -146,6 +147,11 @@ class PcapFilesReader :
   PacketDispatcherIface::ReturnCode set_packet_handler(
       const PacketHandler &handler, void *cookie);
 
+  // If set, packets which are due at the same time (all of them when timing is
+  // not respected) are handed out in bursts of up to 'max_burst' packets
+  PacketDispatcherIface::ReturnCode set_burst_handler(
+      const BurstHandler &handler, size_t max_burst, void *cookie) override;
+
  private:
   std::vector<std::unique_ptr<PcapFileIn>> files;
   unsigned nonEmptyFiles;
@@ -165,6 +171,7 @@ class PcapFilesReader :
   void scan();
   void schedulePacket(unsigned index, const struct timeval *delay);
   void timerFired();  // send a scheduled packet
+  void flushBurst();  // send the packets accumulated in the current burst
 
   PcapFilesReader(PcapFilesReader const& ) = delete;
   PcapFilesReader& operator=(PcapFilesReader const&) = delete;
@@ -172,6 +179,14 @@ class PcapFilesReader :
   // Function to call when a packet is read
   PacketHandler handler;
   void *cookie;
+
+  BurstHandler burstHandler;
+  void *burstCookie;
+  size_t maxBurst;
+  // The data of each packet is copied, since the pcap library reuses its buffer
+  // when moving to the next packet of a file
+  std::vector<std::vector<char>> burstData;
+  std::vector<BurstPacket> burst;
 };
 
 
@@ -182,6 +197,9 @@ class PcapFilesWriter : public PacketReceiverIface {
   // Add a file corresponding to the specified port.
   void addFile(unsigned port, std::string file);
   void send_packet(int port_num, const char *buffer, int len);
+  // each file is only flushed once per burst
+  void send_burst(const PacketDispatcherIface::BurstPacket *packets,
+                  size_t count);
 
  private:
   std::unordered_map<unsigned, std::unique_ptr<PcapFileOut>> files;
@@ -26,6 +26,7 @@
 #include <string>
 
 #include "control_flow.h"
+#include "control_flow_graph.h"
 #include "named_p4object.h"
 
 namespace bm {
@@ -59,8 +60,20 @@ class Pipeline : public NamedP4Object {
     first_node = _first_node;
   }
 
+  ControlFlowNode *get_first_node() const { return first_node; }
+
+  // FlexCore: once set, apply() follows the published snapshots of the graph
+  // (see VersionedControlFlowGraph) instead of the next node pointers, and
+  // set_first_node() only takes effect at the next publish
+  void set_control_flow_graph(VersionedControlFlowGraph *cfg) {
+    this->cfg = cfg;
+    cfg_slot = cfg->add_pipeline(this);
+  }
+
  private:
   ControlFlowNode *first_node;
+  VersionedControlFlowGraph *cfg{nullptr};
+  size_t cfg_slot{0};
 };
 
 }  // namespace bm
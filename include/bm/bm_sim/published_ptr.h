@@ -0,0 +1,128 @@
+/* Copyright 2013-present Barefoot Networks, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//! @file published_ptr.h
+
+#ifndef BM_BM_SIM_PUBLISHED_PTR_H_
+#define BM_BM_SIM_PUBLISHED_PTR_H_
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <thread>
+
+namespace bm {
+
+// pointer to an immutable object which the control plane replaces
+// while packet threads use it, without locks. Readers register in the current
+// epoch for as long as they use the object (see read()); publish() swaps the
+// pointer, moves to the next epoch and waits for the readers of the previous
+// one to be done before deleting the previous object. Readers are never
+// stalled.
+// A thread must not call publish() while it holds a ReadGuard for the same
+// instance, as publish() would wait for it forever. publish() calls must be
+// serialized by the caller.
+template <typename T>
+class PublishedPtr {
+ public:
+  class ReadGuard {
+   public:
+    ~ReadGuard() {
+      if (ptr) ptr->readers[epoch & 1].fetch_sub(1, std::memory_order_release);
+    }
+
+    ReadGuard(ReadGuard &&other) noexcept
+        : ptr(other.ptr), epoch(other.epoch), object(other.object) {
+      other.ptr = nullptr;
+    }
+
+    ReadGuard(const ReadGuard &other) = delete;
+    ReadGuard &operator=(const ReadGuard &other) = delete;
+    ReadGuard &operator=(ReadGuard &&other) = delete;
+
+    const T &operator*() const { return *object; }
+    const T *operator->() const { return object; }
+    const T *get() const { return object; }
+
+   private:
+    friend class PublishedPtr;
+
+    ReadGuard(const PublishedPtr *ptr, uint64_t epoch, const T *object)
+        : ptr(ptr), epoch(epoch), object(object) { }
+
+    const PublishedPtr *ptr;
+    uint64_t epoch;
+    const T *object;
+  };
+
+  PublishedPtr() {
+    readers[0].store(0);
+    readers[1].store(0);
+  }
+
+  ~PublishedPtr() {
+    delete current.load();
+  }
+
+  // A reader registers in the epoch it read, then checks that the epoch has
+  // not changed in the meantime. If it has, publish() may already be waiting
+  // for the readers of the new epoch's parity and may miss this one, so it
+  // tries again. Once registered, the reader is guaranteed to see the object
+  // which was current when the epoch started, or a more recent one.
+  // The object (nullptr if nothing was published yet) remains valid as long as
+  // the guard exists.
+  ReadGuard read() const {
+    while (true) {
+      const uint64_t e = epoch.load();
+      readers[e & 1].fetch_add(1);
+      if (epoch.load() == e) return ReadGuard(this, e, current.load());
+      readers[e & 1].fetch_sub(1);
+    }
+  }
+
+  // Makes object current. Returns once the previous object is no longer used
+  // by any reader, and deletes it.
+  void publish(std::unique_ptr<const T> object) {
+    std::unique_ptr<const T> old_object(current.exchange(object.release()));
+    synchronize();
+  }
+
+  // Returns once the readers registered before the call are done. Readers
+  // which register from now on only see the changes made before the call, so
+  // we only have to wait for the ones registered in the previous epoch. This
+  // is what lets the writer free an object it has just unlinked from the
+  // current one. Must be serialized with publish().
+  void synchronize() {
+    const uint64_t e = epoch.fetch_add(1);
+    while (readers[e & 1].load(std::memory_order_acquire) > 0)
+      std::this_thread::yield();
+  }
+
+  // for the writer, which does not need to register
+  const T *get() const { return current.load(); }
+
+  PublishedPtr(const PublishedPtr &other) = delete;
+  PublishedPtr &operator=(const PublishedPtr &other) = delete;
+
+ private:
+  std::atomic<const T *> current{nullptr};
+  std::atomic<uint64_t> epoch{0};
+  // number of readers registered in even and odd epochs
+  mutable std::atomic<int> readers[2];
+};
+
+}  // namespace bm
+
+#endif  // BM_BM_SIM_PUBLISHED_PTR_H_
@@ -25,9 +25,12 @@
 
 #include <condition_variable>
 #include <deque>
+#include <memory>
 #include <mutex>
 #include <utility>
 
+#include "ring_buffer.h"
+
 namespace bm {
 
 /* TODO(antonin): implement non blocking read behavior */
@@ -37,7 +40,9 @@ namespace bm {
 //! thread. This is a very simple class, which does not implement anything fancy
 //! (e.g. rate limiting, priority queueing, fair scheduling, ...) but can be
 //! used as a base class to build something more advanced.
-//! Queue includes a mutex and is thread-safe.
+//! Queue includes a mutex and is thread-safe. Alternatively, the queue can be
+//! backed by a lock-free RingBuffer (see QueueImpl), in which case the
+//! capacity can only be lowered after construction.
 template <class T>
 class Queue {
  public:
@@ -60,13 +65,19 @@ class Queue {
   Queue()
     : capacity(1024), wb(WriteBlock), rb(ReadBlock) { }
 
-  //! Constructs a queue with specified \p capacity and read / write behaviors
+  //! Constructs a queue with specified \p capacity and read / write
+  //! behaviors. \p impl selects the data structure used to store the items.
   Queue(size_t capacity,
-        WriteBehavior wb = WriteBlock, ReadBehavior rb = ReadBlock)
-    : capacity(capacity), wb(wb), rb(rb) {}
+        WriteBehavior wb = WriteBlock, ReadBehavior rb = ReadBlock,
+        QueueImpl impl = QueueImpl::LOCKED)
+    : capacity(capacity), wb(wb), rb(rb),
+      ring((impl == QueueImpl::RING) ? new RingBuffer<T>(capacity) : nullptr) {
+    if (ring) ring->set_capacity(capacity);
+  }
 
   //! Makes a copy of \p item and pushes it to the front of the queue
   void push_front(const T &item) {
+    if (ring) return push_front(T(item));
     std::unique_lock<std::mutex> lock(q_mutex);
     while (!is_not_full()) {
       if (wb == WriteReturn) return;
@@ -79,6 +90,13 @@ class Queue {
 
   //! Moves \p item to the front of the queue
   void push_front(T &&item) {
+    if (ring) {
+      if (wb == WriteReturn)
+        ring->try_push(std::move(item));
+      else
+        ring->push(std::move(item));
+      return;
+    }
     std::unique_lock<std::mutex> lock(q_mutex);
     while (!is_not_full()) {
       if (wb == WriteReturn) return;
@@ -91,6 +109,7 @@ class Queue {
 
   //! Pops an element from the back of the queue: moves the element to `*pItem`.
   void pop_back(T* pItem) {
+    if (ring) return ring->pop(pItem);
     std::unique_lock<std::mutex> lock(q_mutex);
     while (!is_not_empty())
       q_not_empty.wait(lock);
@@ -100,14 +119,34 @@ class Queue {
     q_not_full.notify_one();
   }
 
+  //! Pops at least one and at most \p max_items elements from the back of the
+  //! queue, oldest first, and moves them to \p items. Returns the number of
+  //! elements popped.
+  size_t pop_back_n(T *items, size_t max_items) {
+    if (ring) return ring->pop_n(items, max_items);
+    std::unique_lock<std::mutex> lock(q_mutex);
+    while (!is_not_empty())
+      q_not_empty.wait(lock);
+    size_t n = 0;
+    for (; n < max_items && is_not_empty(); n++) {
+      items[n] = std::move(queue.back());
+      queue.pop_back();
+    }
+    lock.unlock();
+    q_not_full.notify_all();
+    return n;
+  }
+
   //! Get queue occupancy
   size_t size() const {
+    if (ring) return ring->size();
     std::unique_lock<std::mutex> lock(q_mutex);
     return queue.size();
   }
 
   //! Change the capacity of the queue
   void set_capacity(const size_t c) {
+    if (ring) return ring->set_capacity(c);
     // change capacity but does not discard elements
     std::unique_lock<std::mutex> lock(q_mutex);
     capacity = c;
@@ -131,6 +170,8 @@ class Queue {
   std::deque<T> queue;
   WriteBehavior wb;
   ReadBehavior rb;
+  // only used with QueueImpl::RING
+  std::unique_ptr<RingBuffer<T> > ring;
 
   mutable std::mutex q_mutex;
   mutable std::condition_variable q_not_empty;
@@ -31,9 +31,11 @@
 #define BM_BM_SIM_QUEUEING_H_
 
 #include <algorithm>  // for std::max
+#include <atomic>
 #include <chrono>
 #include <condition_variable>
 #include <deque>
+#include <memory>
 #include <mutex>
 #include <queue>
 #include <tuple>  // for std::forward_as_tuple
@@ -41,6 +43,9 @@
 #include <utility>  // for std::piecewise_construct
 #include <vector>
 
+#include "published_ptr.h"
+#include "ring_buffer.h"
+
 namespace bm {
 
 // These queueing implementations used to have one lock for each worker, which
@@ -53,6 +58,78 @@ namespace bm {
 // into the map. In order to accomodate for this, we had to start using a single
 // lock, shared by all the workers. It's unlikely that contention for this lock
 // will be a bottleneck.
+// When QueueImpl::RING is selected at construction, the lock is not used by
+// push / pop: each worker has a lock-free RingBuffer shared by all its logical
+// queues, the per-queue state is updated with atomics and the map of per-queue
+// state is copied-on-write (see queueing_detail::QueueInfoTable).
+
+namespace queueing_detail {
+
+// Maps logical queue ids to per-queue state for the QueueImpl::RING
+// implementations. Lookups do not take any lock: the map is copied when a new
+// queue id is seen (which is rare) and the copy is published (see
+// PublishedPtr), which frees the previous copy once no lookup is using it. The
+// per-queue state itself is never freed before destruction.
+template <typename Info>
+class QueueInfoTable {
+ public:
+  using MutexType = std::mutex;
+  using LockType = std::unique_lock<MutexType>;
+
+  QueueInfoTable() {
+    map.publish(std::unique_ptr<const Map>(new Map()));
+  }
+
+  Info *find(size_t queue_id) const {
+    auto current = map.read();
+    auto it = current->find(queue_id);
+    return (it == current->end()) ? nullptr : it->second;
+  }
+
+  // make_info is called with the mutex held to create the state of a new
+  // queue
+  template <typename F>
+  Info *get(size_t queue_id, F make_info) {
+    auto *info = find(queue_id);
+    if (info != nullptr) return info;
+    LockType lock(mutex);
+    info = find(queue_id);
+    if (info != nullptr) return info;
+    infos.emplace_back(make_info());
+    info = infos.back().get();
+    std::unique_ptr<Map> new_map(new Map(*map.get()));
+    new_map->emplace(queue_id, info);
+    map.publish(std::move(new_map));
+    return info;
+  }
+
+  // the caller has to hold the mutex (see get_mutex())
+  template <typename F>
+  void for_each(F f) {
+    for (auto &info : infos) f(info.get());
+  }
+
+  MutexType &get_mutex() { return mutex; }
+
+ private:
+  using Map = std::unordered_map<size_t, Info *>;
+
+  MutexType mutex{};
+  std::vector<std::unique_ptr<Info> > infos{};
+  PublishedPtr<Map> map{};
+};
+
+// reserves a spot in a logical queue, returns false if the queue is full
+template <typename Info>
+bool try_reserve(Info *q_info) {
+  auto size = q_info->size.load();
+  while (size < q_info->capacity.load()) {
+    if (q_info->size.compare_exchange_weak(size, size + 1)) return true;
+  }
+  return false;
+}
+
+}  // namespace queueing_detail
 
 //! One of the most basic queueing block possible. Supports an arbitrary number
 //! of logical queues (identified by arbitrary integer ids). Lets you choose (at
@@ -62,8 +139,13 @@ namespace bm {
 //! queue still has its own maximum capacity.  As of now, the behavior is
 //! blocking for both read (pop_back()) and write (push_front()), but we may
 //! offer additional options if there is interest expressed in the future.
+//! With QueueImpl::RING, each physical queue is a lock-free ring of
+//! `std::max(capacity, 1024)` slots, which may make push_front() block before
+//! the logical queue is full if the worker is late; the worker thread pops
+//! elements by batches.
 //!
-//! Template parameter `T` is the type (has to be movable) of the objects that
+//! Template parameter `T` is the type (has to be movable, and
+//! default-constructible for QueueImpl::RING) of the objects that
 //! will be stored in the queues. Template parameter `FMap` is a callable object
 //! that has to be able to map every logical queue id to a worker id. The
 //! following is a good example of functor that meets the requirements:
@@ -92,15 +174,23 @@ class QueueingLogic {
   //! the user has to provide a callable object of type `FMap`, \p
   //! map_to_worker, that can do this mapping. See the QueueingLogic class
   //! description for more information about the `FMap` template parameter.
-  QueueingLogic(size_t nb_workers, size_t capacity, FMap map_to_worker)
+  //! \p impl selects the data structure used for the physical queues.
+  QueueingLogic(size_t nb_workers, size_t capacity, FMap map_to_worker,
+                QueueImpl impl = QueueImpl::LOCKED)
       : nb_workers(nb_workers),
         capacity(capacity),
         workers_info(nb_workers),
-        map_to_worker(std::move(map_to_worker)) { }
+        map_to_worker(std::move(map_to_worker)) {
+    if (impl == QueueImpl::RING) {
+      for (size_t i = 0; i < nb_workers; i++)
+        ring_workers.emplace_back(new RingWorkerInfo(capacity));
+    }
+  }
 
   //! Makes a copy of \p item and pushes it to the front of the logical queue
   //! with id \p queue_id.
   void push_front(size_t queue_id, const T &item) {
+    if (!ring_workers.empty()) return push_front_ring(queue_id, T(item));
     size_t worker_id = map_to_worker(queue_id);
     LockType lock(mutex);
     auto &q_info = get_queue(queue_id);
@@ -115,6 +205,8 @@ class QueueingLogic {
 
   //! Moves \p item to the front of the logical queue with id \p queue_id.
   void push_front(size_t queue_id, T &&item) {
+    if (!ring_workers.empty())
+      return push_front_ring(queue_id, std::move(item));
     size_t worker_id = map_to_worker(queue_id);
     LockType lock(mutex);
     auto &q_info = get_queue(queue_id);
@@ -135,6 +227,8 @@ class QueueingLogic {
   //! element `E` was pushed to queue `queue_id`, you need to use the worker id
   //! `map_to_worker(queue_id)` to retrieve it with this function.
   void pop_back(size_t worker_id, size_t *queue_id, T *pItem) {
+    if (!ring_workers.empty())
+      return pop_back_ring(worker_id, queue_id, pItem);
     LockType lock(mutex);
     auto &w_info = workers_info.at(worker_id);
     auto &queue = w_info.queue;
@@ -151,6 +245,10 @@ class QueueingLogic {
 
   //! Get the occupancy of the logical queue with id \p queue_id.
   size_t size(size_t queue_id) const {
+    if (!ring_workers.empty()) {
+      auto *q_info = ring_queues.find(queue_id);
+      return (q_info == nullptr) ? 0 : q_info->size.load();
+    }
     LockType lock(mutex);
     auto it = queues_info.find(queue_id);
     if (it == queues_info.end()) return 0;
@@ -161,6 +259,12 @@ class QueueingLogic {
   //! Set the capacity of the logical queue with id \p queue_id to \p c
   //! elements.
   void set_capacity(size_t queue_id, size_t c) {
+    if (!ring_workers.empty()) {
+      auto *q_info = get_ring_queue(queue_id);
+      q_info->capacity.store(c);
+      q_info->not_full.notify_all();
+      return;
+    }
     LockType lock(mutex);
     auto &q_info = get_queue(queue_id);
     q_info.capacity = c;
@@ -168,6 +272,15 @@ class QueueingLogic {
 
   //! Set the capacity of all logical queues to \p c elements.
   void set_capacity_for_all(size_t c) {
+    if (!ring_workers.empty()) {
+      LockType lock(ring_queues.get_mutex());
+      ring_queues.for_each([c](RingQueueInfo *q_info) {
+          q_info->capacity.store(c);
+          q_info->not_full.notify_all();
+        });
+      capacity = c;
+      return;
+    }
     LockType lock(mutex);
     for (auto &p : queues_info) p.second.capacity = c;
     capacity = c;
@@ -185,11 +298,12 @@ class QueueingLogic {
 
  private:
   struct QE {
+    QE() = default;
     QE(T e, size_t queue_id)
         : e(std::move(e)), queue_id(queue_id) { }
 
-    T e;
-    size_t queue_id;
+    T e{};
+    size_t queue_id{0};
   };
 
   using MyQ = std::deque<QE>;
@@ -228,12 +342,71 @@ class QueueingLogic {
     return queues_info.at(queue_id);
   }
 
+  struct RingQueueInfo {
+    explicit RingQueueInfo(size_t capacity)
+        : capacity(capacity) { }
+
+    std::atomic<size_t> size{0};
+    std::atomic<size_t> capacity;
+    SpinThenBlockWaiter not_full{};
+  };
+
+  struct RingWorkerInfo {
+    static constexpr size_t batch_size = 32;
+
+    explicit RingWorkerInfo(size_t capacity)
+        : ring(std::max(capacity, static_cast<size_t>(1024))),
+          batch(batch_size) { }
+
+    RingBuffer<QE> ring;
+    // elements popped from the ring but not yet returned, only accessed by the
+    // worker thread
+    std::vector<QE> batch;
+    size_t batch_next{0};
+    size_t batch_end{0};
+  };
+
+  RingQueueInfo *get_ring_queue(size_t queue_id) {
+    return ring_queues.get(queue_id, [this] {
+        return new RingQueueInfo(capacity);
+      });
+  }
+
+  void push_front_ring(size_t queue_id, T &&item) {
+    auto *q_info = get_ring_queue(queue_id);
+    while (!queueing_detail::try_reserve(q_info)) {
+      q_info->not_full.wait([q_info] {
+          return q_info->size.load() < q_info->capacity.load();
+        });
+    }
+    ring_workers.at(map_to_worker(queue_id))->ring.push(
+        QE(std::move(item), queue_id));
+  }
+
+  void pop_back_ring(size_t worker_id, size_t *queue_id, T *pItem) {
+    auto &w_info = *ring_workers.at(worker_id);
+    if (w_info.batch_next == w_info.batch_end) {
+      w_info.batch_end = w_info.ring.pop_n(w_info.batch.data(),
+                                           w_info.batch.size());
+      w_info.batch_next = 0;
+    }
+    auto &qe = w_info.batch[w_info.batch_next++];
+    *queue_id = qe.queue_id;
+    *pItem = std::move(qe.e);
+    auto *q_info = ring_queues.find(*queue_id);
+    q_info->size.fetch_sub(1);
+    q_info->not_full.notify_all();
+  }
+
   mutable MutexType mutex{};
   size_t nb_workers;
   size_t capacity;  // default capacity
   std::unordered_map<size_t, QueueInfo> queues_info;
   std::vector<WorkerInfo> workers_info;
   FMap map_to_worker;
+  // only used with QueueImpl::RING
+  queueing_detail::QueueInfoTable<RingQueueInfo> ring_queues{};
+  std::vector<std::unique_ptr<RingWorkerInfo> > ring_workers{};
 };
 
 
@@ -258,16 +431,27 @@ class QueueingLogicRL {
   //!
   //! Initially, none of the logical queues will be rate-limited, i.e. the
   //! instance will behave as an instance of QueueingLogic.
-  QueueingLogicRL(size_t nb_workers, size_t capacity, FMap map_to_worker)
+  //!
+  //! With QueueImpl::RING, elements go through a lock-free ring (one per
+  //! worker) and the worker thread moves them by batches to a heap only it can
+  //! access, in which they wait for their departure time.
+  QueueingLogicRL(size_t nb_workers, size_t capacity, FMap map_to_worker,
+                  QueueImpl impl = QueueImpl::LOCKED)
       : nb_workers(nb_workers),
         capacity(capacity),
         workers_info(nb_workers),
-        map_to_worker(std::move(map_to_worker)) { }
+        map_to_worker(std::move(map_to_worker)) {
+    if (impl == QueueImpl::RING) {
+      for (size_t i = 0; i < nb_workers; i++)
+        ring_workers.emplace_back(new RingWorkerInfo());
+    }
+  }
 
   //! If the logical queue with id \p queue_id is full, the function will return
   //! `0` immediately. Otherwise, \p item will be copied to the front of the
   //! logical queue and the function will return `1`.
   int push_front(size_t queue_id, const T &item) {
+    if (!ring_workers.empty()) return push_front_ring(queue_id, T(item));
     size_t worker_id = map_to_worker(queue_id);
     LockType lock(mutex);
     auto &q_info = get_queue(queue_id);
@@ -284,6 +468,8 @@ class QueueingLogicRL {
   //! Same as push_front(size_t queue_id, const T &item), but \p item is moved
   //! instead of copied.
   int push_front(size_t queue_id, T &&item) {
+    if (!ring_workers.empty())
+      return push_front_ring(queue_id, std::move(item));
     size_t worker_id = map_to_worker(queue_id);
     LockType lock(mutex);
     auto &q_info = get_queue(queue_id);
@@ -303,6 +489,8 @@ class QueueingLogicRL {
   //! will block until 1) an element is available 2) this element is free to
   //! leave the queue according to the rate limiter.
   void pop_back(size_t worker_id, size_t *queue_id, T *pItem) {
+    if (!ring_workers.empty())
+      return pop_back_ring(worker_id, queue_id, pItem);
     LockType lock(mutex);
     auto &w_info = workers_info.at(worker_id);
     auto &queue = w_info.queue;
@@ -325,6 +513,10 @@ class QueueingLogicRL {
 
   //! @copydoc QueueingLogic::size
   size_t size(size_t queue_id) const {
+    if (!ring_workers.empty()) {
+      auto *q_info = ring_queues.find(queue_id);
+      return (q_info == nullptr) ? 0 : q_info->size.load();
+    }
     LockType lock(mutex);
     auto it = queues_info.find(queue_id);
     if (it == queues_info.end()) return 0;
@@ -335,6 +527,10 @@ class QueueingLogicRL {
   //! Set the capacity of the logical queue with id \p queue_id to \p c
   //! elements.
   void set_capacity(size_t queue_id, size_t c) {
+    if (!ring_workers.empty()) {
+      get_ring_queue(queue_id)->capacity.store(c);
+      return;
+    }
     LockType lock(mutex);
     auto &q_info = get_queue(queue_id);
     q_info.capacity = c;
@@ -342,6 +538,14 @@ class QueueingLogicRL {
 
   //! Set the capacity of all logical queues to \p c elements.
   void set_capacity_for_all(size_t c) {
+    if (!ring_workers.empty()) {
+      LockType lock(ring_queues.get_mutex());
+      ring_queues.for_each([c](RingQueueInfo *q_info) {
+          q_info->capacity.store(c);
+        });
+      capacity = c;
+      return;
+    }
     LockType lock(mutex);
     for (auto &p : queues_info) p.second.capacity = c;
     capacity = c;
@@ -353,6 +557,11 @@ class QueueingLogicRL {
   //! behavior (no rate limit) can be achieved by calling this method with a
   //! rate of 0.
   void set_rate(size_t queue_id, uint64_t pps) {
+    if (!ring_workers.empty()) {
+      get_ring_queue(queue_id)->pkt_delay_ticks.store(
+          rate_to_ticks(pps).count());
+      return;
+    }
     LockType lock(mutex);
     auto &q_info = get_queue(queue_id);
     q_info.queue_rate_pps = pps;
@@ -363,6 +572,14 @@ class QueueingLogicRL {
   void set_rate_for_all(uint64_t pps) {
     using std::chrono::duration;
     using std::chrono::duration_cast;
+    if (!ring_workers.empty()) {
+      LockType lock(ring_queues.get_mutex());
+      ring_queues.for_each([pps](RingQueueInfo *q_info) {
+          q_info->pkt_delay_ticks.store(rate_to_ticks(pps).count());
+        });
+      queue_rate_pps = pps;
+      return;
+    }
     LockType lock(mutex);
     for (auto &p : queues_info) {
       auto &q_info = p.second;
@@ -398,13 +615,14 @@ class QueueingLogicRL {
   struct QE {
     // QE(T e, size_t queue_id, const clock::time_point &send, size_t id)
     //     : e(std::move(e)), queue_id(queue_id), send(send), id(id) { }
+    QE() = default;
     QE(T e, size_t queue_id, const clock::time_point &send, size_t id)
         : e(std::move(e)), queue_id(queue_id), send(send), id(id) { }
 
-    T e;
-    size_t queue_id;
-    clock::time_point send;
-    size_t id;
+    T e{};
+    size_t queue_id{0};
+    clock::time_point send{};
+    size_t id{0};
   };
 
   struct QEComp {
@@ -460,6 +678,104 @@ class QueueingLogicRL {
     return std::max(clock::now(), q_info.last_sent + q_info.pkt_delay_ticks);
   }
 
+  // the rate limiter state is updated by producers without any lock, which is
+  // why durations and time points are stored as tick counts
+  struct RingQueueInfo {
+    RingQueueInfo(size_t capacity, uint64_t queue_rate_pps)
+        : capacity(capacity),
+          pkt_delay_ticks(rate_to_ticks(queue_rate_pps).count()),
+          last_sent(to_ticks(clock::now())) { }
+
+    std::atomic<size_t> size{0};
+    std::atomic<size_t> capacity;
+    std::atomic<ticks::rep> pkt_delay_ticks;
+    std::atomic<ticks::rep> last_sent;
+  };
+
+  struct RingWorkerInfo {
+    static constexpr size_t ring_size = 1024;
+    static constexpr size_t batch_size = 32;
+
+    RingWorkerInfo()
+        : ring(ring_size), batch(batch_size) { }
+
+    RingBuffer<QE> ring;
+    // only accessed by the worker thread
+    std::vector<QE> batch;
+    MyQ queue{};
+    size_t wrapping_counter{0};
+  };
+
+  static ticks::rep to_ticks(const clock::time_point &tp) {
+    return std::chrono::duration_cast<ticks>(tp.time_since_epoch()).count();
+  }
+
+  static clock::time_point from_ticks(ticks::rep t) {
+    return clock::time_point(
+        std::chrono::duration_cast<clock::duration>(ticks(t)));
+  }
+
+  RingQueueInfo *get_ring_queue(size_t queue_id) {
+    return ring_queues.get(queue_id, [this] {
+        return new RingQueueInfo(capacity, queue_rate_pps);
+      });
+  }
+
+  int push_front_ring(size_t queue_id, T &&item) {
+    auto *q_info = get_ring_queue(queue_id);
+    if (!queueing_detail::try_reserve(q_info)) return 0;
+    // same as get_next_tp(), the CAS loop orders concurrent producers
+    auto now = to_ticks(clock::now());
+    auto last_sent = q_info->last_sent.load();
+    ticks::rep send;
+    do {
+      send = std::max(now, last_sent + q_info->pkt_delay_ticks.load());
+    } while (!q_info->last_sent.compare_exchange_weak(last_sent, send));
+    // the id is assigned by the worker, in the order the elements are read
+    // from the ring
+    QE qe(std::move(item), queue_id, from_ticks(send), 0);
+    if (ring_workers.at(map_to_worker(queue_id))->ring.try_push(
+            std::move(qe))) {
+      return 1;
+    }
+    // the ring of the worker is shared by all its queues and is full: the
+    // element is dropped, as when its queue is full, and the departure time
+    // it took is given back unless another producer has taken the next one
+    q_info->size.fetch_sub(1);
+    q_info->last_sent.compare_exchange_strong(send, last_sent);
+    return 0;
+  }
+
+  // moves elements from the ring to the worker's heap
+  void drain_ring(RingWorkerInfo *w_info, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+      auto &qe = w_info->batch[i];
+      w_info->queue.emplace(std::move(qe.e), qe.queue_id, qe.send,
+                            w_info->wrapping_counter++);
+    }
+  }
+
+  void pop_back_ring(size_t worker_id, size_t *queue_id, T *pItem) {
+    auto &w_info = *ring_workers.at(worker_id);
+    auto &queue = w_info.queue;
+    auto *batch = w_info.batch.data();
+    auto batch_size = w_info.batch.size();
+    drain_ring(&w_info, w_info.ring.try_pop_n(batch, batch_size));
+    while (true) {
+      if (queue.size() == 0) {
+        drain_ring(&w_info, w_info.ring.pop_n(batch, batch_size));
+      } else {
+        if (queue.top().send <= clock::now()) break;
+        drain_ring(&w_info,
+                   w_info.ring.pop_n_until(batch, batch_size, queue.top().send));
+      }
+    }
+    *queue_id = queue.top().queue_id;
+    *pItem = std::move(const_cast<QE &>(queue.top()).e);
+    queue.pop();
+    ring_queues.find(*queue_id)->size.fetch_sub(1);
+  }
+
   mutable MutexType mutex{};
   size_t nb_workers;
   size_t capacity;  // default capacity
@@ -467,6 +783,9 @@ class QueueingLogicRL {
   std::unordered_map<size_t, QueueInfo> queues_info;
   std::vector<WorkerInfo> workers_info;
   FMap map_to_worker;
+  // only used with QueueImpl::RING
+  queueing_detail::QueueInfoTable<RingQueueInfo> ring_queues{};
+  std::vector<std::unique_ptr<RingWorkerInfo> > ring_workers{};
 };
 
 
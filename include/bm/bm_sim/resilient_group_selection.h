@@ -0,0 +1,81 @@
+/* Copyright 2013-present Barefoot Networks, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//! @file resilient_group_selection.h
+
+#ifndef BM_BM_SIM_RESILIENT_GROUP_SELECTION_H_
+#define BM_BM_SIM_RESILIENT_GROUP_SELECTION_H_
+
+#include <unordered_map>
+#include <vector>
+
+#include "action_profile.h"
+
+namespace bm {
+
+// member selection with resilient hashing for action selectors (e.g.
+// ECMP or LAG groups). Every group has the same, fixed number of buckets, each
+// of them assigned to one member of the group, and a packet goes to the member
+// of bucket (hash % number of buckets), which is a single array access.
+// When a member is added to a group, it takes its share of buckets from the
+// members which have the most, and when a member is removed, its buckets are
+// given to the members which have the fewest. Only the flows of the buckets
+// which change hands are remapped: about 1 / n of the flows of a group of n
+// members, where hash % n remaps most of them.
+// The number of buckets should be much larger than the number of members in a
+// group, for the flows to be evenly spread.
+// Like the default selection, this relies on the action profile lock: members
+// are added and removed with the write lock held and get_from_hash() is called
+// with the read lock held.
+class ResilientGroupSelection : public ActionProfile::GroupSelectionIface {
+ public:
+  using mbr_hdl_t = ActionProfile::mbr_hdl_t;
+  using grp_hdl_t = ActionProfile::grp_hdl_t;
+  using hash_t = ActionProfile::hash_t;
+
+  static constexpr size_t default_nb_buckets = 4096;
+
+  explicit ResilientGroupSelection(size_t nb_buckets = default_nb_buckets);
+
+  void add_member_to_group(grp_hdl_t grp, mbr_hdl_t mbr) override;
+  void remove_member_from_group(grp_hdl_t grp, mbr_hdl_t mbr) override;
+
+  mbr_hdl_t get_from_hash(grp_hdl_t grp, hash_t h) const override {
+    const auto &buckets = groups[grp].buckets;
+    return buckets[h % buckets.size()];
+  }
+
+  void reset() override;
+
+  size_t get_nb_buckets() const { return nb_buckets; }
+
+  // number of buckets assigned to the member in the group
+  size_t get_nb_buckets(grp_hdl_t grp, mbr_hdl_t mbr) const;
+
+ private:
+  struct Group {
+    // member of each bucket, empty if the group has no member
+    std::vector<mbr_hdl_t> buckets{};
+    // buckets of each member
+    std::unordered_map<mbr_hdl_t, std::vector<size_t> > member_buckets{};
+  };
+
+  size_t nb_buckets;
+  std::vector<Group> groups{};
+};
+
+}  // namespace bm
+
+#endif  // BM_BM_SIM_RESILIENT_GROUP_SELECTION_H_
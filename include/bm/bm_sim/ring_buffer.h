@@ -0,0 +1,328 @@
+/* Copyright 2013-present Barefoot Networks, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//! @file ring_buffer.h
+//! Bounded lock-free ring used as an alternative to the mutex-protected
+//! std::deque in the queueing classes (Queue, QueueingLogic, QueueingLogicRL).
+
+#ifndef BM_BM_SIM_RING_BUFFER_H_
+#define BM_BM_SIM_RING_BUFFER_H_
+
+#include <algorithm>  // for std::min
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+namespace bm {
+
+//! Selects the data structure backing one of the queueing classes. The choice
+//! is made when the queue is constructed and cannot be changed afterwards.
+enum class QueueImpl {
+  //! std::deque protected by a mutex, with condition variables (default)
+  LOCKED,
+  //! bounded lock-free ring (RingBuffer), waiting threads first spin before
+  //! blocking
+  RING
+};
+
+//! Used by threads waiting on a lock-free data structure: the condition is
+//! first polled for a while (busy-wait then yield) and the thread only blocks
+//! on a condition variable if it is still false. Notifying is a single atomic
+//! load when no thread is blocked, so the fast path never makes a system call.
+class SpinThenBlockWaiter {
+ public:
+  //! \p spin_iterations is the number of times the condition is polled before
+  //! blocking; half of them busy-wait, the other half yield the CPU.
+  explicit SpinThenBlockWaiter(unsigned int spin_iterations = 256)
+      : spin_iterations(spin_iterations) { }
+
+  //! Returns once \p pred returns true.
+  template <typename Pred>
+  void wait(Pred pred) {
+    if (spin(pred)) return;
+    nb_blocked.fetch_add(1);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      cv.wait(lock, pred);
+    }
+    nb_blocked.fetch_sub(1);
+  }
+
+  //! Returns once \p pred returns true or \p tp is reached, returns the last
+  //! value of \p pred.
+  template <typename Pred, typename Clock, typename Duration>
+  bool wait_until(Pred pred,
+                  const std::chrono::time_point<Clock, Duration> &tp) {
+    if (spin(pred)) return true;
+    nb_blocked.fetch_add(1);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    bool rv;
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      rv = cv.wait_until(lock, tp, pred);
+    }
+    nb_blocked.fetch_sub(1);
+    return rv;
+  }
+
+  //! Has to be called after the state tested by the waiters' predicate has
+  //! been updated.
+  void notify_all() {
+    // pairs with the fence in wait(): either the waiter sees the new state
+    // when it checks its predicate under the mutex, or we see the waiter
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (nb_blocked.load(std::memory_order_relaxed) == 0) return;
+    { std::unique_lock<std::mutex> lock(mutex); }
+    cv.notify_all();
+  }
+
+ private:
+  template <typename Pred>
+  bool spin(Pred &pred) const {
+    for (unsigned int i = 0; i < spin_iterations; i++) {
+      if (pred()) return true;
+      if (i >= spin_iterations / 2) std::this_thread::yield();
+    }
+    return false;
+  }
+
+  unsigned int spin_iterations;
+  std::atomic<int> nb_blocked{0};
+  std::mutex mutex{};
+  std::condition_variable cv{};
+};
+
+//! Bounded multi-producer multi-consumer FIFO which does not use any lock for
+//! push and pop (Dmitry Vyukov's algorithm: each slot has a sequence number
+//! which tells producers and consumers whether it is free or holds an item for
+//! the current lap). The number of slots is the capacity rounded up to a power
+//! of 2; the capacity itself can be lowered with set_capacity(). The try_*
+//! methods never block; push() and pop() use a SpinThenBlockWaiter when the
+//! ring is full / empty. Batched operations claim several consecutive slots
+//! with a single atomic operation and wake-up waiters once per batch.
+//!
+//! Template parameter `T` has to be default-constructible and
+//! move-assignable.
+template <typename T>
+class RingBuffer {
+ public:
+  //! Constructs a ring which can hold at least \p capacity items
+  explicit RingBuffer(size_t capacity)
+      : mask(round_up_pow2(capacity) - 1),
+        cells(new Cell[mask + 1]),
+        limit(mask + 1) {
+    for (size_t i = 0; i <= mask; i++)
+      cells[i].seq.store(i, std::memory_order_relaxed);
+  }
+
+  //! Moves \p item to the ring if it is not full, returns true on success
+  bool try_push(T &&item) {
+    return try_push_n(&item, 1) == 1;
+  }
+
+  //! Moves the first items of \p items (at most \p n) to the ring and returns
+  //! how many were pushed, which is less than \p n if the ring is full.
+  size_t try_push_n(T *items, size_t n) {
+    size_t pos;
+    size_t k = claim(&enqueue_pos, 0, n, &pos);
+    for (size_t i = 0; i < k; i++) {
+      auto &cell = cells[(pos + i) & mask];
+      cell.item = std::move(items[i]);
+      cell.seq.store(pos + i + 1, std::memory_order_release);
+    }
+    if (k > 0) not_empty.notify_all();
+    return k;
+  }
+
+  //! Moves the oldest item to \p pItem, returns false if the ring is empty
+  bool try_pop(T *pItem) {
+    return try_pop_n(pItem, 1) == 1;
+  }
+
+  //! Moves up to \p n of the oldest items to \p items, and returns how many
+  //! were popped (`0` if the ring is empty).
+  size_t try_pop_n(T *items, size_t n) {
+    size_t pos;
+    size_t k = claim(&dequeue_pos, 1, n, &pos);
+    for (size_t i = 0; i < k; i++) {
+      auto &cell = cells[(pos + i) & mask];
+      items[i] = std::move(cell.item);
+      cell.seq.store(pos + i + mask + 1, std::memory_order_release);
+    }
+    if (k > 0) not_full.notify_all();
+    return k;
+  }
+
+  //! Moves \p item to the ring, waits if the ring is full
+  void push(T &&item) {
+    while (!try_push(std::move(item)))
+      not_full.wait([this] { return !full(); });
+  }
+
+  //! Moves all of \p items to the ring, waits if the ring is full
+  void push_n(T *items, size_t n) {
+    size_t done = 0;
+    while ((done += try_push_n(items + done, n - done)) < n)
+      not_full.wait([this] { return !full(); });
+  }
+
+  //! Moves the oldest item to \p pItem, waits if the ring is empty
+  void pop(T *pItem) {
+    while (!try_pop(pItem))
+      not_empty.wait([this] { return !empty(); });
+  }
+
+  //! Moves at least 1 and at most \p n items to \p items, waits if the ring is
+  //! empty. Returns the number of items popped.
+  size_t pop_n(T *items, size_t n) {
+    size_t k;
+    while ((k = try_pop_n(items, n)) == 0)
+      not_empty.wait([this] { return !empty(); });
+    return k;
+  }
+
+  //! Same as pop_n(), but gives up when \p tp is reached, in which case `0` is
+  //! returned.
+  template <typename Clock, typename Duration>
+  size_t pop_n_until(T *items, size_t n,
+                     const std::chrono::time_point<Clock, Duration> &tp) {
+    size_t k;
+    while ((k = try_pop_n(items, n)) == 0) {
+      if (!not_empty.wait_until([this] { return !empty(); }, tp)) return 0;
+    }
+    return k;
+  }
+
+  //! Number of items in the ring; only a snapshot when other threads are
+  //! pushing or popping concurrently.
+  size_t size() const {
+    auto head = dequeue_pos.load(std::memory_order_acquire);
+    auto tail = enqueue_pos.load(std::memory_order_acquire);
+    return (tail > head) ? (tail - head) : 0;
+  }
+
+  bool empty() const { return size() == 0; }
+
+  bool full() const { return size() >= capacity(); }
+
+  //! Current capacity, see set_capacity()
+  size_t capacity() const { return limit.load(std::memory_order_relaxed); }
+
+  //! Number of slots, which is the capacity given to the constructor rounded
+  //! up to a power of 2
+  size_t nb_slots() const { return mask + 1; }
+
+  //! Changes the maximum number of items in the ring, without discarding
+  //! items. The capacity cannot exceed nb_slots().
+  void set_capacity(size_t c) {
+    limit.store(std::min(c, nb_slots()), std::memory_order_relaxed);
+    not_full.notify_all();
+  }
+
+  //! Deleted copy constructor
+  RingBuffer(const RingBuffer &) = delete;
+  //! Deleted copy assignment operator
+  RingBuffer &operator =(const RingBuffer &) = delete;
+
+  //! Deleted move constructor
+  RingBuffer(RingBuffer &&) = delete;
+  //! Deleted move assignment operator
+  RingBuffer &&operator =(RingBuffer &&) = delete;
+
+ private:
+  static constexpr size_t cache_line_size = 64;
+
+  struct Cell {
+    std::atomic<size_t> seq{0};
+    T item{};
+  };
+
+  static size_t round_up_pow2(size_t v) {
+    size_t p = 1;
+    while (p < v) p <<= 1;
+    return p;
+  }
+
+  // Claims up to n consecutive slots starting at *pos_counter. A slot is ready
+  // for a producer when its sequence number is equal to its position (offset
+  // == 0) and for a consumer when it is equal to its position + 1 (offset ==
+  // 1). Only the owner of a position can change the sequence number of a ready
+  // slot, so checking all slots before the CAS is enough.
+  size_t claim(std::atomic<size_t> *pos_counter, size_t offset, size_t n,
+               size_t *pos) {
+    if (n == 0) return 0;
+    size_t p = pos_counter->load(std::memory_order_relaxed);
+    while (true) {
+      if (offset == 0) {
+        // the consumers' position only increases, so this is conservative
+        auto head = dequeue_pos.load(std::memory_order_acquire);
+        auto used = p - head;
+        auto c = capacity();
+        if (used >= c) {
+          if (pos_counter->load(std::memory_order_relaxed) == p) return 0;
+          p = pos_counter->load(std::memory_order_relaxed);
+          continue;
+        }
+        n = std::min(n, c - used);
+      }
+      size_t k = 0;
+      bool stale = false;
+      for (; k < n; k++) {
+        auto seq = cells[(p + k) & mask].seq.load(std::memory_order_acquire);
+        auto diff = static_cast<std::ptrdiff_t>(seq - (p + k + offset));
+        if (diff == 0) continue;
+        // positive difference: another thread got this slot before us and our
+        // view of the counter is stale
+        stale = (diff > 0 && k == 0);
+        break;
+      }
+      if (k == 0) {
+        if (!stale) return 0;  // full (producer) or empty (consumer)
+        p = pos_counter->load(std::memory_order_relaxed);
+        continue;
+      }
+      if (pos_counter->compare_exchange_weak(p, p + k,
+                                             std::memory_order_relaxed)) {
+        *pos = p;
+        return k;
+      }
+    }
+  }
+
+  size_t mask;
+  std::unique_ptr<Cell[]> cells;
+  // producers and consumers should not write to the same cache line; we use
+  // padding rather than alignas, as over-aligned types cannot be allocated
+  // with new in C++11
+  struct Padding { char bytes[cache_line_size]; };
+  Padding pad0{};
+  std::atomic<size_t> enqueue_pos{0};
+  Padding pad1{};
+  std::atomic<size_t> dequeue_pos{0};
+  Padding pad2{};
+  std::atomic<size_t> limit;
+  SpinThenBlockWaiter not_empty{};
+  SpinThenBlockWaiter not_full{};
+};
+
+}  // namespace bm
+
+#endif  // BM_BM_SIM_RING_BUFFER_H_
@@ -61,6 +61,16 @@ class RuntimeInterface {
                    const std::string &table_name,
                    bool reset_default_entry) = 0;
 
+  virtual MatchErrorCode
+  mt_get_cache_stats(cxt_id_t cxt_id,
+                     const std::string &table_name,
+                     LookupCacheStats *stats) const = 0;
+
+  virtual MatchErrorCode
+  mt_set_cache_size(cxt_id_t cxt_id,
+                    const std::string &table_name,
+                    size_t size) = 0;
+
   // direct tables
 
   virtual MatchErrorCode
@@ -0,0 +1,160 @@
+#ifndef BM_BM_SIM_RUNTIME_RECONFIG_PLAN_H_
+#define BM_BM_SIM_RUNTIME_RECONFIG_PLAN_H_
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <iosfwd>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "runtime_reconfig_error_codes.h"
+
+namespace bm {
+
+class P4Objects;
+
+class ReconfigStats;
+
+// FlexCore: one line of a runtime reconfiguration plan, once tokenized. The
+// meaning of the operands depends on the step type:
+//   insert tabl / cond:        ids[0] = new id
+//   insert flex:               ids[0] = flx id, ids[1] = false next,
+//                              ids[2] = true next
+//   insert register_array:     ids[0] = new id, args[0] = size,
+//                              args[1] = bitwidth
+//   change tabl / cond / flex: ids[0] = source node, ids[1] = destination
+//                              node, args[0] = edge name
+//   change init:               ids[0] = destination node
+//   change register_array_*:   ids[0] = register array, args[0] = new value
+//   trigger on / off:          args[0] = "after_packets" or "at_time_ms" for
+//                              a scheduled switch (empty if immediate),
+//                              args[1] = number of packets or timestamp
+//   delete *:                  ids[0] = deleted object
+struct ReconfigStep {
+  enum class Type {
+    INSERT_TABLE,
+    INSERT_CONDITIONAL,
+    INSERT_FLEX,
+    INSERT_REGISTER_ARRAY,
+    CHANGE_TABLE,
+    CHANGE_CONDITIONAL,
+    CHANGE_FLEX,
+    CHANGE_INIT,
+    CHANGE_REGISTER_ARRAY_SIZE,
+    CHANGE_REGISTER_ARRAY_BITWIDTH,
+    TRIGGER_ON,
+    TRIGGER_OFF,
+    DELETE_TABLE,
+    DELETE_CONDITIONAL,
+    DELETE_FLEX,
+    DELETE_REGISTER_ARRAY
+  };
+
+  static const char *type_name(Type type);
+
+  Type type;
+  std::string pipeline{};
+  std::string ids[3]{};
+  std::string args[2]{};
+  size_t line_no{0};
+};
+
+// FlexCore: a whole reconfiguration plan. The plan is parsed and validated
+// before anything is applied, so that commit() never leaves the live
+// P4Objects half-way between the old and the new program because of a bad
+// line. The P4Objects built from the new JSON are owned by the plan.
+class ReconfigPlan {
+ public:
+  // Tokenizes every line of the plan and checks the syntax of each step (known
+  // operation and target, number of operands, numeric arguments). Blank lines
+  // and lines starting with '#' are ignored.
+  RuntimeReconfigErrorCode parse(std::istream *is);
+
+  // Walks the steps in order and checks that every id has the right prefix,
+  // is declared before being used and is not declared twice, and that every
+  // "old_" and "new_" reference resolves in the live objects or in the new
+  // objects respectively. It then resolves the ids of every step the way
+  // commit() will, so that commit() cannot fail once it has started modifying
+  // the live objects. id2newNodeName holds the ids declared by the previous
+  // plans. Nothing is modified.
+  RuntimeReconfigErrorCode validate(
+      const P4Objects &live,
+      const std::unordered_map<std::string, std::string> &id2newNodeName) const;
+
+  // Applies all the steps but the flex triggers to the live objects, recording
+  // the latency of each step in stats (if not nullptr). The caller is
+  // responsible for calling validate() first, with the same id2newNodeName,
+  // for publishing the new control flow graph and, if needs_quiesce() is true,
+  // for making sure that no packet is using the live objects. Since validate()
+  // resolved every id, commit() cannot fail.
+  void commit(
+      P4Objects *live,
+      std::unordered_map<std::string, std::string> *id2newNodeName,
+      ReconfigStats *stats) const;
+
+  // Applies the flex triggers of the plan, in order. Must be called after the
+  // control flow graph built by commit() has been published: a packet which
+  // sees the new flex version has to find the flex nodes inserted by the plan.
+  void apply_triggers(P4Objects *live, ReconfigStats *stats) const;
+
+  void set_new_objects(std::shared_ptr<P4Objects> p4objects_new) {
+    new_objects = std::move(p4objects_new);
+  }
+
+  const std::vector<ReconfigStep> &get_steps() const { return steps; }
+
+  // Control flow graph edits (insertions, deletions and next node changes) are
+  // applied aside and published at once, register arrays can be resized while
+  // in use and flex triggers are a single atomic store (see FlexVersion), so
+  // packet processing only has to be stopped for register array deletions.
+  bool needs_quiesce() const;
+
+  // Names, in the new program, of the tables and conditionals inserted by the
+  // plan; this is all we need to load from the new JSON.
+  std::set<std::string> get_inserted_node_names() const;
+
+ private:
+  RuntimeReconfigErrorCode resolve_commit_ids(
+      const std::unordered_map<std::string, std::string> &id2newNodeName) const;
+
+  std::vector<ReconfigStep> steps{};
+  std::shared_ptr<P4Objects> new_objects{nullptr};
+};
+
+// FlexCore: latency histograms for runtime reconfiguration, one per step type
+// plus one per phase of the plan execution (prepare, quiesce, commit,
+// publish, total). Buckets are powers of 2 in microseconds.
+class ReconfigStats {
+ public:
+  using clock = std::chrono::steady_clock;
+
+  void record(const std::string &name, clock::duration latency);
+
+  void reset();
+
+  // Human-readable dump, one line per histogram, used by the runtime CLI.
+  std::string to_string() const;
+
+ private:
+  static constexpr size_t nb_buckets = 24;
+
+  struct Histogram {
+    uint64_t count{0};
+    uint64_t total_ns{0};
+    uint64_t max_ns{0};
+    std::array<uint64_t, nb_buckets> buckets{};
+  };
+
+  mutable std::mutex mutex{};
+  std::map<std::string, Histogram> histograms{};
+};
+
+}  // namespace bm
+
+#endif  // BM_BM_SIM_RUNTIME_RECONFIG_PLAN_H_
@@ -24,6 +24,8 @@
 #ifndef BM_BM_SIM_SIMPLE_PRE_H_
 #define BM_BM_SIM_SIMPLE_PRE_H_
 
+#include <atomic>
+#include <memory>
 #include <string>
 #include <unordered_map>
 #include <vector>
@@ -32,6 +34,7 @@
 
 #include "handle_mgr.h"
 #include "pre.h"
+#include "published_ptr.h"
 
 // forward declaration of Json::Value
 namespace Json {
@@ -88,7 +91,28 @@ class McSimplePre {
   static constexpr size_t LAG_MAP_SIZE = 256;
   using LagMap = McPre::Set<LAG_MAP_SIZE>;
 
-  McSimplePre() {}
+  //! The replicas of a multicast group, as returned by get_replication_list().
+  //! The list cannot change while this object exists.
+  class ReplicationList {
+   public:
+    using const_iterator = std::vector<McOut>::const_iterator;
+
+    const_iterator begin() const { return list->begin(); }
+    const_iterator end() const { return list->end(); }
+    size_t size() const { return list->size(); }
+    bool empty() const { return list->empty(); }
+
+   private:
+    friend class McSimplePre;
+
+    explicit ReplicationList(std::shared_ptr<const std::vector<McOut> > list)
+        : list(std::move(list)) { }
+
+    std::shared_ptr<const std::vector<McOut> > list;
+  };
+
+  McSimplePre();
+  virtual ~McSimplePre() = default;
   McReturnCode mc_mgrp_create(const mgrp_t, mgrp_hdl_t *);
   McReturnCode mc_mgrp_destroy(const mgrp_hdl_t);
   McReturnCode mc_node_create(const rid_t,
@@ -104,9 +128,10 @@ class McSimplePre {
 
   void reset_state();
 
-  //! This is the only "dataplane" method for this class. It takes as input a
-  //! multicast group id (set during pipeline processing) and returns a vector
-  //! of McOut instances (rid + egress port).
+  //! This is the "dataplane" method for this class, along with
+  //! get_replication_list(). It takes as input a multicast group id (set
+  //! during pipeline processing) and returns a vector of McOut instances (rid +
+  //! egress port).
   //!
   //! The mgid (multicast group id) points to a L1 (level 1) node. Each L1 node
   //! has a unique rid and points to a L2 node. The L2 node includes a list of
@@ -128,6 +153,13 @@ class McSimplePre {
   //! @endcode
   std::vector<McOut> replicate(const McIn) const;
 
+  //! Same as replicate(), but returns the list of replicas maintained by the
+  //! PRE instead of a copy: this does not take any lock nor allocate
+  //! memory. The list is rebuilt (and published atomically) whenever the
+  //! control plane modifies the multicast group; the returned list is shared
+  //! with the PRE and remains valid after that.
+  ReplicationList get_replication_list(const McIn) const;
+
   //! Deleted copy constructor
   McSimplePre(const McSimplePre &other) = delete;
   //! Deleted move assignment operator
@@ -179,6 +211,17 @@ class McSimplePre {
   // internal version, which does not acquire the lock
   void reset_state_();
 
+  // does not acquire lock; appends the copies of an L1 node to list
+  virtual void append_replicas(const L1Entry &l1_entry,
+                               const L2Entry &l2_entry,
+                               std::vector<McOut> *list) const;
+
+  // does not acquire lock; rebuilds and publishes the list of replicas of a
+  // multicast group (or removes it if the group no longer exists)
+  void update_replication_list(mgrp_hdl_t mgrp_hdl);
+  // does not acquire lock; rebuilds and publishes all the lists
+  void update_replication_lists();
+
   // does not acquire lock
   void get_entries_common(Json::Value *root) const;
 
@@ -191,6 +234,40 @@ class McSimplePre {
   HandleMgr l1_handles{};
   HandleMgr l2_handles{};
   mutable boost::shared_mutex mutex{};
+
+ private:
+  using ReplicaList = std::shared_ptr<const std::vector<McOut> >;
+
+  // Flattened list of replicas of a multicast group, so that the dataplane
+  // does not walk the L1 and L2 nodes (nor acquire the lock) for every
+  // packet. Replacing the list of a group does not affect the other groups.
+  struct Group {
+    explicit Group(const ReplicaList *replicas)
+        : replicas(replicas) { }
+    ~Group() { delete replicas.load(); }
+
+    std::atomic<const ReplicaList *> replicas;
+  };
+
+  // the groups as seen by the dataplane; only changes when a group is created
+  // or destroyed
+  using GroupIndex = std::unordered_map<mgrp_t, const Group *>;
+
+  // what a control plane call unlinked from the groups seen by the dataplane;
+  // freed once the packets which may still use it are done
+  struct Retired {
+    std::vector<std::unique_ptr<const ReplicaList> > lists{};
+    std::vector<std::unique_ptr<Group> > groups{};
+  };
+
+  // does not acquire lock; returns true if the group was created or destroyed
+  bool rebuild_group(mgrp_hdl_t mgrp_hdl, Retired *retired);
+  // publishes the groups if index_changed is true, then waits for the readers
+  // of the retired objects to be done
+  void publish_groups(bool index_changed, const Retired &retired);
+
+  std::unordered_map<mgrp_hdl_t, std::unique_ptr<Group> > groups{};
+  PublishedPtr<GroupIndex> published_groups{};
 };
 
 }  // namespace bm
@@ -54,9 +54,11 @@ class McSimplePreLAG : public McSimplePre {
 
   void reset_state();
 
-  std::vector<McOut> replicate(const McIn) const;
-
  private:
+  // adds the LAG member ports to the replicas of the node
+  void append_replicas(const L1Entry &l1_entry, const L2Entry &l2_entry,
+                       std::vector<McOut> *list) const override;
+
   struct LagEntry {
     uint16_t member_count;
     PortMap port_map{};
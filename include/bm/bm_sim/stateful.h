@@ -35,15 +35,18 @@
 #ifndef BM_BM_SIM_STATEFUL_H_
 #define BM_BM_SIM_STATEFUL_H_
 
+#include <array>
+#include <atomic>
 #include <functional>
+#include <iterator>
+#include <memory>
 #include <mutex>
+#include <stdexcept>
 #include <string>
 #include <unordered_set>
 #include <unordered_map>
 #include <vector>
 
-#include <boost/thread/locks.hpp>  // for boost::lock
-
 #include "bignum.h"
 #include "data.h"
 #include "named_p4object.h"
@@ -52,10 +55,14 @@
 namespace bm {
 
 class RegisterArray;  // forward declaration
+struct RegisterChunk;  // forward declaration
 
 //! A Register object is essentially just a Data object, meant to live in a
 //! RegisterArray. Use the Data class methods to read and write to a Register.
 class Register : public Data {
+  friend class RegisterArray;
+  friend struct RegisterChunk;
+
  public:
   enum RegisterErrorCode {
     SUCCESS = 0,
@@ -65,22 +72,37 @@ class Register : public Data {
   };
 
  public:
-  Register(int nbits, const RegisterArray *register_array);
+  explicit Register(const RegisterChunk *chunk);
 
   void export_bytes() override;
 
-  void set_bitwidth(int bit_width) {
-    mask = 1;
-    mask <<= bit_width;
-    mask -= 1;
-    export_bytes();
-  }
-
  private:
-  Bignum mask{1};
-  // keep a pointer to parent RegisterArray so that export_bytes() can notify
-  // write operations
+  void apply_mask();
+
+  // the bitwidth is the same for all the registers in a chunk, and the chunk
+  // has a pointer to the parent RegisterArray, so that export_bytes() can
+  // notify write operations
+  const RegisterChunk *chunk;
+};
+
+// A RegisterArray stores its registers in chunks of at most
+// RegisterArray::chunk_size registers. Chunks are never resized, so that
+// register addresses remain valid, but they can be shared by successive
+// versions of the array (see RegisterArray::resize()).
+struct RegisterChunk {
+  RegisterChunk(const RegisterArray *register_array, size_t base, size_t size,
+                int bitwidth);
+
+  // masks the current values if the bitwidth decreases
+  void set_bitwidth(int bitwidth);
+
   const RegisterArray *register_array;
+  // index of the first register of the chunk in the array
+  size_t base;
+  Bignum mask{1};
+  // same as mask, used when the value fits in 64 bits
+  uint64_t mask_u64{0};
+  std::vector<Register> registers{};
 };
 
 using register_array_id_t = p4object_id_t;
@@ -100,11 +122,81 @@ class RegisterArray : public NamedP4Object {
   friend class RegisterSync;
   friend class Register;
 
- public:
-  using iterator = std::vector<Register>::iterator;
-  using const_iterator = std::vector<Register>::const_iterator;
+  template <typename RA, typename R>
+  class IteratorImpl {
+   public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = Register;
+    using difference_type = std::ptrdiff_t;
+    using pointer = R *;
+    using reference = R &;
+
+    IteratorImpl(RA *register_array, size_t idx)
+        : register_array(register_array), idx(idx) { }
+
+    reference operator*() const { return (*register_array)[idx]; }
+    pointer operator->() const { return &(*register_array)[idx]; }
+
+    IteratorImpl &operator++() {
+      idx++;
+      return *this;
+    }
+
+    IteratorImpl operator++(int) {
+      IteratorImpl tmp(*this);
+      idx++;
+      return tmp;
+    }
+
+    bool operator==(const IteratorImpl &other) const {
+      return register_array == other.register_array && idx == other.idx;
+    }
+
+    bool operator!=(const IteratorImpl &other) const {
+      return !(*this == other);
+    }
+
+   private:
+    RA *register_array;
+    size_t idx;
+  };
 
-  using UniqueLock = std::unique_lock<std::mutex>;
+ public:
+  using iterator = IteratorImpl<RegisterArray, Register>;
+  using const_iterator = IteratorImpl<const RegisterArray, const Register>;
+
+  //! Maximum number of registers in a chunk. The registers are stored in
+  //! chunks which are never moved in memory, which lets resize() re-use them.
+  static constexpr size_t chunk_size = 4096;
+
+  //! The cells are protected by a fixed number of mutexes (stripes), the cell
+  //! at index `idx` being protected by stripe `idx % nb_stripes`. Threads
+  //! accessing different cells of a "hot" register array therefore do not
+  //! contend unless the cells share a stripe.
+  static constexpr size_t nb_stripes = 16;
+
+  //! Lock on a single stripe, see cell_lock()
+  using CellLock = std::unique_lock<std::mutex>;
+
+  //! Exclusive access to the whole register array, obtained by locking all the
+  //! stripes in order, see unique_lock()
+  class UniqueLock {
+   public:
+    UniqueLock() = default;
+
+    explicit UniqueLock(const RegisterArray &register_array) {
+      for (size_t i = 0; i < nb_stripes; i++)
+        locks[i] = CellLock(register_array.stripes[i].mutex);
+    }
+
+    void unlock() {
+      for (auto &lock : locks)
+        if (lock.owns_lock()) lock.unlock();
+    }
+
+   private:
+    std::array<CellLock, nb_stripes> locks{};
+  };
 
   //! Used to notify listeners that a write occurred in the array at \p idx. You
   //! can register your own notifier function by calling register_notifier().
@@ -113,51 +205,74 @@ class RegisterArray : public NamedP4Object {
   RegisterArray(const std::string &name, p4object_id_t id,
                 size_t size, int bitwidth);
 
+  ~RegisterArray();
+
   //! Access the register at position \p idx, asserts if bad \p idx
   Register &operator[](size_t idx) {
     assert(idx < size());
-    return registers[idx];
+    return get_table()->get(idx);
   }
 
   //! @copydoc operator[]
   const Register &operator[](size_t idx) const {
     assert(idx < size());
-    return registers[idx];
+    return get_table()->get(idx);
   }
 
   //! Access the register at position \p idx, throws a std::out_of_range
   //! exception if \p idx is invalid
   Register &at(size_t idx) {
-    return registers.at(idx);
+    if (idx >= size()) throw std::out_of_range("invalid register index");
+    return get_table()->get(idx);
   }
 
   //! @copydoc at
   const Register &at(size_t idx) const {
-    return registers.at(idx);
+    if (idx >= size()) throw std::out_of_range("invalid register index");
+    return get_table()->get(idx);
   }
 
   // iterators
 
   //! NC
-  iterator begin() { return registers.begin(); }
+  iterator begin() { return iterator(this, 0); }
 
   //! NC
-  const_iterator begin() const { return registers.begin(); }
+  const_iterator begin() const { return const_iterator(this, 0); }
 
   //! NC
-  iterator end() { return registers.end(); }
+  iterator end() { return iterator(this, size()); }
 
   //! NC
-  const_iterator end() const { return registers.end(); }
+  const_iterator end() const { return const_iterator(this, size()); }
 
   //! Return the size of the RegisterArray (i.e. number of registers it
   //! includes)
-  size_t size() const { return registers.size(); }
-
-  int get_bitwidth() const { return bitwidth; }
-
-  void set_bitwidth(int bitwidth) { this->bitwidth = bitwidth;  }
-
+  size_t size() const { return nb_registers.load(std::memory_order_acquire); }
+
+  int get_bitwidth() const { return bitwidth.load(); }
+
+  //! Changes the bitwidth of all the registers, the current values are masked
+  //! if the bitwidth decreases. The chunks are updated one at a time, each one
+  //! with exclusive access to the array, so that packets accessing the array
+  //! are only stalled for the time it takes to update a single chunk.
+  void set_bitwidth(int bitwidth);
+
+  //! Changes the number of registers in the array. The values of the first
+  //! `min(size(), new_size)` registers are preserved and the other registers
+  //! are initialized to 0. The new version of the array is built without
+  //! holding the array lock, re-using all the existing chunks except for the
+  //! last one if it is too small (the registers of these chunks which are
+  //! beyond the current size are reset with their stripe held, one stripe at a
+  //! time), and is then published with an atomic pointer swap (RCU-style).
+  //! Exclusive access to the array is only required to copy the values of
+  //! that last chunk and swap the pointers. The stripes are the
+  //! read-side critical sections: every access to a register is done with a
+  //! stripe held, so the previous version can be released right away.
+  void resize(size_t new_size);
+
+  //! Resets all the registers to 0, the new registers are allocated without
+  //! holding any lock (see resize()).
   void reset_state();
 
   //! Register your own notifier function. Every time a write operation is
@@ -169,26 +284,64 @@ class RegisterArray : public NamedP4Object {
   //! Request exclusive access to this register array. This method needs to be
   //! called when the target needs to read or write a register. Note that it is
   //! never necessary to call this method in a primitive action, since when an
-  //! action is executed, it is guaranteed exclusive access to all the register
-  //! arrays it reads or writes.
-  UniqueLock unique_lock() const { return UniqueLock(m_mutex); }
+  //! action is executed, it is guaranteed exclusive access to the register
+  //! cells (or the whole register arrays) it reads or writes.
+  UniqueLock unique_lock() const { return UniqueLock(*this); }
   // NOLINTNEXTLINE(runtime/references)
   void unlock(UniqueLock &lock) const { lock.unlock(); }
 
-  //! Exchange the underlying memory of this register array with registers_new.
-  //! This function is used to quickly update the content of a register array.
-  //! @param registers_new a vector of new registers to be swapped with the registers in this register array
-  void reset_registers_with(std::vector<Register>& registers_new) { 
-    registers.swap(registers_new); 
-    registers_new.clear();
+  //! Request access to the register at position \p idx only. This is enough
+  //! to read or write that register, and to call size(): resizing the array
+  //! requires unique_lock(), which waits for all the stripes.
+  CellLock cell_lock(size_t idx) const { return CellLock(stripe_mutex(idx)); }
+
+  //! Returns the mutex protecting the register at position \p idx
+  std::mutex &stripe_mutex(size_t idx) const {
+    return stripes[idx % nb_stripes].mutex;
   }
 
+  //! Deleted copy constructor
+  RegisterArray(const RegisterArray &other) = delete;
+  //! Deleted copy assignment operator
+  RegisterArray &operator=(const RegisterArray &other) = delete;
+
  private:
+  // a version of the array, only modified before it is published
+  struct Table {
+    Register &get(size_t idx) const {
+      return chunks[idx / chunk_size]->registers[idx % chunk_size];
+    }
+
+    std::vector<std::shared_ptr<RegisterChunk> > chunks{};
+  };
+
+  Table *get_table() const { return table.load(std::memory_order_acquire); }
+
+  // appends new chunks to new_table until it can hold new_size registers
+  void add_chunks(Table *new_table, size_t new_size) const;
+
+  // resets registers [begin, end) of chunk, holding the stripe of each one
+  void reset_registers(RegisterChunk *chunk, size_t begin, size_t end) const;
+
+  // publishes new_table while holding exclusive access to the array, the
+  // previous table is returned
+  std::unique_ptr<Table> publish(std::unique_ptr<Table> new_table,
+                                 size_t new_size);
+
   void notify(const Register &reg) const;
 
-  std::vector<Register> registers{};
-  mutable std::mutex m_mutex{};
-  int bitwidth{};
+  struct Stripe {
+    std::mutex mutex{};
+    // keep stripes on different cache lines, to avoid false sharing
+    char pad[64 - sizeof(std::mutex) % 64];
+  };
+
+  std::atomic<Table *> table{nullptr};
+  std::atomic<size_t> nb_registers{0};
+  mutable std::array<Stripe, nb_stripes> stripes{};
+  std::atomic<int> bitwidth{0};
+  // serializes resize(), set_bitwidth() and reset_state()
+  std::mutex resize_mutex{};
   std::vector<Notifier> notifiers{};
 };
 
@@ -196,12 +349,18 @@ class RegisterArray : public NamedP4Object {
 // This class was added to provide some measure of concurrency support for
 // register accesses. Every time an action is executed, this action is given
 // exclusive access to all the registers it is referring to. Same thing for a
-// parse state.
+// parse state. Actions for which every register access is to a single cell,
+// whose index is known before the access, only lock the stripes of these cells
+// (see ActionFn).
+// To avoid deadlocks, all stripes are always locked in increasing address
+// order; since the stripes of a RegisterArray are stored contiguously, this
+// means arrays are locked in increasing address order, and the stripes of one
+// array in increasing index order.
 class RegisterSync {
  public:
-  using Lock = RegisterArray::UniqueLock;
+  using Lock = RegisterArray::CellLock;
 
-  template <size_t NumLocks = 4>
+  template <size_t NumLocks = RegisterArray::nb_stripes>
   using LockVector = std::vector<
     Lock, ::detail::short_alloc<Lock, NumLocks * sizeof(Lock), alignof(Lock)> >;
 
@@ -216,12 +375,20 @@ class RegisterSync {
 
   // tried NRVO, but RegisterLocks not movable
   void lock(RegisterLocks *RL) const {
-    for (auto m : mutexes) RL->v.emplace_back(*m, std::defer_lock);
-    boost::lock(RL->v.begin(), RL->v.end());
+    for (auto m : mutexes) RL->v.emplace_back(*m);
+  }
+
+  bool empty() const { return register_arrays.empty(); }
+
+  // register arrays in locking order
+  const std::vector<const RegisterArray *> &get_register_arrays() const {
+    return sorted_arrays;
   }
 
  private:
-  mutable std::vector<std::mutex *> mutexes{};
+  // sorted by address
+  std::vector<std::mutex *> mutexes{};
+  std::vector<const RegisterArray *> sorted_arrays{};
   std::unordered_set<const RegisterArray *> register_arrays{};
 };
 
@@ -66,6 +66,7 @@
 #include <memory>
 #include <set>
 #include <string>
+#include <tuple>
 #include <typeindex>
 #include <typeinfo>
 #include <unordered_map>
@@ -117,6 +118,10 @@ class SwitchWContexts : public DevMgr, public RuntimeInterface {
 
   int receive(port_t port_num, const char *buffer, int len);
 
+  //! Called by the device manager with a burst of received packets, when the
+  //! backend supports it (see DevMgr::set_burst_handler()).
+  int receive_burst(const BurstPacket *packets, size_t count);
+
   //! Call this function when you are ready to process packets. This function
   //! will call start_and_return_() which you have to override in your switch
   //! implementation. Note that if the switch is started without a P4
@@ -167,6 +172,17 @@ class SwitchWContexts : public DevMgr, public RuntimeInterface {
     return contexts.at(cxt_id).field_exists(header_name, field_name);
   }
 
+  //! Returns the header id and the offset in the header of the given field for
+  //! context \p cxt_id, resolving field aliases. These can be used with
+  //! PHV::get_field(header_id_t, int), which avoids looking up the field by
+  //! name for every packet. The field needs to exist, see field_exists(). The
+  //! values may change when a new config is swapped in.
+  std::tuple<header_id_t, int> field_info(cxt_id_t cxt_id,
+                                          const std::string &header_name,
+                                          const std::string &field_name) const {
+    return contexts.at(cxt_id).field_info(header_name, field_name);
+  }
+
   //! Force arithmetic on field. No effect if field is not defined in the input
   //! JSON. For optimization reasons, only fields on which arithmetic will be
   //! performed receive the ability to perform arithmetic operations. These
@@ -337,6 +353,20 @@ class SwitchWContexts : public DevMgr, public RuntimeInterface {
                                                 reset_default_entry);
   }
 
+  MatchErrorCode
+  mt_get_cache_stats(cxt_id_t cxt_id,
+                     const std::string &table_name,
+                     LookupCacheStats *stats) const override {
+    return contexts.at(cxt_id).mt_get_cache_stats(table_name, stats);
+  }
+
+  MatchErrorCode
+  mt_set_cache_size(cxt_id_t cxt_id,
+                    const std::string &table_name,
+                    size_t size) override {
+    return contexts.at(cxt_id).mt_set_cache_size(table_name, size);
+  }
+
   MatchErrorCode
   mt_add_entry(cxt_id_t cxt_id,
                const std::string &table_name,
@@ -844,7 +874,7 @@ class SwitchWContexts : public DevMgr, public RuntimeInterface {
       return static_cast<int>(RuntimeReconfigErrorCode::OPEN_PLAN_FILE_FAIL);
     }
 
-    int reconfig_return_code = mt_runtime_reconfig_with_stream(0, &json_file_stream, &plan_file_stream);
+    int reconfig_return_code = mt_runtime_reconfig_with_stream(cxt_id, &json_file_stream, &plan_file_stream);
 
     if (reconfig_return_code != static_cast<int>(RuntimeReconfigErrorCode::SUCCESS)) {
       return reconfig_return_code;
@@ -870,11 +900,9 @@ class SwitchWContexts : public DevMgr, public RuntimeInterface {
                                   std::istream* json_file_stream,
                                   std::istream* plan_file_stream,
                                   const std::string& output_json_file = "") {
-    RuntimeReconfigErrorCode reconfig_return_code = contexts.at(cxt_id).mt_runtime_reconfig_with_stream(json_file_stream, 
-                                                                                                        plan_file_stream,
-                                                                                                        get_lookup_factory(),
-                                                                                                        required_fields,
-                                                                                                        arith_objects);
+    RuntimeReconfigErrorCode reconfig_return_code = do_runtime_reconfig(cxt_id,
+                                                                        json_file_stream,
+                                                                        plan_file_stream);
 
     if (reconfig_return_code != RuntimeReconfigErrorCode::SUCCESS) {
       return static_cast<int>(reconfig_return_code);
@@ -897,6 +925,16 @@ class SwitchWContexts : public DevMgr, public RuntimeInterface {
     return static_cast<int>(RuntimeReconfigErrorCode::SUCCESS);
   }
 
+  std::string
+  mt_runtime_reconfig_get_stats(cxt_id_t cxt_id) const {
+    return contexts.at(cxt_id).mt_runtime_reconfig_get_stats();
+  }
+
+  void
+  mt_runtime_reconfig_reset_stats(cxt_id_t cxt_id) {
+    contexts.at(cxt_id).mt_runtime_reconfig_reset_stats();
+  }
+
   // ---------- End RuntimeInterface ----------
 
  protected:
@@ -949,10 +987,25 @@ class SwitchWContexts : public DevMgr, public RuntimeInterface {
 
   void swap_notify();
 
+  // FlexCore: validates the whole plan while packets are still flowing, then
+  // applies it and publishes the new control flow graph. Packet processing for
+  // this context is only stopped (like for do_swap()) if the plan has steps
+  // which cannot be applied while packets are in flight, see
+  // ReconfigPlan::needs_quiesce()
+  RuntimeReconfigErrorCode do_runtime_reconfig(cxt_id_t cxt_id,
+                                               std::istream *json_file_stream,
+                                               std::istream *plan_file_stream);
+
   //! Override in your switch implementation; it will be called every time a
   //! packet is received.
   virtual int receive_(port_t port_num, const char *buffer, int len) = 0;
 
+  //! You can override this method in your switch implementation to process a
+  //! burst of received packets at once (e.g. to enqueue all of them with a
+  //! single lock acquisition). The default implementation calls receive_() for
+  //! each packet.
+  virtual int receive_burst_(const BurstPacket *packets, size_t count);
+
   //! Override in your switch implementation; do all your initialization in this
   //! function (e.g. start processing threads) and call start_and_return() when
   //! you are ready to process packets. See start_and_return() for more
@@ -965,7 +1018,8 @@ class SwitchWContexts : public DevMgr, public RuntimeInterface {
   virtual void reset_target_state_() { }
 
   //! You can override this method in your target. It will be called at the end
-  //! of a config swap operation. At that time, you will be guaranteed that no
+  //! of a config swap operation, as well as at the end of a successful runtime
+  //! reconfiguration. At that time, you will be guaranteed that no
   //! Packet instances exist, as long as your target uses the correct methods to
   //! instantiate these objects (bm::SwitchWContexts::new_packet_ptr() and
   //! bm::SwitchWContexts::new_packet()).
@@ -1037,6 +1091,14 @@ class Switch : public SwitchWContexts {
     return field_exists(0, header_name, field_name);
   }
 
+  // to avoid C++ name hiding
+  using SwitchWContexts::field_info;
+  //! See SwitchWContexts::field_info()
+  std::tuple<header_id_t, int> field_info(const std::string &header_name,
+                                          const std::string &field_name) const {
+    return field_info(0, header_name, field_name);
+  }
+
   // to avoid C++ name hiding
   using SwitchWContexts::new_packet_ptr;
   //! Convenience wrapper around SwitchWContexts::new_packet_ptr() for a single
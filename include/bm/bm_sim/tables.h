@@ -53,6 +53,11 @@ class MatchActionTable : public ControlFlowNode {
 
   const ControlFlowNode *operator()(Packet *pkt) const override;
 
+  // FlexCore: tables only have one next node, see MatchTable::lookup()
+  const ControlFlowNode *get_out_edge(int edge) const override {
+    return (edge == 0) ? match_table->get_next_node_miss() : nullptr;
+  }
+
   MatchTableAbstract *get_match_table() { return match_table.get(); }
 
  public:
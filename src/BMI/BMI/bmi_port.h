@@ -40,6 +40,15 @@ typedef struct bmi_port_stats_s {
    returns. */
 typedef void (*bmi_packet_handler_t)(int port_num, const char *buffer, int len, void *cookie);
 
+typedef struct bmi_packet_s {
+  int port_num;
+  const char *buffer;
+  int len;
+} bmi_packet_t;
+
+/* same as above for each packet of the burst */
+typedef void (*bmi_burst_handler_t)(const bmi_packet_t *packets, int count, void *cookie);
+
 int bmi_port_create_mgr(bmi_port_mgr_t **port_mgr, int max_port_count);
 
 /* Start running the port manager on its own thread */
@@ -49,9 +58,22 @@ int bmi_set_packet_handler(bmi_port_mgr_t *port_mgr,
 			   bmi_packet_handler_t packet_handler,
 			   void *cookie);
 
+/* when a burst handler is set, it is used instead of the packet handler: up to
+   max_burst packets are read from the ready ports at each iteration of the
+   select loop and handed to the burst handler at once */
+int bmi_set_burst_handler(bmi_port_mgr_t *port_mgr,
+			  bmi_burst_handler_t burst_handler,
+			  int max_burst,
+			  void *cookie);
+
 int bmi_port_send(bmi_port_mgr_t *port_mgr,
 		  int port_num, const char *buffer, int len);
 
+/* sends count packets while acquiring the port manager lock only once; returns
+   the number of packets which could not be sent */
+int bmi_port_send_burst(bmi_port_mgr_t *port_mgr,
+			const bmi_packet_t *packets, int count);
+
 int bmi_port_interface_add(bmi_port_mgr_t *port_mgr,
 			   const char *ifname, int port_num,
 			   const char *pcap_input_dump,
@@ -79,6 +79,15 @@ int bmi_interface_create(bmi_interface_t **bmi, const char *device) {
     return -1;
   }
 
+  /* reads are only attempted once select reports the fd as readable, but the
+     port manager keeps reading until there is no packet left (to fill a
+     burst), which must not block */
+  if(pcap_setnonblock(bmi_->pcap, 1, errbuf) != 0) {
+    pcap_close(bmi_->pcap);
+    free(bmi_);
+    return -1;
+  }
+
   bmi_->fd = pcap_get_selectable_fd(bmi_->pcap);
   if(bmi_->fd < 0) {
     pcap_close(bmi_->pcap);
@@ -54,6 +54,15 @@ typedef struct bmi_port_mgr_s {
   int max_fd;
   void *cookie;
   bmi_packet_handler_t packet_handler;
+  bmi_burst_handler_t burst_handler;
+  void *burst_cookie;
+  int max_burst;
+  /* only used by the select thread; bmi_interface_recv does not make a copy
+  and the pcap buffer is reused for the next packet read from the same port, so
+  each packet of the burst is copied to its own buffer */
+  bmi_packet_t *burst;
+  char **burst_bufs;
+  int *burst_buf_sizes;
   pthread_t select_thread;
   /* We use a RW mutex to protect port_mgr and port state. Send & receive will
   acquire a read lock, while port_add and port_remove will acquire a write
@@ -73,6 +82,57 @@ static inline bmi_port_t *get_port(bmi_port_mgr_t *port_mgr, int port_num) {
   return (pinfo == NULL) ? NULL : (bmi_port_t *) *pinfo;
 }
 
+static void free_burst(bmi_port_mgr_t *port_mgr) {
+  int i;
+  for (i = 0; i < port_mgr->max_burst; i++) free(port_mgr->burst_bufs[i]);
+  free(port_mgr->burst);
+  free(port_mgr->burst_bufs);
+  free(port_mgr->burst_buf_sizes);
+  port_mgr->burst = NULL;
+  port_mgr->burst_bufs = NULL;
+  port_mgr->burst_buf_sizes = NULL;
+  port_mgr->max_burst = 0;
+}
+
+/* reads up to max_burst packets from the port and appends them to the current
+burst, which already includes count packets; the burst handler is called every
+time the burst is full. Returns the new size of the burst. */
+static int recv_burst(bmi_port_mgr_t *port_mgr, int port_num,
+                      bmi_port_t *port_info, int count) {
+  const char *pkt_data;
+  int pkt_len;
+  int i;
+  uint64_t in_packets = 0;
+  uint64_t in_octets = 0;
+  for (i = 0; i < port_mgr->max_burst; i++) {
+    pkt_len = bmi_interface_recv(port_info->bmi, &pkt_data);
+    if (pkt_len < 0) break;
+    if (pkt_len > port_mgr->burst_buf_sizes[count]) {
+      char *buf = realloc(port_mgr->burst_bufs[count], pkt_len);
+      assert(buf);
+      port_mgr->burst_bufs[count] = buf;
+      port_mgr->burst_buf_sizes[count] = pkt_len;
+    }
+    memcpy(port_mgr->burst_bufs[count], pkt_data, pkt_len);
+    port_mgr->burst[count].port_num = port_num;
+    port_mgr->burst[count].buffer = port_mgr->burst_bufs[count];
+    port_mgr->burst[count].len = pkt_len;
+    in_packets += 1;
+    in_octets += pkt_len;
+    if (++count == port_mgr->max_burst) {
+      port_mgr->burst_handler(port_mgr->burst, count, port_mgr->burst_cookie);
+      count = 0;
+    }
+  }
+  if (in_packets > 0) {
+    pthread_mutex_lock(&port_info->stats_lock);
+    port_info->stats.in_packets += in_packets;
+    port_info->stats.in_octets += in_octets;
+    pthread_mutex_unlock(&port_info->stats_lock);
+  }
+  return count;
+}
+
 static void *run_select(void *data) {
   bmi_port_mgr_t *port_mgr = (bmi_port_mgr_t *) data;
   int n;
@@ -83,6 +143,7 @@ static void *run_select(void *data) {
   fd_set fds;
   int max_fd;
   Word_t *pinfo;
+  int burst_count;
 
   struct timeval timeout;
   while(1) {
@@ -115,7 +176,7 @@ static void *run_select(void *data) {
 
     pthread_rwlock_rdlock(&port_mgr->lock);
 
-    if (!port_mgr->packet_handler) {
+    if (!port_mgr->packet_handler && !port_mgr->burst_handler) {
       pthread_rwlock_unlock(&port_mgr->lock);
       continue;
     }
@@ -124,12 +185,17 @@ static void *run_select(void *data) {
     overhead to acquire / release the lock at each iteration - we would need to
     hold the lock to call FD_ISSET... */
     port_num = 0;
+    burst_count = 0;
     JLF(pinfo, port_mgr->ports_map, port_num);
     while (n && pinfo != NULL) {
       port_info = (bmi_port_t *) *pinfo;
       assert(port_info->bmi);
 
-      if (FD_ISSET(port_info->fd, &fds)) {
+      if (FD_ISSET(port_info->fd, &fds) && port_mgr->burst_handler) {
+        --n;
+        burst_count = recv_burst(port_mgr, (int) port_num, port_info,
+                                 burst_count);
+      } else if (FD_ISSET(port_info->fd, &fds)) {
         --n;
         pkt_len = bmi_interface_recv(port_info->bmi, &pkt_data);
         if (pkt_len >= 0) {
@@ -146,6 +212,12 @@ static void *run_select(void *data) {
       JLN(pinfo, port_mgr->ports_map, port_num);
     }
 
+    /* one handler call for all the packets read from the ready ports */
+    if (burst_count > 0) {
+      port_mgr->burst_handler(port_mgr->burst, burst_count,
+                              port_mgr->burst_cookie);
+    }
+
     pthread_rwlock_unlock(&port_mgr->lock);
   }
 
@@ -201,6 +273,69 @@ int bmi_set_packet_handler(bmi_port_mgr_t *port_mgr,
   return 0;
 }
 
+int bmi_set_burst_handler(bmi_port_mgr_t *port_mgr,
+                          bmi_burst_handler_t burst_handler,
+                          int max_burst,
+                          void *cookie) {
+  if (max_burst <= 0) return -1;
+  pthread_rwlock_wrlock(&port_mgr->lock);
+  free_burst(port_mgr);
+  port_mgr->burst = calloc(max_burst, sizeof(*port_mgr->burst));
+  port_mgr->burst_bufs = calloc(max_burst, sizeof(*port_mgr->burst_bufs));
+  port_mgr->burst_buf_sizes = calloc(
+      max_burst, sizeof(*port_mgr->burst_buf_sizes));
+  port_mgr->max_burst = max_burst;
+  port_mgr->burst_handler = burst_handler;
+  port_mgr->burst_cookie = cookie;
+  pthread_rwlock_unlock(&port_mgr->lock);
+  return 0;
+}
+
+static void add_out_stats(bmi_port_t *port,
+                          uint64_t *out_packets, uint64_t *out_octets) {
+  if (port && *out_packets > 0) {
+    pthread_mutex_lock(&port->stats_lock);
+    port->stats.out_packets += *out_packets;
+    port->stats.out_octets += *out_octets;
+    pthread_mutex_unlock(&port->stats_lock);
+  }
+  *out_packets = 0;
+  *out_octets = 0;
+}
+
+int bmi_port_send_burst(bmi_port_mgr_t *port_mgr,
+                        const bmi_packet_t *packets, int count) {
+  bmi_port_t *port = NULL;
+  int port_num = -1;
+  uint64_t out_packets = 0;
+  uint64_t out_octets = 0;
+  int nb_errors = 0;
+  int i;
+
+  pthread_rwlock_rdlock(&port_mgr->lock);
+
+  for (i = 0; i < count; i++) {
+    /* consecutive packets usually go out of the same port, in which case the
+    port lookup and the stats update are done once for all of them */
+    if (!port || packets[i].port_num != port_num) {
+      add_out_stats(port, &out_packets, &out_octets);
+      port_num = packets[i].port_num;
+      port = get_port(port_mgr, port_num);
+    }
+    if (!port ||
+        bmi_interface_send(port->bmi, packets[i].buffer, packets[i].len)) {
+      nb_errors++;
+      continue;
+    }
+    out_packets += 1;
+    out_octets += packets[i].len;
+  }
+  add_out_stats(port, &out_packets, &out_octets);
+
+  pthread_rwlock_unlock(&port_mgr->lock);
+  return nb_errors;
+}
+
 int bmi_port_send(bmi_port_mgr_t *port_mgr,
                   int port_num, const char *buffer, int len) {
   pthread_rwlock_rdlock(&port_mgr->lock);
@@ -344,6 +479,7 @@ int bmi_port_destroy_mgr(bmi_port_mgr_t *port_mgr) {
   close(port_mgr->socketpairfd[1]);
 
   pthread_rwlock_destroy(&port_mgr->lock);
+  free_burst(port_mgr);
   free(port_mgr->ports_info);
   int rc;
   JLFA(rc, port_mgr->ports_map);
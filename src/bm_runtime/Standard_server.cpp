@@ -93,6 +93,8 @@ public:
         return TableOperationErrorCode::IMMUTABLE_TABLE_ENTRIES;
       case MatchErrorCode::BAD_ACTION_DATA:
         return TableOperationErrorCode::BAD_ACTION_DATA;
+      case MatchErrorCode::CACHE_DISABLED:
+        return TableOperationErrorCode::CACHE_DISABLED;
       case MatchErrorCode::ERROR:
         return TableOperationErrorCode::ERROR;
       default:
@@ -217,6 +219,37 @@ public:
     }
   }
 
+  void bm_mt_get_cache_stats(BmMtCacheStats& _return, const int32_t cxt_id, const std::string& table_name) {
+    Logger::get()->trace("bm_mt_get_cache_stats");
+    LookupCacheStats stats;
+    auto error_code = switch_->mt_get_cache_stats(cxt_id, table_name, &stats);
+    if(error_code != MatchErrorCode::SUCCESS) {
+      InvalidTableOperation ito;
+      ito.code = get_exception_code(error_code);
+      throw ito;
+    }
+    _return.size = static_cast<int64_t>(stats.size);
+    _return.hits = static_cast<int64_t>(stats.hits);
+    _return.misses = static_cast<int64_t>(stats.misses);
+    _return.evictions = static_cast<int64_t>(stats.evictions);
+  }
+
+  void bm_mt_set_cache_size(const int32_t cxt_id, const std::string& table_name, const int32_t size) {
+    Logger::get()->trace("bm_mt_set_cache_size");
+    if (size < 0) {
+      InvalidTableOperation ito;
+      ito.code = TableOperationErrorCode::ERROR;
+      throw ito;
+    }
+    auto error_code = switch_->mt_set_cache_size(
+        cxt_id, table_name, static_cast<size_t>(size));
+    if(error_code != MatchErrorCode::SUCCESS) {
+      InvalidTableOperation ito;
+      ito.code = get_exception_code(error_code);
+      throw ito;
+    }
+  }
+
   BmEntryHandle bm_mt_add_entry(const int32_t cxt_id, const std::string& table_name, const BmMatchParams& match_key, const std::string& action_name, const BmActionData& action_data, const BmAddEntryOptions& options) {
     Logger::get()->trace("bm_table_add_entry");
     entry_handle_t entry_handle;
@@ -260,6 +293,16 @@ public:
     }
   }
 
+  void bm_mt_runtime_reconfig_get_stats(std::string& _return, const int32_t cxt_id) {
+    Logger::get()->trace("bm_mt_runtime_reconfig_get_stats");
+    _return.append(switch_->mt_runtime_reconfig_get_stats(cxt_id));
+  }
+
+  void bm_mt_runtime_reconfig_reset_stats(const int32_t cxt_id) {
+    Logger::get()->trace("bm_mt_runtime_reconfig_reset_stats");
+    switch_->mt_runtime_reconfig_reset_stats(cxt_id);
+  }
+
   void bm_mt_set_default_action(const int32_t cxt_id, const std::string& table_name, const std::string& action_name, const BmActionData& action_data) {
     Logger::get()->trace("bm_set_default_action");
     ActionData data;
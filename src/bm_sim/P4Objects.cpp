@@ -605,6 +605,103 @@ const T &get_object(const std::unordered_map<std::string, T> &map,
   return it->second;
 }
 
+// FlexCore: builds the configuration loaded by P4Objects::init_objects_delta
+// from the JSON of the new program (full or delta) and from the configuration
+// of the running program
+Json::Value
+build_delta_cfg(const Json::Value &cfg_delta, const Json::Value &cfg_base,
+                const std::set<std::string> &node_names) {
+  Json::Value cfg_root(Json::objectValue);
+
+  // the inserted nodes process the PHVs of the running program, so we always
+  // use its header layout, even if the new JSON comes with its own copy
+  static const char *const base_keys[] = {
+    "__meta__", "enums", "header_types", "headers", "header_stacks",
+    "header_union_types", "header_unions", "header_union_stacks",
+    "field_aliases", "errors", "field_lists", "learn_lists", "force_arith"};
+  for (const char *key : base_keys) {
+    if (cfg_base.isMember(key)) cfg_root[key] = cfg_base[key];
+  }
+  if (cfg_delta.isMember("program"))
+    cfg_root["program"] = cfg_delta["program"];
+  if (cfg_delta.isMember("calculations"))
+    cfg_root["calculations"] = cfg_delta["calculations"];
+
+  std::set<int> action_ids;
+  std::set<string> action_names;  // old JSON format
+  std::set<string> act_prof_names;
+  std::set<string> direct_meter_names;
+
+  auto &cfg_pipelines = cfg_root["pipelines"] = Json::Value(Json::arrayValue);
+  for (const auto &cfg_pipeline : cfg_delta["pipelines"]) {
+    Json::Value pipeline(Json::objectValue);
+    for (const auto &key : cfg_pipeline.getMemberNames()) {
+      if (key == "tables" || key == "conditionals" ||
+          key == "action_profiles" || key == "action_calls")
+        continue;
+      pipeline[key] = cfg_pipeline[key];
+    }
+
+    auto &tables = pipeline["tables"] = Json::Value(Json::arrayValue);
+    for (const auto &cfg_table : cfg_pipeline["tables"]) {
+      if (node_names.find(cfg_table["name"].asString()) == node_names.end())
+        continue;
+      tables.append(cfg_table);
+      for (const auto &cfg_action_id : cfg_table["action_ids"])
+        action_ids.insert(cfg_action_id.asInt());
+      for (const auto &cfg_action_name : cfg_table["actions"])
+        action_names.insert(cfg_action_name.asString());
+      if (cfg_table.isMember("default_entry"))
+        action_ids.insert(cfg_table["default_entry"]["action_id"].asInt());
+      for (const auto &cfg_entry : cfg_table["entries"])
+        action_ids.insert(cfg_entry["action_entry"]["action_id"].asInt());
+      if (cfg_table.isMember("action_profile"))
+        act_prof_names.insert(cfg_table["action_profile"].asString());
+      if (cfg_table.isMember("direct_meters") &&
+          !cfg_table["direct_meters"].isNull())
+        direct_meter_names.insert(cfg_table["direct_meters"].asString());
+    }
+
+    auto &conditionals = pipeline["conditionals"] =
+        Json::Value(Json::arrayValue);
+    for (const auto &cfg_conditional : cfg_pipeline["conditionals"]) {
+      if (node_names.find(cfg_conditional["name"].asString()) ==
+          node_names.end())
+        continue;
+      conditionals.append(cfg_conditional);
+    }
+
+    auto &act_profs = pipeline["action_profiles"] =
+        Json::Value(Json::arrayValue);
+    for (const auto &cfg_act_prof : cfg_pipeline["action_profiles"]) {
+      if (act_prof_names.find(cfg_act_prof["name"].asString()) !=
+          act_prof_names.end())
+        act_profs.append(cfg_act_prof);
+    }
+
+    cfg_pipelines.append(pipeline);
+  }
+
+  auto &actions = cfg_root["actions"] = Json::Value(Json::arrayValue);
+  for (const auto &cfg_action : cfg_delta["actions"]) {
+    if (action_ids.find(cfg_action["id"].asInt()) != action_ids.end() ||
+        action_names.find(cfg_action["name"].asString()) != action_names.end())
+      actions.append(cfg_action);
+  }
+
+  // direct meters belong to their table, the other meter arrays are shared
+  // with the running program
+  auto &meter_arrays = cfg_root["meter_arrays"] =
+      Json::Value(Json::arrayValue);
+  for (const auto &cfg_meter_array : cfg_delta["meter_arrays"]) {
+    if (direct_meter_names.find(cfg_meter_array["name"].asString()) !=
+        direct_meter_names.end())
+      meter_arrays.append(cfg_meter_array);
+  }
+
+  return cfg_root;
+}
+
 }  // namespace
 
 struct P4Objects::InitState {
@@ -1078,6 +1175,16 @@ P4Objects::init_parsers(const Json::Value &cfg_root, InitState *init_state) {
               std::get<0>(dest), std::get<1>(dest),
               std::get<0>(src), std::get<1>(src));
             enable_arith(std::get<0>(src), std::get<1>(src));
+          } else if (src_type == "hexstr" &&
+                     parse_state.get() == flex_init_state &&
+                     cfg_dest["value"][1].asString() ==
+                         "flexMetadata.version") {
+            // FlexCore: the constant is only the initial version, each packet
+            // is given the current one, see flex_trigger_rt()
+            flex_version.set(Data(cfg_src["value"].asString()).get<
+                FlexVersion::version_t>());
+            parse_state->add_set_from_flex_version(
+              std::get<0>(dest), std::get<1>(dest), &flex_version);
           } else if (src_type == "hexstr") {
             parse_state->add_set_from_data(
               std::get<0>(dest), std::get<1>(dest),
@@ -1491,6 +1598,7 @@ P4Objects::init_actions(const Json::Value &cfg_root) {
     const auto &cfg_primitive_calls = cfg_action["primitives"];
     for (const auto &cfg_primitive_call : cfg_primitive_calls)
       add_primitive_to_action(cfg_primitive_call, action_fn.get());
+    action_fn->finalize_register_accesses();
 
     add_action(action_id, std::move(action_fn));
   }
@@ -1670,6 +1778,8 @@ P4Objects::init_pipelines(const Json::Value &cfg_root,
       if (with_selection) {
         auto calc = process_cfg_selector(cfg_act_prof["selector"]);
         action_profile->set_hash(std::move(calc));
+        auto selector = lookup_factory->create_group_selector();
+        if (selector) action_profile->set_group_selector(selector);
       }
       add_action_profile(act_prof_name, std::move(action_profile));
     }
@@ -1795,6 +1905,8 @@ P4Objects::init_pipelines(const Json::Value &cfg_root,
           assert(cfg_table.isMember("selector"));
           auto calc = process_cfg_selector(cfg_table["selector"]);
           action_profile->set_hash(std::move(calc));
+          auto selector = lookup_factory->create_group_selector();
+          if (selector) action_profile->set_group_selector(selector);
         }
       } else {
         throw json_exception(
@@ -1869,9 +1981,7 @@ P4Objects::init_pipelines(const Json::Value &cfg_root,
 
       auto get_next_node = [this](const Json::Value &cfg_next_node)
           -> const ControlFlowNode *{
-        if (cfg_next_node.isNull())
-          return nullptr;
-        return get_control_node_cfg(cfg_next_node.asString());
+        return get_next_node_cfg(cfg_next_node);
       };
 
       std::string act_prof_name("");
@@ -2021,11 +2131,11 @@ P4Objects::init_pipelines(const Json::Value &cfg_root,
       const auto &cfg_false_next = cfg_conditional["false_next"];
 
       if (!cfg_true_next.isNull()) {
-        auto next_node = get_control_node_cfg(cfg_true_next.asString());
+        auto next_node = get_next_node_cfg(cfg_true_next);
         conditional->set_next_node_if_true(next_node);
       }
       if (!cfg_false_next.isNull()) {
-        auto next_node = get_control_node_cfg(cfg_false_next.asString());
+        auto next_node = get_next_node_cfg(cfg_false_next);
         conditional->set_next_node_if_false(next_node);
       }
     }
@@ -2043,11 +2153,8 @@ P4Objects::init_pipelines(const Json::Value &cfg_root,
       }
     }
 
-    ControlFlowNode *first_node = nullptr;
-    if (!cfg_pipeline["init_table"].isNull()) {
-      const string first_node_name = cfg_pipeline["init_table"].asString();
-      first_node = get_control_node_cfg(first_node_name);
-    }
+    ControlFlowNode *first_node =
+        get_next_node_cfg(cfg_pipeline["init_table"]);
 
     Pipeline *pipeline = new Pipeline(pipeline_name, pipeline_id, first_node);
     add_pipeline(pipeline_name, unique_ptr<Pipeline>(pipeline));
@@ -2058,6 +2165,15 @@ void
 P4Objects::init_checksums(const Json::Value &cfg_root) {
   DupIdChecker dup_id_checker("checksum");
   const Json::Value &cfg_checksums = cfg_root["checksums"];
+  // see CalcBasedChecksum::set_verifier()
+  struct CalcBasedChecksumInfo {
+    CalcBasedChecksum *checksum;
+    header_id_t header_id;
+    int field_offset;
+    const NamedCalculation *calculation;
+  };
+  std::vector<CalcBasedChecksumInfo> verify_checksums;
+  std::vector<CalcBasedChecksumInfo> update_checksums;
   for (const auto &cfg_checksum : cfg_checksums) {
     const string checksum_name = cfg_checksum["name"].asString();
     p4object_id_t checksum_id = cfg_checksum["id"].asInt();
@@ -2072,6 +2188,8 @@ P4Objects::init_checksums(const Json::Value &cfg_root) {
     enable_arith(header_id, field_offset);
 
     Checksum *checksum;
+    CalcBasedChecksumInfo calc_info = {nullptr, header_id, field_offset,
+                                       nullptr};
     if (checksum_type == "ipv4") {
       checksum = new IPv4Checksum(checksum_name, checksum_id,
                                   header_id, field_offset);
@@ -2080,8 +2198,10 @@ P4Objects::init_checksums(const Json::Value &cfg_root) {
       const string calculation_name = cfg_checksum["calculation"].asString();
       NamedCalculation *calculation = get_named_calculation_cfg(
           calculation_name);
-      checksum = new CalcBasedChecksum(checksum_name, checksum_id,
-                                       header_id, field_offset, calculation);
+      calc_info.checksum = new CalcBasedChecksum(
+          checksum_name, checksum_id, header_id, field_offset, calculation);
+      calc_info.calculation = calculation;
+      checksum = calc_info.checksum;
     }
 
     const Json::Value true_value(true);
@@ -2101,12 +2221,27 @@ P4Objects::init_checksums(const Json::Value &cfg_root) {
       for (auto it = deparsers.begin(); it != deparsers.end(); ++it) {
         it->second->add_checksum(checksum);
       }
+      if (calc_info.checksum) update_checksums.push_back(calc_info);
     }
 
     if (do_verify) {
       for (auto it = parsers.begin(); it != parsers.end(); ++it) {
         it->second->add_checksum(checksum);
       }
+      if (calc_info.checksum) verify_checksums.push_back(calc_info);
+    }
+  }
+
+  // P4_16 programs have distinct checksums (and calculations) for verification
+  // and update, so we look for one with the same target field and input
+  for (const auto &u : update_checksums) {
+    const auto &u_builder = u.calculation->get_buf_builder();
+    for (const auto &v : verify_checksums) {
+      if (u.header_id == v.header_id && u.field_offset == v.field_offset &&
+          u_builder == v.calculation->get_buf_builder()) {
+        u.checksum->set_verifier(v.checksum);
+        break;
+      }
     }
   }
 }
@@ -2197,15 +2332,48 @@ P4Objects::init_objects(std::istream *is,
                         std::shared_ptr<TransportIface> notifications_transport,
                         const std::set<header_field_pair> &required_fields,
                         const ForceArith &arith_objects) {
+  Json::Value cfg_root;
+  (*is) >> cfg_root;
+
+  prepare_flex_hdr_parser(cfg_root);
+
+  return init_objects_from_cfg(cfg_root, lookup_factory, device_id, cxt_id,
+                               notifications_transport, required_fields,
+                               arith_objects);
+}
+
+int
+P4Objects::init_objects_delta(
+    std::istream *is, const P4Objects &base,
+    const std::set<std::string> &node_names,
+    LookupStructureFactory *lookup_factory,
+    device_id_t device_id, cxt_id_t cxt_id,
+    std::shared_ptr<TransportIface> notifications_transport,
+    const std::set<header_field_pair> &required_fields,
+    const ForceArith &arith_objects) {
+  Json::Value cfg_delta;
+  (*is) >> cfg_delta;
+
+  base_objects = &base;
+
+  return init_objects_from_cfg(
+      build_delta_cfg(cfg_delta, base.get_cfg(), node_names),
+      lookup_factory, device_id, cxt_id, notifications_transport,
+      required_fields, arith_objects);
+}
+
+int
+P4Objects::init_objects_from_cfg(
+    const Json::Value &cfg_root, LookupStructureFactory *lookup_factory,
+    device_id_t device_id, cxt_id_t cxt_id,
+    std::shared_ptr<TransportIface> notifications_transport,
+    const std::set<header_field_pair> &required_fields,
+    const ForceArith &arith_objects) {
   tableIdCount = 0;
   actionIdCount = 0;
   conditionalIdCount = 0;
   conditionalNameMax = 0;
   registerArrayIdCount = 0;
-  Json::Value cfg_root;
-  (*is) >> cfg_root;
-
-  prepare_flex_hdr_parser(cfg_root);
 
   this->cfg_root = cfg_root;
 
@@ -2330,6 +2498,8 @@ P4Objects::init_objects(std::istream *is,
 
   parse_config_options(cfg_root);
 
+  control_flow_graph.publish();
+
   return 0;
 }
 
@@ -2990,16 +3160,20 @@ P4Objects::insert_match_table_rt(std::shared_ptr<P4Objects> p4objects_new,
   // This means the header_id, field_offset of old and new programs are the same
   // TODO: Support different header and field definition
 
-  if (match_table->get_with_ageing()) {
-    std::cout << "Flexcore: Error: We don't support ageing table yet" << std::endl;
-    // ageing_monitor->add_table(table->get_match_table());
-  }
-
-  std::unique_ptr<MatchActionTable> unique_ptr_table(table_ptr);
+  // the table is moved out of the new objects, which can be released before
+  // the live ones
+  std::unique_ptr<MatchActionTable> unique_ptr_table(
+      p4objects_new->match_action_tables_map.at(name).release());
+  p4objects_new->match_action_tables_map.erase(name);
+  p4objects_new->remove_control_node(name);
   add_match_action_table(table_name, std::move(unique_ptr_table));
 
   MatchTableAbstract *table = get_abstract_match_table(table_name);
 
+  // the monitor starts tracking the entries of the table at its next sweep
+  if (table != nullptr && table->get_with_ageing())
+    ageing_monitor->add_table(table);
+
   if (table != nullptr) {
     auto abstract_table = get_abstract_match_table_rt(table_name);
     if (!abstract_table) {
@@ -3023,6 +3197,16 @@ P4Objects::insert_match_table_rt(std::shared_ptr<P4Objects> p4objects_new,
 
   std::unordered_map<int, int> action_id_new2comb;
   for (const auto &node : next_nodes) {
+    auto moved = p4objects_new->moved_action_ids.find(node.first);
+    if (moved != p4objects_new->moved_action_ids.end()) {
+      // action shared with a table inserted before by the same plan
+      ActionFn *action = get_action_by_id(moved->second);
+      action_id_new2comb[node.first] = moved->second;
+      const ControlFlowNode *next_node = use_null_next ? nullptr : get_next_node(node.second);
+      table->set_next_node(moved->second, next_node);
+      add_action_to_table(table_name, action->get_name(), action);
+      continue;
+    }
     if (actionIdCount == 0) {
       actionIdCount = actions_map.size();
     }
@@ -3031,7 +3215,10 @@ P4Objects::insert_match_table_rt(std::shared_ptr<P4Objects> p4objects_new,
     ActionFn *action = p4objects_new->get_action_by_id(node.first);
     action->set_id(action_id);
     action_name = action->get_name();
-    std::unique_ptr<ActionFn> unique_ptr_action(action);
+    std::unique_ptr<ActionFn> unique_ptr_action(
+        p4objects_new->actions_map.at(node.first).release());
+    p4objects_new->actions_map.erase(node.first);
+    p4objects_new->moved_action_ids[node.first] = action_id;
     add_action(action_id, std::move(unique_ptr_action));
     p4objects_new->modify_json_value("action", node.first, "id", action_id);
     action_id_new2comb[node.first] = action_id;
@@ -3082,6 +3269,9 @@ P4Objects::insert_conditional_rt(std::shared_ptr<P4Objects> p4objects_new,
   dup_id_checker_condition.add(conditional_id);
   conditional->set_id(conditional_id);
   conditional->set_name(new_name);
+  p4objects_new->conditionals_map.at(conditional_name).release();
+  p4objects_new->conditionals_map.erase(conditional_name);
+  p4objects_new->remove_control_node(conditional_name);
   add_conditional(new_name, unique_ptr<Conditional>(conditional));
   p4objects_new->modify_json_value(pipeline_name+" conditional", conditional_name, "id", conditional_id);
   p4objects_new->modify_json_value(pipeline_name+" conditional", conditional_name, "name", new_name);
@@ -3131,6 +3321,7 @@ void
 P4Objects::prepare_flex_hdr_parser(Json::Value &cfg_root) {
   auto &cfg_header_types = cfg_root["header_types"];
   // FlexCore: Prepare flex header
+  bool has_scalars = false;
   for (auto &cfg_header_type : cfg_header_types) {
     if (cfg_header_type["name"] == "scalars_0") {
       std::string s = "[\"flexMetadata.version\", 8, false]";
@@ -3138,10 +3329,42 @@ P4Objects::prepare_flex_hdr_parser(Json::Value &cfg_root) {
       Json::Value v;
       ss >> v;
       cfg_header_type["fields"].append(v);
+      has_scalars = true;
       break;
     }
   }
 
+  // programs compiled with the legacy P4_14 compiler do not have a "scalars"
+  // metadata header, so we add one for the flex version, with the next
+  // available ids
+  if (!has_scalars) {
+    int max_header_type_id = -1;
+    for (const auto &cfg_header_type : cfg_header_types)
+      max_header_type_id = std::max(max_header_type_id,
+                                    cfg_header_type["id"].asInt());
+    auto &cfg_headers = cfg_root["headers"];
+    int max_header_id = -1;
+    for (const auto &cfg_header : cfg_headers)
+      max_header_id = std::max(max_header_id, cfg_header["id"].asInt());
+
+    Json::Value header_type(Json::objectValue);
+    header_type["name"] = "scalars_0";
+    header_type["id"] = max_header_type_id + 1;
+    Json::Value field(Json::arrayValue);
+    field.append("flexMetadata.version");
+    field.append(8);
+    field.append(false);
+    header_type["fields"].append(field);
+    cfg_header_types.append(header_type);
+
+    Json::Value header(Json::objectValue);
+    header["name"] = "scalars";
+    header["id"] = max_header_id + 1;
+    header["header_type"] = "scalars_0";
+    header["metadata"] = true;
+    cfg_headers.append(header);
+  }
+
   // insert a state to init flex version for all parsers
   // TODO: for now, assuming only has one parser
   auto &cfg_parsers = cfg_root["parsers"];
@@ -3231,12 +3454,12 @@ P4Objects::build_flex_json_value(int id,
     "}";
   char output[2048];
 
-  const char *new_next_name_cstr = (new_next_name == "" ? "null" : "\"" + new_next_name + "\"").c_str();
-  const char *old_next_name_cstr = (old_next_name == "" ? "null" : "\"" + old_next_name + "\"").c_str();
+  const std::string new_next_name_json = new_next_name == "" ? "null" : "\"" + new_next_name + "\"";
+  const std::string old_next_name_json = old_next_name == "" ? "null" : "\"" + old_next_name + "\"";
 
   std::sprintf(output, s, name.c_str(), id, name.c_str(), 
-    old_next_name_cstr,
-    new_next_name_cstr);
+    old_next_name_json.c_str(),
+    new_next_name_json.c_str());
 
   std::stringstream ss;
   Json::Value v;
@@ -3364,30 +3587,9 @@ P4Objects::change_register_array_size_rt(const std::string& name,
                                          const std::string& register_array_size) {
   RegisterArray* register_array = get_register_array(name);
   int new_register_array_size = std::stoi(register_array_size);
-  int ori_register_array_size = register_array->size();
-  if (new_register_array_size == ori_register_array_size) {
-    return;
-  } else if (new_register_array_size > ori_register_array_size) {
-    std::vector<Register> registers_new;
-    registers_new.reserve(new_register_array_size);
-    auto lock = register_array->unique_lock();
-    for (int i = 0; i < new_register_array_size; i++) {
-      if (i < ori_register_array_size) {
-        registers_new.push_back(register_array->at(i));
-      } else {
-        registers_new.emplace_back(register_array->get_bitwidth(), register_array);
-      }
-    }
-    register_array->reset_registers_with(registers_new);
-  } else {
-    std::vector<Register> registers_new;
-    registers_new.reserve(new_register_array_size);
-    auto lock = register_array->unique_lock();
-    for (int i = 0; i < new_register_array_size; i++) {
-      registers_new.push_back(register_array->at(i));
-    }
-    register_array->reset_registers_with(registers_new);
-  }
+  // values are preserved, and packets are only stalled while the new version
+  // of the array is published
+  register_array->resize(new_register_array_size);
   modify_json_value("register_array", name, "size", new_register_array_size);
 }
 
@@ -3396,28 +3598,23 @@ P4Objects::change_register_array_bitwidth_rt(const std::string& name,
                                              const std::string& register_array_bitwidth) {
   RegisterArray* register_array = get_register_array(name);
   int new_register_array_bitwidth = std::stoi(register_array_bitwidth);
-  {
-    auto lock = register_array->unique_lock();
-    std::vector<Register> registers_new(register_array->begin(), register_array->end());
-    for (Register &register_item : registers_new) {
-      register_item.set_bitwidth(new_register_array_bitwidth);
-    }
-    register_array->reset_registers_with(registers_new);
-  }
   register_array->set_bitwidth(new_register_array_bitwidth);
   modify_json_value("register_array", name, "bitwidth", new_register_array_bitwidth);
 }
 
 void
 P4Objects::flex_trigger_rt(bool on) {
-  ParserOpSet<Data> *op = (ParserOpSet<Data>*) flex_init_state->get_parser_op(0);
-  if (on) {
-    op->src.set(Data("0x01"));
-    // op->set_src(Data("0x00"));
-  } else {
-    op->src.set(Data("0x00"));
-    // op->set_src(Data("0x01"));
-  }
+  flex_version.set(on ? 1 : 0);
+}
+
+bool
+P4Objects::flex_trigger_at_packet_rt(bool on, uint64_t packet_number) {
+  return flex_version.schedule_at_packet(on ? 1 : 0, packet_number);
+}
+
+bool
+P4Objects::flex_trigger_at_time_rt(bool on, uint64_t ts_ms) {
+  return flex_version.schedule_at_time(on ? 1 : 0, ts_ms);
 }
 void
 P4Objects::delete_flex_rt(const std::string &pipeline_name,
@@ -3427,6 +3624,9 @@ P4Objects::delete_flex_rt(const std::string &pipeline_name,
 void
 P4Objects::delete_conditional_rt(const std::string &pipeline_name,
     const std::string &name) {
+  // packets may still be evaluating the conditional with the current version
+  // of the graph
+  control_flow_graph.retire(std::move(conditionals_map.at(name)));
   remove_conditional(name);
   remove_json_value(pipeline_name+" conditional", name);
 }
@@ -3439,6 +3639,11 @@ P4Objects::delete_match_table_rt(const std::string &pipeline_name,
   //       Need to double check
   // TODO: Also, I don't delete the related action from the map yet
   //       This is secondary because actions don't take much resource
+  // the ageing monitor must not sweep the table once it is destroyed
+  MatchTableAbstract *table = get_abstract_match_table_rt(name);
+  if (table != nullptr && table->get_with_ageing())
+    ageing_monitor->remove_table(table->get_id());
+  control_flow_graph.retire(std::move(match_action_tables_map.at(name)));
   remove_match_action_table(name);
   remove_json_value(pipeline_name+" table", name);
 }
@@ -3449,6 +3654,11 @@ P4Objects::delete_register_array_rt(const std::string& name) {
   remove_json_value("register_array", name);
 }
 
+void
+P4Objects::publish_control_flow_graph_rt() {
+  control_flow_graph.publish();
+}
+
 void
 P4Objects::insert_parse_state_rt(std::shared_ptr<P4Objects> p4objects_new,
     const std::string &parser_name, 
@@ -3910,6 +4120,18 @@ P4Objects::get_pipeline_rt(const std::string &name) const {
   return (it != pipelines_map.end()) ? it->second.get() : nullptr;
 }
 
+Conditional *
+P4Objects::get_conditional_rt(const std::string &name) const {
+  auto it = conditionals_map.find(name);
+  return (it != conditionals_map.end()) ? it->second.get() : nullptr;
+}
+
+ControlFlowNode *
+P4Objects::get_control_node_rt(const std::string &name) const {
+  auto it = control_nodes_map.find(name);
+  return (it != control_nodes_map.end()) ? it->second : nullptr;
+}
+
 ExternType *
 P4Objects::get_extern_instance_rt(const std::string &name) const {
   auto it = extern_instances.find(name);
@@ -4099,10 +4321,12 @@ P4Objects::add_control_action(const std::string &name,
 void
 P4Objects::add_control_node(const std::string &name, ControlFlowNode *node) {
   add_new_object(&control_nodes_map, "control node", name, node);
+  control_flow_graph.add_node(node);
 }
 
 void
 P4Objects::remove_control_node(const std::string &name) {
+  control_flow_graph.remove_node(get_control_node_cfg(name));
   remove_object(&control_nodes_map, "control node", name);
 }
 
@@ -4116,9 +4340,21 @@ P4Objects::get_control_node_cfg(const std::string &name) const {
   return get_object(control_nodes_map, "control node", name);
 }
 
+// a delta only contains the inserted nodes, their next nodes are left
+// unresolved and are set by the reconfiguration plan
+ControlFlowNode *
+P4Objects::get_next_node_cfg(const Json::Value &cfg_next_node) const {
+  if (cfg_next_node.isNull()) return nullptr;
+  const auto name = cfg_next_node.asString();
+  if (base_objects && control_nodes_map.find(name) == control_nodes_map.end())
+    return nullptr;
+  return get_control_node_cfg(name);
+}
+
 void
 P4Objects::add_pipeline(const std::string &name,
                         std::unique_ptr<Pipeline> pipeline) {
+  pipeline->set_control_flow_graph(&control_flow_graph);
   add_new_object(&pipelines_map, "pipeline", name, std::move(pipeline));
 }
 
@@ -4130,6 +4366,8 @@ P4Objects::add_meter_array(const std::string &name,
 
 MeterArray *
 P4Objects::get_meter_array_cfg(const std::string &name) const {
+  if (base_objects && meter_arrays.find(name) == meter_arrays.end())
+    return base_objects->get_meter_array_cfg(name);
   return get_object(meter_arrays, "meter", name).get();
 }
 
@@ -4141,6 +4379,8 @@ P4Objects::add_counter_array(const std::string &name,
 
 CounterArray *
 P4Objects::get_counter_array_cfg(const std::string &name) const {
+  if (base_objects && counter_arrays.find(name) == counter_arrays.end())
+    return base_objects->get_counter_array_cfg(name);
   return get_object(counter_arrays, "counter", name).get();
 }
 
@@ -4152,6 +4392,8 @@ P4Objects::add_register_array(const std::string &name,
 
 RegisterArray *
 P4Objects::get_register_array_cfg(const std::string &name) const {
+  if (base_objects && register_arrays.find(name) == register_arrays.end())
+    return base_objects->get_register_array_cfg(name);
   return get_object(register_arrays, "register", name).get();
 }
 
@@ -4163,6 +4405,8 @@ P4Objects::add_named_calculation(
 
 NamedCalculation *
 P4Objects::get_named_calculation_cfg(const std::string &name) const {
+  if (base_objects && calculations.find(name) == calculations.end())
+    return base_objects->get_named_calculation_cfg(name);
   return get_object(calculations, "calculation", name).get();
 }
 
@@ -4180,6 +4424,8 @@ P4Objects::add_extern_instance(const std::string &name,
 
 ExternType *
 P4Objects::get_extern_instance_cfg(const std::string &name) const {
+  if (base_objects && extern_instances.find(name) == extern_instances.end())
+    return base_objects->get_extern_instance_cfg(name);
   return get_object(extern_instances, "extern", name).get();
 }
 
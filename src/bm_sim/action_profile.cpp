@@ -23,6 +23,7 @@
 #include <bm/bm_sim/logger.h>
 #include <bm/bm_sim/packet.h>
 
+#include <algorithm>
 #include <iostream>
 #include <memory>
 #include <string>
@@ -65,29 +66,33 @@ ActionProfile::IndirectIndex::deserialize(std::istream *in,
 
 MatchErrorCode
 ActionProfile::GroupInfo::add_member(mbr_hdl_t mbr) {
-  if (!mbrs.add(mbr)) return MatchErrorCode::MBR_ALREADY_IN_GRP;
+  auto it = std::lower_bound(mbrs.begin(), mbrs.end(), mbr);
+  if (it != mbrs.end() && *it == mbr) return MatchErrorCode::MBR_ALREADY_IN_GRP;
+  mbrs.insert(it, mbr);
   return MatchErrorCode::SUCCESS;
 }
 
 MatchErrorCode
 ActionProfile::GroupInfo::delete_member(mbr_hdl_t mbr) {
-  if (!mbrs.remove(mbr)) return MatchErrorCode::MBR_NOT_IN_GRP;
+  auto it = std::lower_bound(mbrs.begin(), mbrs.end(), mbr);
+  if (it == mbrs.end() || *it != mbr) return MatchErrorCode::MBR_NOT_IN_GRP;
+  mbrs.erase(it);
   return MatchErrorCode::SUCCESS;
 }
 
 bool
 ActionProfile::GroupInfo::contains_member(mbr_hdl_t mbr) const {
-  return mbrs.contains(mbr);
+  return std::binary_search(mbrs.begin(), mbrs.end(), mbr);
 }
 
 size_t
 ActionProfile::GroupInfo::size() const {
-  return mbrs.count();
+  return mbrs.size();
 }
 
 ActionProfile::mbr_hdl_t
 ActionProfile::GroupInfo::get_nth(size_t n) const {
-  return mbrs.get_nth(n);
+  return mbrs[n];
 }
 
 void
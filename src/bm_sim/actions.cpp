@@ -26,6 +26,8 @@
 #include <bm/bm_sim/packet.h>
 #include <bm/bm_sim/logger.h>
 
+#include <algorithm>  // for std::find
+#include <iterator>  // for std::distance
 #include <string>
 #include <vector>
 
@@ -140,6 +142,7 @@ ActionFn::parameter_push_back_register_gen(
   param.register_gen.array = register_array;
 
   idx->grab_register_accesses(&register_sync);
+  register_accesses_in_expressions = true;
 
   param.register_gen.idx = idx.get();
   params.push_back(param);
@@ -194,7 +197,12 @@ ActionFn::parameter_push_back_expression(std::unique_ptr<Expression> expr) {
   if (nb_expression_params == ActionFn::nb_data_tmps)
     ActionFn::nb_data_tmps += 1;
 
-  expr->grab_register_accesses(&register_sync);
+  RegisterSync expr_register_sync;
+  expr->grab_register_accesses(&expr_register_sync);
+  if (!expr_register_sync.empty()) {
+    register_accesses_in_expressions = true;
+    register_sync.merge_from(expr_register_sync);
+  }
 
   expressions.push_back(std::move(expr));
   ActionParam param;
@@ -298,6 +306,141 @@ ActionFn::grab_register_accesses(RegisterSync *rs) const {
   rs->merge_from(register_sync);
 }
 
+bool
+ActionFn::same_register_index(const ActionParam &p1,
+                              const ActionParam &p2) const {
+  if (p1.tag != p2.tag) return false;
+  switch (p1.tag) {
+    case ActionParam::CONST:
+      return const_values[p1.const_offset] == const_values[p2.const_offset];
+    case ActionParam::ACTION_DATA:
+      return p1.action_data_offset == p2.action_data_offset;
+    case ActionParam::FIELD:
+      return p1.field.header == p2.field.header &&
+          p1.field.field_offset == p2.field.field_offset;
+    case ActionParam::REGISTER_REF:
+      return p1.register_ref.idx == p2.register_ref.idx;
+    default:
+      return false;
+  }
+}
+
+// conservative: returns true if the primitive may modify the field used as a
+// register index, or if we cannot tell
+bool
+ActionFn::may_write_register_index(size_t primitive,
+                                   const ActionParam &index) const {
+  if (index.tag != ActionParam::FIELD) return false;
+  const auto &call = primitives[primitive];
+  for (size_t i = 0; i < call.get_num_params(); i++) {
+    if (!call.get_primitive()->is_param_writable(i)) continue;
+    const auto &param = params[call.get_param_offset() + i];
+    switch (param.tag) {
+      case ActionParam::FIELD:
+        if (param.field.header == index.field.header &&
+            param.field.field_offset == index.field.field_offset)
+          return true;
+        break;
+      case ActionParam::HEADER:
+        if (param.header == index.field.header) return true;
+        break;
+      case ActionParam::REGISTER_REF:
+      case ActionParam::REGISTER_ARRAY:
+      case ActionParam::METER_ARRAY:
+      case ActionParam::COUNTER_ARRAY:
+        break;
+      default:
+        return true;
+    }
+  }
+  return false;
+}
+
+void
+ActionFn::finalize_register_accesses() {
+  register_cell_accesses.clear();
+  register_cells_only = false;
+  if (register_sync.empty() || register_accesses_in_expressions) return;
+  const auto &arrays = register_sync.get_register_arrays();
+  // we use a 64-bit mask to keep track of locked arrays
+  if (arrays.size() > 64) return;
+
+  std::vector<RegisterCellAccess> accesses;
+  for (size_t p = 0; p < primitives.size(); p++) {
+    const auto &call = primitives[p];
+    const auto *primitive = call.get_primitive();
+    const size_t offset = call.get_param_offset();
+    if (primitive->is_jump()) {
+      // a backward jump could change the index used by an access after the
+      // stripe was locked
+      const auto &target = params[offset + call.get_num_params() - 1];
+      if (target.tag != ActionParam::CONST ||
+          const_values[target.const_offset].get<size_t>() <= p)
+        return;
+      continue;
+    }
+    for (size_t i = 0; i < call.get_num_params(); i++) {
+      const auto &param = params[offset + i];
+      RegisterCellAccess access;
+      access.primitive = p;
+      if (param.tag == ActionParam::REGISTER_REF) {
+        access.index_param = offset + i;
+        access.array = param.register_ref.array;
+      } else if (param.tag == ActionParam::REGISTER_ARRAY) {
+        int index_param = primitive->get_register_index_param(i);
+        if (index_param < 0) return;
+        access.index_param = offset + static_cast<size_t>(index_param);
+        switch (params[access.index_param].tag) {
+          case ActionParam::CONST:
+          case ActionParam::ACTION_DATA:
+          case ActionParam::FIELD:
+            break;
+          default:
+            return;
+        }
+        access.array = param.register_array;
+      } else if (param.tag == ActionParam::REGISTER_GEN) {
+        return;
+      } else {
+        continue;
+      }
+      auto it = std::find(arrays.begin(), arrays.end(), access.array);
+      access.array_pos = std::distance(arrays.begin(), it);
+      assert(access.array_pos < arrays.size());
+      accesses.push_back(access);
+    }
+  }
+
+  // The stripes are locked lazily, right before the first access to each
+  // array, so arrays have to be accessed for the first time in locking order.
+  // Then all the accesses to an array need to use the same index, which cannot
+  // be modified between the first and the last access.
+  std::vector<const RegisterCellAccess *> first(arrays.size(), nullptr);
+  std::vector<const RegisterCellAccess *> last(arrays.size(), nullptr);
+  size_t next_pos = 0;
+  for (const auto &access : accesses) {
+    auto &first_access = first[access.array_pos];
+    if (first_access == nullptr) {
+      if (access.array_pos < next_pos) return;
+      next_pos = access.array_pos + 1;
+      first_access = &access;
+    } else if (!same_register_index(params[first_access->index_param],
+                                    params[access.index_param])) {
+      return;
+    }
+    last[access.array_pos] = &access;
+  }
+  for (size_t pos = 0; pos < arrays.size(); pos++) {
+    if (first[pos] == nullptr) return;
+    const auto &index = params[first[pos]->index_param];
+    for (size_t p = first[pos]->primitive; p < last[pos]->primitive; p++)
+      if (may_write_register_index(p, index)) return;
+  }
+
+  register_cell_accesses = std::move(accesses);
+  register_cells_only = true;
+}
+
 size_t
 ActionFn::get_num_params() const {
   return num_params;
@@ -374,10 +517,19 @@ ActionFnEntry::push_back_action_data(const char *bytes, int nbytes) {
 
 void
 ActionFnEntry::execute(Packet *pkt) const {
+  execute(pkt, nullptr);
+}
+
+void
+ActionFnEntry::execute(Packet *pkt,
+                       RegisterSync::RegisterLocks *cell_locks) const {
   ActionEngineState state(pkt, action_data, action_fn->const_values,
                           action_fn->sub_params);
 
   auto &primitives = action_fn->primitives;
+  const auto &cell_accesses = action_fn->register_cell_accesses;
+  size_t next_cell_access = 0;
+  uint64_t locked_arrays = 0;
   size_t param_offset = 0;
   BMLOG_TRACE_SI_PKT(*pkt, action_fn->get_source_info(),
                      "Action {}", action_fn->get_name());
@@ -387,6 +539,19 @@ ActionFnEntry::execute(Packet *pkt) const {
       "Primitive {}",
         (primitive.get_source_info() == nullptr) ? "(no source info)"
         : primitive.get_source_info()->get_source_fragment());
+    // only forward jumps in this case, see finalize_register_accesses()
+    for (; cell_locks && next_cell_access < cell_accesses.size() &&
+             cell_accesses[next_cell_access].primitive <= idx;
+         next_cell_access++) {
+      const auto &access = cell_accesses[next_cell_access];
+      const uint64_t array_bit = static_cast<uint64_t>(1) << access.array_pos;
+      if (access.primitive < idx || (locked_arrays & array_bit)) continue;
+      const auto &index = action_fn->params[access.index_param];
+      size_t i = (index.tag == ActionParam::REGISTER_REF) ?
+          index.register_ref.idx : index.to<const Data &>(&state).get<size_t>();
+      cell_locks->v.emplace_back(access.array->stripe_mutex(i));
+      locked_arrays |= array_bit;
+    }
     param_offset = primitive.get_param_offset();
     primitive.execute(&state, &(action_fn->params[param_offset]));
     idx = primitive.get_jump_offset(idx);
@@ -405,8 +570,12 @@ ActionFnEntry::operator()(Packet *pkt) const {
 
   {
     RegisterSync::RegisterLocks RL;
-    action_fn->register_sync.lock(&RL);
-    execute(pkt);
+    if (action_fn->register_cells_only) {
+      execute(pkt, &RL);
+    } else {
+      action_fn->register_sync.lock(&RL);
+      execute(pkt, nullptr);
+    }
   }
 
   DEBUGGER_NOTIFY_CTR(
@@ -476,6 +645,8 @@ struct _jump_if_zero : public ActionPrimitive<const Data &, const Data &> {
     return (offset < 0) ? (current_offset + 1) : static_cast<size_t>(offset);
   }
 
+  bool is_jump() const override { return true; }
+
  private:
   static thread_local int offset;
 };
@@ -492,6 +663,8 @@ struct _jump : public ActionPrimitive<const Data &> {
     return static_cast<size_t>(offset);
   }
 
+  bool is_jump() const override { return true; }
+
  private:
   static thread_local int offset;
 };
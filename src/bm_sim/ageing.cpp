@@ -28,20 +28,120 @@
 #include <mutex>
 #include <condition_variable>
 #include <map>
-#include <unordered_set>
 #include <vector>
 #include <memory>
+#include <algorithm>
+#include <array>
+#include <chrono>
 
 namespace bm {
 
 static_assert(sizeof(AgeingMonitorIface::msg_hdr_t) == 32u,
               "Invalid size for ageing notification header");
 
+namespace {
+
+using clock = Packet::clock;
+
+uint64_t get_ms(const clock::time_point &tp) {
+  using std::chrono::duration_cast;
+  using std::chrono::milliseconds;
+  return duration_cast<milliseconds>(tp.time_since_epoch()).count();
+}
+
+// see HANDLE_INTERNAL in match_units.cpp
+size_t get_internal_handle(entry_handle_t handle) {
+  return handle & 0x00ffffff;
+}
+
+// Hierarchical timer wheel (Varghese & Lauck) with a 1ms tick. Level l has 64
+// slots, each covering 64^l ticks, and a timer is stored in the lowest level
+// which can hold it given its expiry time. When the current time reaches the
+// beginning of a slot in a higher level, its timers are moved (cascaded) down
+// to the lower levels. Adding a timer is O(1) and advancing the time only
+// visits the slots the current time goes through, so the cost of a sweep
+// depends on the number of timers which expire, not on the number of timers.
+class TimerWheel {
+ public:
+  struct Timer {
+    entry_handle_t handle;
+    uint64_t expiry_ms;
+  };
+
+  explicit TimerWheel(uint64_t now_ms)
+      : now_ms(now_ms) { }
+
+  void add(const Timer &timer) {
+    nb_timers++;
+    if (timer.expiry_ms <= now_ms) {
+      overdue.push_back(timer);
+      return;
+    }
+    // timers which expire after the range of the wheel are stored in the
+    // last slot of the highest level, and will be cascaded again
+    const uint64_t delta = std::min(timer.expiry_ms - now_ms, max_delta - 1);
+    const uint64_t placement_ms = now_ms + delta;
+    int level = 0;
+    while (delta >= (uint64_t(1) << (slot_bits * (level + 1)))) level++;
+    const size_t slot = (placement_ms >> (slot_bits * level)) & slot_mask;
+    slots[level][slot].push_back(timer);
+  }
+
+  // advances the current time to to_ms and appends the timers which have
+  // expired to expired
+  void advance(uint64_t to_ms, std::vector<Timer> *expired) {
+    // timers cascaded to the current tick end up in overdue
+    while (now_ms < to_ms && nb_timers > overdue.size()) {
+      now_ms++;
+      for (int level = nb_levels - 1; level > 0; level--) {
+        const int shift = slot_bits * level;
+        if ((now_ms & ((uint64_t(1) << shift) - 1)) != 0) continue;
+        cascade(level, (now_ms >> shift) & slot_mask);
+      }
+      auto &timers = slots[0][now_ms & slot_mask];
+      expired->insert(expired->end(), timers.begin(), timers.end());
+      nb_timers -= timers.size();
+      timers.clear();
+    }
+    now_ms = std::max(now_ms, to_ms);
+    expired->insert(expired->end(), overdue.begin(), overdue.end());
+    nb_timers -= overdue.size();
+    overdue.clear();
+  }
+
+  void clear(uint64_t now_ms) {
+    for (auto &level : slots)
+      for (auto &timers : level) timers.clear();
+    overdue.clear();
+    nb_timers = 0;
+    this->now_ms = now_ms;
+  }
+
+ private:
+  static constexpr int slot_bits = 6;
+  static constexpr size_t slot_mask = (1u << slot_bits) - 1;
+  static constexpr int nb_levels = 6;
+  static constexpr uint64_t max_delta = uint64_t(1) << (slot_bits * nb_levels);
+
+  void cascade(int level, size_t slot) {
+    std::vector<Timer> timers;
+    timers.swap(slots[level][slot]);
+    nb_timers -= timers.size();
+    for (const auto &timer : timers) add(timer);
+  }
+
+  uint64_t now_ms;
+  size_t nb_timers{0};
+  std::array<std::array<std::vector<Timer>, slot_mask + 1>, nb_levels> slots{};
+  std::vector<Timer> overdue{};
+};
+
+}  // namespace
+
 class AgeingMonitor final : public AgeingMonitorIface {
  public:
   using msg_hdr_t = AgeingMonitorIface::msg_hdr_t;
   using buffer_id_t = uint64_t;
-  using clock = Packet::clock;
 
   AgeingMonitor(device_id_t device_id, cxt_id_t cxt_id,
                 std::shared_ptr<TransportIface> writer,
@@ -51,6 +151,8 @@ class AgeingMonitor final : public AgeingMonitorIface {
 
   void add_table(MatchTableAbstract *table) override;
 
+  void remove_table(p4object_id_t id) override;
+
   void set_sweep_interval(unsigned int ms) override;
 
   unsigned int get_sweep_interval() override;
@@ -64,9 +166,15 @@ class AgeingMonitor final : public AgeingMonitorIface {
   void do_sweep();
 
  private:
+  // Each entry with a TTL has a timer in the wheel, set to its expiry time as
+  // of the last time it was checked. Hits only update the entry timestamp, so
+  // when a timer expires, the entry may have been hit in the meantime, in
+  // which case the timer is simply set again. Rather than removing timers from
+  // the wheel, we keep track of the live timer for each entry, and the other
+  // ones are ignored when they expire.
   struct TableData {
-    explicit TableData(MatchTableAbstract *table)
-      : table(table) { }
+    TableData(MatchTableAbstract *table, uint64_t now_ms)
+      : table(table), wheel(now_ms) { }
 
     TableData(const TableData &other) = delete;
     TableData &operator=(const TableData &other) = delete;
@@ -74,8 +182,38 @@ class AgeingMonitor final : public AgeingMonitorIface {
     TableData(TableData &&other) /*noexcept*/ = default;
     TableData &operator=(TableData &&other) /*noexcept*/ = default;
 
+    void set_timer(entry_handle_t handle, uint64_t expiry_ms) {
+      const auto idx = get_internal_handle(handle);
+      if (idx >= live_timers.size())
+        live_timers.resize(idx + 1, TimerWheel::Timer{0, 0});
+      live_timers[idx] = {handle, expiry_ms};
+      wheel.add({handle, expiry_ms});
+    }
+
+    void clear_timer(entry_handle_t handle) {
+      live_timers[get_internal_handle(handle)] = {0, 0};
+    }
+
+    bool is_live(const TimerWheel::Timer &timer) const {
+      const auto idx = get_internal_handle(timer.handle);
+      return idx < live_timers.size() &&
+          live_timers[idx].handle == timer.handle &&
+          live_timers[idx].expiry_ms == timer.expiry_ms;
+    }
+
+    void clear(uint64_t now_ms) {
+      wheel.clear(now_ms);
+      live_timers.clear();
+      scanned = false;
+    }
+
     MatchTableAbstract *table{nullptr};
-    std::unordered_set<entry_handle_t> prev_sweep_entries{};
+    TimerWheel wheel;
+    // indexed by internal handle
+    std::vector<TimerWheel::Timer> live_timers{};
+    // false until all the entries with a TTL have been retrieved from the
+    // table; after that, only TTL updates are
+    bool scanned{false};
   };
 
  private:
@@ -83,6 +221,11 @@ class AgeingMonitor final : public AgeingMonitorIface {
 
   std::map<p4object_id_t, TableData> tables_with_ageing{};
 
+  // separate from tables_with_ageing, so that it can be accessed during a
+  // sweep
+  mutable std::mutex names_mutex{};
+  std::map<p4object_id_t, std::string> table_names{};
+
   device_id_t device_id{};
   cxt_id_t cxt_id{};
 
@@ -91,7 +234,9 @@ class AgeingMonitor final : public AgeingMonitorIface {
   std::atomic<unsigned int> sweep_interval_ms{0};
 
   std::vector<entry_handle_t> entries{};
-  std::vector<entry_handle_t> entries_tmp{};
+  std::vector<entry_handle_t> handles_tmp{};
+  std::vector<uint64_t> expiry_times_tmp{};
+  std::vector<TimerWheel::Timer> timers_tmp{};
   buffer_id_t buffer_id{0};
 
   std::thread sweep_thread{};
@@ -118,7 +263,19 @@ AgeingMonitor::~AgeingMonitor() {
 
 void
 AgeingMonitor::add_table(MatchTableAbstract *table) {
-  tables_with_ageing.insert(std::make_pair(table->get_id(), TableData(table)));
+  std::unique_lock<std::mutex> lock(mutex);
+  tables_with_ageing.insert(std::make_pair(
+      table->get_id(), TableData(table, get_ms(clock::now()))));
+  std::unique_lock<std::mutex> names_lock(names_mutex);
+  table_names[table->get_id()] = table->get_name();
+}
+
+void
+AgeingMonitor::remove_table(p4object_id_t id) {
+  std::unique_lock<std::mutex> lock(mutex);
+  tables_with_ageing.erase(id);
+  std::unique_lock<std::mutex> names_lock(names_mutex);
+  table_names.erase(id);
 }
 
 void
@@ -137,20 +294,21 @@ void
 AgeingMonitor::reset_state() {
   std::unique_lock<std::mutex> lock(mutex);
   entries.clear();
-  entries_tmp.clear();
   buffer_id = 0;
+  const auto now_ms = get_ms(clock::now());
   for (auto &entry : tables_with_ageing) {
     TableData &data = entry.second;
-    data.prev_sweep_entries.clear();
+    data.clear(now_ms);
   }
 }
 
 std::string
 AgeingMonitor::get_table_name_from_id(p4object_id_t id) const {
+  std::unique_lock<std::mutex> lock(names_mutex);
   // we use a std::map, but lookup should be fast for such a small map
-  auto it = tables_with_ageing.find(id);
-  if (it == tables_with_ageing.end()) return "";
-  return it->second.table->get_name();
+  auto it = table_names.find(id);
+  if (it == table_names.end()) return "";
+  return it->second;
 }
 
 void
@@ -168,31 +326,55 @@ AgeingMonitor::sweep_loop() {
 
 void
 AgeingMonitor::do_sweep() {
+  const uint64_t now_ms = get_ms(clock::now());
+  // an entry which is still idle is notified again every other sweep, which
+  // gives the control plane another chance if it missed a notification
+  const uint64_t renotify_ms = sweep_interval_ms + sweep_interval_ms / 2;
+
   for (auto &entry : tables_with_ageing) {
     TableData &data = entry.second;
-    const MatchTableAbstract *t = data.table;
-    auto &prev_sweep_entries = data.prev_sweep_entries;
-    t->sweep_entries(&entries_tmp);
-    if (entries_tmp.empty()) {
-      prev_sweep_entries.clear();
-      continue;
+    MatchTableAbstract *t = data.table;
+
+    handles_tmp.clear();
+    t->get_ttl_updates(&handles_tmp, !data.scanned);
+    data.scanned = true;
+    expiry_times_tmp.resize(handles_tmp.size());
+    t->get_expiry_times(handles_tmp.data(), handles_tmp.size(),
+                        expiry_times_tmp.data());
+    for (size_t i = 0; i < handles_tmp.size(); i++) {
+      if (expiry_times_tmp[i] > 0)
+        data.set_timer(handles_tmp[i], expiry_times_tmp[i]);
     }
 
-    for (entry_handle_t handle : entries_tmp) {
-      if (prev_sweep_entries.find(handle) == prev_sweep_entries.end()) {
+    timers_tmp.clear();
+    data.wheel.advance(now_ms, &timers_tmp);
+    handles_tmp.clear();
+    for (const auto &timer : timers_tmp) {
+      if (data.is_live(timer)) handles_tmp.push_back(timer.handle);
+    }
+    if (handles_tmp.empty()) continue;
+
+    // the entries may have been hit, modified or deleted since their timer was
+    // set
+    expiry_times_tmp.resize(handles_tmp.size());
+    t->get_expiry_times(handles_tmp.data(), handles_tmp.size(),
+                        expiry_times_tmp.data());
+    for (size_t i = 0; i < handles_tmp.size(); i++) {
+      const entry_handle_t handle = handles_tmp[i];
+      const uint64_t expiry_ms = expiry_times_tmp[i];
+      if (expiry_ms == 0) {
+        data.clear_timer(handle);
+      } else if (expiry_ms > now_ms) {
+        data.set_timer(handle, expiry_ms);
+      } else {
         BMLOG_TRACE("Ageing entry {} in table '{}'\n", handle, t->get_name());
         entries.push_back(handle);
+        data.set_timer(handle, now_ms + renotify_ms);
       }
     }
-    entries_tmp.clear();
-    prev_sweep_entries.clear();
 
     if (entries.empty()) continue;
 
-    for (entry_handle_t handle : entries) {
-      prev_sweep_entries.insert(handle);
-    }
-
     BMLOG_TRACE("Sending ageing notification for table '{}' ({})",
                 t->get_name(), entry.first);
 
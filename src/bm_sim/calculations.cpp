@@ -126,6 +126,119 @@ BufBuilder::operator()(const Packet &pkt, ByteContainer *buf) const {
   }
 }
 
+bool
+BufBuilder::operator==(const BufBuilder &other) const {
+  return with_payload == other.with_payload && entries == other.entries;
+}
+
+namespace {
+
+// a ones' complement sum is a sum modulo 0xffff, which is linear, so
+// each field can be considered separately. As 2^16 = 1 modulo 0xffff, a field
+// value contributes (value modulo 0xffff), rotated to account for the position
+// of its last bit in the buffer relative to the 16-bit words.
+uint32_t csum16_term(uint64_t value, int end_bit) {
+  const uint64_t v = value % 0xffff;
+  const int rot = (16 - end_bit % 16) % 16;
+  return static_cast<uint32_t>(((v << rot) | (v >> (16 - rot))) & 0xffff);
+}
+
+// for values larger than 64 bits (big-endian, as in Field::get_bytes())
+uint32_t csum16_term(const char *bytes, size_t nbytes, int end_bit) {
+  uint64_t sum = 0;
+  for (size_t i = 0; i < nbytes; i++) {
+    const uint64_t b = static_cast<unsigned char>(bytes[nbytes - 1 - i]);
+    sum += (i % 2) ? (b << 8) : b;
+  }
+  return csum16_term(sum, end_bit);
+}
+
+}  // namespace
+
+bool
+BufBuilder::is_from_packet(const PHV &phv) const {
+  if (with_payload) return false;
+  for (const auto &entry : entries) {
+    if (boost::get<constant_t>(&entry)) continue;
+    const auto *f = boost::get<field_t>(&entry);
+    if (!f) return false;
+    const Header &header = phv.get_header(f->header);
+    const bool extracted = header.get_packet_offset() >= 0;
+    if (header.is_valid() != extracted) return false;
+    if (!extracted) continue;
+    if (!header.get_packet_image() || header.is_modified()) return false;
+    if (static_cast<size_t>(f->field_offset) >=
+        header.get_header_type().get_layout().size()) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool
+BufBuilder::update_csum16(const PHV &phv, uint16_t old_cksum,
+                          uint16_t *cksum) const {
+  if (with_payload) return false;
+  uint32_t sum = static_cast<uint16_t>(~old_cksum) % 0xffff;
+  int nbits = 0;
+  // consecutive fields usually belong to the same header, which is only
+  // checked once
+  const Header *header = nullptr;
+  const char *image = nullptr;
+  const std::vector<HeaderType::FieldLayout> *layout = nullptr;
+  for (const auto &entry : entries) {
+    if (const auto *c = boost::get<constant_t>(&entry)) {
+      nbits += c->nbits;
+      continue;
+    }
+    const auto *f = boost::get<field_t>(&entry);
+    if (!f) return false;
+    if (header != &phv.get_header(f->header)) {
+      header = &phv.get_header(f->header);
+      // same checks as in is_from_packet(), so that the buffer has the same
+      // layout as when old_cksum was computed
+      const bool extracted = header->get_packet_offset() >= 0;
+      if (header->is_valid() != extracted) return false;
+      image = extracted ? header->get_packet_image() : nullptr;
+      if (extracted && !image) return false;
+      layout = &header->get_header_type().get_layout();
+    }
+    if (!image) continue;  // not extracted
+    if (static_cast<size_t>(f->field_offset) >= layout->size()) return false;
+    const auto &field_layout = (*layout)[f->field_offset];
+    nbits += field_layout.nbits;
+    if (!header->is_field_modified(f->field_offset)) continue;
+    const auto &new_bytes = header->get_field(f->field_offset).get_bytes();
+    if (field_layout.fits_u64) {
+      const uint64_t old_value = (extract::load_be64(
+          image + field_layout.byte_offset) >> field_layout.shift) &
+          field_layout.mask;
+      uint64_t new_value = 0;
+      for (const char b : new_bytes)
+        new_value = (new_value << 8) | static_cast<unsigned char>(b);
+      if (new_value == old_value) continue;
+      sum += csum16_term(new_value, nbits);
+      sum += 0xffff - csum16_term(old_value, nbits);
+    } else {
+      static thread_local ByteContainer old_bytes;
+      old_bytes.resize(new_bytes.size());
+      extract::generic_extract(image + field_layout.byte_offset,
+                               field_layout.bit_offset, field_layout.nbits,
+                               old_bytes.data());
+      if (std::equal(new_bytes.begin(), new_bytes.end(), old_bytes.begin()))
+        continue;
+      sum += csum16_term(new_bytes.data(), new_bytes.size(), nbits);
+      sum += 0xffff - csum16_term(old_bytes.data(), old_bytes.size(), nbits);
+    }
+    sum %= 0xffff;
+  }
+  // a sum of 0 is ambiguous: the full computation returns 0xffff for an
+  // all-zero buffer, 0 otherwise
+  if (sum == 0) return false;
+  *cksum = static_cast<uint16_t>(~sum);
+  return true;
+}
+
 namespace hash {
 
 uint64_t xxh64(const char *buffer, size_t s) {
@@ -464,6 +577,12 @@ CustomCrcMgr<T>::update_config(RawCalculationIface<uint64_t> *c,
   return CustomCrcErrorCode::SUCCESS;
 }
 
+bool
+is_csum16(const RawCalculationIface<uint64_t> &c) {
+  return dynamic_cast<const RawCalculation<uint64_t, csum16> *>(&c) ||
+      dynamic_cast<const RawCalculation<uint64_t, cksum16> *>(&c);
+}
+
 // explicit instantiation, should prevent implicit instantiation
 template class CustomCrcMgr<uint8_t>;
 template class CustomCrcMgr<uint16_t>;
@@ -28,6 +28,8 @@
 #include <string>
 #include <sstream>
 
+#include "extract.h"
+
 namespace bm {
 
 namespace {
@@ -107,6 +109,21 @@ Checksum::update(Packet *pkt) const {
 
 bool
 Checksum::verify(const Packet &pkt) const {
+  bool checked;
+  return check(pkt, &checked);
+}
+
+bool
+Checksum::verify_and_record(Packet *pkt) const {
+  bool checked;
+  const bool valid = check(*pkt, &checked);
+  if (checked && valid) record_verified(pkt->get_phv());
+  return valid;
+}
+
+bool
+Checksum::check(const Packet &pkt, bool *checked) const {
+  *checked = false;
   if (!is_target_field_valid(pkt)) {
     BMLOG_TRACE_PKT(
         pkt, "Skipping checksum '{}' verification because target field invalid",
@@ -119,6 +136,7 @@ Checksum::verify(const Packet &pkt) const {
         get_name());
     return true;
   } else {
+    *checked = true;
     bool valid = verify_(pkt);
     BMLOG_DEBUG_PKT(pkt, "Verified checksum '{}': {}", get_name(),
                     valid ? "passed" : "failed");
@@ -146,10 +164,17 @@ CalcBasedChecksum::CalcBasedChecksum(const std::string &name, p4object_id_t id,
                                      header_id_t header_id, int field_offset,
                                      const NamedCalculation *calculation)
   : Checksum(name, id, header_id, field_offset),
-    calculation(calculation) { }
+    calculation(calculation),
+    csum16(is_csum16(*calculation->get_raw_calculation())) { }
+
+void
+CalcBasedChecksum::set_verifier(const CalcBasedChecksum *verifier) {
+  this->verifier = verifier;
+}
 
 void
 CalcBasedChecksum::update_(Packet *pkt) const {
+  if (update_incremental(pkt)) return;
   const uint64_t cksum = calculation->output(*pkt);
   auto &f_cksum = pkt->get_phv()->get_field(header_id, field_offset);
   f_cksum.set(cksum);
@@ -165,6 +190,51 @@ CalcBasedChecksum::verify_(const Packet &pkt) const {
   return (cksum == f_cksum.get<uint64_t>());
 }
 
+void
+CalcBasedChecksum::record_verified(PHV *phv) const {
+  if (!csum16) return;
+  if (!calculation->get_buf_builder().is_from_packet(*phv)) return;
+  auto &hdr = phv->get_header(header_id);
+  // the checksum itself must be the one extracted from the packet
+  if (hdr.is_modified() || hdr.get_packet_offset() < 0) return;
+  if (!hdr.get_packet_image()) return;
+  const auto &layout = hdr.get_header_type().get_layout();
+  if (static_cast<size_t>(field_offset) >= layout.size()) return;
+  hdr.set_verified_checksum(this);
+}
+
+// a full update recomputes the checksum over all the fields (e.g. the
+// whole IPv4 header after a TTL decrement); the incremental one only looks at
+// the fields of the modified headers. It starts from the value of the target
+// field extracted from the packet, which therefore needs to be correct: the
+// parser checked it with the verifier.
+bool
+CalcBasedChecksum::update_incremental(Packet *pkt) const {
+  if (!verifier) return false;
+  PHV *phv = pkt->get_phv();
+  auto &hdr = phv->get_header(header_id);
+  if (hdr.get_verified_checksum() != verifier) return false;
+  // the record is only cleared when the header is extracted again
+  if (hdr.get_packet_offset() < 0) return false;
+  const auto &field_layout = hdr.get_header_type().get_layout()[field_offset];
+  if (field_layout.nbits != 16 || !field_layout.fits_u64) return false;
+  const auto old_cksum = static_cast<uint16_t>(
+      (extract::load_be64(hdr.get_packet_image() + field_layout.byte_offset) >>
+       field_layout.shift) & field_layout.mask);
+  uint16_t cksum;
+  if (!calculation->get_buf_builder().update_csum16(*phv, old_cksum, &cksum))
+    return false;
+  auto &f_cksum = hdr[field_offset];
+  const auto &bytes = f_cksum.get_bytes();
+  // leave the header unmodified if the checksum did not change, so that the
+  // deparser does not have to write it back
+  if (static_cast<unsigned char>(bytes[0]) != (cksum >> 8) ||
+      static_cast<unsigned char>(bytes[1]) != (cksum & 0xff)) {
+    f_cksum.set(cksum);
+  }
+  return true;
+}
+
 IPv4Checksum::IPv4Checksum(const std::string &name, p4object_id_t id,
                            header_id_t header_id, int field_offset)
   : Checksum(name, id, header_id, field_offset) { }
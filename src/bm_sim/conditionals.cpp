@@ -29,6 +29,11 @@ namespace bm {
 
 const ControlFlowNode *
 Conditional::operator()(Packet *pkt) const {
+  return (apply_edge(pkt) == 0) ? true_next : false_next;
+}
+
+int
+Conditional::apply_edge(Packet *pkt) const {
   // TODO(antonin)
   // this is temporary while we experiment with the debugger
   DEBUGGER_NOTIFY_CTR(
@@ -53,7 +58,7 @@ Conditional::operator()(Packet *pkt) const {
   DEBUGGER_NOTIFY_CTR(
       Debugger::PacketId::make(pkt->get_packet_id(), pkt->get_copy_id()),
       DBG_CTR_EXIT(DBG_CTR_CONDITION) | get_id());
-  return result ? true_next : false_next;
+  return result ? 0 : 1;
 }
 
 }  // namespace bm
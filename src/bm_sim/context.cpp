@@ -58,6 +58,23 @@ Context::mt_clear_entries(const std::string &table_name,
   return MatchErrorCode::SUCCESS;
 }
 
+MatchErrorCode
+Context::mt_get_cache_stats(const std::string &table_name,
+                            LookupCacheStats *stats) const {
+  boost::shared_lock<boost::shared_mutex> lock(request_mutex);
+  auto abstract_table = p4objects_rt->get_abstract_match_table_rt(table_name);
+  if (!abstract_table) return MatchErrorCode::INVALID_TABLE_NAME;
+  return abstract_table->get_cache_stats(stats);
+}
+
+MatchErrorCode
+Context::mt_set_cache_size(const std::string &table_name, size_t size) {
+  boost::shared_lock<boost::shared_mutex> lock(request_mutex);
+  auto abstract_table = p4objects_rt->get_abstract_match_table_rt(table_name);
+  if (!abstract_table) return MatchErrorCode::INVALID_TABLE_NAME;
+  return abstract_table->set_cache_size(size);
+}
+
 MatchErrorCode
 Context::mt_add_entry(const std::string &table_name,
                       const std::vector<MatchKeyParam> &match_key,
@@ -76,51 +93,6 @@ Context::mt_add_entry(const std::string &table_name,
     match_key, action, std::move(action_data), handle, priority);
 }
 
-// helper function for FlexCore
-// It will return RuntimeReconfigErrorCode::SUCCESS, if success
-// Otherwise, return RuntimeReconfigErrorCode::UNFOUND_ID_ERROR if the id is unfound, or return RuntimeReconfigErrorCode::PREFIX_ERROR if the prefix is wrong
-RuntimeReconfigErrorCode 
-convert_id_to_name(std::unordered_map<std::string, std::string> &id2newNodeName, 
-    std::string *out, std::string *in, int size) {
-  for (int i = 0; i < size; i++) {
-    if (in[i] == "null") {
-      out[i] = "";
-      continue;
-    }
-    const std::string prefix = in[i].substr(0, 3);
-    const std::string actual_name = in[i].substr(4);
-    if (prefix == "new"
-        || prefix == "flx") {
-      if (id2newNodeName.find(in[i]) == id2newNodeName.end()) {
-        BMLOG_ERROR("Error: cannot find the id {} from id2newNodeName", in[i]);
-        return RuntimeReconfigErrorCode::UNFOUND_ID_ERROR;
-      }
-      out[i] = id2newNodeName[in[i]];
-    } else if (prefix == "old") {
-      out[i] = actual_name;
-    } else {
-      BMLOG_ERROR("Error: prefix {} has no match", prefix);
-      return RuntimeReconfigErrorCode::PREFIX_ERROR;
-    }
-  }
-
-  return RuntimeReconfigErrorCode::SUCCESS;
-}
-
-// helper function for FlexCore
-// It will return RuntimeReconfigErrorCode::SUCCESS if success
-// Otherwise, return RuntimeReconfigErrorCode::DUP_CHECK_ERROR, if the id already exists
-RuntimeReconfigErrorCode
-dup_check(const std::unordered_map<std::string, std::string> &id2newNodeName, 
-    const std::string &name) {
-  if (id2newNodeName.find(name) != id2newNodeName.end()) {
-    BMLOG_ERROR("Error: Duplicated id {} from id2newNodeName", name);
-    return RuntimeReconfigErrorCode::DUP_CHECK_ERROR;
-  }
-
-  return RuntimeReconfigErrorCode::SUCCESS;
-}
-
 // helper function for FlexCore
 // It will return RuntimeReconfigErrorCode::SUCCESS if success
 // Otherwise, return RuntimeReconfigErrorCode::INVALID_HASH_FUNCTION_NAME_ERROR if the hash function is unfound
@@ -172,168 +144,58 @@ Context::mt_runtime_reconfig_with_stream(std::istream* json_file_stream,
                                         LookupStructureFactory *lookup_factory,
                                         const std::set<P4Objects::header_field_pair> &required_fields,
                                         const P4Objects::ForceArith &arith_objects) {
-  p4objects_new = std::make_shared<P4Objects>(std::cout, true);
-  int status = p4objects_new->init_objects(json_file_stream, lookup_factory, device_id, cxt_id,
-                                           notifications_transport,
-                                           required_fields, arith_objects);
+  ReconfigPlan plan;
+  RuntimeReconfigErrorCode rc = runtime_reconfig_prepare(
+      json_file_stream, plan_file_stream, lookup_factory, required_fields,
+      arith_objects, &plan);
+  if (rc != RuntimeReconfigErrorCode::SUCCESS) return rc;
+  return runtime_reconfig_commit(plan);
+}
+
+RuntimeReconfigErrorCode
+Context::runtime_reconfig_prepare(std::istream *json_file_stream,
+                                  std::istream *plan_file_stream,
+                                  LookupStructureFactory *lookup_factory,
+                                  const std::set<header_field_pair> &required_fields,
+                                  const ForceArith &arith_objects,
+                                  ReconfigPlan *plan) {
+  auto start = ReconfigStats::clock::now();
+  RuntimeReconfigErrorCode rc = plan->parse(plan_file_stream);
+  if (rc != RuntimeReconfigErrorCode::SUCCESS) return rc;
+
+  boost::shared_lock<boost::shared_mutex> lock(request_mutex);
+  // only the nodes inserted by the plan are loaded from the new JSON, the rest
+  // (header layout, stateful objects) is shared with the running program
+  auto new_objects = std::make_shared<P4Objects>(std::cout, true);
+  int status = new_objects->init_objects_delta(
+      json_file_stream, *p4objects_rt, plan->get_inserted_node_names(),
+      lookup_factory, device_id, cxt_id, notifications_transport,
+      required_fields, arith_objects);
   if (status) return RuntimeReconfigErrorCode::P4OBJECTS_INIT_FAIL;
-  
-  std::string line;
-  std::unordered_map<std::string, std::string> id2newNodeName;
-  std::string op;
-  std::string target;
-  std::string pipeline;
-  std::string items[3], vals[3];
-  while (std::getline(*plan_file_stream, line)) {
-    sleep(1);
-    std::stringstream ss(line);
-    ss >> op >> target;
-    if (op == "insert") {
-      if (target == "tabl") {
-        ss >> pipeline >> items[0];
-        const std::string prefix = items[0].substr(0, 3);
-        const std::string actual_name = items[0].substr(4);
-        if (prefix != "new") {
-          BMLOG_ERROR("Error: inserted table should only have prefix 'new_', but you enter {}", items[0]);
-          return RuntimeReconfigErrorCode::PREFIX_ERROR;
-        }
-        if (dup_check(id2newNodeName, items[0]) == RuntimeReconfigErrorCode::DUP_CHECK_ERROR) {
-          return RuntimeReconfigErrorCode::DUP_CHECK_ERROR;
-        }
-        id2newNodeName[items[0]] = p4objects_rt->insert_match_table_rt(p4objects_new, pipeline, actual_name, true);
-      } else if (target == "cond") {
-        ss >> pipeline >> items[0];
-        const std::string prefix = items[0].substr(0, 3);
-        const std::string actual_name = items[0].substr(4);
-        if (prefix != "new") {
-          BMLOG_ERROR("Error: inserted cond should only have prefix 'new_', but you enter {}", items[0]);
-          return RuntimeReconfigErrorCode::PREFIX_ERROR;
-        }
-        if (dup_check(id2newNodeName, items[0]) == RuntimeReconfigErrorCode::DUP_CHECK_ERROR) {
-          return RuntimeReconfigErrorCode::DUP_CHECK_ERROR;
-        }
-        id2newNodeName[items[0]] = p4objects_rt->insert_conditional_rt(p4objects_new, pipeline, actual_name, true);
-      } else if (target == "flex") {
-        ss >> pipeline >> items[0] >> items[1] >> items[2];
-        const std::string prefix = items[0].substr(0, 3);
-        const std::string actual_name = items[0].substr(4);
-        if (prefix != "flx") {
-          BMLOG_ERROR("Error: inserted flex should only have prefix 'flx_', but you enter {}", items[0]);
-          return RuntimeReconfigErrorCode::PREFIX_ERROR;
-        }
-        RuntimeReconfigErrorCode convert_id_return_code = convert_id_to_name(id2newNodeName, vals, items+1, 2);
-        if (convert_id_return_code != RuntimeReconfigErrorCode::SUCCESS) {
-          return convert_id_return_code;
-        }
-        id2newNodeName[items[0]] = p4objects_rt->insert_flex_rt(pipeline, vals[0], vals[1]);
-      } else if (target == "register_array") {
-        ss >> items[0] >> vals[0] >> vals[1];
-        const std::string prefix = items[0].substr(0, 3);
-        const std::string actual_name = items[0].substr(4);
-        if (prefix != "new") {
-          BMLOG_ERROR("Error: inserted register_array should only have prefix 'new_', but you enter {}", items[0]);
-          return RuntimeReconfigErrorCode::PREFIX_ERROR;
-        }
-        if (dup_check(id2newNodeName, items[0]) == RuntimeReconfigErrorCode::DUP_CHECK_ERROR) {
-          return RuntimeReconfigErrorCode::DUP_CHECK_ERROR;
-        }
-        id2newNodeName[items[0]] = p4objects_rt->insert_register_array_rt(actual_name, vals[0], vals[1]);
-      } else {
-        BMLOG_ERROR("Error: unsupported target for insert: {}", target);
-        return RuntimeReconfigErrorCode::UNSUPPORTED_TARGET_ERROR;
-      }
-    } else if (op == "change") {
-      if (target == "tabl") {
-        ss >> pipeline >> items[0] >> items[2] >> items[1];
-        RuntimeReconfigErrorCode convert_id_return_code = convert_id_to_name(id2newNodeName, vals, items, 2);
-        if (convert_id_return_code != RuntimeReconfigErrorCode::SUCCESS) {
-          return convert_id_return_code;
-        }
-        p4objects_rt->change_table_next_node_rt(pipeline, vals[0], items[2], vals[1]);
-      } else if (target == "cond") {
-        ss >> pipeline >> items[0] >> items[2] >> items[1];
-        RuntimeReconfigErrorCode convert_id_return_code = convert_id_to_name(id2newNodeName, vals, items, 2);
-        if (convert_id_return_code != RuntimeReconfigErrorCode::SUCCESS) {
-          return convert_id_return_code;
-        }
-        p4objects_rt->change_conditional_next_node_rt(pipeline, vals[0], items[2], vals[1]);
-      } else if (target == "flex") {
-        ss >> pipeline >> items[0] >> items[2] >> items[1];
-        RuntimeReconfigErrorCode convert_id_return_code = convert_id_to_name(id2newNodeName, vals, items, 2);
-        if (convert_id_return_code != RuntimeReconfigErrorCode::SUCCESS) {
-          return convert_id_return_code;
-        }
-        p4objects_rt->change_conditional_next_node_rt(pipeline, vals[0], items[2], vals[1]);
-      } else if (target == "init") {
-        ss >> pipeline >> items[0];
-        RuntimeReconfigErrorCode convert_id_return_code = convert_id_to_name(id2newNodeName, vals, items, 1);
-        if (convert_id_return_code != RuntimeReconfigErrorCode::SUCCESS) {
-          return convert_id_return_code;
-        }
-        p4objects_rt->change_init_node_rt(pipeline, vals[0]);
-      } else if (target == "register_array_size") {
-        ss >> items[0] >> items[1];
-        RuntimeReconfigErrorCode convert_id_return_code = convert_id_to_name(id2newNodeName, vals, items, 1);
-        if (convert_id_return_code != RuntimeReconfigErrorCode::SUCCESS) {
-          return convert_id_return_code;
-        }
-        p4objects_rt->change_register_array_size_rt(vals[0], items[1]);
-      } else if (target == "register_array_bitwidth") {
-        ss >> items[0] >> items[1];
-        RuntimeReconfigErrorCode convert_id_return_code = convert_id_to_name(id2newNodeName, vals, items, 1);
-        if (convert_id_return_code != RuntimeReconfigErrorCode::SUCCESS) {
-          return convert_id_return_code;
-        }
-        p4objects_rt->change_register_array_bitwidth_rt(vals[0], items[1]);
-      } else {
-        BMLOG_ERROR("Error: unsupported target for change: {}", target);
-        return RuntimeReconfigErrorCode::UNSUPPORTED_TARGET_ERROR;
-      }
-    } else if (op == "trigger") {
-      if (target == "on") {
-        p4objects_rt->flex_trigger_rt(true);
-      } else if (target == "off") {
-        p4objects_rt->flex_trigger_rt(false);
-      } else {
-        BMLOG_ERROR("Error: unsupported target for trigger: {}", target);
-        return RuntimeReconfigErrorCode::UNSUPPORTED_TARGET_ERROR;
-      }
-    } else if (op == "delete") {
-      if (target == "register_array") {
-        ss >> items[0];
-      } else {
-        ss >> pipeline >> items[0];
-      }
-      RuntimeReconfigErrorCode convert_id_return_code = convert_id_to_name(id2newNodeName, vals, items, 1);
-      if (convert_id_return_code != RuntimeReconfigErrorCode::SUCCESS) {
-        return convert_id_return_code;
-      }
-
-      if (target == "tabl") {
-        p4objects_rt->delete_match_table_rt(pipeline, vals[0]);
-      } else if (target == "cond") {
-        p4objects_rt->delete_conditional_rt(pipeline, vals[0]);
-      } else if (target == "flex") {
-        p4objects_rt->delete_flex_rt(pipeline, vals[0]);
-      } else if (target == "register_array") {
-        p4objects_rt->delete_register_array_rt(vals[0]);
-      } else {
-        BMLOG_ERROR("Error: unsupported target for delete: {}", target);
-        return RuntimeReconfigErrorCode::UNSUPPORTED_TARGET_ERROR;
-      }
-      const std::string prefix = items[0].substr(0, 3);
-      const std::string actual_name = items[0].substr(4);
-      if (prefix == "new" || prefix == "flx") {
-        if (id2newNodeName.erase(items[0]) != 1) {
-          BMLOG_ERROR("Error: delete id from id2newNodeName fail: {}", items[0]);
-          return RuntimeReconfigErrorCode::DELETE_ID_FAIL;
-        }
-      }
-    } else {
-      BMLOG_ERROR("Error: unsupport operation {}", op);
-    }
-  }
-  return RuntimeReconfigErrorCode::SUCCESS;      
+  p4objects_new = new_objects;
+  plan->set_new_objects(new_objects);
+
+  rc = plan->validate(*p4objects_rt, id2newNodeName);
+  lock.unlock();
+  reconfig_stats.record("prepare", ReconfigStats::clock::now() - start);
+  return rc;
+}
+
+RuntimeReconfigErrorCode
+Context::runtime_reconfig_commit(const ReconfigPlan &plan) {
+  auto start = ReconfigStats::clock::now();
+  boost::unique_lock<boost::shared_mutex> lock(request_mutex);
+  // another reconfiguration may have been committed since prepare
+  RuntimeReconfigErrorCode rc = plan.validate(*p4objects_rt, id2newNodeName);
+  if (rc != RuntimeReconfigErrorCode::SUCCESS) return rc;
+  plan.commit(p4objects_rt.get(), &id2newNodeName, &reconfig_stats);
+  reconfig_stats.record("commit", ReconfigStats::clock::now() - start);
+  auto publish_start = ReconfigStats::clock::now();
+  p4objects_rt->publish_control_flow_graph_rt();
+  reconfig_stats.record("publish",
+                        ReconfigStats::clock::now() - publish_start);
+  plan.apply_triggers(p4objects_rt.get(), &reconfig_stats);
+  return rc;
 }
 
 MatchErrorCode
@@ -850,8 +712,9 @@ Context::register_read(const std::string &register_name,
   RegisterArray *register_array = p4objects_rt->get_register_array_rt(
       register_name);
   if (!register_array) return Register::INVALID_REGISTER_NAME;
+  // holding any stripe is enough to prevent the array from being resized
+  auto register_lock = register_array->cell_lock(idx);
   if (idx >= register_array->size()) return Register::INVALID_INDEX;
-  auto register_lock = register_array->unique_lock();
   value->set((*register_array)[idx]);
   return Register::SUCCESS;
 }
@@ -875,8 +738,8 @@ Context::register_write(const std::string &register_name,
   RegisterArray *register_array = p4objects_rt->get_register_array_rt(
       register_name);
   if (!register_array) return Register::INVALID_REGISTER_NAME;
+  auto register_lock = register_array->cell_lock(idx);
   if (idx >= register_array->size()) return Register::INVALID_INDEX;
-  auto register_lock = register_array->unique_lock();
   (*register_array)[idx].set(std::move(value));
   return Register::SUCCESS;
 }
@@ -889,9 +752,9 @@ Context::register_write_range(const std::string &register_name,
   RegisterArray *register_array = p4objects_rt->get_register_array_rt(
       register_name);
   if (!register_array) return Register::INVALID_REGISTER_NAME;
+  auto register_lock = register_array->unique_lock();
   if (end > register_array->size() || start > end)
     return Register::INVALID_INDEX;
-  auto register_lock = register_array->unique_lock();
   for (size_t idx = start; idx < end; idx++)
     register_array->at(idx).set(value);
   return Register::SUCCESS;
@@ -0,0 +1,81 @@
+/* Copyright 2013-present Barefoot Networks, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <bm/bm_sim/control_flow_graph.h>
+#include <bm/bm_sim/pipeline.h>
+#include <bm/bm_sim/_assert.h>
+
+namespace bm {
+
+VersionedControlFlowGraph::ReadGuard
+VersionedControlFlowGraph::read() const {
+  return current.read();
+}
+
+void
+VersionedControlFlowGraph::add_node(ControlFlowNode *node) {
+  size_t slot;
+  if (free_slots.empty()) {
+    slot = nodes.size();
+    nodes.push_back(node);
+  } else {
+    // the previous node in this slot may still be used with the current
+    // snapshot, but it indexes the snapshot's own copy of the edges
+    slot = free_slots.back();
+    free_slots.pop_back();
+    nodes[slot] = node;
+  }
+  node->set_cfg_slot(slot);
+}
+
+void
+VersionedControlFlowGraph::remove_node(ControlFlowNode *node) {
+  const size_t slot = node->get_cfg_slot();
+  _BM_ASSERT(slot < nodes.size() && nodes[slot] == node);
+  nodes[slot] = nullptr;
+  free_slots.push_back(slot);
+}
+
+size_t
+VersionedControlFlowGraph::add_pipeline(const Pipeline *pipeline) {
+  pipelines.push_back(pipeline);
+  return pipelines.size() - 1;
+}
+
+void
+VersionedControlFlowGraph::publish() {
+  std::unique_ptr<ControlFlowGraph> graph(new ControlFlowGraph());
+  graph->edges.resize(nodes.size());
+  for (size_t slot = 0; slot < nodes.size(); slot++) {
+    if (!nodes[slot]) continue;
+    for (int edge = 0; edge < ControlFlowGraph::max_out_edges; edge++)
+      graph->edges[slot][edge] = nodes[slot]->get_out_edge(edge);
+  }
+  graph->first_nodes.reserve(pipelines.size());
+  for (const auto pipeline : pipelines)
+    graph->first_nodes.push_back(pipeline->get_first_node());
+  graph->version = get_version() + 1;
+
+  current.publish(std::move(graph));
+  retired.clear();
+}
+
+uint64_t
+VersionedControlFlowGraph::get_version() const {
+  const auto graph = current.get();
+  return graph ? graph->version : 0;
+}
+
+}  // namespace bm
@@ -74,8 +74,6 @@ Deparser::deparse(Packet *pkt) const {
       DBG_CTR_DEPARSER | get_id());
   BMLOG_DEBUG_PKT(*pkt, "Deparser '{}': start", get_name());
   update_checksums(pkt);
-  char *data = pkt->prepend(get_headers_size(*phv));
-  int bytes_parsed = 0;
   {
     RegisterSync::RegisterLocks RL;
     register_sync.lock(&RL);
@@ -85,13 +83,17 @@ Deparser::deparse(Packet *pkt) const {
   }
   // invalidating headers, and resetting header stacks is done in the Packet
   // destructor, when the PHV is released
-  for (auto it = headers.begin(); it != headers.end(); ++it) {
-    const auto &header = phv->get_header(*it);
-    if (header.is_valid()) {
-      BMELOG(deparser_emit, *pkt, *it);
-      BMLOG_DEBUG_PKT(*pkt, "Deparsing header '{}'", header.get_name());
-      header.deparse(data + bytes_parsed);
-      bytes_parsed += header.get_nbytes_packet();
+  if (!deparse_in_place(pkt)) {
+    char *data = pkt->prepend(get_headers_size(*phv));
+    int bytes_parsed = 0;
+    for (auto it = headers.begin(); it != headers.end(); ++it) {
+      const auto &header = phv->get_header(*it);
+      if (header.is_valid()) {
+        BMELOG(deparser_emit, *pkt, *it);
+        BMLOG_DEBUG_PKT(*pkt, "Deparsing header '{}'", header.get_name());
+        header.deparse(data + bytes_parsed);
+        bytes_parsed += header.get_nbytes_packet();
+      }
     }
   }
   BMELOG(deparser_done, *pkt, *this);
@@ -101,6 +103,44 @@ Deparser::deparse(Packet *pkt) const {
   BMLOG_DEBUG_PKT(*pkt, "Deparser '{}': end", get_name());
 }
 
+// if the valid headers are the ones the parser extracted, in the
+// same order, the bytes they were extracted from are still in the buffer, in
+// front of the packet data (see Packet::remove_parsed()). We make them part of
+// the data again, which moves no data, and only the headers which were
+// modified since they were extracted need to be deparsed, in place. A packet
+// whose data is shared with its clones (e.g. a multicast replica) gets a
+// private copy of the data only in that case.
+bool
+Deparser::deparse_in_place(Packet *pkt) const {
+  if (!pkt->can_restore_parsed()) return false;
+  const PHV *phv = pkt->get_phv();
+  int offset = 0;
+  bool modified = false;
+  for (auto it = headers.begin(); it != headers.end(); ++it) {
+    const auto &header = phv->get_header(*it);
+    if (!header.is_valid()) continue;
+    if (header.get_packet_offset() != offset) return false;
+    offset += header.get_nbytes_packet();
+    modified = modified || header.is_modified();
+  }
+  if (static_cast<size_t>(offset) != pkt->get_parsed_bytes()) return false;
+
+  pkt->restore_parsed();
+  char *data = modified ? pkt->data() : nullptr;
+  for (auto it = headers.begin(); it != headers.end(); ++it) {
+    const auto &header = phv->get_header(*it);
+    if (!header.is_valid()) continue;
+    BMELOG(deparser_emit, *pkt, *it);
+    if (header.is_modified()) {
+      BMLOG_DEBUG_PKT(*pkt, "Deparsing header '{}'", header.get_name());
+      header.deparse(data + header.get_packet_offset());
+    } else {
+      BMLOG_DEBUG_PKT(*pkt, "Header '{}' left in place", header.get_name());
+    }
+  }
+  return true;
+}
+
 void
 Deparser::update_checksums(Packet *pkt) const {
   for (const Checksum *checksum : checksums) {
@@ -80,6 +80,10 @@ class FilesDevMgrImp : public DevMgrIface {
     writer.send_packet(port_num, buffer, len);
   }
 
+  void transmit_burst_(const BurstPacket *packets, size_t count) override {
+    writer.send_burst(packets, count);
+  }
+
   void start_() override {
     reader_thread = std::thread(&PcapFilesReader::start, &reader);
     reader_thread.detach();
@@ -91,6 +95,11 @@ class FilesDevMgrImp : public DevMgrIface {
     return ReturnCode::SUCCESS;
   }
 
+  ReturnCode set_burst_handler_(const BurstHandler &handler, size_t max_burst,
+                                void *cookie) override {
+    return reader.set_burst_handler(handler, max_burst, cookie);
+  }
+
   bool port_is_up_(port_t port) const override {
     Lock lock(mutex);
     return port_info.find(port) != port_info.end();
@@ -146,6 +155,28 @@ DevMgrIface::set_packet_handler(const PacketHandler &handler, void *cookie) {
   return set_packet_handler_(handler, cookie);
 }
 
+PacketDispatcherIface::ReturnCode
+DevMgrIface::set_burst_handler(const BurstHandler &handler, size_t max_burst,
+                               void *cookie) {
+  return set_burst_handler_(handler, max_burst, cookie);
+}
+
+PacketDispatcherIface::ReturnCode
+DevMgrIface::set_burst_handler_(const BurstHandler &handler, size_t max_burst,
+                                void *cookie) {  // default implementation
+  UNUSED(handler);
+  UNUSED(max_burst);
+  UNUSED(cookie);
+  return ReturnCode::UNSUPPORTED;
+}
+
+void
+DevMgrIface::transmit_burst_(const BurstPacket *packets,
+                             size_t count) {  // default implementation
+  for (size_t i = 0; i < count; i++)
+    transmit_fn_(packets[i].port_num, packets[i].buffer, packets[i].len);
+}
+
 bool
 DevMgrIface::port_is_up(port_t port_num) const {
   return port_is_up_(port_num);
@@ -232,6 +263,20 @@ DevMgr::transmit_fn(port_t port_num, const char *buffer, int len) {
   pimp->transmit_fn(port_num, buffer, len);
 }
 
+void
+DevMgr::transmit_burst(const BurstPacket *packets, size_t count) {
+  assert(pimp);
+  if (dump_packet_data > 0) {
+    for (size_t i = 0; i < count; i++) {
+      Logger::get()->info(
+          "Sending packet of length {} on port {}: {}", packets[i].len,
+          packets[i].port_num,
+          sample_packet_data(packets[i].buffer, packets[i].len));
+    }
+  }
+  pimp->transmit_burst(packets, count);
+}
+
 PacketDispatcherIface::ReturnCode
 DevMgr::port_remove(port_t port_num) {
   assert(pimp);
@@ -248,6 +293,16 @@ DevMgr::set_packet_handler(const PacketHandler &handler, void *cookie) {
   return pimp->set_packet_handler(handler, cookie);
 }
 
+PacketDispatcherIface::ReturnCode
+DevMgr::set_burst_handler(const BurstHandler &handler, size_t max_burst,
+                          void *cookie) {
+  assert(pimp);
+  assert(max_burst > 0);
+  ReturnCode rc = pimp->set_burst_handler(handler, max_burst, cookie);
+  if (rc == ReturnCode::SUCCESS) burst_size = max_burst;
+  return rc;
+}
+
 PacketDispatcherIface::ReturnCode
 DevMgr::register_status_cb(const PortStatus &type,
                            const PortStatusCb &port_cb) {
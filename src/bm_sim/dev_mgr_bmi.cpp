@@ -22,6 +22,7 @@
 #include <bm/bm_sim/logger.h>
 
 #include <cassert>
+#include <cstddef>  // offsetof
 #include <cstdlib>
 #include <mutex>
 #include <map>
@@ -33,6 +34,19 @@ extern "C" {
 
 namespace bm {
 
+namespace {
+
+// bursts are passed to / from the BMI library without any conversion
+using BurstPacket = PacketDispatcherIface::BurstPacket;
+static_assert(sizeof(BurstPacket) == sizeof(bmi_packet_t) &&
+              offsetof(BurstPacket, port_num) ==
+              offsetof(bmi_packet_t, port_num) &&
+              offsetof(BurstPacket, buffer) == offsetof(bmi_packet_t, buffer) &&
+              offsetof(BurstPacket, len) == offsetof(bmi_packet_t, len),
+              "BurstPacket and bmi_packet_t must have the same layout");
+
+}  // namespace
+
 // These are private implementations
 
 // Implementation that uses the BMI to send/receive packets
@@ -94,6 +108,12 @@ class BmiDevMgrImp : public DevMgrIface {
     bmi_port_send(port_mgr, port_num, buffer, len);
   }
 
+  void transmit_burst_(const BurstPacket *packets, size_t count) override {
+    bmi_port_send_burst(port_mgr,
+                        reinterpret_cast<const bmi_packet_t *>(packets),
+                        static_cast<int>(count));
+  }
+
   void start_() override {
     assert(port_mgr);
     if (bmi_start_mgr(port_mgr))
@@ -113,6 +133,25 @@ class BmiDevMgrImp : public DevMgrIface {
     return ReturnCode::SUCCESS;
   }
 
+  ReturnCode set_burst_handler_(const BurstHandler &handler, size_t max_burst,
+                                void *cookie) override {
+    burst_handler = handler;
+    burst_cookie = cookie;
+    if (bmi_set_burst_handler(port_mgr, &BmiDevMgrImp::bmi_burst_handler,
+                              static_cast<int>(max_burst), this)) {
+      Logger::get()->critical("Could not set BMI burst handler");
+      return ReturnCode::ERROR;
+    }
+    return ReturnCode::SUCCESS;
+  }
+
+  static void bmi_burst_handler(const bmi_packet_t *packets, int count,
+                                void *cookie) {
+    auto *dev_mgr = static_cast<BmiDevMgrImp *>(cookie);
+    dev_mgr->burst_handler(reinterpret_cast<const BurstPacket *>(packets),
+                           static_cast<size_t>(count), dev_mgr->burst_cookie);
+  }
+
   bool port_is_up_(port_t port) const override {
     bool is_up = false;
     assert(port_mgr);
@@ -152,6 +191,8 @@ class BmiDevMgrImp : public DevMgrIface {
   using Lock = std::lock_guard<std::mutex>;
 
   bmi_port_mgr_t *port_mgr{nullptr};
+  BurstHandler burst_handler{};
+  void *burst_cookie{nullptr};
   mutable Mutex mutex;
   std::map<port_t, DevMgrIface::PortInfo> port_info;
 };
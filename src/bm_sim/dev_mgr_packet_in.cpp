@@ -33,6 +33,7 @@
 #include <mutex>
 #include <string>
 #include <map>
+#include <vector>
 
 namespace bm {
 
@@ -100,6 +101,22 @@ class PacketInDevMgrImp : public DevMgrIface {
     return ReturnCode::SUCCESS;
   }
 
+  // Every time the receive thread wakes up, it reads all the messages already
+  // queued on the socket (up to max_burst PACKET_IN messages) before calling
+  // the handler. The packets are not copied, the messages are freed once the
+  // handler returns.
+  // There is no transmit_burst_ override: the protocol carries one packet per
+  // nanomsg message.
+  ReturnCode set_burst_handler_(const BurstHandler &handler, size_t max_burst,
+                                void *cookie) override {
+    burst_handler = handler;
+    burst_cookie = cookie;
+    burst.reserve(max_burst);
+    burst_msgs.reserve(max_burst);
+    this->max_burst = max_burst;
+    return ReturnCode::SUCCESS;
+  }
+
   bool port_is_up_(port_t port) const override {
     if (!enforce_ports) return true;
     Lock lock(mutex);
@@ -186,6 +203,8 @@ class PacketInDevMgrImp : public DevMgrIface {
 
   void handle_msg(void *msg);
   void handle_info_req_msg(void *msg);
+  bool add_to_burst(void *msg);
+  void flush_burst();
 
  private:
   using Mutex = std::mutex;
@@ -195,6 +214,12 @@ class PacketInDevMgrImp : public DevMgrIface {
   nn::socket s;
   PacketHandler pkt_handler{};
   void *pkt_cookie{nullptr};
+  BurstHandler burst_handler{};
+  void *burst_cookie{nullptr};
+  size_t max_burst{1};
+  // only accessed by the receive thread
+  std::vector<BurstPacket> burst{};
+  std::vector<void *> burst_msgs{};
   std::thread receive_thread{};
   std::atomic<bool> stop_receive_thread{false};
   std::atomic<bool> started{false};
@@ -294,6 +319,35 @@ PacketInDevMgrImp::handle_msg(void *msg) {
   }
 }
 
+// returns false if msg is not a packet which can be added to the burst, in which
+// case it has to go through handle_msg
+bool
+PacketInDevMgrImp::add_to_burst(void *msg) {
+  packet_hdr_t packet_hdr;
+  std::memcpy(&packet_hdr, msg, sizeof(packet_hdr));
+  if (packet_hdr.type != MSG_TYPE_PACKET_IN) return false;
+  if (enforce_ports) {
+    Lock lock(mutex);
+    auto it = port_info.find(packet_hdr.port);
+    if (it == port_info.end() || !it->second.is_up)
+      return false;
+  }
+  char *data = static_cast<char *>(msg) + sizeof(packet_hdr);
+  BMLOG_TRACE("Packet in received on port {}", packet_hdr.port);
+  burst.push_back({packet_hdr.port, data, packet_hdr.more});
+  burst_msgs.push_back(msg);
+  return true;
+}
+
+void
+PacketInDevMgrImp::flush_burst() {
+  if (burst.empty()) return;
+  burst_handler(burst.data(), burst.size(), burst_cookie);
+  for (auto msg : burst_msgs) nn::freemsg(msg);
+  burst.clear();
+  burst_msgs.clear();
+}
+
 void
 PacketInDevMgrImp::receive_loop() {
   struct nn_msghdr msghdr;
@@ -308,9 +362,24 @@ PacketInDevMgrImp::receive_loop() {
     int rc = s.recvmsg(&msghdr, 0);
     if (rc < 0) continue;
     assert(msg);
-    handle_msg(msg);
-    nn::freemsg(msg);
-    msg = nullptr;
+    if (!burst_handler) {
+      handle_msg(msg);
+      nn::freemsg(msg);
+      msg = nullptr;
+      continue;
+    }
+    do {
+      assert(msg);
+      if (!add_to_burst(msg)) {
+        // preserve the ordering between packets and other messages
+        flush_burst();
+        handle_msg(msg);
+        nn::freemsg(msg);
+      }
+      msg = nullptr;
+      if (burst.size() == max_burst) flush_burst();
+    } while (!stop_receive_thread && s.recvmsg(&msghdr, NN_DONTWAIT) >= 0);
+    flush_burst();
   }
 }
 
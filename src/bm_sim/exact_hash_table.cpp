@@ -0,0 +1,249 @@
+/* Copyright 2013-present Barefoot Networks, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <bm/bm_sim/_assert.h>
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+#include "exact_hash_table.h"
+#include "xxhash.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace bm {
+
+namespace {
+
+constexpr int8_t kEmpty = -128;
+constexpr int8_t kDeleted = -2;
+// full slots store the 7 low bits of the hash, so they are >= 0
+
+// maximum load factor is 7/8
+size_t max_elements(size_t capacity) {
+  return capacity - capacity / 8;
+}
+
+// smallest power of 2 (at least one group) with enough room for size elements
+size_t capacity_for(size_t size, size_t group_size) {
+  size_t capacity = group_size;
+  while (max_elements(capacity) < size) capacity *= 2;
+  return capacity;
+}
+
+// bit i of the returned mask is set iff ctrl[i] == v, for the 16 control bytes
+// of a group
+uint32_t match_byte(const int8_t *ctrl, int8_t v) {
+#ifdef __SSE2__
+  const __m128i g = _mm_loadu_si128(reinterpret_cast<const __m128i *>(ctrl));
+  return static_cast<uint32_t>(
+      _mm_movemask_epi8(_mm_cmpeq_epi8(g, _mm_set1_epi8(v))));
+#else
+  uint32_t mask = 0;
+  for (int i = 0; i < 16; i++)
+    mask |= static_cast<uint32_t>(ctrl[i] == v) << i;
+  return mask;
+#endif
+}
+
+// empty and deleted slots are the only ones with the sign bit set
+uint32_t match_free(const int8_t *ctrl) {
+#ifdef __SSE2__
+  const __m128i g = _mm_loadu_si128(reinterpret_cast<const __m128i *>(ctrl));
+  return static_cast<uint32_t>(_mm_movemask_epi8(g));
+#else
+  uint32_t mask = 0;
+  for (int i = 0; i < 16; i++)
+    mask |= static_cast<uint32_t>(ctrl[i] < 0) << i;
+  return mask;
+#endif
+}
+
+int8_t h2(uint64_t h) {
+  return static_cast<int8_t>(h & 0x7f);
+}
+
+size_t h1(uint64_t h) {
+  return static_cast<size_t>(h >> 7);
+}
+
+}  // namespace
+
+ExactHashTable::ExactHashTable(size_t size, size_t nbytes_key)
+    : nbytes_key(nbytes_key) {
+  reset(capacity_for(size, group_size));
+}
+
+uint64_t
+ExactHashTable::hash(const char *key) const {
+  return XXH64(key, nbytes_key, 0);
+}
+
+// groups are probed following the triangular numbers, which visits all of them
+// since the number of groups is a power of 2; the probing stops at the first
+// group with an empty slot, since the key would have been inserted there
+size_t
+ExactHashTable::find_slot(const char *key, uint64_t h) const {
+  size_t g = h1(h) & group_mask;
+  for (size_t i = 1; i <= group_mask + 1; i++) {
+    const size_t base = g * group_size;
+    for (uint32_t mask = match_byte(&ctrl[base], h2(h)); mask != 0;
+         mask &= mask - 1) {
+      const size_t slot = base + __builtin_ctz(mask);
+      if (std::memcmp(&keys[slot * nbytes_key], key, nbytes_key) == 0)
+        return slot;
+    }
+    if (match_byte(&ctrl[base], kEmpty) != 0) break;
+    g = (g + i) & group_mask;
+  }
+  return capacity();
+}
+
+size_t
+ExactHashTable::find_free_slot(uint64_t h) const {
+  size_t g = h1(h) & group_mask;
+  // there is always at least one empty slot (see max_elements)
+  for (size_t i = 1; ; i++) {
+    const size_t base = g * group_size;
+    const uint32_t mask = match_free(&ctrl[base]);
+    if (mask != 0) return base + __builtin_ctz(mask);
+    g = (g + i) & group_mask;
+  }
+}
+
+bool
+ExactHashTable::find(const ByteContainer &key, uintptr_t *value) const {
+  if (key.size() != nbytes_key) return false;
+  const size_t slot = find_slot(key.data(), hash(key.data()));
+  if (slot == capacity()) return false;
+  *value = values[slot];
+  return true;
+}
+
+void
+ExactHashTable::find_batch(const ByteContainer *keys, size_t n,
+                           uintptr_t *values, bool *found) const {
+  constexpr size_t chunk = 16;
+  uint64_t hashes[chunk];
+  for (size_t start = 0; start < n; start += chunk) {
+    const size_t end = std::min(n, start + chunk);
+    for (size_t i = start; i < end; i++) {
+      if (keys[i].size() != nbytes_key) continue;
+      const uint64_t h = hash(keys[i].data());
+      hashes[i - start] = h;
+      const size_t base = (h1(h) & group_mask) * group_size;
+      __builtin_prefetch(&ctrl[base]);
+      __builtin_prefetch(&this->keys[base * nbytes_key]);
+    }
+    for (size_t i = start; i < end; i++) {
+      found[i] = false;
+      if (keys[i].size() != nbytes_key) continue;
+      const size_t slot = find_slot(keys[i].data(), hashes[i - start]);
+      if (slot == capacity()) continue;
+      values[i] = this->values[slot];
+      found[i] = true;
+    }
+  }
+}
+
+void
+ExactHashTable::insert(const ByteContainer &key, uintptr_t value) {
+  _BM_ASSERT(key.size() == nbytes_key);
+  const uint64_t h = hash(key.data());
+  size_t slot = find_slot(key.data(), h);
+  if (slot != capacity()) {
+    values[slot] = value;
+    return;
+  }
+  slot = find_free_slot(h);
+  if (growth_left == 0 && ctrl[slot] == kEmpty) {
+    // if the table is not full, reclaiming the deleted slots is enough
+    if (nb_elements + 1 > max_elements(capacity()))
+      rehash(capacity() * 2);
+    else
+      rehash(capacity());
+    slot = find_free_slot(h);
+  }
+  if (ctrl[slot] == kEmpty) growth_left--;
+  ctrl[slot] = h2(h);
+  std::copy(key.begin(), key.end(), keys.begin() + slot * nbytes_key);
+  values[slot] = value;
+  nb_elements++;
+}
+
+// a slot can be marked as empty again if its group still has an empty slot,
+// since in that case no probing went past the group; otherwise it has to be
+// marked as deleted
+bool
+ExactHashTable::erase(const ByteContainer &key) {
+  if (key.size() != nbytes_key) return false;
+  const size_t slot = find_slot(key.data(), hash(key.data()));
+  if (slot == capacity()) return false;
+  const size_t base = slot & ~(group_size - 1);
+  if (match_byte(&ctrl[base], kEmpty) != 0) {
+    ctrl[slot] = kEmpty;
+    growth_left++;
+  } else {
+    ctrl[slot] = kDeleted;
+  }
+  nb_elements--;
+  return true;
+}
+
+void
+ExactHashTable::clear() {
+  std::fill(ctrl.begin(), ctrl.end(), kEmpty);
+  nb_elements = 0;
+  growth_left = max_elements(capacity());
+}
+
+void
+ExactHashTable::rehash(size_t new_capacity) {
+  std::vector<int8_t> old_ctrl;
+  std::vector<char> old_keys;
+  std::vector<uintptr_t> old_values;
+  old_ctrl.swap(ctrl);
+  old_keys.swap(keys);
+  old_values.swap(values);
+  reset(new_capacity);
+  for (size_t i = 0; i < old_ctrl.size(); i++) {
+    if (old_ctrl[i] < 0) continue;
+    const char *key = &old_keys[i * nbytes_key];
+    const uint64_t h = hash(key);
+    const size_t slot = find_free_slot(h);
+    ctrl[slot] = h2(h);
+    std::copy(key, key + nbytes_key, keys.begin() + slot * nbytes_key);
+    values[slot] = old_values[i];
+    growth_left--;
+    nb_elements++;
+  }
+}
+
+void
+ExactHashTable::reset(size_t new_capacity) {
+  ctrl.assign(new_capacity, kEmpty);
+  // one extra byte, so that taking the address of the first key is valid even
+  // for a 0-byte key
+  keys.assign(new_capacity * nbytes_key + 1, 0);
+  values.assign(new_capacity, 0);
+  group_mask = new_capacity / group_size - 1;
+  nb_elements = 0;
+  growth_left = max_elements(new_capacity);
+}
+
+}  // namespace bm
@@ -0,0 +1,83 @@
+/* Copyright 2013-present Barefoot Networks, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef BM_SIM_EXACT_HASH_TABLE_H_
+#define BM_SIM_EXACT_HASH_TABLE_H_
+
+#include <bm/bm_sim/bytecontainer.h>
+
+#include <cstdint>
+#include <vector>
+
+namespace bm {
+
+// Open addressing hash table used for exact match tables, in the style of
+// Swiss tables (Abseil's flat_hash_map). All keys have the same width and are
+// stored inline in a flat array, next to a flat array of values, so that an
+// insertion never allocates and a lookup does not chase pointers. Each slot
+// also has a control byte, which is either empty, deleted (tombstone) or holds
+// the 7 low bits of the key hash. Slots are probed in groups of 16, and the
+// control bytes of a group are compared with the hash bits of the key all at
+// once (with SSE2 when available), so that keys are only compared when there
+// is a good chance they match.
+// The table is sized when it is created, for the declared size of the match
+// table, and only grows (rehashes) if more entries than that are inserted.
+class ExactHashTable {
+ public:
+  ExactHashTable(size_t size, size_t nbytes_key);
+
+  bool find(const ByteContainer &key, uintptr_t *value) const;
+
+  // independent lookups are interleaved: the hashes are computed and the
+  // first group of each key is prefetched before any probing is done
+  void find_batch(const ByteContainer *keys, size_t n, uintptr_t *values,
+                  bool *found) const;
+
+  // overwrites the value if the key is already present
+  void insert(const ByteContainer &key, uintptr_t value);
+
+  bool erase(const ByteContainer &key);
+
+  void clear();
+
+  size_t size() const { return nb_elements; }
+
+  size_t capacity() const { return ctrl.size(); }
+
+ private:
+  static constexpr size_t group_size = 16;
+
+  uint64_t hash(const char *key) const;
+  // returns the slot of the key, or capacity() if it is not in the table
+  size_t find_slot(const char *key, uint64_t h) const;
+  // returns an empty or deleted slot where the key can be inserted
+  size_t find_free_slot(uint64_t h) const;
+  void rehash(size_t new_capacity);
+  void reset(size_t new_capacity);
+
+  size_t nbytes_key;
+  size_t nb_elements{0};
+  // number of empty slots which can still be used before the maximum load
+  // factor is reached; deleted slots are not counted
+  size_t growth_left{0};
+  size_t group_mask{0};
+  std::vector<int8_t> ctrl{};
+  std::vector<char> keys{};
+  std::vector<uintptr_t> values{};
+};
+
+}  // namespace bm
+
+#endif  // BM_SIM_EXACT_HASH_TABLE_H_
@@ -0,0 +1,407 @@
+/* Copyright 2013-present Barefoot Networks, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <bm/bm_sim/phv.h>
+
+#include <functional>
+#include <utility>
+#include <vector>
+
+#include "expression_compiler.h"
+
+namespace bm {
+
+namespace {
+
+using Operand = CompiledExpression::Operand;
+using Term = CompiledExpression::Term;
+using Predicate = CompiledExpression::Predicate;
+
+constexpr uint64_t kNoMask = ~static_cast<uint64_t>(0);
+
+bool load_operand(const Operand &o, const PHV &phv,
+                  const std::vector<Data> &locals, uint64_t *v) {
+  switch (o.type) {
+    case Operand::Type::FIELD:
+      if (!phv.get_field(o.header, o.offset).get_if_u64(v)) return false;
+      break;
+    case Operand::Type::LOCAL:
+      if (!locals[o.offset].get_if_u64(v)) return false;
+      break;
+    case Operand::Type::CONST:
+      *v = o.value;
+      break;
+  }
+  *v &= o.mask;
+  return true;
+}
+
+// when the term is masked, wrapping around is fine: the interpreter would
+// compute the exact (possibly negative or wider) value and mask it, which gives
+// the same bits
+bool eval_term(const Term &t, const PHV &phv, const std::vector<Data> &locals,
+               uint64_t *v) {
+  uint64_t a, b;
+  if (!load_operand(t.a, phv, locals, &a)) return false;
+  if (t.op == Term::Op::NONE) {
+    *v = a;
+    return true;
+  }
+  if (!load_operand(t.b, phv, locals, &b)) return false;
+  switch (t.op) {
+    case Term::Op::ADD:
+      *v = a + b;
+      if (*v < a && t.mask == kNoMask) return false;
+      break;
+    case Term::Op::SUB:
+      if (a < b && t.mask == kNoMask) return false;
+      *v = a - b;
+      break;
+    case Term::Op::BIT_AND:
+      *v = a & b;
+      break;
+    case Term::Op::BIT_OR:
+      *v = a | b;
+      break;
+    case Term::Op::BIT_XOR:
+      *v = a ^ b;
+      break;
+    case Term::Op::NONE:
+      break;
+  }
+  *v &= t.mask;
+  return true;
+}
+
+template <typename Cmp>
+bool eval_cmp(const Predicate &p, const PHV &phv,
+              const std::vector<Data> &locals, bool *result) {
+  uint64_t lhs, rhs;
+  if (!eval_term(p.lhs, phv, locals, &lhs)) return false;
+  if (!eval_term(p.rhs, phv, locals, &rhs)) return false;
+  *result = Cmp()(lhs, rhs) != p.negate;
+  return true;
+}
+
+// the most common shape by far: an unmasked field compared with a constant
+template <typename Cmp>
+bool eval_field_cmp_const(const Predicate &p, const PHV &phv,
+                          const std::vector<Data> &locals, bool *result) {
+  (void) locals;
+  uint64_t v;
+  if (!phv.get_field(p.lhs.a.header, p.lhs.a.offset).get_if_u64(&v))
+    return false;
+  *result = Cmp()(v, p.rhs.a.value) != p.negate;
+  return true;
+}
+
+bool eval_valid(const Predicate &p, const PHV &phv,
+                const std::vector<Data> &locals, bool *result) {
+  (void) locals;
+  *result = phv.get_header(p.header).is_valid() != p.negate;
+  return true;
+}
+
+// constants are stored as the negation of false
+bool eval_constant(const Predicate &p, const PHV &phv,
+                   const std::vector<Data> &locals, bool *result) {
+  (void) phv;
+  (void) locals;
+  *result = p.negate;
+  return true;
+}
+
+bool eval_data_to_bool(const Predicate &p, const PHV &phv,
+                       const std::vector<Data> &locals, bool *result) {
+  uint64_t v;
+  if (!eval_term(p.lhs, phv, locals, &v)) return false;
+  *result = (v != 0) != p.negate;
+  return true;
+}
+
+template <typename Cmp>
+Predicate::EvalFn select_cmp(const Term &lhs, const Term &rhs) {
+  const bool field_cmp_const =
+      lhs.op == Term::Op::NONE && lhs.a.type == Operand::Type::FIELD &&
+      lhs.a.mask == kNoMask && rhs.op == Term::Op::NONE &&
+      rhs.a.type == Operand::Type::CONST && rhs.a.mask == kNoMask;
+  return field_cmp_const ? &eval_field_cmp_const<Cmp> : &eval_cmp<Cmp>;
+}
+
+Predicate::EvalFn select_cmp(ExprOpcode opcode, const Term &lhs,
+                             const Term &rhs) {
+  switch (opcode) {
+    case ExprOpcode::EQ_DATA:
+      return select_cmp<std::equal_to<uint64_t> >(lhs, rhs);
+    case ExprOpcode::NEQ_DATA:
+      return select_cmp<std::not_equal_to<uint64_t> >(lhs, rhs);
+    case ExprOpcode::GT_DATA:
+      return select_cmp<std::greater<uint64_t> >(lhs, rhs);
+    case ExprOpcode::LT_DATA:
+      return select_cmp<std::less<uint64_t> >(lhs, rhs);
+    case ExprOpcode::GET_DATA:
+      return select_cmp<std::greater_equal<uint64_t> >(lhs, rhs);
+    case ExprOpcode::LET_DATA:
+      return select_cmp<std::less_equal<uint64_t> >(lhs, rhs);
+    default:
+      break;
+  }
+  return nullptr;
+}
+
+// for "const op field", so that it can use eval_field_cmp_const
+ExprOpcode mirror_cmp(ExprOpcode opcode) {
+  switch (opcode) {
+    case ExprOpcode::GT_DATA:
+      return ExprOpcode::LT_DATA;
+    case ExprOpcode::LT_DATA:
+      return ExprOpcode::GT_DATA;
+    case ExprOpcode::GET_DATA:
+      return ExprOpcode::LET_DATA;
+    case ExprOpcode::LET_DATA:
+      return ExprOpcode::GET_DATA;
+    default:
+      return opcode;
+  }
+}
+
+// a term which is a single operand, without its own mask
+bool is_bare(const Term &t) {
+  return t.op == Term::Op::NONE && t.mask == kNoMask;
+}
+
+bool is_bare_const(const Term &t) {
+  return is_bare(t) && t.a.type == Operand::Type::CONST;
+}
+
+// what the ops evaluate to, in the symbolic execution done by compile()
+struct Value {
+  enum class Kind { TERM, HEADER, PREDICATES };
+
+  Kind kind;
+  Term term;
+  header_id_t header;
+  std::vector<Predicate> predicates;
+  bool conjunction;
+};
+
+Value make_term(const Operand &o) {
+  Value v{};
+  v.kind = Value::Kind::TERM;
+  v.term.a = o;
+  v.term.op = Term::Op::NONE;
+  v.term.mask = kNoMask;
+  return v;
+}
+
+Value make_predicate(const Predicate &p) {
+  Value v{};
+  v.kind = Value::Kind::PREDICATES;
+  v.predicates.push_back(p);
+  v.conjunction = true;
+  return v;
+}
+
+bool apply_arith(ExprOpcode opcode, Value l, Value r, Value *v) {
+  Term::Op op;
+  switch (opcode) {
+    case ExprOpcode::ADD: op = Term::Op::ADD; break;
+    case ExprOpcode::SUB: op = Term::Op::SUB; break;
+    case ExprOpcode::BIT_AND: op = Term::Op::BIT_AND; break;
+    case ExprOpcode::BIT_OR: op = Term::Op::BIT_OR; break;
+    case ExprOpcode::BIT_XOR: op = Term::Op::BIT_XOR; break;
+    default: return false;
+  }
+  if (op == Term::Op::BIT_AND && is_bare_const(l.term) &&
+      !is_bare_const(r.term)) {
+    std::swap(l, r);
+  }
+  if (op == Term::Op::BIT_AND && is_bare_const(r.term)) {
+    // masking with a constant
+    const uint64_t mask = r.term.a.value & r.term.a.mask;
+    if (l.term.op == Term::Op::NONE)
+      l.term.a.mask &= mask;
+    else
+      l.term.mask &= mask;
+    *v = std::move(l);
+    return true;
+  }
+  if (!is_bare(l.term) || !is_bare(r.term)) return false;
+  *v = std::move(l);
+  v->term.b = r.term.a;
+  v->term.op = op;
+  return true;
+}
+
+bool apply_logical(bool conjunction, Value l, Value r, Value *v) {
+  if (l.predicates.size() > 1 && l.conjunction != conjunction) return false;
+  if (r.predicates.size() > 1 && r.conjunction != conjunction) return false;
+  *v = std::move(l);
+  v->predicates.insert(v->predicates.end(),
+                       r.predicates.begin(), r.predicates.end());
+  v->conjunction = conjunction;
+  return true;
+}
+
+}  // namespace
+
+std::unique_ptr<CompiledExpression>
+CompiledExpression::compile(const std::vector<Op> &ops,
+                            const std::vector<Data> &const_values) {
+  std::vector<Value> stack;
+  auto pop = [&stack](Value::Kind kind, Value *v) {
+    if (stack.empty() || stack.back().kind != kind) return false;
+    *v = std::move(stack.back());
+    stack.pop_back();
+    return true;
+  };
+
+  for (const auto &op : ops) {
+    Value l{}, r{}, v{};
+    Predicate p{};
+    uint64_t value;
+    switch (op.opcode) {
+      case ExprOpcode::LOAD_FIELD:
+        stack.push_back(make_term({Operand::Type::FIELD, op.field.header,
+                                   op.field.field_offset, 0, kNoMask}));
+        break;
+      case ExprOpcode::LOAD_LOCAL:
+        stack.push_back(make_term(
+            {Operand::Type::LOCAL, 0, op.local_offset, 0, kNoMask}));
+        break;
+      case ExprOpcode::LOAD_CONST:
+        if (!const_values[op.const_offset].get_if_u64(&value)) return nullptr;
+        stack.push_back(
+            make_term({Operand::Type::CONST, 0, 0, value, kNoMask}));
+        break;
+      case ExprOpcode::LOAD_BOOL:
+        p.eval = &eval_constant;
+        p.negate = op.bool_value;
+        stack.push_back(make_predicate(p));
+        break;
+      case ExprOpcode::LOAD_HEADER:
+        v.kind = Value::Kind::HEADER;
+        v.header = op.header;
+        stack.push_back(std::move(v));
+        break;
+      case ExprOpcode::VALID_HEADER:
+        if (!pop(Value::Kind::HEADER, &v)) return nullptr;
+        p.eval = &eval_valid;
+        p.header = v.header;
+        stack.push_back(make_predicate(p));
+        break;
+      case ExprOpcode::ADD:
+      case ExprOpcode::SUB:
+      case ExprOpcode::BIT_AND:
+      case ExprOpcode::BIT_OR:
+      case ExprOpcode::BIT_XOR:
+        if (!pop(Value::Kind::TERM, &r) || !pop(Value::Kind::TERM, &l))
+          return nullptr;
+        if (!apply_arith(op.opcode, std::move(l), std::move(r), &v))
+          return nullptr;
+        stack.push_back(std::move(v));
+        break;
+      case ExprOpcode::EQ_DATA:
+      case ExprOpcode::NEQ_DATA:
+      case ExprOpcode::GT_DATA:
+      case ExprOpcode::LT_DATA:
+      case ExprOpcode::GET_DATA:
+      case ExprOpcode::LET_DATA:
+        if (!pop(Value::Kind::TERM, &r) || !pop(Value::Kind::TERM, &l))
+          return nullptr;
+        p.lhs = l.term;
+        p.rhs = r.term;
+        if (is_bare_const(l.term) && !is_bare_const(r.term)) {
+          std::swap(p.lhs, p.rhs);
+          p.eval = select_cmp(mirror_cmp(op.opcode), p.lhs, p.rhs);
+        } else {
+          p.eval = select_cmp(op.opcode, p.lhs, p.rhs);
+        }
+        stack.push_back(make_predicate(p));
+        break;
+      case ExprOpcode::DATA_TO_BOOL:
+        if (!pop(Value::Kind::TERM, &v)) return nullptr;
+        p.eval = &eval_data_to_bool;
+        p.lhs = v.term;
+        stack.push_back(make_predicate(p));
+        break;
+      case ExprOpcode::NOT:
+        // De Morgan's laws for chains
+        if (!pop(Value::Kind::PREDICATES, &v)) return nullptr;
+        for (auto &predicate : v.predicates)
+          predicate.negate = !predicate.negate;
+        v.conjunction = !v.conjunction;
+        stack.push_back(std::move(v));
+        break;
+      case ExprOpcode::AND:
+      case ExprOpcode::OR:
+        if (!pop(Value::Kind::PREDICATES, &r) ||
+            !pop(Value::Kind::PREDICATES, &l)) {
+          return nullptr;
+        }
+        if (!apply_logical(op.opcode == ExprOpcode::AND,
+                           std::move(l), std::move(r), &v)) {
+          return nullptr;
+        }
+        stack.push_back(std::move(v));
+        break;
+      default:
+        return nullptr;
+    }
+  }
+
+  if (stack.size() != 1) return nullptr;
+  std::unique_ptr<CompiledExpression> compiled(new CompiledExpression());
+  auto &v = stack.back();
+  switch (v.kind) {
+    case Value::Kind::TERM:
+      compiled->term = v.term;
+      break;
+    case Value::Kind::PREDICATES:
+      compiled->predicates = std::move(v.predicates);
+      compiled->conjunction = v.conjunction;
+      break;
+    case Value::Kind::HEADER:
+      return nullptr;
+  }
+  return compiled;
+}
+
+bool
+CompiledExpression::eval_bool(const PHV &phv, const std::vector<Data> &locals,
+                              bool *result) const {
+  if (predicates.empty()) return false;
+  // predicates have no side effects, so we can stop as soon as the result is
+  // known
+  for (const auto &p : predicates) {
+    bool r;
+    if (!p.eval(p, phv, locals, &r)) return false;
+    if (r != conjunction) {
+      *result = r;
+      return true;
+    }
+  }
+  *result = conjunction;
+  return true;
+}
+
+bool
+CompiledExpression::eval_arith(const PHV &phv, const std::vector<Data> &locals,
+                               uint64_t *result) const {
+  if (!predicates.empty()) return false;
+  return eval_term(term, phv, locals, result);
+}
+
+}  // namespace bm
@@ -0,0 +1,99 @@
+/* Copyright 2013-present Barefoot Networks, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef BM_SIM_EXPRESSION_COMPILER_H_
+#define BM_SIM_EXPRESSION_COMPILER_H_
+
+#include <bm/bm_sim/expressions.h>
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace bm {
+
+// the compiled form of an expression with one of the shapes the P4
+// compiler emits for most conditions and action arguments. Expression::build()
+// tries to compile every expression; the ones which are not supported keep
+// going through the interpreter. The supported shapes are:
+//  - terms: (a op b) & mask, where op is +, -, &, | or ^ (or no op at all) and
+//    a and b are fields, action parameters or constants, each of them
+//    optionally masked with a constant, e.g. ((f & 0xffff) + 1) & 0xffff
+//  - predicates: comparisons between 2 terms, valid(header), d2b(term), boolean
+//    constants and their negation
+//  - a chain of predicates joined by "and" only or by "or" only
+// Values are computed with uint64_t arithmetic, which gives the same results as
+// Data as long as every operand is a non-negative value which fits in 64 bits
+// and an unmasked addition or subtraction does not overflow. This is checked
+// for every evaluation: when it does not hold, the evaluation methods return
+// false and the expression has to be evaluated by the interpreter.
+class CompiledExpression {
+ public:
+  // returns nullptr if the expression does not have a supported shape
+  static std::unique_ptr<CompiledExpression> compile(
+      const std::vector<Op> &ops, const std::vector<Data> &const_values);
+
+  bool is_bool() const { return !predicates.empty(); }
+
+  bool eval_bool(const PHV &phv, const std::vector<Data> &locals,
+                 bool *result) const;
+
+  bool eval_arith(const PHV &phv, const std::vector<Data> &locals,
+                  uint64_t *result) const;
+
+  struct Operand {
+    enum class Type { FIELD, LOCAL, CONST };
+
+    Type type;
+    header_id_t header;
+    // field offset or local offset
+    int offset;
+    // for constants
+    uint64_t value;
+    uint64_t mask;
+  };
+
+  struct Term {
+    enum class Op { NONE, ADD, SUB, BIT_AND, BIT_OR, BIT_XOR };
+
+    Operand a;
+    Operand b;
+    Op op;
+    uint64_t mask;
+  };
+
+  struct Predicate {
+    // one function per kind of predicate, and for comparisons, per comparison
+    // operator, selected at compilation time
+    using EvalFn = bool (*)(const Predicate &p, const PHV &phv,
+                            const std::vector<Data> &locals, bool *result);
+
+    EvalFn eval;
+    Term lhs;
+    Term rhs;
+    header_id_t header;
+    bool negate;
+  };
+
+ private:
+  std::vector<Predicate> predicates{};
+  // true for a chain of "and", false for a chain of "or"
+  bool conjunction{true};
+  Term term{};
+};
+
+}  // namespace bm
+
+#endif  // BM_SIM_EXPRESSION_COMPILER_H_
@@ -24,6 +24,7 @@
 #include <bm/bm_sim/phv.h>
 #include <bm/bm_sim/stateful.h>
 
+#include <atomic>
 #include <stack>
 #include <string>
 #include <vector>
@@ -31,8 +32,16 @@
 
 #include <cassert>
 
+#include "expression_compiler.h"
+
 namespace bm {
 
+namespace {
+
+std::atomic<bool> compilation_enabled{true};
+
+}  // namespace
+
 ExprOpcodesMap::ExprOpcodesMap() {
   opcodes_map = {
     {"load_field", ExprOpcode::LOAD_FIELD},
@@ -382,6 +391,19 @@ void
 Expression::build() {
   data_registers_cnt = assign_dest_registers();
   built = true;
+  compiled = nullptr;
+  if (compilation_enabled)
+    compiled = CompiledExpression::compile(ops, const_values);
+}
+
+bool
+Expression::is_compiled() const {
+  return compiled != nullptr;
+}
+
+/* static */ void
+Expression::set_compilation_enabled(bool enabled) {
+  compilation_enabled = enabled;
 }
 
 void
@@ -827,6 +849,8 @@ Expression::eval_bool(const PHV &phv, const std::vector<Data> &locals) const {
   // should make sure this never happens instead and we should treat this as
   // an error
   if (ops.empty()) return false;
+  bool result;
+  if (compiled && compiled->eval_bool(phv, locals, &result)) return result;
   auto &temps = ExpressionTemps::get_instance();
   eval_(phv, locals, &temps);
   return temps.pop_bool();
@@ -835,6 +859,9 @@ Expression::eval_bool(const PHV &phv, const std::vector<Data> &locals) const {
 Data
 Expression::eval_arith(const PHV &phv, const std::vector<Data> &locals) const {
   if (ops.empty()) return Data(0);
+  uint64_t result;
+  if (compiled && compiled->eval_arith(phv, locals, &result))
+    return Data(result);
   auto &temps = ExpressionTemps::get_instance();
   eval_(phv, locals, &temps);
   return *temps.pop_data();
@@ -847,6 +874,11 @@ Expression::eval_arith(const PHV &phv, Data *data,
     data->set(0);
     return;
   }
+  uint64_t result;
+  if (compiled && compiled->eval_arith(phv, locals, &result)) {
+    data->set(result);
+    return;
+  }
   auto &temps = ExpressionTemps::get_instance();
   eval_(phv, locals, &temps);
   data->set(*temps.pop_data());
@@ -1037,6 +1069,8 @@ VLHeaderExpression::resolve(header_id_t header_id) {
       op.field.header = header_id;
     }
   }
+  // the compiled form still refers to the locals
+  new_expr.build();
   return new_expr;
 }
 
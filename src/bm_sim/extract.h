@@ -22,6 +22,7 @@
 #define BM_SIM_EXTRACT_H_
 
 #include <algorithm>  // for std::fill, std::copy
+#include <cstdint>
 
 namespace bm {
 
@@ -120,6 +121,18 @@ static inline void generic_deparse(const char *data, int bitwidth,
   }
 }
 
+static inline uint64_t load_be64(const char *data) {
+  auto p = reinterpret_cast<const unsigned char *>(data);
+  return (static_cast<uint64_t>(p[0]) << 56) |
+      (static_cast<uint64_t>(p[1]) << 48) |
+      (static_cast<uint64_t>(p[2]) << 40) |
+      (static_cast<uint64_t>(p[3]) << 32) |
+      (static_cast<uint64_t>(p[4]) << 24) |
+      (static_cast<uint64_t>(p[5]) << 16) |
+      (static_cast<uint64_t>(p[6]) << 8) |
+      static_cast<uint64_t>(p[7]);
+}
+
 }  // namespace extract
 
 }  // namespace bm
@@ -55,7 +55,11 @@ void
 Field::swap_values(Field *other) {
   // do not swap arith!
   std::swap(value, other->value);
+  std::swap(value_u64, other->value_u64);
+  std::swap(use_u64, other->use_u64);
   std::swap(bytes, other->bytes);
+  mark_modified();
+  other->mark_modified();
   if (VL) {
     std::swap(nbits, other->nbits);
     std::swap(nbytes, other->nbytes);
@@ -70,6 +74,7 @@ Field::swap_values(Field *other) {
 int
 Field::extract(const char *data, int hdr_offset) {
   extract::generic_extract(data, hdr_offset, nbits, bytes.data());
+  mark_modified();
 
   if (arith) sync_value();
 
@@ -113,6 +118,7 @@ Field::assign_VL(const Field &src) {
   max = src.max;
   min = src.min;
   set(src);
+  mark_modified();
   parent_hdr->recompute_nbytes_packet();
 }
 
@@ -122,6 +128,7 @@ Field::reset_VL() {
   nbits = 0;
   nbytes = 0;
   mask = 1;
+  mark_modified();
   if (is_signed) {
     max = 1;
     min = 1;
@@ -132,8 +139,13 @@ void
 Field::copy_value(const Field &src) {
   // it's important to have a way of copying a field value without the
   // packet_id pointer. This is used by PHV::copy_headers().
-  value = src.value;
+  use_u64 = src.use_u64;
+  if (use_u64)
+    value_u64 = src.value_u64;
+  else
+    value = src.value;
   bytes = src.bytes;
+  mark_modified();
   if (VL) {
     nbits = src.nbits;
     nbytes = src.nbytes;
@@ -0,0 +1,173 @@
+/* Copyright 2013-present Barefoot Networks, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <bm/bm_sim/flex_version.h>
+#include <bm/bm_sim/_assert.h>
+
+#include <algorithm>
+#include <chrono>
+
+namespace bm {
+
+constexpr size_t FlexVersion::nb_versions;
+constexpr uint64_t FlexVersion::max_threshold;
+constexpr size_t FlexVersion::nb_counter_shards;
+
+namespace {
+
+// same clock as Packet::get_ingress_ts_ms()
+uint64_t now_ms() {
+  return std::chrono::duration_cast<std::chrono::milliseconds>(
+      std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+}  // namespace
+
+FlexVersion::FlexVersion() {
+  for (auto &c : counters) {
+    for (auto &count : c.counts) count.store(0);
+    c.unsequenced.store(0);
+  }
+}
+
+FlexVersion::Counters &
+FlexVersion::get_counters() {
+  static std::atomic<size_t> next_shard{0};
+  static thread_local const size_t shard =
+      next_shard.fetch_add(1, std::memory_order_relaxed) % nb_counter_shards;
+  return counters[shard];
+}
+
+FlexVersion::state_t
+FlexVersion::make_state(version_t current, version_t next, Schedule schedule,
+                        uint64_t threshold) {
+  _BM_ASSERT(current < nb_versions && next < nb_versions);
+  _BM_ASSERT(threshold <= max_threshold);
+  return static_cast<state_t>(current) |
+      (static_cast<state_t>(next) << 8) |
+      (static_cast<state_t>(schedule) << 16) |
+      (threshold << 18);
+}
+
+FlexVersion::version_t
+FlexVersion::version_of(state_t state, uint64_t packet_number,
+                        uint64_t ts_ms) {
+  const auto schedule = static_cast<Schedule>((state >> 16) & 0x3);
+  const uint64_t threshold = state >> 18;
+  bool reached = false;
+  switch (schedule) {
+    case Schedule::NONE:
+      break;
+    case Schedule::AT_PACKET:
+      reached = (packet_number >= threshold);
+      break;
+    case Schedule::AT_TIME:
+      reached = (ts_ms >= threshold);
+      break;
+  }
+  return static_cast<version_t>(reached ? (state >> 8) : state);
+}
+
+// Packets only take a sequence number when a switch is scheduled at a packet
+// number, so that the common case is a load of the state and increments of
+// counters which are not shared with the other threads.
+FlexVersion::version_t
+FlexVersion::assign(uint64_t ts_ms) {
+  state_t s = state.load();
+  auto &c = get_counters();
+  if (static_cast<Schedule>((s >> 16) & 0x3) != Schedule::AT_PACKET) {
+    const version_t version = version_of(s, 0, ts_ms);
+    c.counts[version].fetch_add(1, std::memory_order_relaxed);
+    c.unsequenced.fetch_add(1, std::memory_order_relaxed);
+    return version;
+  }
+  const uint64_t packet_number = sequence.fetch_add(1);
+  const version_t version = version_of(s, packet_number, ts_ms);
+  c.counts[version].fetch_add(1, std::memory_order_relaxed);
+  // once the switch is reached, the next packets no longer need a sequence
+  // number; this fails if the control plane has replaced the state meanwhile
+  if (packet_number >= (s >> 18)) {
+    const version_t next = static_cast<version_t>(s >> 8);
+    state.compare_exchange_strong(
+        s, make_state(next, next, Schedule::NONE, 0));
+  }
+  return version;
+}
+
+void
+FlexVersion::set(version_t version) {
+  state.store(make_state(version, version, Schedule::NONE, 0));
+}
+
+// The switch is first published with an unreachable threshold, so that every
+// packet which has not loaded the state yet takes a sequence number and the
+// number of unsequenced packets no longer changes (but for the packets in
+// flight). The threshold can then be converted to a sequence number.
+bool
+FlexVersion::schedule_at_packet(version_t version, uint64_t packet_number) {
+  const version_t current = get_version();
+  state.store(make_state(current, version, Schedule::AT_PACKET,
+                         max_threshold));
+  uint64_t unsequenced = 0;
+  for (const auto &c : counters) unsequenced += c.unsequenced.load();
+  const uint64_t first = sequence.load();
+  const bool pending = (unsequenced + first <= packet_number);
+  const uint64_t threshold =
+      pending ? packet_number - unsequenced : std::min(first, max_threshold);
+  state.store(make_state(current, version, Schedule::AT_PACKET, threshold));
+  return pending;
+}
+
+bool
+FlexVersion::schedule_at_time(version_t version, uint64_t ts_ms) {
+  state.store(make_state(get_version(), version, Schedule::AT_TIME, ts_ms));
+  return now_ms() < ts_ms;
+}
+
+FlexVersion::version_t
+FlexVersion::get_version() const {
+  return version_of(state.load(), sequence.load(), now_ms());
+}
+
+bool
+FlexVersion::has_pending_switch() const {
+  const state_t s = state.load();
+  const auto schedule = static_cast<Schedule>((s >> 16) & 0x3);
+  if (schedule == Schedule::NONE) return false;
+  const uint64_t threshold = s >> 18;
+  if (schedule == Schedule::AT_PACKET) return sequence.load() < threshold;
+  return now_ms() < threshold;
+}
+
+uint64_t
+FlexVersion::get_packet_count() const {
+  uint64_t total = 0;
+  for (const auto &c : counters) {
+    for (const auto &count : c.counts)
+      total += count.load(std::memory_order_relaxed);
+  }
+  return total;
+}
+
+uint64_t
+FlexVersion::get_packet_count(version_t version) const {
+  if (version >= nb_versions) return 0;
+  uint64_t total = 0;
+  for (const auto &c : counters)
+    total += c.counts[version].load(std::memory_order_relaxed);
+  return total;
+}
+
+}  // namespace bm
@@ -31,6 +31,8 @@
 #include <map>
 #include <vector>
 
+#include "extract.h"
+
 namespace bm {
 
 namespace {
@@ -89,6 +91,18 @@ HeaderType::push_back_field(const std::string &field_name, int field_bit_width,
   fields_info.insert(
       pos,
       {field_name, field_bit_width, is_signed, is_saturating, is_VL, false});
+
+  FieldLayout field_layout;
+  field_layout.byte_offset = layout_nbits / 8;
+  field_layout.bit_offset = layout_nbits % 8;
+  field_layout.nbits = field_bit_width;
+  field_layout.fits_u64 = (field_bit_width > 0) &&
+      (field_layout.bit_offset + field_bit_width <= 64);
+  field_layout.shift = 64 - field_layout.bit_offset - field_bit_width;
+  field_layout.mask = (field_bit_width >= 64) ? ~static_cast<uint64_t>(0) :
+      ((static_cast<uint64_t>(1) << field_bit_width) - 1);
+  layout.push_back(field_layout);
+  layout_nbits += field_bit_width;
   return offset;
 }
 
@@ -154,8 +168,16 @@ Header::Header(const std::string &name, p4object_id_t id,
     fields.back().set_id(field_unique_id);
     if (!finfo.is_hidden) nbytes_packet += fields.back().get_nbits();
   }
+  // the fields are not moved anymore
+  for (size_t i = 0; i < fields.size(); i++) {
+    if (!fields[i].is_hidden())
+      fields[i].set_modified_flag(&modified, field_modified_bit(i));
+  }
   assert(nbytes_packet % 8 == 0);
   nbytes_packet /= 8;
+  // padded so that the last field can be read with a 64-bit load
+  if (!metadata && !header_type.is_VL_header())
+    packet_image.resize(nbytes_packet + sizeof(uint64_t));
   valid_field = &fields.at(header_type.get_hidden_offset(
       HeaderType::HiddenF::VALID));
 
@@ -218,17 +240,32 @@ Header::set_written_to(bool written_to_value) {
     f.set_written_to(written_to_value);
 }
 
+// the header is copied to packet_image in one go, and each field is
+// read from there at the position precomputed by the header type, instead of
+// walking the fields with running bit offsets.
 void
 Header::extract(const char *data, const PHV &phv) {
   if (is_VL_header()) return extract_VL(data, phv);
-  int hdr_offset = 0;
-  for (Field &f : fields) {
-    if (f.is_hidden()) break;  // all hidden fields are at the end
-    hdr_offset += f.extract(data, hdr_offset);
-    data += hdr_offset / 8;
-    hdr_offset = hdr_offset % 8;
+  const size_t image_size = nbytes_packet + sizeof(uint64_t);
+  if (packet_image.size() != image_size) packet_image.resize(image_size);
+  std::copy(data, data + nbytes_packet, packet_image.begin());
+  const char *image = packet_image.data();
+  const auto &layout = header_type.get_layout();
+  for (size_t i = 0; i < layout.size(); i++) {
+    const auto &field_layout = layout[i];
+    const char *src = image + field_layout.byte_offset;
+    if (field_layout.fits_u64) {
+      fields[i].extract_u64(
+          (extract::load_be64(src) >> field_layout.shift) & field_layout.mask);
+    } else {
+      fields[i].extract(src, field_layout.bit_offset);
+    }
   }
   mark_valid();
+  modified = 0;
+  // set by the parser
+  packet_offset = -1;
+  verified_checksum = nullptr;
 }
 
 template <typename Fn>
@@ -252,6 +289,9 @@ Header::extract_VL_common(const char *data, const Fn &VL_fn) {
   assert(nbytes_packet % 8 == 0);
   nbytes_packet /= 8;
   mark_valid();
+  modified = 0;
+  packet_offset = -1;
+  verified_checksum = nullptr;
 }
 
 void
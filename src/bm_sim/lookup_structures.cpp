@@ -22,16 +22,23 @@
 #include <bm/bm_sim/_assert.h>
 #include <bm/bm_sim/lookup_structures.h>
 #include <bm/bm_sim/match_key_types.h>
+#include <bm/bm_sim/resilient_group_selection.h>
 
 #include <algorithm>  // for std::swap
+#include <array>
+#include <atomic>
+#include <cstring>
 #include <unordered_map>
 #include <vector>
 #include <tuple>
+#include <utility>
 #include <limits>
-#include <list>
-#include <mutex>
+#include <map>
 
+#include "exact_hash_table.h"
+#include "lpm_multibit.h"
 #include "lpm_trie.h"
+#include "ternary_scan.h"
 
 namespace bm {
 
@@ -43,10 +50,13 @@ static_assert(sizeof(uintptr_t) == sizeof(internal_handle_t),
 // We don't need or want to export these classes outside of this
 // compilation unit.
 
+// Trie is one of LPMTrie, LPMDir24_8 or LPMMultibitTrie
+template <typename Trie>
 class LPMTrieStructure : public LPMLookupStructure {
  public:
-  explicit LPMTrieStructure(size_t key_width_bytes)
-    : trie(key_width_bytes) {
+  template <typename... Args>
+  explicit LPMTrieStructure(Args &&... args)
+    : trie(std::forward<Args>(args)...) {
     }
 
   /* Copy constructor */
@@ -68,6 +78,11 @@ class LPMTrieStructure : public LPMLookupStructure {
     return trie.lookup(key_data, reinterpret_cast<uintptr_t *>(handle));
   }
 
+  void lookup_batch(const ByteContainer *keys, size_t n,
+                    internal_handle_t *handles, bool *hits) const override {
+    trie.lookup_batch(keys, n, reinterpret_cast<uintptr_t *>(handles), hits);
+  }
+
   bool entry_exists(const LPMMatchKey &key) const override {
     return trie.has_prefix(key.data, key.prefix_length);
   }
@@ -93,41 +108,37 @@ class LPMTrieStructure : public LPMLookupStructure {
   }
 
  private:
-  LPMTrie trie;
+  Trie trie;
 };
 
 class ExactMap : public ExactLookupStructure {
  public:
-  explicit ExactMap(size_t size) {
-    entries_map.reserve(size);
-  }
+  ExactMap(size_t size, size_t nbytes_key)
+      : entries_map(size, nbytes_key) { }
 
   bool lookup(const ByteContainer &key,
               internal_handle_t *handle) const override {
-    const auto entry_it = entries_map.find(key);
-    if (entry_it == entries_map.end()) {
-      return false;  // Nothing found
-    } else {
-      *handle = entry_it->second;
-      return true;
-    }
+    return entries_map.find(key, handle);
+  }
+
+  void lookup_batch(const ByteContainer *keys, size_t n,
+                    internal_handle_t *handles, bool *hits) const override {
+    entries_map.find_batch(keys, n, handles, hits);
   }
 
   bool entry_exists(const ExactMatchKey &key) const override {
-    return entries_map.find(key.data) != entries_map.end();
+    internal_handle_t handle;
+    return entries_map.find(key.data, &handle);
   }
 
   bool retrieve_handle(const ExactMatchKey &key,
                        internal_handle_t *handle) const override {
-    const auto it = entries_map.find(key.data);
-    if (it == entries_map.cend()) return false;
-    *handle = it->second;
-    return true;
+    return entries_map.find(key.data, handle);
   }
 
   void add_entry(const ExactMatchKey &key,
                  internal_handle_t handle) override {
-    entries_map[key.data] = handle;  // key is copied, which is not great
+    entries_map.insert(key.data, handle);
   }
 
   void delete_entry(const ExactMatchKey &key) override {
@@ -139,15 +150,27 @@ class ExactMap : public ExactLookupStructure {
   }
 
  private:
-  std::unordered_map<ByteContainer, internal_handle_t, ByteContainerKeyHash>
-    entries_map{};
+  ExactHashTable entries_map;
 };
 
-template <size_t S = 64>
+// Lookup result cache used by EntryList. Lookups run concurrently in all the
+// threads holding the table read lock, so protecting the cache with a mutex
+// would serialize them. Instead, the cache is a set-associative array of slots,
+// each one protected by its own sequence number (seqlock): a reader checks that
+// the sequence number is even and did not change while it was reading the
+// slot, and a writer only updates a slot after atomically making its sequence
+// number odd, giving up if another thread is already writing to it. The key is
+// stored as atomic words so that racing reads and writes are well-defined.
+// Modifying the table does not clear the cache, it increments the generation
+// number, and slots from a previous generation are ignored. The hit / miss /
+// eviction counters are sharded by thread to avoid contention.
 class TernaryCache {
  public:
-  TernaryCache() {
-    cache.reserve(S);
+  static constexpr size_t default_size = 1024;
+
+  TernaryCache(size_t nbytes_key, size_t size)
+      : nb_words_key((nbytes_key + 7) / 8) {
+    resize(size);
   }
 
   TernaryCache(const TernaryCache& other) = delete;
@@ -156,85 +179,156 @@ class TernaryCache {
   TernaryCache(TernaryCache&& other)= delete;
   TernaryCache &operator =(TernaryCache &&other) = delete;
 
-  bool lookup(const ByteContainer &key_data, internal_handle_t *handle) {
-    std::unique_lock<std::mutex> lock(mutex);
-    auto it = cache.find(key_data);
-    if (it != cache.end()) {
-      *handle = it->second->handle;
-      move_to_head(it);
-      return true;
+  bool lookup(const ByteContainer &key_data, size_t hash,
+              internal_handle_t *handle) {
+    if (nb_sets == 0) return false;
+    const auto gen = generation.load(std::memory_order_acquire);
+    const auto *set = get_set(hash);
+    for (size_t way = 0; way < nb_ways; way++) {
+      if (read_slot(&set[way * slot_words()], key_data, gen, handle)) {
+        get_counters().hits.fetch_add(1, std::memory_order_relaxed);
+        return true;
+      }
     }
+    get_counters().misses.fetch_add(1, std::memory_order_relaxed);
     return false;
   }
 
-  bool add(const ByteContainer &key_data, internal_handle_t handle) {
-    std::unique_lock<std::mutex> lock(mutex);
-    auto it = cache.find(key_data);
-    if (it != cache.end()) return false;
-    if (cache.size() == S) {  // cache is full
-      auto evict = entries.back();
-      int success = cache.erase(evict.key);
-      _BM_UNUSED(success);
-      assert(success == 1);
-      entries.pop_back();
+  void add(const ByteContainer &key_data, size_t hash,
+           internal_handle_t handle) {
+    if (nb_sets == 0) return;
+    const auto gen = generation.load(std::memory_order_acquire);
+    auto *set = get_set(hash);
+    // use a free slot (or one from a previous generation) if possible,
+    // otherwise evict one of the slots, chosen with the bits of the hash which
+    // were not used to select the set
+    size_t victim = (hash >> 32) % nb_ways;
+    bool evict = true;
+    for (size_t way = 0; way < nb_ways; way++) {
+      if (set[way * slot_words() + 1].load(std::memory_order_relaxed) != gen) {
+        victim = way;
+        evict = false;
+        break;
+      }
+    }
+    if (write_slot(&set[victim * slot_words()], key_data, gen, handle) &&
+        evict) {
+      get_counters().evictions.fetch_add(1, std::memory_order_relaxed);
     }
-    entries.emplace_front(handle, key_data);
-    cache.emplace(key_data, entries.begin());
-    return true;
   }
 
   // we are being very conservative and invalidating the whole cache every time
   // the table is modified
   void invalidate_all() {
-    // this lock may not be strictly needed here, since this method is only
-    // called for table operations involving the write lock
-    std::unique_lock<std::mutex> lock(mutex);
-    cache.clear();
-    entries.clear();
+    generation.fetch_add(1, std::memory_order_release);
+  }
+
+  // must not be called concurrently with lookup or add (i.e. requires the
+  // table write lock)
+  void resize(size_t size) {
+    // round up to a power of 2 number of sets, so we can use a mask to pick the
+    // set
+    nb_sets = 0;
+    if (size > 0) {
+      nb_sets = 1;
+      while (nb_sets * nb_ways < size) nb_sets <<= 1;
+    }
+    slots.reset(nb_sets == 0 ?
+                nullptr : new std::atomic<uint64_t>[nb_sets * set_words()]);
+    for (size_t i = 0; i < nb_sets * set_words(); i++) slots[i] = 0;
+    for (auto &c : counters) {
+      c.hits = 0;
+      c.misses = 0;
+      c.evictions = 0;
+    }
   }
 
- private:
-  struct CacheEntry {
-    CacheEntry(internal_handle_t handle, const ByteContainer &key)
-        : handle(handle), key(key) { }
+  void get_stats(LookupCacheStats *stats) const {
+    stats->size = nb_sets * nb_ways;
+    stats->hits = stats->misses = stats->evictions = 0;
+    for (const auto &c : counters) {
+      stats->hits += c.hits.load(std::memory_order_relaxed);
+      stats->misses += c.misses.load(std::memory_order_relaxed);
+      stats->evictions += c.evictions.load(std::memory_order_relaxed);
+    }
+  }
 
-    internal_handle_t handle;
-    ByteContainer key;
+ private:
+  // padded to avoid false sharing between threads
+  struct Counters {
+    std::atomic<uint64_t> hits{0};
+    std::atomic<uint64_t> misses{0};
+    std::atomic<uint64_t> evictions{0};
+    char padding[64 - 3 * sizeof(std::atomic<uint64_t>)];
   };
 
-  std::list<CacheEntry> entries{};
-
-// I believe that g++-4.8 does not implement std::list correctly (according to
-// the C++11 standard): erase does not accept a const_iterator and splice is not
-// implemented properly (see below).
-#if defined(__clang__) || __GNUC__ >= 5 || (__GNUC__ == 4 && __GNUC_MINOR__ > 8)
-  using entries_iterator = typename decltype(entries)::const_iterator;
-#else
-  using entries_iterator = typename decltype(entries)::iterator;
-#endif
-
-  // should we avoid the 2 copies of the key by using a pointer in the map and
-  // defining custom hash and eq
-  std::unordered_map<ByteContainer, entries_iterator, ByteContainerKeyHash>
-  cache{};
-  mutable std::mutex mutex{};
-
-  // this is more complicated that it needs to be because of buggy g++-4.8
-  void move_to_head(typename decltype(cache)::iterator map_it) {
-#if defined(__clang__) || __GNUC__ >= 5 || (__GNUC__ == 4 && __GNUC_MINOR__ > 8)
-    // move to head, without any copies
-    entries.splice(entries.begin(), entries, map_it->second);
-#else
-    // Apparently g++-4.8 does not implement std::list::splice properly, but
-    // implements it in the C++03 way, which does not require splice to keep all
-    // iterators valid (unlike C++11).
-    auto it = map_it->second;
-    entries.push_front(*it);
-    entries.erase(it);
-    // need to update the iterator in the cache unlike with splice where the
-    // iterator is preserved
-    map_it->second = entries.begin();
-#endif
+  static constexpr size_t nb_ways = 4;
+  static constexpr size_t nb_counter_shards = 16;
+
+  // each slot is made of: the sequence number, the generation (0 means that the
+  // slot was never written), the handle, then the key
+  size_t nb_words_key;
+  size_t nb_sets{0};
+  std::unique_ptr<std::atomic<uint64_t>[]> slots{nullptr};
+  // starts at 1, see above
+  std::atomic<uint64_t> generation{1};
+  std::array<Counters, nb_counter_shards> counters{};
+
+  size_t slot_words() const { return 3 + nb_words_key; }
+  size_t set_words() const { return nb_ways * slot_words(); }
+
+  std::atomic<uint64_t> *get_set(size_t hash) const {
+    return &slots[(hash & (nb_sets - 1)) * set_words()];
+  }
+
+  Counters &get_counters() {
+    static std::atomic<size_t> next_shard{0};
+    static thread_local const size_t shard =
+        next_shard.fetch_add(1, std::memory_order_relaxed) % nb_counter_shards;
+    return counters[shard];
+  }
+
+  static uint64_t key_word(const ByteContainer &key_data, size_t word_index) {
+    uint64_t word = 0;
+    const size_t offset = word_index * 8;
+    std::memcpy(&word, key_data.data() + offset,
+                std::min<size_t>(8, key_data.size() - offset));
+    return word;
+  }
+
+  bool read_slot(const std::atomic<uint64_t> *slot,
+                 const ByteContainer &key_data, uint64_t gen,
+                 internal_handle_t *handle) const {
+    const auto seq = slot[0].load(std::memory_order_acquire);
+    if (seq & 1) return false;  // being written
+    if (slot[1].load(std::memory_order_relaxed) != gen) return false;
+    bool match = true;
+    for (size_t i = 0; i < nb_words_key && match; i++) {
+      match = (slot[3 + i].load(std::memory_order_relaxed) ==
+               key_word(key_data, i));
+    }
+    const auto slot_handle = slot[2].load(std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (!match || slot[0].load(std::memory_order_relaxed) != seq) return false;
+    *handle = static_cast<internal_handle_t>(slot_handle);
+    return true;
+  }
+
+  bool write_slot(std::atomic<uint64_t> *slot, const ByteContainer &key_data,
+                  uint64_t gen, internal_handle_t handle) {
+    auto seq = slot[0].load(std::memory_order_relaxed);
+    if (seq & 1) return false;
+    // another thread is writing to this slot, we just give up
+    if (!slot[0].compare_exchange_strong(seq, seq + 1,
+                                         std::memory_order_acquire))
+      return false;
+    std::atomic_thread_fence(std::memory_order_release);
+    slot[1].store(gen, std::memory_order_relaxed);
+    slot[2].store(handle, std::memory_order_relaxed);
+    for (size_t i = 0; i < nb_words_key; i++)
+      slot[3 + i].store(key_word(key_data, i), std::memory_order_relaxed);
+    slot[0].store(seq + 2, std::memory_order_release);
+    return true;
   }
 };
 
@@ -247,43 +341,73 @@ bool operator==(const RangeMatchKey &k1, const RangeMatchKey &k2) {
           k1.range_widths == k2.range_widths);
 }
 
+size_t range_bytes(const TernaryMatchKey &key) {
+  (void) key;
+  return 0;
+}
+
+size_t range_bytes(const RangeMatchKey &key) {
+  size_t nbytes = 0;
+  for (const auto w : key.range_widths) nbytes += w;
+  return nbytes;
+}
+
 // used by both TernaryMap and RangeMap
+// The entries are stored as a structure of arrays (see ternary_scan.h), with
+// one row per handle, so that lookups can compare the key with several bytes
+// of each entry at a time using SIMD instructions. The rows are scanned in
+// handle order and ties between entries with the same priority are broken in
+// favor of the smallest handle. For range keys, the range fields are zeroed in
+// the rows (so they are ignored by the scan) and the Compare functor passed to
+// lookup checks them for the rows which match.
 template <typename K>
 class EntryList {
  public:
-  EntryList(size_t size, bool enable_cache)
-      : entries(size), enable_cache(enable_cache) { }
+  EntryList(size_t size, size_t nbytes_key, bool enable_cache)
+      : nbytes_key(nbytes_key), stride(ternary_scan::stride_for(nbytes_key)),
+        scan_fn(ternary_scan::get_scan_fn(ternary_scan::best_impl())),
+        enable_cache(enable_cache),
+        cache(nbytes_key, enable_cache ? TernaryCache::default_size : 0) {
+    (void) size;
+  }
 
   template <typename Compare>
   bool lookup(const ByteContainer &key_data, internal_handle_t *handle,
               Compare cmp) const {
+    size_t hash = 0;
     if (cache_activated()) {
-      auto in_cache = cache.lookup(key_data, handle);
+      hash = ByteContainerKeyHash()(key_data);
+      auto in_cache = cache.lookup(key_data, hash, handle);
       if (in_cache) return true;
     }
 
+    // lookups are done concurrently (with the read lock) so we cannot use a
+    // member for this
+    static thread_local ternary_scan::AlignedBytes padded_key;
+    padded_key.resize(0);
+    padded_key.resize(stride);
+    std::memcpy(padded_key.data(), key_data.data(), nbytes_key);
+
     auto min_priority =
         std::numeric_limits<decltype(TernaryMatchKey::priority)>::max();
-
-    const Entry *min_entry = nullptr;
+    bool found = false;
     internal_handle_t min_handle = 0;
 
-    for (const Entry *entry = head; entry; entry = entry->next) {
+    for (size_t i = scan(padded_key.data(), 0); i < nb_rows;
+         i = scan(padded_key.data(), i + 1)) {
       // not sufficient if the first entry in the table has priority
       // "min_priority" (= max integer value).
-      // if (entry->priority >= min_priority) continue;
-      if (entry->priority >= min_priority && min_entry != nullptr) continue;
-
-      if (cmp(key_data, *entry->key)) {
-        min_priority = entry->priority;
-        min_entry = entry;
-        min_handle = handle_from_entry(entry);
+      if (priorities[i] >= min_priority && found) continue;
+      if (cmp(key_data, *keys[i])) {
+        min_priority = priorities[i];
+        found = true;
+        min_handle = i;
       }
     }
 
-    if (min_entry) {
+    if (found) {
       *handle = min_handle;
-      if (cache_activated()) cache.add(key_data, min_handle);
+      if (cache_activated()) cache.add(key_data, hash, min_handle);
       return true;
     }
 
@@ -291,91 +415,121 @@ class EntryList {
   }
 
   bool exists(const K &key) const {
-    auto entry = find_entry(key);
-    return (entry != nullptr);
+    size_t row;
+    return find_entry(key, &row);
   }
 
   bool retrieve_handle(const K &key, internal_handle_t *handle) const {
-    auto entry = find_entry(key);
-    if (entry == nullptr) return false;
-    *handle = handle_from_entry(entry);
+    size_t row;
+    if (!find_entry(key, &row)) return false;
+    *handle = row;
     return true;
   }
 
   void add(const K &key, internal_handle_t handle) {
-    Entry &entry = entries.at(handle);
-    entry.priority = key.priority;
-    entry.key = &key;
-
-    if (handle == 0) {
-      entry.prev = nullptr;
-      entry.next = head;
-      head = &entry;
-      if (entry.next) entry.next->prev = &entry;
-    } else {
-      assert(&entry != head);
-      // this uses knowledge about how the match unit allocates handles;
-      // basically if a handle is allocated, in means all handles before it have
-      // already been allocated.
-      Entry &prev_entry = entries[handle - 1];
-      entry.prev = &prev_entry;
-      entry.next = prev_entry.next;
-      prev_entry.next = &entry;
-      if (entry.next) entry.next->prev = &entry;
+    if (handle >= nb_rows) {
+      const size_t old_nb_rows = nb_rows;
+      nb_rows = handle + 1;
+      data.resize(nb_rows * stride);
+      masks.resize(nb_rows * stride);
+      priorities.resize(nb_rows);
+      keys.resize(nb_rows, nullptr);
+      for (size_t row = old_nb_rows; row < nb_rows; row++) clear_row(row);
+    }
+    assert(keys[handle] == nullptr);
+    const auto nb_range_bytes = range_bytes(key);
+    char *d = data.data() + handle * stride;
+    char *m = masks.data() + handle * stride;
+    std::memset(d, 0, stride);
+    std::memset(m, 0, stride);
+    for (size_t i = nb_range_bytes; i < nbytes_key; i++) {
+      d[i] = key.data[i];
+      m[i] = key.mask[i];
     }
+    priorities[handle] = key.priority;
+    keys[handle] = &key;
+
     entries_count++;
     if (cache_activated()) cache.invalidate_all();
     update_use_cache();
   }
 
   void delete_entry(const K &key) {
-    auto entry = find_entry(key);
-    assert(entry);
-    if (entry->prev)
-      entry->prev->next = entry->next;
-    else
-      head = entry->next;
-    if (entry->next) entry->next->prev = entry->prev;
+    size_t row;
+    auto found = find_entry(key, &row);
+    _BM_UNUSED(found);
+    assert(found);
+    clear_row(row);
     entries_count--;
     if (cache_activated()) cache.invalidate_all();
     update_use_cache();
   }
 
   void clear() {
-    head = nullptr;
+    nb_rows = 0;
+    data.resize(0);
+    masks.resize(0);
+    priorities.clear();
+    keys.clear();
     cache.invalidate_all();
     entries_count = 0;
     update_use_cache();
   }
 
- private:
-  struct Entry {
-    int priority;  // duplicated on purpose (for efficiency although debatable)
-    const K *key;
-    Entry *prev;
-    Entry *next;
-  };
+  bool get_cache_stats(LookupCacheStats *stats) const {
+    if (!enable_cache) return false;
+    cache.get_stats(stats);
+    return true;
+  }
+
+  bool set_cache_size(size_t size) {
+    if (!enable_cache) return false;
+    cache.resize(size);
+    return true;
+  }
 
-  Entry *head{nullptr};
-  std::vector<Entry> entries;
+ private:
+  size_t nbytes_key;
+  size_t stride;
+  ternary_scan::ScanFn scan_fn;
+
+  // one row per handle, up to the largest handle that was ever used
+  size_t nb_rows{0};
+  ternary_scan::AlignedBytes data{};
+  ternary_scan::AlignedBytes masks{};
+  std::vector<int> priorities{};
+  // nullptr for unused rows
+  std::vector<const K *> keys{};
   size_t entries_count{0};
 
   bool enable_cache;
   bool use_cache{false};
-  mutable TernaryCache<> cache{};
+  mutable TernaryCache cache;
 
   static constexpr size_t cache_activation_min_entries = 16;
 
-  internal_handle_t handle_from_entry(const Entry *entry) const {
-    return std::distance(&entries[0], entry);
+  size_t scan(const char *padded_key, size_t begin) const {
+    return scan_fn(padded_key, data.data(), masks.data(), stride, begin,
+                   nb_rows);
   }
 
-  const Entry *find_entry(const K &key) const {
-    for (Entry *entry = head; entry; entry = entry->next) {
-      if (entry->priority == key.priority && *entry->key == key)
-        return entry;
+  // the row can never match: the key byte is masked out but the data byte is
+  // not 0
+  void clear_row(size_t row) {
+    std::memset(data.data() + row * stride, 0, stride);
+    std::memset(masks.data() + row * stride, 0, stride);
+    data.data()[row * stride] = 1;
+    keys[row] = nullptr;
+  }
+
+  bool find_entry(const K &key, size_t *row) const {
+    for (size_t i = 0; i < nb_rows; i++) {
+      if (keys[i] && priorities[i] == key.priority && *keys[i] == key) {
+        *row = i;
+        return true;
+      }
     }
-    return nullptr;
+    return false;
   }
 
   bool cache_activated() const {
@@ -387,18 +541,187 @@ class EntryList {
   }
 };
 
+// Tuple space search, used by both TupleSpaceTernaryMap and
+// TupleSpaceRangeMap. Entries are grouped into tuples according to their mask,
+// and each tuple stores its entries in a hash map indexed by the masked key. A
+// lookup probes each tuple once, instead of comparing the key with every entry
+// like EntryList does. Tuples are visited in increasing order of their minimum
+// priority value, which lets us stop as soon as no remaining tuple can contain
+// a better match. For range keys, the range fields (which always come first in
+// the key) are not part of the hash map key and are checked against every entry
+// of the matching bucket.
+template <typename K>
+class TupleSpace {
+ public:
+  explicit TupleSpace(size_t nbytes_key)
+      : nbytes_key(nbytes_key) { }
+
+  template <typename Compare>
+  bool lookup(const ByteContainer &key_data, internal_handle_t *handle,
+              Compare range_cmp) const {
+    // lookups are done concurrently (with the read lock) so we cannot use a
+    // member for this
+    static thread_local ByteContainer masked_key;
+    masked_key.resize(nbytes_key);
+
+    const Entry *best = nullptr;
+    for (const Tuple *tuple : tuples) {
+      if (best && tuple->min_priority() > best->priority) break;
+      for (size_t byte_index = 0; byte_index < nbytes_key; byte_index++)
+        masked_key[byte_index] = key_data[byte_index] & tuple->mask[byte_index];
+      const auto it = tuple->buckets.find(masked_key);
+      if (it == tuple->buckets.end()) continue;
+      // entries are sorted in the bucket, so the first entry which matches is
+      // the best one
+      for (const Entry &entry : it->second) {
+        if (best && !is_better(entry, *best)) break;
+        if (range_cmp(key_data, *entry.key)) {
+          best = &entry;
+          break;
+        }
+      }
+    }
+
+    if (!best) return false;
+    *handle = best->handle;
+    return true;
+  }
+
+  bool exists(const K &key) const {
+    return find_entry(key) != nullptr;
+  }
+
+  bool retrieve_handle(const K &key, internal_handle_t *handle) const {
+    auto entry = find_entry(key);
+    if (entry == nullptr) return false;
+    *handle = entry->handle;
+    return true;
+  }
+
+  void add(const K &key, internal_handle_t handle) {
+    const auto nb_range_bytes = range_bytes(key);
+    auto &tuple = tuples_map[tuple_mask(key, nb_range_bytes)];
+    if (!tuple) {
+      tuple.reset(new Tuple());
+      tuple->mask = tuple_mask(key, nb_range_bytes);
+      tuples.push_back(tuple.get());
+    }
+    auto &bucket = tuple->buckets[bucket_key(key, nb_range_bytes)];
+    const Entry entry = {key.priority, handle, &key};
+    bucket.insert(
+        std::upper_bound(bucket.begin(), bucket.end(), entry, is_better),
+        entry);
+    tuple->priorities[key.priority]++;
+    sort_tuples();
+  }
+
+  void delete_entry(const K &key) {
+    const auto nb_range_bytes = range_bytes(key);
+    const auto tuple_it = tuples_map.find(tuple_mask(key, nb_range_bytes));
+    assert(tuple_it != tuples_map.end());
+    Tuple *tuple = tuple_it->second.get();
+    const auto bucket_it = tuple->buckets.find(bucket_key(key, nb_range_bytes));
+    assert(bucket_it != tuple->buckets.end());
+    auto &bucket = bucket_it->second;
+    const auto entry_it = std::find_if(
+        bucket.begin(), bucket.end(), [&key](const Entry &entry) {
+          return entry.priority == key.priority && *entry.key == key; });
+    assert(entry_it != bucket.end());
+    bucket.erase(entry_it);
+    if (bucket.empty()) tuple->buckets.erase(bucket_it);
+
+    auto priority_it = tuple->priorities.find(key.priority);
+    if (--priority_it->second == 0) tuple->priorities.erase(priority_it);
+
+    if (tuple->buckets.empty()) {
+      tuples.erase(std::find(tuples.begin(), tuples.end(), tuple));
+      tuples_map.erase(tuple_it);
+    } else {
+      sort_tuples();
+    }
+  }
+
+  void clear() {
+    tuples.clear();
+    tuples_map.clear();
+  }
+
+ private:
+  struct Entry {
+    int priority;
+    internal_handle_t handle;
+    const K *key;
+  };
+
+  struct Tuple {
+    int min_priority() const {
+      return priorities.begin()->first;
+    }
+
+    ByteContainer mask{};
+    // entries in a bucket are sorted with is_better
+    std::unordered_map<ByteContainer, std::vector<Entry>, ByteContainerKeyHash>
+    buckets{};
+    // number of entries in the tuple for each priority value
+    std::map<int, size_t> priorities{};
+  };
+
+  size_t nbytes_key;
+  // sorted by minimum priority value
+  std::vector<Tuple *> tuples{};
+  std::unordered_map<ByteContainer, std::unique_ptr<Tuple>,
+                     ByteContainerKeyHash> tuples_map{};
+
+  // same tie-breaking rule as EntryList, which returns the entry that comes
+  // first in the list (i.e. the one with the smallest handle)
+  static bool is_better(const Entry &e1, const Entry &e2) {
+    return (e1.priority < e2.priority) ||
+        (e1.priority == e2.priority && e1.handle < e2.handle);
+  }
+
+  static ByteContainer tuple_mask(const K &key, size_t nb_range_bytes) {
+    ByteContainer mask(key.mask);
+    for (size_t byte_index = 0; byte_index < nb_range_bytes; byte_index++)
+      mask[byte_index] = 0;
+    return mask;
+  }
+
+  static ByteContainer bucket_key(const K &key, size_t nb_range_bytes) {
+    ByteContainer data(key.data);
+    for (size_t byte_index = 0; byte_index < nb_range_bytes; byte_index++)
+      data[byte_index] = 0;
+    return data;
+  }
+
+  const Entry *find_entry(const K &key) const {
+    const auto nb_range_bytes = range_bytes(key);
+    const auto tuple_it = tuples_map.find(tuple_mask(key, nb_range_bytes));
+    if (tuple_it == tuples_map.end()) return nullptr;
+    const auto &buckets = tuple_it->second->buckets;
+    const auto bucket_it = buckets.find(bucket_key(key, nb_range_bytes));
+    if (bucket_it == buckets.end()) return nullptr;
+    for (const Entry &entry : bucket_it->second) {
+      if (entry.priority == key.priority && *entry.key == key) return &entry;
+    }
+    return nullptr;
+  }
+
+  void sort_tuples() {
+    std::stable_sort(tuples.begin(), tuples.end(),
+                     [](const Tuple *t1, const Tuple *t2) {
+                       return t1->min_priority() < t2->min_priority(); });
+  }
+};
+
 class TernaryMap : public TernaryLookupStructure {
  public:
   TernaryMap(size_t size, size_t nbytes_key, bool enable_cache = true)
-      : entry_list(size, enable_cache), nbytes_key(nbytes_key) {}
+      : entry_list(size, nbytes_key, enable_cache), nbytes_key(nbytes_key) {}
 
   bool lookup(const ByteContainer &key_data,
               internal_handle_t *handle) const override {
-    auto cmp = [this](const ByteContainer &key_data, const TernaryMatchKey &k) {
-      for (size_t byte_index = 0; byte_index < this->nbytes_key; byte_index++) {
-        if (k.data[byte_index] != (key_data[byte_index] & k.mask[byte_index]))
-          return false;
-      }
+    // the whole key is covered by the scan
+    auto cmp = [](const ByteContainer &, const TernaryMatchKey &) {
       return true;
     };
 
@@ -427,6 +750,14 @@ class TernaryMap : public TernaryLookupStructure {
     entry_list.clear();
   }
 
+  bool get_cache_stats(LookupCacheStats *stats) const override {
+    return entry_list.get_cache_stats(stats);
+  }
+
+  bool set_cache_size(size_t size) override {
+    return entry_list.set_cache_size(size);
+  }
+
  private:
   EntryList<TernaryMatchKey> entry_list;
   size_t nbytes_key;
@@ -435,11 +766,13 @@ class TernaryMap : public TernaryLookupStructure {
 class RangeMap : public RangeLookupStructure {
  public:
   RangeMap(size_t size, size_t nbytes_key, bool enable_cache = true)
-      : entry_list(size, enable_cache), nbytes_key(nbytes_key) {}
+      : entry_list(size, nbytes_key, enable_cache), nbytes_key(nbytes_key) {}
 
   bool lookup(const ByteContainer &key_data,
               internal_handle_t *handle) const override {
-    auto cmp = [this](const ByteContainer &key_data, const RangeMatchKey &k) {
+    // only the range fields need to be checked, the rest of the key is covered
+    // by the scan
+    auto cmp = [](const ByteContainer &key_data, const RangeMatchKey &k) {
       size_t offset = 0;
       for (const int w : k.range_widths) {
         if (memcmp(&key_data[offset], &k.data[offset], w) < 0) {
@@ -450,12 +783,6 @@ class RangeMap : public RangeLookupStructure {
         }
         offset += w;
       }
-
-      for (; offset < nbytes_key; offset++) {
-        if (k.data[offset] != (key_data[offset] & k.mask[offset]))
-          return false;
-      }
-
       return true;
     };
 
@@ -484,16 +811,138 @@ class RangeMap : public RangeLookupStructure {
     entry_list.clear();
   }
 
+  bool get_cache_stats(LookupCacheStats *stats) const override {
+    return entry_list.get_cache_stats(stats);
+  }
+
+  bool set_cache_size(size_t size) override {
+    return entry_list.set_cache_size(size);
+  }
+
  private:
   EntryList<RangeMatchKey> entry_list;
   size_t nbytes_key;
 };
 
+class TupleSpaceTernaryMap : public TernaryLookupStructure {
+ public:
+  explicit TupleSpaceTernaryMap(size_t nbytes_key)
+      : tuple_space(nbytes_key) { }
+
+  bool lookup(const ByteContainer &key_data,
+              internal_handle_t *handle) const override {
+    // the whole key is covered by the tuple lookup
+    auto cmp = [](const ByteContainer &, const TernaryMatchKey &) {
+      return true;
+    };
+
+    return tuple_space.lookup(key_data, handle, cmp);
+  }
+
+  bool entry_exists(const TernaryMatchKey &key) const override {
+    return tuple_space.exists(key);
+  }
+
+  bool retrieve_handle(const TernaryMatchKey &key,
+                       internal_handle_t *handle) const override {
+    return tuple_space.retrieve_handle(key, handle);
+  }
+
+  void add_entry(const TernaryMatchKey &key,
+                 internal_handle_t handle) override {
+    tuple_space.add(key, handle);
+  }
+
+  void delete_entry(const TernaryMatchKey &key) override {
+    tuple_space.delete_entry(key);
+  }
+
+  void clear() override {
+    tuple_space.clear();
+  }
+
+ private:
+  TupleSpace<TernaryMatchKey> tuple_space;
+};
+
+class TupleSpaceRangeMap : public RangeLookupStructure {
+ public:
+  explicit TupleSpaceRangeMap(size_t nbytes_key)
+      : tuple_space(nbytes_key) { }
+
+  bool lookup(const ByteContainer &key_data,
+              internal_handle_t *handle) const override {
+    // only the range fields need to be checked, the rest of the key is covered
+    // by the tuple lookup
+    auto cmp = [](const ByteContainer &key_data, const RangeMatchKey &k) {
+      size_t offset = 0;
+      for (const int w : k.range_widths) {
+        if (memcmp(&key_data[offset], &k.data[offset], w) < 0) {
+          return false;
+        }
+        if (memcmp(&key_data[offset], &k.mask[offset], w) > 0) {
+          return false;
+        }
+        offset += w;
+      }
+      return true;
+    };
+
+    return tuple_space.lookup(key_data, handle, cmp);
+  }
+
+  bool entry_exists(const RangeMatchKey &key) const override {
+    return tuple_space.exists(key);
+  }
+
+  bool retrieve_handle(const RangeMatchKey &key,
+                       internal_handle_t *handle) const override {
+    return tuple_space.retrieve_handle(key, handle);
+  }
+
+  void add_entry(const RangeMatchKey &key,
+                 internal_handle_t handle) override {
+    tuple_space.add(key, handle);
+  }
+
+  void delete_entry(const RangeMatchKey &key) override {
+    tuple_space.delete_entry(key);
+  }
+
+  void clear() override {
+    tuple_space.clear();
+  }
+
+ private:
+  TupleSpace<RangeMatchKey> tuple_space;
+};
+
 }  // namespace
 
 LookupStructureFactory::LookupStructureFactory(bool enable_ternary_cache)
     : enable_ternary_cache(enable_ternary_cache) { }
 
+void
+LookupStructureFactory::set_tuple_space_min_size(size_t min_size) {
+  tuple_space_min_size = min_size;
+}
+
+void
+LookupStructureFactory::set_multibit_lpm_min_size(size_t min_size) {
+  multibit_lpm_min_size = min_size;
+}
+
+std::shared_ptr<ActionProfile::GroupSelectionIface>
+LookupStructureFactory::create_group_selector() {
+  if (resilient_selector_buckets == 0) return nullptr;
+  return std::make_shared<ResilientGroupSelection>(resilient_selector_buckets);
+}
+
+void
+LookupStructureFactory::set_resilient_selector_buckets(size_t nb_buckets) {
+  resilient_selector_buckets = nb_buckets;
+}
+
 template <>
 std::unique_ptr<LookupStructure<ExactMatchKey> >
 LookupStructureFactory::create<ExactMatchKey>(
@@ -525,24 +974,39 @@ LookupStructureFactory::create<RangeMatchKey>(
 
 std::unique_ptr<ExactLookupStructure>
 LookupStructureFactory::create_for_exact(size_t size, size_t nbytes_key) {
-  (void) nbytes_key;
-  return std::unique_ptr<ExactLookupStructure>(new ExactMap(size));
+  return std::unique_ptr<ExactLookupStructure>(new ExactMap(size, nbytes_key));
 }
 
 std::unique_ptr<LPMLookupStructure>
 LookupStructureFactory::create_for_LPM(size_t size, size_t nbytes_key) {
-  (void) size;
-  return std::unique_ptr<LPMLookupStructure>(new LPMTrieStructure(nbytes_key));
+  if (size >= multibit_lpm_min_size) {
+    if (nbytes_key == 4) {
+      return std::unique_ptr<LPMLookupStructure>(
+          new LPMTrieStructure<LPMDir24_8>());
+    }
+    return std::unique_ptr<LPMLookupStructure>(
+        new LPMTrieStructure<LPMMultibitTrie>(nbytes_key));
+  }
+  return std::unique_ptr<LPMLookupStructure>(
+      new LPMTrieStructure<LPMTrie>(nbytes_key));
 }
 
 std::unique_ptr<TernaryLookupStructure>
 LookupStructureFactory::create_for_ternary(size_t size, size_t nbytes_key) {
+  if (size >= tuple_space_min_size) {
+    return std::unique_ptr<TernaryLookupStructure>(
+        new TupleSpaceTernaryMap(nbytes_key));
+  }
   return std::unique_ptr<TernaryLookupStructure>(
       new TernaryMap(size, nbytes_key, enable_ternary_cache));
 }
 
 std::unique_ptr<RangeLookupStructure>
 LookupStructureFactory::create_for_range(size_t size, size_t nbytes_key) {
+  if (size >= tuple_space_min_size) {
+    return std::unique_ptr<RangeLookupStructure>(
+        new TupleSpaceRangeMap(nbytes_key));
+  }
   return std::unique_ptr<RangeLookupStructure>(
       new RangeMap(size, nbytes_key, enable_ternary_cache));
 }
@@ -0,0 +1,576 @@
+/* Copyright 2013-present Barefoot Networks, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <bm/bm_sim/_assert.h>
+
+#include <algorithm>
+#include <array>
+#include <vector>
+
+#include "lpm_multibit.h"
+
+namespace bm {
+
+namespace {
+
+constexpr uint32_t max_value = 0x00ffffff;
+
+constexpr size_t batch_size = 16;
+
+int popcount(uint64_t v) {
+  return __builtin_popcountll(v);
+}
+
+// DIR-24-8 entries are either 0 (no match), the index of a tbl8 group
+// (group_bit set, in tbl24 only), or a value along with the length of the
+// prefix it comes from, which is needed to update the table in place.
+
+constexpr uint32_t valid_bit = 1u << 31;
+constexpr uint32_t group_bit = 1u << 30;
+constexpr int depth_shift = 24;
+
+uint32_t make_entry(uint32_t value, int depth) {
+  return valid_bit | (static_cast<uint32_t>(depth) << depth_shift) | value;
+}
+
+int entry_depth(uint32_t entry) {
+  return (entry >> depth_shift) & 0x3f;
+}
+
+uint32_t prefix_mask(int prefix_length) {
+  return (prefix_length == 0) ? 0 : (~0u << (32 - prefix_length));
+}
+
+}  // namespace
+
+LPMDir24_8::LPMDir24_8()
+    : tbl24(1u << 24, 0) { }
+
+uint32_t
+LPMDir24_8::get_addr(const ByteContainer &key) {
+  const auto *bytes = reinterpret_cast<const unsigned char *>(key.data());
+  return (static_cast<uint32_t>(bytes[0]) << 24) |
+      (static_cast<uint32_t>(bytes[1]) << 16) |
+      (static_cast<uint32_t>(bytes[2]) << 8) | bytes[3];
+}
+
+uint32_t
+LPMDir24_8::find_shorter(uint32_t addr, int prefix_length) const {
+  for (int l = prefix_length - 1; l >= 0; l--) {
+    const auto &m = prefixes[l];
+    if (m.empty()) continue;
+    const auto it = m.find(addr & prefix_mask(l));
+    if (it != m.end()) return make_entry(it->second, l);
+  }
+  return 0;
+}
+
+uint32_t
+LPMDir24_8::alloc_group(uint32_t init) {
+  uint32_t group;
+  if (!free_groups.empty()) {
+    group = free_groups.back();
+    free_groups.pop_back();
+  } else {
+    group = static_cast<uint32_t>(tbl8.size() >> 8);
+    _BM_ASSERT(group <= max_value);
+    tbl8.resize(tbl8.size() + 256);
+  }
+  std::fill(tbl8.begin() + (group << 8), tbl8.begin() + ((group + 1) << 8),
+            init);
+  return group;
+}
+
+void
+LPMDir24_8::insert_prefix(const ByteContainer &prefix, int prefix_length,
+                          uintptr_t value) {
+  _BM_ASSERT(prefix_length >= 0 && prefix_length <= 32);
+  _BM_ASSERT(value <= max_value);
+  const uint32_t addr = get_addr(prefix) & prefix_mask(prefix_length);
+  prefixes[prefix_length][addr] = static_cast<uint32_t>(value);
+
+  // entries which come from a shorter (or the same) prefix are overwritten
+  const uint32_t new_entry = make_entry(value, prefix_length);
+  auto update = [prefix_length, new_entry](uint32_t *entry) {
+    if (!(*entry & valid_bit) || entry_depth(*entry) <= prefix_length)
+      *entry = new_entry;
+  };
+
+  if (prefix_length <= 24) {
+    const uint32_t start = addr >> 8;
+    const uint32_t count = 1u << (24 - prefix_length);
+    for (uint32_t i = start; i < start + count; i++) {
+      uint32_t &entry = tbl24[i];
+      if (entry & group_bit) {
+        uint32_t *group = &tbl8[(entry & max_value) << 8];
+        for (int j = 0; j < 256; j++) update(&group[j]);
+      } else {
+        update(&entry);
+      }
+    }
+  } else {
+    uint32_t &entry = tbl24[addr >> 8];
+    if (!(entry & group_bit))
+      entry = valid_bit | group_bit | alloc_group(entry);
+    uint32_t *group = &tbl8[(entry & max_value) << 8];
+    const uint32_t start = addr & 0xff;
+    const uint32_t count = 1u << (32 - prefix_length);
+    for (uint32_t j = start; j < start + count; j++) update(&group[j]);
+  }
+}
+
+bool
+LPMDir24_8::delete_prefix(const ByteContainer &prefix, int prefix_length) {
+  const uint32_t addr = get_addr(prefix) & prefix_mask(prefix_length);
+  auto &m = prefixes[prefix_length];
+  const auto it = m.find(addr);
+  if (it == m.end()) return false;
+  m.erase(it);
+
+  // entries which come from the deleted prefix now come from the longest
+  // shorter prefix which covers it, if any
+  const uint32_t replacement = find_shorter(addr, prefix_length);
+  auto update = [prefix_length, replacement](uint32_t *entry) {
+    if ((*entry & valid_bit) && entry_depth(*entry) == prefix_length)
+      *entry = replacement;
+  };
+
+  if (prefix_length <= 24) {
+    const uint32_t start = addr >> 8;
+    const uint32_t count = 1u << (24 - prefix_length);
+    for (uint32_t i = start; i < start + count; i++) {
+      uint32_t &entry = tbl24[i];
+      if (entry & group_bit) {
+        uint32_t *group = &tbl8[(entry & max_value) << 8];
+        for (int j = 0; j < 256; j++) update(&group[j]);
+      } else {
+        update(&entry);
+      }
+    }
+  } else {
+    uint32_t &entry = tbl24[addr >> 8];
+    const uint32_t group_idx = entry & max_value;
+    uint32_t *group = &tbl8[group_idx << 8];
+    const uint32_t start = addr & 0xff;
+    const uint32_t count = 1u << (32 - prefix_length);
+    for (uint32_t j = start; j < start + count; j++) update(&group[j]);
+    // if there is no prefix longer than 24 bits left in the group, all its
+    // entries are the same and it can be released
+    const uint32_t first = group[0];
+    if ((!(first & valid_bit) || entry_depth(first) <= 24) &&
+        std::all_of(group, group + 256,
+                    [first](uint32_t e) { return e == first; })) {
+      entry = first;
+      free_groups.push_back(group_idx);
+    }
+  }
+  return true;
+}
+
+bool
+LPMDir24_8::has_prefix(const ByteContainer &prefix, int prefix_length) const {
+  uintptr_t value;
+  return retrieve_value(prefix, prefix_length, &value);
+}
+
+bool
+LPMDir24_8::retrieve_value(const ByteContainer &prefix, int prefix_length,
+                           uintptr_t *value) const {
+  const auto &m = prefixes[prefix_length];
+  const auto it = m.find(get_addr(prefix) & prefix_mask(prefix_length));
+  if (it == m.end()) return false;
+  *value = it->second;
+  return true;
+}
+
+bool
+LPMDir24_8::lookup(const ByteContainer &key, uintptr_t *value) const {
+  const uint32_t addr = get_addr(key);
+  uint32_t entry = tbl24[addr >> 8];
+  if (entry & group_bit)
+    entry = tbl8[((entry & max_value) << 8) | (addr & 0xff)];
+  if (!(entry & valid_bit)) return false;
+  *value = entry & max_value;
+  return true;
+}
+
+void
+LPMDir24_8::lookup_batch(const ByteContainer *keys, size_t n,
+                         uintptr_t *values, bool *found) const {
+  uint32_t addrs[batch_size];
+  uint32_t entries[batch_size];
+  for (size_t base = 0; base < n; base += batch_size) {
+    const size_t m = std::min(batch_size, n - base);
+    for (size_t i = 0; i < m; i++) {
+      addrs[i] = get_addr(keys[base + i]);
+      __builtin_prefetch(&tbl24[addrs[i] >> 8]);
+    }
+    for (size_t i = 0; i < m; i++) {
+      entries[i] = tbl24[addrs[i] >> 8];
+      if (entries[i] & group_bit) {
+        __builtin_prefetch(
+            &tbl8[((entries[i] & max_value) << 8) | (addrs[i] & 0xff)]);
+      }
+    }
+    for (size_t i = 0; i < m; i++) {
+      if (entries[i] & group_bit)
+        entries[i] = tbl8[((entries[i] & max_value) << 8) | (addrs[i] & 0xff)];
+      found[base + i] = entries[i] & valid_bit;
+      values[base + i] = entries[i] & max_value;
+    }
+  }
+}
+
+void
+LPMDir24_8::clear() {
+  std::fill(tbl24.begin(), tbl24.end(), 0);
+  tbl8.clear();
+  free_groups.clear();
+  for (auto &m : prefixes) m.clear();
+}
+
+/* LPMMultibitTrie */
+
+namespace {
+
+constexpr int stride = 6;
+
+size_t get_depth(int prefix_length) {
+  return (prefix_length == 0) ? 0
+                              : static_cast<size_t>(prefix_length - 1) / stride;
+}
+
+// bit index of a prefix in NodeInfo::prefixes, from its length in the node
+// and its bits
+unsigned get_prefix_idx(int local_length, unsigned bits) {
+  return (1u << local_length) - 1 + bits;
+}
+
+int get_prefix_rank(const uint64_t prefixes[2], unsigned prefix_idx) {
+  const uint64_t bit = 1ull << (prefix_idx & 63);
+  return (prefix_idx < 64) ? popcount(prefixes[0] & (bit - 1))
+      : popcount(prefixes[0]) + popcount(prefixes[1] & (bit - 1));
+}
+
+}  // namespace
+
+LPMMultibitTrie::LPMMultibitTrie(size_t key_width_bytes)
+    : key_width_bytes(key_width_bytes),
+      nb_chunks((key_width_bytes * 8 + stride - 1) / stride) {
+  clear();
+}
+
+// bits beyond the end of the key are 0, they are never part of a prefix
+unsigned
+LPMMultibitTrie::get_chunk(const ByteContainer &key, size_t depth) const {
+  const size_t offset = depth * stride;
+  const size_t i = offset / 8;
+  const auto *bytes = reinterpret_cast<const unsigned char *>(key.data());
+  const unsigned v = (static_cast<unsigned>(bytes[i]) << 8) |
+      ((i + 1 < key_width_bytes) ? bytes[i + 1] : 0);
+  return (v >> (16 - stride - (offset % 8))) & 0x3f;
+}
+
+uint32_t
+LPMMultibitTrie::get_child(const Node &node, unsigned chunk) const {
+  const uint64_t bit = 1ull << chunk;
+  if (!(node.children & bit)) return 0;
+  return node.base_child + popcount(node.children & (bit - 1));
+}
+
+uint32_t
+LPMMultibitTrie::get_leaf(const Node &node, unsigned chunk) const {
+  // includes chunk itself; when chunk is 63, the shift overflows to 0 and all
+  // bits are selected, as expected
+  const uint64_t bits = node.leafvec & ((2ull << chunk) - 1);
+  return leaves[node.base_leaf + popcount(bits) - 1];
+}
+
+uint32_t
+LPMMultibitTrie::add_child(uint32_t idx, unsigned chunk) {
+  const uint64_t bit = 1ull << chunk;
+  // a new node has no prefix, it only inherits the best match of its parent
+  Node child{0, 1, 0, leaves.alloc(1)};
+  leaves[child.base_leaf] = get_leaf(nodes[idx], chunk);
+  const size_t n = popcount(nodes[idx].children);
+  const size_t pos = popcount(nodes[idx].children & (bit - 1));
+  const uint32_t base = nodes.insert_at(nodes[idx].base_child, n, pos, child);
+  const uint32_t info_base =
+      infos.insert_at(nodes[idx].base_child, n, pos, NodeInfo{{0, 0}, 0});
+  _BM_ASSERT(base == info_base);
+  _BM_UNUSED(info_base);
+  nodes[idx].children |= bit;
+  nodes[idx].base_child = base;
+  return base + pos;
+}
+
+void
+LPMMultibitTrie::remove_child(uint32_t idx, unsigned chunk) {
+  const uint64_t bit = 1ull << chunk;
+  const Node child = nodes[get_child(nodes[idx], chunk)];
+  leaves.free(child.base_leaf, popcount(child.leafvec));
+  const size_t n = popcount(nodes[idx].children);
+  const size_t pos = popcount(nodes[idx].children & (bit - 1));
+  const uint32_t base = nodes.erase_at(nodes[idx].base_child, n, pos);
+  infos.erase_at(nodes[idx].base_child, n, pos);
+  nodes[idx].children &= ~bit;
+  nodes[idx].base_child = base;
+}
+
+// Recomputes the leaves of the node at index idx, given the best match
+// inherited from its parent, as well as the leaves of the subtrees rooted at
+// children lo to hi, which inherit from this node.
+void
+LPMMultibitTrie::encode(uint32_t idx, uint32_t inherited, unsigned lo,
+                        unsigned hi) {
+  std::array<uint32_t, 64> best;
+  best.fill(inherited);
+  const NodeInfo &info = infos[idx];
+  // prefixes are ordered by length, so longer ones overwrite shorter ones
+  uint32_t value_idx = info.base_value;
+  for (unsigned w = 0; w < 2; w++) {
+    for (uint64_t bits = info.prefixes[w]; bits; bits &= bits - 1) {
+      const unsigned prefix_idx = w * 64 + __builtin_ctzll(bits);
+      int local_length = 0;
+      while ((2u << local_length) - 1 <= prefix_idx) local_length++;
+      const unsigned first = (prefix_idx + 1 - (1u << local_length))
+          << (stride - local_length);
+      std::fill(best.begin() + first,
+                best.begin() + first + (1u << (stride - local_length)),
+                values[value_idx++] + 1);
+    }
+  }
+
+  uint64_t leafvec = 0;
+  for (unsigned c = 0; c < 64; c++)
+    if (c == 0 || best[c] != best[c - 1]) leafvec |= 1ull << c;
+  Node &node = nodes[idx];
+  const size_t nb_leaves = popcount(leafvec);
+  const size_t old_nb_leaves = popcount(node.leafvec);
+  if (!LPMBlockPool<uint32_t>::same_size_class(nb_leaves, old_nb_leaves)) {
+    leaves.free(node.base_leaf, old_nb_leaves);
+    node.base_leaf = leaves.alloc(nb_leaves);
+  }
+  node.leafvec = leafvec;
+  for (unsigned c = 0, i = 0; c < 64; c++) {
+    if (c == 0 || best[c] != best[c - 1])
+      leaves[node.base_leaf + i++] = best[c];
+  }
+
+  const uint64_t range = ((2ull << hi) - 1) & ~((1ull << lo) - 1);
+  for (uint64_t bits = node.children & range; bits; bits &= bits - 1) {
+    const unsigned c = __builtin_ctzll(bits);
+    encode(get_child(nodes[idx], c), best[c], 0, 63);
+  }
+}
+
+// path receives the index of the nodes from the root to the node where the
+// prefix is stored
+bool
+LPMMultibitTrie::find_node(const ByteContainer &prefix, int prefix_length,
+                           bool create, std::vector<uint32_t> *path) {
+  const size_t depth = get_depth(prefix_length);
+  path->assign(1, 0);
+  for (size_t d = 0; d < depth; d++) {
+    const unsigned chunk = get_chunk(prefix, d);
+    uint32_t child = get_child(nodes[path->back()], chunk);
+    if (child == 0) {
+      if (!create) return false;
+      child = add_child(path->back(), chunk);
+    }
+    path->push_back(child);
+  }
+  return true;
+}
+
+bool
+LPMMultibitTrie::find_node(const ByteContainer &prefix, int prefix_length,
+                           uint32_t *idx) const {
+  const size_t depth = get_depth(prefix_length);
+  *idx = 0;
+  for (size_t d = 0; d < depth; d++) {
+    *idx = get_child(nodes[*idx], get_chunk(prefix, d));
+    if (*idx == 0) return false;
+  }
+  return true;
+}
+
+namespace {
+
+struct LocalPrefix {
+  // chunk is the chunk of the prefix at the depth of the node
+  LocalPrefix(int prefix_length, unsigned chunk) {
+    local_length = prefix_length - stride * get_depth(prefix_length);
+    bits = (local_length == 0) ? 0 : chunk >> (stride - local_length);
+    idx = get_prefix_idx(local_length, bits);
+  }
+
+  // chunks of the node covered by the prefix
+  unsigned lo() const { return bits << (stride - local_length); }
+  unsigned hi() const { return lo() + (1u << (stride - local_length)) - 1; }
+
+  int local_length;
+  unsigned bits;
+  unsigned idx;
+};
+
+}  // namespace
+
+void
+LPMMultibitTrie::insert_prefix(const ByteContainer &prefix, int prefix_length,
+                               uintptr_t value) {
+  _BM_ASSERT(prefix_length >= 0 &&
+             static_cast<size_t>(prefix_length) <= key_width_bytes * 8);
+  _BM_ASSERT(value <= max_value);
+  std::vector<uint32_t> path;
+  find_node(prefix, prefix_length, true, &path);
+  const uint32_t idx = path.back();
+  const size_t depth = path.size() - 1;
+  const LocalPrefix local(prefix_length, get_chunk(prefix, depth));
+
+  NodeInfo &info = infos[idx];
+  const int rank = get_prefix_rank(info.prefixes, local.idx);
+  const uint64_t bit = 1ull << (local.idx & 63);
+  if (info.prefixes[local.idx / 64] & bit) {
+    values[info.base_value + rank] = static_cast<uint32_t>(value);
+  } else {
+    const size_t n = popcount(info.prefixes[0]) + popcount(info.prefixes[1]);
+    info.base_value = values.insert_at(info.base_value, n, rank,
+                                       static_cast<uint32_t>(value));
+    info.prefixes[local.idx / 64] |= bit;
+  }
+
+  const uint32_t inherited = (depth == 0) ? 0 :
+      get_leaf(nodes[path[depth - 1]], get_chunk(prefix, depth - 1));
+  encode(idx, inherited, local.lo(), local.hi());
+}
+
+bool
+LPMMultibitTrie::delete_prefix(const ByteContainer &prefix,
+                               int prefix_length) {
+  std::vector<uint32_t> path;
+  if (!find_node(prefix, prefix_length, false, &path)) return false;
+  const uint32_t idx = path.back();
+  const size_t depth = path.size() - 1;
+  const LocalPrefix local(prefix_length, get_chunk(prefix, depth));
+
+  NodeInfo &info = infos[idx];
+  const uint64_t bit = 1ull << (local.idx & 63);
+  if (!(info.prefixes[local.idx / 64] & bit)) return false;
+  const int rank = get_prefix_rank(info.prefixes, local.idx);
+  const size_t n = popcount(info.prefixes[0]) + popcount(info.prefixes[1]);
+  info.base_value = values.erase_at(info.base_value, n, rank);
+  info.prefixes[local.idx / 64] &= ~bit;
+
+  const uint32_t inherited = (depth == 0) ? 0 :
+      get_leaf(nodes[path[depth - 1]], get_chunk(prefix, depth - 1));
+  encode(idx, inherited, local.lo(), local.hi());
+
+  // nodes without prefixes or children are not needed anymore
+  for (size_t d = depth; d > 0; d--) {
+    const NodeInfo &i = infos[path[d]];
+    if (i.prefixes[0] || i.prefixes[1] || nodes[path[d]].children) break;
+    remove_child(path[d - 1], get_chunk(prefix, d - 1));
+  }
+  return true;
+}
+
+bool
+LPMMultibitTrie::has_prefix(const ByteContainer &prefix,
+                            int prefix_length) const {
+  uintptr_t value;
+  return retrieve_value(prefix, prefix_length, &value);
+}
+
+bool
+LPMMultibitTrie::retrieve_value(const ByteContainer &prefix, int prefix_length,
+                                uintptr_t *value) const {
+  uint32_t idx;
+  if (!find_node(prefix, prefix_length, &idx)) return false;
+  const LocalPrefix local(prefix_length,
+                          get_chunk(prefix, get_depth(prefix_length)));
+  const NodeInfo &info = infos[idx];
+  if (!(info.prefixes[local.idx / 64] & (1ull << (local.idx & 63))))
+    return false;
+  *value = values[info.base_value + get_prefix_rank(info.prefixes, local.idx)];
+  return true;
+}
+
+bool
+LPMMultibitTrie::lookup(const ByteContainer &key, uintptr_t *value) const {
+  const Node *node = &nodes[0];
+  // nodes at the last level have no children, so we always end up in a leaf
+  uint32_t leaf = 0;
+  for (size_t d = 0; d < nb_chunks; d++) {
+    const unsigned chunk = get_chunk(key, d);
+    const uint32_t child = get_child(*node, chunk);
+    if (child == 0) {
+      leaf = get_leaf(*node, chunk);
+      break;
+    }
+    node = &nodes[child];
+  }
+  if (leaf == 0) return false;
+  *value = leaf - 1;
+  return true;
+}
+
+void
+LPMMultibitTrie::lookup_batch(const ByteContainer *keys, size_t n,
+                              uintptr_t *values, bool *found) const {
+  // marks the keys for which the lookup is over
+  constexpr uint32_t done = 0xffffffff;
+  uint32_t idxs[batch_size];
+  for (size_t base = 0; base < n; base += batch_size) {
+    const size_t m = std::min(batch_size, n - base);
+    std::fill(idxs, idxs + m, 0);
+    std::fill(found + base, found + base + m, false);
+    size_t remaining = m;
+    for (size_t d = 0; remaining > 0 && d < nb_chunks; d++) {
+      for (size_t i = 0; i < m; i++) {
+        if (idxs[i] == done) continue;
+        const Node &node = nodes[idxs[i]];
+        const unsigned chunk = get_chunk(keys[base + i], d);
+        const uint32_t child = get_child(node, chunk);
+        if (child != 0) {
+          idxs[i] = child;
+          __builtin_prefetch(&nodes[child]);
+          continue;
+        }
+        const uint32_t leaf = get_leaf(node, chunk);
+        found[base + i] = (leaf != 0);
+        values[base + i] = leaf - 1;
+        idxs[i] = done;
+        remaining--;
+      }
+    }
+  }
+}
+
+void
+LPMMultibitTrie::clear() {
+  nodes.clear();
+  infos.clear();
+  leaves.clear();
+  values.clear();
+  const uint32_t root = nodes.alloc(1);
+  infos.alloc(1);
+  _BM_ASSERT(root == 0);
+  nodes[root] = Node{0, 1, 0, leaves.alloc(1)};
+  infos[root] = NodeInfo{{0, 0}, 0};
+  leaves[nodes[root].base_leaf] = 0;
+}
+
+}  // namespace bm
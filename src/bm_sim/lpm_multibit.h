@@ -0,0 +1,243 @@
+/* Copyright 2013-present Barefoot Networks, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef BM_SIM_LPM_MULTIBIT_H_
+#define BM_SIM_LPM_MULTIBIT_H_
+
+#include <bm/bm_sim/bytecontainer.h>
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace bm {
+
+// Alternatives to LPMTrie (lpm_trie.h) for large routing tables. They have the
+// same interface, but values (match unit handles) have to fit in 24 bits. In
+// both, the best match for every possible key has been precomputed, so that a
+// lookup never has to backtrack, and the prefixes themselves are kept on the
+// side, for updates and to retrieve entries. Updates are done in place and are
+// not safe with concurrent lookups, which is fine since match units hold the
+// table lock in write mode when modifying entries.
+
+// DIR-24-8 (Gupta et al.), for 32-bit keys: the first 24 bits of the key index
+// a table with 2^24 entries, which either stores the result or points to a
+// second-level group of 256 entries indexed by the last 8 bits. A lookup takes
+// at most 2 memory accesses, at the cost of a fixed 64MB table.
+class LPMDir24_8 {
+ public:
+  LPMDir24_8();
+
+  void insert_prefix(const ByteContainer &prefix, int prefix_length,
+                     uintptr_t value);
+
+  bool delete_prefix(const ByteContainer &prefix, int prefix_length);
+
+  bool has_prefix(const ByteContainer &prefix, int prefix_length) const;
+
+  bool retrieve_value(const ByteContainer &prefix, int prefix_length,
+                      uintptr_t *value) const;
+
+  bool lookup(const ByteContainer &key, uintptr_t *value) const;
+
+  // independent lookups are interleaved to overlap their memory accesses
+  void lookup_batch(const ByteContainer *keys, size_t n, uintptr_t *values,
+                    bool *found) const;
+
+  void clear();
+
+ private:
+  static uint32_t get_addr(const ByteContainer &key);
+  uint32_t find_shorter(uint32_t addr, int prefix_length) const;
+  uint32_t alloc_group(uint32_t init);
+
+  // 0 is not a valid entry
+  std::vector<uint32_t> tbl24;
+  std::vector<uint32_t> tbl8{};
+  std::vector<uint32_t> free_groups{};
+  // one map per prefix length, from masked address to value
+  std::array<std::unordered_map<uint32_t, uint32_t>, 33> prefixes{};
+};
+
+// Pool of fixed-size elements, handed out in contiguous blocks. Block sizes
+// are rounded up to a power of 2, so that freed blocks are easy to reuse and so
+// that most blocks can grow or shrink by one element in place. Indices are used
+// instead of pointers, since the underlying vector may be reallocated.
+template <typename T>
+class LPMBlockPool {
+ public:
+  T &operator[](size_t idx) { return elems[idx]; }
+  const T &operator[](size_t idx) const { return elems[idx]; }
+
+  // n has to be greater than 0
+  uint32_t alloc(size_t n) {
+    const int c = size_class(n);
+    if (static_cast<size_t>(c) < free_blocks.size() &&
+        !free_blocks[c].empty()) {
+      const auto base = free_blocks[c].back();
+      free_blocks[c].pop_back();
+      return base;
+    }
+    const auto base = static_cast<uint32_t>(elems.size());
+    elems.resize(elems.size() + (size_t(1) << c));
+    return base;
+  }
+
+  void free(uint32_t base, size_t n) {
+    const int c = size_class(n);
+    if (static_cast<size_t>(c) >= free_blocks.size())
+      free_blocks.resize(c + 1);
+    free_blocks[c].push_back(base);
+  }
+
+  // inserts v at position pos in the block of n elements starting at base and
+  // returns the (possibly new) base of the block
+  uint32_t insert_at(uint32_t base, size_t n, size_t pos, const T &v) {
+    if (n > 0 && size_class(n + 1) == size_class(n)) {
+      std::copy_backward(elems.begin() + base + pos, elems.begin() + base + n,
+                         elems.begin() + base + n + 1);
+      elems[base + pos] = v;
+      return base;
+    }
+    const auto new_base = alloc(n + 1);
+    std::copy(elems.begin() + base, elems.begin() + base + pos,
+              elems.begin() + new_base);
+    elems[new_base + pos] = v;
+    std::copy(elems.begin() + base + pos, elems.begin() + base + n,
+              elems.begin() + new_base + pos + 1);
+    if (n > 0) free(base, n);
+    return new_base;
+  }
+
+  // removes the element at position pos in the block of n elements starting at
+  // base and returns the (possibly new) base of the block
+  uint32_t erase_at(uint32_t base, size_t n, size_t pos) {
+    if (n == 1) {
+      free(base, n);
+      return 0;
+    }
+    if (size_class(n - 1) == size_class(n)) {
+      std::copy(elems.begin() + base + pos + 1, elems.begin() + base + n,
+                elems.begin() + base + pos);
+      return base;
+    }
+    const auto new_base = alloc(n - 1);
+    std::copy(elems.begin() + base, elems.begin() + base + pos,
+              elems.begin() + new_base);
+    std::copy(elems.begin() + base + pos + 1, elems.begin() + base + n,
+              elems.begin() + new_base + pos);
+    free(base, n);
+    return new_base;
+  }
+
+  void clear() {
+    elems.clear();
+    free_blocks.clear();
+  }
+
+  static bool same_size_class(size_t n1, size_t n2) {
+    return size_class(n1) == size_class(n2);
+  }
+
+ private:
+  static int size_class(size_t n) {
+    int c = 0;
+    while ((size_t(1) << c) < n) c++;
+    return c;
+  }
+
+  std::vector<T> elems{};
+  // indexed by size class
+  std::vector<std::vector<uint32_t> > free_blocks{};
+};
+
+// Poptrie (Asai et al.), a multibit trie for keys of any width. Each node
+// consumes 6 bits of the key. Instead of 64 pointers, a node has a 64-bit
+// bitmap of the chunks which lead to a child node and a 64-bit bitmap marking
+// where the (precomputed) best match changes, with the children and the
+// results (leaves) stored contiguously in shared arrays and indexed with
+// popcount. Nodes are therefore 24 bytes, and runs of identical results take a
+// single 4-byte leaf. The prefixes themselves are stored in the node where
+// they end, using the same kind of bitmap, so there is no separate
+// control-plane trie.
+class LPMMultibitTrie {
+ public:
+  explicit LPMMultibitTrie(size_t key_width_bytes);
+
+  void insert_prefix(const ByteContainer &prefix, int prefix_length,
+                     uintptr_t value);
+
+  bool delete_prefix(const ByteContainer &prefix, int prefix_length);
+
+  bool has_prefix(const ByteContainer &prefix, int prefix_length) const;
+
+  bool retrieve_value(const ByteContainer &prefix, int prefix_length,
+                      uintptr_t *value) const;
+
+  bool lookup(const ByteContainer &key, uintptr_t *value) const;
+
+  // the trie is walked one level at a time for a group of keys, prefetching the
+  // next node of each key
+  void lookup_batch(const ByteContainer *keys, size_t n, uintptr_t *values,
+                    bool *found) const;
+
+  void clear();
+
+ private:
+  struct Node {
+    uint64_t children;
+    uint64_t leafvec;
+    uint32_t base_child;
+    uint32_t base_leaf;
+  };
+
+  // control-plane part of a node, stored at the same index as the node in a
+  // separate pool (both pools see the same sequence of allocations), so that
+  // lookups do not have to load it
+  struct NodeInfo {
+    // prefix made of the first l bits (0 to 6) of the chunk v: bit 2^l - 1 + v
+    uint64_t prefixes[2];
+    uint32_t base_value;
+  };
+
+  unsigned get_chunk(const ByteContainer &key, size_t depth) const;
+  // returns the index of the child node, or 0 (the root) if there is none
+  uint32_t get_child(const Node &node, unsigned chunk) const;
+  uint32_t get_leaf(const Node &node, unsigned chunk) const;
+
+  // walks the trie down to the node where the prefix is stored; returns false
+  // if the node does not exist, unless create is true
+  bool find_node(const ByteContainer &prefix, int prefix_length, bool create,
+                 std::vector<uint32_t> *path);
+  bool find_node(const ByteContainer &prefix, int prefix_length,
+                 uint32_t *idx) const;
+  uint32_t add_child(uint32_t idx, unsigned chunk);
+  void remove_child(uint32_t idx, unsigned chunk);
+  void encode(uint32_t idx, uint32_t inherited, unsigned lo, unsigned hi);
+
+  size_t key_width_bytes;
+  size_t nb_chunks;
+  // node 0 is the root
+  LPMBlockPool<Node> nodes{};
+  LPMBlockPool<NodeInfo> infos{};
+  LPMBlockPool<uint32_t> leaves{};
+  LPMBlockPool<uint32_t> values{};
+};
+
+}  // namespace bm
+
+#endif  // BM_SIM_LPM_MULTIBIT_H_
@@ -84,6 +84,11 @@ class LPMTrie {
                               reinterpret_cast<value_t *>(value));
   }
 
+  void lookup_batch(const ByteContainer *keys, size_t n, uintptr_t *values,
+                    bool *found) const {
+    for (size_t i = 0; i < n; i++) found[i] = lookup(keys[i], &values[i]);
+  }
+
   void clear() {
     bf_lpm_trie_destroy(trie);
     trie = bf_lpm_trie_create(key_width_bytes, true);
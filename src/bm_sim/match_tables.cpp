@@ -299,6 +299,39 @@ MatchTableAbstract::sweep_entries(std::vector<entry_handle_t> *entries) const {
   match_unit_->sweep_entries(entries);
 }
 
+// set_entry_ttl() and add_entry(), which record TTL updates, hold the write
+// lock, and the ageing monitor is the only caller of this method
+void
+MatchTableAbstract::get_ttl_updates(std::vector<entry_handle_t> *entries,
+                                    bool all) {
+  auto lock = lock_read();
+  match_unit_->get_ttl_updates(entries, all);
+}
+
+void
+MatchTableAbstract::get_expiry_times(const entry_handle_t *handles, size_t n,
+                                     uint64_t *expiry_times_ms) const {
+  auto lock = lock_read();
+  match_unit_->get_expiry_times(handles, n, expiry_times_ms);
+}
+
+MatchErrorCode
+MatchTableAbstract::get_cache_stats(LookupCacheStats *stats) const {
+  auto lock = lock_read();
+  if (!match_unit_->get_cache_stats(stats))
+    return MatchErrorCode::CACHE_DISABLED;
+  return MatchErrorCode::SUCCESS;
+}
+
+MatchErrorCode
+MatchTableAbstract::set_cache_size(size_t size) {
+  // the cache cannot be resized while lookups are in progress
+  auto lock = lock_write();
+  if (!match_unit_->set_cache_size(size))
+    return MatchErrorCode::CACHE_DISABLED;
+  return MatchErrorCode::SUCCESS;
+}
+
 MatchTableAbstract::handle_iterator
 MatchTableAbstract::handles_begin() const {
   auto lock = lock_read();
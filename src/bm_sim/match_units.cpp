@@ -676,6 +676,20 @@ MatchUnitAbstract_::valid_handle_(internal_handle_t handle) const {
   return handles.valid_handle(handle);
 }
 
+// default implementation
+bool
+MatchUnitAbstract_::get_cache_stats(LookupCacheStats *stats) const {
+  (void) stats;
+  return false;
+}
+
+// default implementation
+bool
+MatchUnitAbstract_::set_cache_size(size_t size) {
+  (void) size;
+  return false;
+}
+
 bool
 MatchUnitAbstract_::valid_handle(entry_handle_t handle) const {
   return this->valid_handle_(HANDLE_INTERNAL(handle));
@@ -721,6 +735,7 @@ MatchUnitAbstract_::set_entry_ttl(entry_handle_t handle, unsigned int ttl_ms) {
   // reset timestamp so that entries are not aged right away even if they have
   // not been hit in a while (i.e. timeout starts now)
   meta.ts.set(Packet::clock::now());
+  if (record_ttl_updates) ttl_updates.push_back(handle);
   return MatchErrorCode::SUCCESS;
 }
 
@@ -740,6 +755,37 @@ MatchUnitAbstract_::sweep_entries(std::vector<entry_handle_t> *entries) const {
   }
 }
 
+void
+MatchUnitAbstract_::get_ttl_updates(std::vector<entry_handle_t> *entries,
+                                    bool all) {
+  record_ttl_updates = true;
+  if (all) {
+    ttl_updates.clear();
+    for (auto it = handles.begin(); it != handles.end(); ++it) {
+      const EntryMeta &meta = entry_meta[*it];
+      if (meta.timeout_ms > 0)
+        entries->push_back(HANDLE_SET(meta.version, *it));
+    }
+    return;
+  }
+  entries->insert(entries->end(), ttl_updates.begin(), ttl_updates.end());
+  ttl_updates.clear();
+}
+
+void
+MatchUnitAbstract_::get_expiry_times(const entry_handle_t *handles, size_t n,
+                                     uint64_t *expiry_times_ms) const {
+  for (size_t i = 0; i < n; i++) {
+    const internal_handle_t handle_ = HANDLE_INTERNAL(handles[i]);
+    expiry_times_ms[i] = 0;
+    if (!this->valid_handle_(handle_)) continue;
+    const EntryMeta &meta = entry_meta[handle_];
+    if (meta.version != HANDLE_VERSION(handles[i]) || meta.timeout_ms == 0)
+      continue;
+    expiry_times_ms[i] = meta.ts.get_ms() + meta.timeout_ms;
+  }
+}
+
 void
 MatchUnitAbstract_::dump_key_params(
     std::ostream *out, const std::vector<MatchKeyParam> &params,
@@ -809,6 +855,9 @@ MatchUnitAbstract<V>::add_entry(const std::vector<MatchKeyParam> &match_key,
   EntryMeta &meta = entry_meta[HANDLE_INTERNAL(*handle)];
   meta.reset();
   meta.version = HANDLE_VERSION(*handle);
+  // the TTL of the previous entry with the same internal handle is kept
+  if (meta.timeout_ms > 0 && record_ttl_updates)
+    ttl_updates.push_back(*handle);
   return rc;
 }
 
@@ -873,6 +922,7 @@ MatchUnitAbstract<V>::reset_state() {
   this->num_entries = 0;
   this->handles.clear();
   this->entry_meta = std::vector<EntryMeta>(size);
+  this->ttl_updates.clear();
   reset_state_();
 }
 
@@ -1079,6 +1129,18 @@ MatchUnitGeneric<K, V>::reset_state_() {
   entries = std::vector<Entry>(this->size);
 }
 
+template <typename K, typename V>
+bool
+MatchUnitGeneric<K, V>::get_cache_stats(LookupCacheStats *stats) const {
+  return lookup_structure->get_cache_stats(stats);
+}
+
+template <typename K, typename V>
+bool
+MatchUnitGeneric<K, V>::set_cache_size(size_t size) {
+  return lookup_structure->set_cache_size(size);
+}
+
 namespace {
 
 void serialize_key(const ExactMatchKey &key, std::ostream *out) {
@@ -1160,6 +1222,8 @@ MatchUnitGeneric<K, V>::deserialize_(std::istream *in, const P4Objects &objs) {
     meta.reset();
     meta.version = version;
     (*in) >> meta.timeout_ms;
+    if (meta.timeout_ms > 0 && this->record_ttl_updates)
+      this->ttl_updates.push_back(HANDLE_SET(version, handle_));
     // meta.counter.deserialize(in);
   }
   if (this->direct_meters) this->direct_meters->deserialize(in);
@@ -19,6 +19,7 @@
  */
 
 #include <bm/bm_sim/packet.h>
+#include <bm/bm_sim/packet_pool.h>
 #include <bm/bm_sim/phv.h>
 
 #include <algorithm>  // for swap
@@ -79,7 +80,9 @@ CopyIdGenerator::reset(packet_id_t packet_id) {
 
 void
 Packet::update_signature(uint64_t seed) {
-  signature = XXH64(buffer.start(), buffer.get_data_size(), seed);
+  // const access, so that the data of a clone is not copied
+  const PacketBuffer &data = buffer;
+  signature = XXH64(data.start(), data.get_data_size(), seed);
 }
 
 void
@@ -92,11 +95,18 @@ Packet::set_ingress_ts() {
 Packet::Packet(cxt_id_t cxt_id, port_t ingress_port, packet_id_t id,
                copy_id_t copy_id, int ingress_length, PacketBuffer &&buffer,
                PHVSourceIface *phv_source)
+    : Packet(cxt_id, ingress_port, id, copy_id, ingress_length,
+             std::move(buffer), phv_source, 0) {
+  update_signature();
+}
+
+Packet::Packet(cxt_id_t cxt_id, port_t ingress_port, packet_id_t id,
+               copy_id_t copy_id, int ingress_length, PacketBuffer &&buffer,
+               PHVSourceIface *phv_source, uint64_t signature)
     : cxt_id(cxt_id), ingress_port(ingress_port), packet_id(id),
-      copy_id(copy_id), ingress_length(ingress_length),
+      copy_id(copy_id), ingress_length(ingress_length), signature(signature),
       buffer(std::move(buffer)), phv_source(phv_source) {
   assert(phv_source);
-  update_signature();
   set_ingress_ts();
   phv = phv_source->get(cxt_id);
   phv->set_packet_id(packet_id, copy_id);
@@ -148,12 +158,21 @@ Packet::change_context(cxt_id_t new_cxt) {
    }
 */
 
+// the clone shares the packet data, including the bytes removed by the parser
+void
+Packet::copy_parsed_bytes(const Packet &src) {
+  has_parsed_bytes = src.has_parsed_bytes;
+  parsed_bytes = src.parsed_bytes;
+  parsed_data_size = src.parsed_data_size;
+}
+
 Packet
 Packet::clone_with_phv() const {
   copy_id_t new_copy_id = copy_id_gen->add_one(packet_id);
   Packet pkt(cxt_id, ingress_port, packet_id, new_copy_id, ingress_length,
-             buffer.clone(buffer.get_data_size()), phv_source);
+             buffer.clone_shared(), phv_source, signature);
   pkt.phv->copy_headers(*phv);
+  pkt.copy_parsed_bytes(*this);
   // return std::move(pkt);
   // Enable NRVO
   return pkt;
@@ -168,10 +187,11 @@ Packet
 Packet::clone_with_phv_reset_metadata() const {
   copy_id_t new_copy_id = copy_id_gen->add_one(packet_id);
   Packet pkt(cxt_id, ingress_port, packet_id, new_copy_id, ingress_length,
-             buffer.clone(buffer.get_data_size()), phv_source);
+             buffer.clone_shared(), phv_source, signature);
   // TODO(antonin): optimize this
   pkt.phv->copy_headers(*phv);
   pkt.phv->reset_metadata();
+  pkt.copy_parsed_bytes(*this);
   // return std::move(pkt);
   // Enable NRVO
   return pkt;
@@ -186,7 +206,7 @@ Packet
 Packet::clone_choose_context(cxt_id_t new_cxt) const {
   copy_id_t new_copy_id = copy_id_gen->add_one(packet_id);
   Packet pkt(new_cxt, ingress_port, packet_id, new_copy_id, ingress_length,
-             buffer.clone(buffer.get_data_size()), phv_source);
+             buffer.clone_shared(), phv_source, signature);
   // return std::move(pkt);
   // Enable NRVO
   return pkt;
@@ -216,6 +236,9 @@ Packet::Packet(Packet &&other) noexcept
       copy_id(other.copy_id), ingress_length(other.ingress_length),
       flags(other.flags),
       signature(other.signature), payload_size(other.payload_size),
+      has_parsed_bytes(other.has_parsed_bytes),
+      parsed_bytes(other.parsed_bytes),
+      parsed_data_size(other.parsed_data_size),
       ingress_ts(other.ingress_ts), ingress_ts_ms(other.ingress_ts_ms),
   phv_source(other.phv_source), registers(other.registers) {
   buffer = std::move(other.buffer);
@@ -233,6 +256,9 @@ Packet::operator=(Packet &&other) noexcept {
   flags = other.flags;
   signature = other.signature;
   payload_size = other.payload_size;
+  has_parsed_bytes = other.has_parsed_bytes;
+  parsed_bytes = other.parsed_bytes;
+  parsed_data_size = other.parsed_data_size;
   ingress_ts = other.ingress_ts;
   ingress_ts_ms = other.ingress_ts_ms;
   phv_source = other.phv_source;
@@ -244,6 +270,19 @@ Packet::operator=(Packet &&other) noexcept {
   return *this;
 }
 
+static_assert(sizeof(Packet) <= PacketPool::max_packet_size,
+              "Packet instances are too large for the PacketPool");
+
+void *
+Packet::operator new(size_t size) {
+  return PacketPool::allocate_packet(size);
+}
+
+void
+Packet::operator delete(void *p) {
+  PacketPool::release_packet(p, sizeof(Packet));
+}
+
 Packet
 Packet::make_new(PHVSourceIface *phv_source) {
   return Packet(0, 0, 0, 0, 0, PacketBuffer(), phv_source);
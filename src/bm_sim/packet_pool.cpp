@@ -0,0 +1,304 @@
+/* Copyright 2013-present Barefoot Networks, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <bm/bm_sim/packet_pool.h>
+
+#include <algorithm>  // for std::min
+#include <array>
+#include <atomic>
+#include <mutex>
+#include <new>
+#include <vector>
+
+namespace bm {
+
+constexpr size_t PacketPool::max_buffer_size;
+constexpr size_t PacketPool::max_packet_size;
+
+namespace {
+
+// buffer size classes are 256, 512, ..., max_buffer_size
+constexpr size_t min_buffer_size = 256;
+constexpr size_t nb_buffer_pools = 7;
+static_assert((min_buffer_size << (nb_buffer_pools - 1)) ==
+              PacketPool::max_buffer_size, "Invalid buffer size classes");
+constexpr size_t packet_pool_idx = nb_buffer_pools;
+constexpr size_t nb_pools = nb_buffer_pools + 1;
+
+// number of blocks moved at once between a thread cache and the depot
+constexpr size_t batch_size = 32;
+// maximum number of free blocks cached by a thread, per size class
+constexpr size_t max_cached_blocks = 2 * batch_size;
+// maximum number of free blocks in the depot, per size class; extra blocks are
+// returned to the heap allocator
+constexpr size_t max_depot_blocks = 64 * batch_size;
+
+// Only modified by the thread which owns the cache, read by get_stats(): there
+// is no need for an atomic read-modify-write.
+class Counter {
+ public:
+  void increment() {
+    value.store(value.load(std::memory_order_relaxed) + 1,
+                std::memory_order_relaxed);
+  }
+
+  uint64_t get() const { return value.load(std::memory_order_relaxed); }
+
+ private:
+  std::atomic<uint64_t> value{0};
+};
+
+// free blocks of one size class cached by a thread, along with the hits and
+// misses of the thread for this size class
+struct Cache {
+  std::vector<void *> blocks{};
+  Counter hits{};
+  Counter misses{};
+};
+
+class BlockPool {
+ public:
+  explicit BlockPool(size_t block_size)
+      : block_size(block_size) { }
+
+  // cache is nullptr if the calling thread's caches have already been
+  // destroyed (thread exit)
+  void *allocate(Cache *cache) {
+    if (!cache) {
+      uncached_misses.fetch_add(1, std::memory_order_relaxed);
+      return ::operator new(block_size);
+    }
+    auto &blocks = cache->blocks;
+    if (blocks.empty()) refill(&blocks);
+    if (blocks.empty()) {
+      cache->misses.increment();
+      return ::operator new(block_size);
+    }
+    cache->hits.increment();
+    void *block = blocks.back();
+    blocks.pop_back();
+    return block;
+  }
+
+  void release(Cache *cache, void *block) {
+    if (!cache) {
+      std::unique_lock<std::mutex> lock(mutex);
+      if (depot.size() < max_depot_blocks) {
+        depot.push_back(block);
+        return;
+      }
+      lock.unlock();
+      ::operator delete(block);
+      return;
+    }
+    cache->blocks.push_back(block);
+    if (cache->blocks.size() > max_cached_blocks)
+      flush(&cache->blocks, batch_size);
+  }
+
+  // moves the last nb_blocks blocks of the cache to the depot
+  void flush(std::vector<void *> *cache, size_t nb_blocks) {
+    std::unique_lock<std::mutex> lock(mutex);
+    for (; nb_blocks > 0; nb_blocks--) {
+      void *block = cache->back();
+      cache->pop_back();
+      if (depot.size() < max_depot_blocks)
+        depot.push_back(block);
+      else
+        ::operator delete(block);
+    }
+  }
+
+  // misses of the threads whose caches have already been destroyed
+  uint64_t get_uncached_misses() const {
+    return uncached_misses.load(std::memory_order_relaxed);
+  }
+
+ private:
+  void refill(std::vector<void *> *cache) {
+    std::unique_lock<std::mutex> lock(mutex);
+    size_t nb_blocks = std::min(batch_size, depot.size());
+    cache->insert(cache->end(), depot.end() - nb_blocks, depot.end());
+    depot.resize(depot.size() - nb_blocks);
+  }
+
+  const size_t block_size;
+  std::mutex mutex{};
+  std::vector<void *> depot{};
+  std::atomic<uint64_t> uncached_misses{0};
+};
+
+// Never destroyed: packets may still be released by some threads while static
+// objects are being destroyed.
+BlockPool **
+get_pools() {
+  static BlockPool **pools = [] {
+    auto pools_ = new BlockPool *[nb_pools];
+    for (size_t i = 0; i < nb_buffer_pools; i++)
+      pools_[i] = new BlockPool(min_buffer_size << i);
+    pools_[packet_pool_idx] = new BlockPool(PacketPool::max_packet_size);
+    return pools_;
+  }();
+  return pools;
+}
+
+// The thread caches are only constructed on first use; once they have been
+// destroyed (the thread is exiting), get_cache() returns nullptr and blocks are
+// exchanged with the depot directly.
+class ThreadCaches;
+thread_local ThreadCaches *current_caches = nullptr;
+thread_local bool caches_destroyed = false;
+
+// The hits and misses are counted per thread cache and only summed when the
+// stats are read. The caches register themselves here; the counts of the
+// caches which are destroyed are accumulated in retired. Never destroyed, for
+// the same reason as the pools.
+struct CacheRegistry {
+  std::mutex mutex{};
+  std::vector<const ThreadCaches *> caches{};
+  std::array<PacketPool::Stats, nb_pools> retired{};
+};
+
+CacheRegistry *
+get_registry() {
+  static CacheRegistry *registry = new CacheRegistry();
+  return registry;
+}
+
+class ThreadCaches {
+ public:
+  ThreadCaches() {
+    for (auto &cache : caches) cache.blocks.reserve(max_cached_blocks + 1);
+    current_caches = this;
+    auto registry = get_registry();
+    std::unique_lock<std::mutex> lock(registry->mutex);
+    registry->caches.push_back(this);
+  }
+
+  ~ThreadCaches() {
+    current_caches = nullptr;
+    caches_destroyed = true;
+    auto pools = get_pools();
+    for (size_t i = 0; i < nb_pools; i++) {
+      auto &blocks = caches[i].blocks;
+      if (!blocks.empty()) pools[i]->flush(&blocks, blocks.size());
+    }
+    auto registry = get_registry();
+    std::unique_lock<std::mutex> lock(registry->mutex);
+    auto &registered = registry->caches;
+    registered.erase(std::find(registered.begin(), registered.end(), this));
+    for (size_t i = 0; i < nb_pools; i++) {
+      auto stats = get_stats(i);
+      registry->retired[i].hits += stats.hits;
+      registry->retired[i].misses += stats.misses;
+    }
+  }
+
+  Cache *get(size_t pool_idx) { return &caches[pool_idx]; }
+
+  PacketPool::Stats get_stats(size_t pool_idx) const {
+    const auto &cache = caches[pool_idx];
+    return {cache.hits.get(), cache.misses.get()};
+  }
+
+ private:
+  std::array<Cache, nb_pools> caches{};
+};
+
+PacketPool::Stats
+get_pool_stats(size_t pool_idx) {
+  auto registry = get_registry();
+  std::unique_lock<std::mutex> lock(registry->mutex);
+  auto stats = registry->retired[pool_idx];
+  for (auto caches : registry->caches) {
+    auto cache_stats = caches->get_stats(pool_idx);
+    stats.hits += cache_stats.hits;
+    stats.misses += cache_stats.misses;
+  }
+  stats.misses += get_pools()[pool_idx]->get_uncached_misses();
+  return stats;
+}
+
+Cache *
+get_cache(size_t pool_idx) {
+  if (current_caches) return current_caches->get(pool_idx);
+  if (caches_destroyed) return nullptr;
+  static thread_local ThreadCaches caches;
+  return caches.get(pool_idx);
+}
+
+size_t
+buffer_pool_idx(size_t size) {
+  size_t idx = 0;
+  while ((min_buffer_size << idx) < size) idx++;
+  return idx;
+}
+
+std::atomic<uint64_t> large_buffers{0};
+
+}  // namespace
+
+char *
+PacketPool::allocate_buffer(size_t size) {
+  if (size > max_buffer_size) {
+    large_buffers.fetch_add(1, std::memory_order_relaxed);
+    return static_cast<char *>(::operator new(size));
+  }
+  auto idx = buffer_pool_idx(size);
+  return static_cast<char *>(get_pools()[idx]->allocate(get_cache(idx)));
+}
+
+void
+PacketPool::release_buffer(char *buffer, size_t size) {
+  if (size > max_buffer_size) {
+    ::operator delete(buffer);
+    return;
+  }
+  auto idx = buffer_pool_idx(size);
+  get_pools()[idx]->release(get_cache(idx), buffer);
+}
+
+void *
+PacketPool::allocate_packet(size_t size) {
+  if (size > max_packet_size) return ::operator new(size);
+  return get_pools()[packet_pool_idx]->allocate(get_cache(packet_pool_idx));
+}
+
+void
+PacketPool::release_packet(void *packet, size_t size) {
+  if (size > max_packet_size) {
+    ::operator delete(packet);
+    return;
+  }
+  get_pools()[packet_pool_idx]->release(get_cache(packet_pool_idx), packet);
+}
+
+PacketPool::Stats
+PacketPool::get_buffer_stats() {
+  Stats stats{0, large_buffers.load(std::memory_order_relaxed)};
+  for (size_t i = 0; i < nb_buffer_pools; i++) {
+    auto pool_stats = get_pool_stats(i);
+    stats.hits += pool_stats.hits;
+    stats.misses += pool_stats.misses;
+  }
+  return stats;
+}
+
+PacketPool::Stats
+PacketPool::get_packet_stats() {
+  return get_pool_stats(packet_pool_idx);
+}
+
+}  // namespace bm
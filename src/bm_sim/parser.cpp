@@ -25,6 +25,7 @@
 #include <bm/bm_sim/logger.h>
 #include <bm/bm_sim/event_logger.h>
 #include <bm/bm_sim/expressions.h>
+#include <bm/bm_sim/flex_version.h>
 #include <bm/bm_sim/phv.h>
 #include <bm/bm_sim/actions.h>
 #include <bm/bm_sim/checksums.h>
@@ -247,6 +248,7 @@ void extract_fixed(Header *hdr,
   BMELOG(parser_extract, *pkt, hdr->get_id());
   check_enough_data_for_extract(*pkt, *bytes_parsed, *hdr);
   hdr->extract(data, *phv);
+  hdr->set_packet_offset(static_cast<int>(*bytes_parsed));
   *bytes_parsed += hdr->get_nbytes_packet();
 }
 
@@ -399,6 +401,25 @@ struct ParserOpExtractUnionStack : ParserOp {
   }
 };
 
+// FlexCore: used by the flex_start state to tag each packet with its version
+struct ParserOpSetFlexVersion : ParserOp {
+  field_t dst;
+  FlexVersion *version;
+
+  ParserOpSetFlexVersion(header_id_t header, int offset, FlexVersion *version)
+      : dst({header, offset}), version(version) { }
+
+  void operator()(Packet *pkt, const char *data,
+                  size_t *bytes_parsed) const override {
+    (void) data; (void) bytes_parsed;
+    auto phv = pkt->get_phv();
+    auto &f_dst = phv->get_field(dst.header, dst.offset);
+    f_dst.set(version->assign(pkt->get_ingress_ts_ms()));
+    BMLOG_DEBUG_PKT(*pkt, "Parser set: setting field '{}' to flex version {}",
+                    phv->get_field_name(dst.header, dst.offset), f_dst);
+  }
+};
+
 struct ParserOpVerify : ParserOp {
   BoolExpression condition;
   ArithExpression error_expr;
@@ -970,6 +991,13 @@ ParseState::add_set_from_expression(header_id_t dst_header, int dst_offset,
       new ParserOpSet<ArithExpression>(dst_header, dst_offset, expr));
 }
 
+void
+ParseState::add_set_from_flex_version(header_id_t dst_header, int dst_offset,
+                                      FlexVersion *version) {
+  parser_ops.emplace_back(
+      new ParserOpSetFlexVersion(dst_header, dst_offset, version));
+}
+
 void
 ParseState::add_advance_from_data(const Data &shift_bytes) {
   parser_ops.emplace_back(new ParserOpAdvance<Data>(shift_bytes));
@@ -1141,7 +1169,7 @@ Parser::add_checksum(const Checksum *checksum) {
 void
 Parser::verify_checksums(Packet *pkt) const {
   for (auto checksum : checksums) {
-    auto is_correct = checksum->verify(*pkt);
+    auto is_correct = checksum->verify_and_record(pkt);
     if (!is_correct) {
       pkt->set_checksum_error(true);
       BMLOG_ERROR_PKT(*pkt, "Checksum '{}' is not correct",
@@ -1163,7 +1191,9 @@ Parser::parse(Packet *pkt) const {
   // Core::NoError and the checksum_error to false
   pkt->set_error_code(no_error);
   pkt->set_checksum_error(false);
-  const char *data = pkt->data();
+  // the data is only read, so it does not need to be copied if it is shared
+  // with clones of the packet
+  const char *data = static_cast<const Packet *>(pkt)->data();
   if (!init_state) return;
   const ParseState *next_state = init_state;
   size_t bytes_parsed = 0;
@@ -1181,7 +1211,7 @@ Parser::parse(Packet *pkt) const {
     }
     BMLOG_TRACE_PKT(*pkt, "Bytes parsed: {}", bytes_parsed);
   }
-  pkt->remove(bytes_parsed);
+  pkt->remove_parsed(bytes_parsed);
   verify_checksums(pkt);
   BMELOG(parser_done, *pkt, *this);
   DEBUGGER_NOTIFY_CTR(
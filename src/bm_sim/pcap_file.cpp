@@ -16,6 +16,7 @@
 #include <bm/bm_sim/pcap_file.h>
 #include <bm/bm_sim/logger.h>
 
+#include <algorithm>  // std::find
 #include <cassert>
 #include <chrono>
 #include <thread>
@@ -173,7 +174,10 @@ PcapFilesReader::PcapFilesReader(bool respectTiming,
   : nonEmptyFiles(0),
     wait_time_in_seconds(wait_time_in_seconds),
     respectTiming(respectTiming),
-    started(false) {
+    started(false),
+    cookie(nullptr),
+    burstCookie(nullptr),
+    maxBurst(1) {
   timerclear(&zero);
 }
 
@@ -189,6 +193,7 @@ void
 PcapFilesReader::scan() {
   while (true) {
     if (nonEmptyFiles == 0) {
+      flushBurst();
       BMLOG_DEBUG("Pcap reader: end of all input files");
       // notifyAllEnd();
       return;
@@ -248,7 +253,13 @@ void PcapFilesReader::timerFired() {
   auto file = files.at(scheduledIndex).get();
   std::unique_ptr<PcapPacket> packet = file->current();
 
-  if (handler != nullptr)
+  if (burstHandler != nullptr) {
+    auto &data = burstData.at(burst.size());
+    data.assign(packet->getData(), packet->getData() + packet->getLength());
+    burst.push_back({static_cast<int>(packet->getPort()), data.data(),
+                     static_cast<int>(packet->getLength())});
+    if (burst.size() == maxBurst) flushBurst();
+  } else if (handler != nullptr)
     handler(packet->getPort(), packet->getData(), packet->getLength(), cookie);
   else
     pcap_fatal_error("No packet handler set when sending packet");
@@ -270,6 +281,8 @@ void PcapFilesReader::schedulePacket(unsigned index, const struct timeval *at) {
     auto duration = std::chrono::seconds(at->tv_sec) +
       std::chrono::microseconds(at->tv_usec);
     BMLOG_DEBUG("Pcap reader: sleep for {}", duration.count());
+    // do not hold packets which are already due
+    flushBurst();
     std::this_thread::sleep_for(duration);
     timerFired();
   }
@@ -333,6 +346,29 @@ PcapFilesReader::set_packet_handler(const PacketHandler &hnd, void *ck) {
   return ReturnCode::SUCCESS;
 }
 
+PacketDispatcherIface::ReturnCode
+PcapFilesReader::set_burst_handler(const BurstHandler &hnd, size_t max_burst,
+                                   void *ck) {
+  assert(hnd);
+  assert(max_burst > 0);
+
+  if (started)
+    pcap_fatal_error("Cannot set burst handler once the reader is started");
+  burstHandler = hnd;
+  burstCookie = ck;
+  maxBurst = max_burst;
+  burstData.resize(max_burst);
+  burst.reserve(max_burst);
+  return ReturnCode::SUCCESS;
+}
+
+void
+PcapFilesReader::flushBurst() {
+  if (burst.empty()) return;
+  burstHandler(burst.data(), burst.size(), burstCookie);
+  burst.clear();
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 
 PcapFileOut::PcapFileOut(unsigned port, std::string filename)
@@ -348,7 +384,7 @@ PcapFileOut::PcapFileOut(unsigned port, std::string filename)
 }
 
 void
-PcapFileOut::writePacket(const char *data, unsigned length) {
+PcapFileOut::writePacket(const char *data, unsigned length, bool flush) {
   struct pcap_pkthdr pkt_header;
   memset(&pkt_header, 0, sizeof(pkt_header));
   gettimeofday(&pkt_header.ts, NULL);
@@ -356,6 +392,11 @@ PcapFileOut::writePacket(const char *data, unsigned length) {
   pkt_header.len = length;
   pcap_dump(reinterpret_cast<unsigned char *>(dumper), &pkt_header,
             reinterpret_cast<const unsigned char *>(data));
+  if (flush) pcap_dump_flush(dumper);
+}
+
+void
+PcapFileOut::flush() {
   pcap_dump_flush(dumper);
 }
 
@@ -391,4 +432,19 @@ PcapFilesWriter::send_packet(int port_num, const char *buffer, int len) {
   file->writePacket(buffer, len);
 }
 
+void
+PcapFilesWriter::send_burst(const PacketDispatcherIface::BurstPacket *packets,
+                            size_t count) {
+  std::vector<PcapFileOut *> written;
+  for (size_t i = 0; i < count; i++) {
+    auto it = files.find(packets[i].port_num);
+    if (it == files.end()) continue;  // see send_packet
+    auto file = it->second.get();
+    file->writePacket(packets[i].buffer, packets[i].len, false);
+    if (std::find(written.begin(), written.end(), file) == written.end())
+      written.push_back(file);
+  }
+  for (auto file : written) file->flush();
+}
+
 }  // namespace bm
@@ -44,6 +44,7 @@ PHV::reset() {
   for (auto &h : headers) {
     h.mark_invalid();
     if (h.is_VL_header()) h.reset_VL_header();
+    h.packet_offset = -1;
   }
 }
 
@@ -82,8 +83,19 @@ PHV::copy_headers(const PHV &src) {
   for (size_t h = 0; h < headers.size(); h++) {
     headers[h].valid = src.headers[h].valid;
     headers[h].metadata = src.headers[h].metadata;
-    if (headers[h].valid || headers[h].metadata)
+    if (headers[h].valid || headers[h].metadata) {
       headers[h].copy_fields(src.headers[h]);
+      // the clone shares the packet data (see Packet::clone_with_phv())
+      headers[h].modified = src.headers[h].modified;
+      headers[h].packet_offset = src.headers[h].packet_offset;
+      // needed to update checksums incrementally (see CalcBasedChecksum)
+      if (headers[h].packet_offset >= 0) {
+        headers[h].packet_image = src.headers[h].packet_image;
+        headers[h].verified_checksum = src.headers[h].verified_checksum;
+      }
+    } else {
+      headers[h].packet_offset = -1;
+    }
   }
   for (size_t hs = 0; hs < header_stacks.size(); hs++) {
     header_stacks[hs].next = src.header_stacks[hs].next;
@@ -35,13 +35,21 @@ Pipeline::apply(Packet *pkt) {
       Debugger::PacketId::make(pkt->get_packet_id(), pkt->get_copy_id()),
       DBG_CTR_CONTROL | get_id());
   BMLOG_DEBUG_PKT(*pkt, "Pipeline '{}': start", get_name());
-  const ControlFlowNode *node = first_node;
-  while (node) {
-    if (pkt->is_marked_for_exit()) {
-      BMLOG_DEBUG_PKT(*pkt, "Packet is marked for exit, interrupting pipeline");
-      break;
-    }
-    node = (*node)(pkt);
+  auto exit_requested = [pkt]() {
+    if (!pkt->is_marked_for_exit()) return false;
+    BMLOG_DEBUG_PKT(*pkt, "Packet is marked for exit, interrupting pipeline");
+    return true;
+  };
+  if (cfg) {
+    // the whole pipeline is applied with the same version of the graph
+    const auto graph = cfg->read();
+    const ControlFlowNode *node = graph->get_first_node(cfg_slot);
+    while (node && !exit_requested())
+      node = graph->get_next_node(node, node->apply_edge(pkt));
+  } else {
+    const ControlFlowNode *node = first_node;
+    while (node && !exit_requested())
+      node = (*node)(pkt);
   }
   BMELOG(pipeline_done, *pkt, *this);
   DEBUGGER_NOTIFY_CTR(
@@ -0,0 +1,108 @@
+/* Copyright 2013-present Barefoot Networks, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <bm/bm_sim/resilient_group_selection.h>
+#include <bm/bm_sim/_assert.h>
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+namespace bm {
+
+constexpr size_t ResilientGroupSelection::default_nb_buckets;
+
+namespace {
+
+using MemberBuckets = std::unordered_map<ResilientGroupSelection::mbr_hdl_t,
+                                         std::vector<size_t> >;
+
+bool fewer_buckets(const MemberBuckets::value_type &a,
+                   const MemberBuckets::value_type &b) {
+  return a.second.size() < b.second.size();
+}
+
+}  // namespace
+
+ResilientGroupSelection::ResilientGroupSelection(size_t nb_buckets)
+    : nb_buckets(nb_buckets) {
+  _BM_ASSERT(nb_buckets > 0);
+}
+
+void
+ResilientGroupSelection::add_member_to_group(grp_hdl_t grp, mbr_hdl_t mbr) {
+  if (grp >= groups.size()) groups.resize(grp + 1);
+  auto &group = groups[grp];
+  _BM_ASSERT(group.member_buckets.count(mbr) == 0);
+  auto &buckets = group.member_buckets[mbr];
+
+  if (group.member_buckets.size() == 1) {
+    group.buckets.assign(nb_buckets, mbr);
+    buckets.resize(nb_buckets);
+    for (size_t b = 0; b < nb_buckets; b++) buckets[b] = b;
+    return;
+  }
+
+  // the new member is the one with the fewest buckets (none), so it is never
+  // picked as a donor
+  const size_t share = nb_buckets / group.member_buckets.size();
+  for (size_t i = 0; i < share; i++) {
+    auto donor = std::max_element(group.member_buckets.begin(),
+                                  group.member_buckets.end(), fewer_buckets);
+    const size_t b = donor->second.back();
+    donor->second.pop_back();
+    group.buckets[b] = mbr;
+    buckets.push_back(b);
+  }
+}
+
+void
+ResilientGroupSelection::remove_member_from_group(grp_hdl_t grp,
+                                                  mbr_hdl_t mbr) {
+  _BM_ASSERT(grp < groups.size());
+  auto &group = groups[grp];
+  auto it = group.member_buckets.find(mbr);
+  _BM_ASSERT(it != group.member_buckets.end());
+  const auto freed = std::move(it->second);
+  group.member_buckets.erase(it);
+
+  if (group.member_buckets.empty()) {
+    group.buckets.clear();
+    return;
+  }
+
+  for (const auto b : freed) {
+    auto recipient = std::min_element(group.member_buckets.begin(),
+                                      group.member_buckets.end(),
+                                      fewer_buckets);
+    recipient->second.push_back(b);
+    group.buckets[b] = recipient->first;
+  }
+}
+
+void
+ResilientGroupSelection::reset() {
+  groups.clear();
+}
+
+size_t
+ResilientGroupSelection::get_nb_buckets(grp_hdl_t grp, mbr_hdl_t mbr) const {
+  if (grp >= groups.size()) return 0;
+  const auto &member_buckets = groups[grp].member_buckets;
+  const auto it = member_buckets.find(mbr);
+  return (it == member_buckets.end()) ? 0 : it->second.size();
+}
+
+}  // namespace bm
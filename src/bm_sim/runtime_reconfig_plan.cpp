@@ -0,0 +1,752 @@
+#include <bm/bm_sim/runtime_reconfig_plan.h>
+#include <bm/bm_sim/P4Objects.h>
+#include <bm/bm_sim/logger.h>
+#include <bm/bm_sim/_assert.h>
+
+#include <algorithm>
+#include <cctype>
+#include <iomanip>
+#include <istream>
+#include <set>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace bm {
+
+namespace {
+
+using Type = ReconfigStep::Type;
+
+// helper function for FlexCore
+// Returns true if the id has one of the 3-letter prefixes followed by '_'
+bool
+split_id(const std::string &id, std::string *prefix, std::string *name) {
+  if (id.size() < 4 || id[3] != '_') return false;
+  *prefix = id.substr(0, 3);
+  *name = id.substr(4);
+  return true;
+}
+
+// helper function for FlexCore
+bool
+is_positive_number(const std::string &s) {
+  if (s.empty() || s.size() > 9) return false;
+  if (!std::all_of(s.begin(), s.end(), ::isdigit)) return false;
+  return std::stoi(s) > 0;
+}
+
+// helper function for FlexCore
+// Returns true if s is a number a flex switch can be scheduled at
+bool
+is_flex_threshold(const std::string &s) {
+  if (s.empty() || s.size() > 19) return false;
+  if (!std::all_of(s.begin(), s.end(), ::isdigit)) return false;
+  return std::stoull(s) <= FlexVersion::max_threshold;
+}
+
+// helper function for FlexCore
+// It will return RuntimeReconfigErrorCode::SUCCESS, if success
+// Otherwise, return RuntimeReconfigErrorCode::UNFOUND_ID_ERROR if the id is unfound, or return RuntimeReconfigErrorCode::PREFIX_ERROR if the prefix is wrong
+RuntimeReconfigErrorCode
+convert_id_to_name(const std::unordered_map<std::string, std::string> &id2newNodeName,
+    const std::string &in, std::string *out) {
+  if (in == "null") {
+    *out = "";
+    return RuntimeReconfigErrorCode::SUCCESS;
+  }
+  std::string prefix, actual_name;
+  if (!split_id(in, &prefix, &actual_name)) {
+    BMLOG_ERROR("Error: id {} has no prefix", in);
+    return RuntimeReconfigErrorCode::PREFIX_ERROR;
+  }
+  if (prefix == "new" || prefix == "flx") {
+    auto it = id2newNodeName.find(in);
+    if (it == id2newNodeName.end()) {
+      BMLOG_ERROR("Error: cannot find the id {} from id2newNodeName", in);
+      return RuntimeReconfigErrorCode::UNFOUND_ID_ERROR;
+    }
+    *out = it->second;
+  } else if (prefix == "old") {
+    *out = actual_name;
+  } else {
+    BMLOG_ERROR("Error: prefix {} has no match", prefix);
+    return RuntimeReconfigErrorCode::PREFIX_ERROR;
+  }
+  return RuntimeReconfigErrorCode::SUCCESS;
+}
+
+// FlexCore: symbolic execution of a plan against the live objects. Objects
+// are never modified, we only keep track of which ids get declared and which
+// live objects get deleted by the previous steps.
+class PlanValidator {
+ public:
+  PlanValidator(const P4Objects &live, const P4Objects *new_objects,
+                const std::unordered_map<std::string, std::string> &id2newNodeName)
+      : live(live), new_objects(new_objects) {
+    // ids declared by previous plans refer to objects which are now live
+    for (const auto &p : id2newNodeName) {
+      Kind kind;
+      if (p.first.compare(0, 3, "flx") == 0)
+        kind = Kind::FLEX;
+      else if (live.get_abstract_match_table_rt(p.second))
+        kind = Kind::TABLE;
+      else if (live.get_conditional_rt(p.second))
+        kind = Kind::CONDITIONAL;
+      else if (live.get_register_array_rt(p.second))
+        kind = Kind::REGISTER_ARRAY;
+      else
+        continue;
+      ids[p.first] = {kind, "", p.second};
+    }
+  }
+
+  RuntimeReconfigErrorCode check(const ReconfigStep &step);
+
+ private:
+  enum class Kind { TABLE, CONDITIONAL, FLEX, REGISTER_ARRAY };
+
+  struct SymbolicId {
+    Kind kind;
+    // name of the object in the new P4Objects, if inserted by this plan
+    std::string new_name;
+    // name of the object in the live P4Objects, if inserted by a previous plan
+    std::string live_name;
+  };
+
+  bool live_exists(const std::string &name, bool found) const {
+    return found && removed.find(name) == removed.end();
+  }
+
+  RuntimeReconfigErrorCode check_pipeline(const ReconfigStep &step) const {
+    if (!live.get_pipeline_rt(step.pipeline)) {
+      BMLOG_ERROR("Error: line {}: unknown pipeline {}",
+                  step.line_no, step.pipeline);
+      return RuntimeReconfigErrorCode::UNFOUND_ID_ERROR;
+    }
+    return RuntimeReconfigErrorCode::SUCCESS;
+  }
+
+  RuntimeReconfigErrorCode declare(const std::string &id,
+                                   const char *expected_prefix,
+                                   Kind kind, std::string *actual_name);
+
+  RuntimeReconfigErrorCode resolve(const std::string &id,
+                                   const std::set<Kind> &kinds,
+                                   const SymbolicId **sym,
+                                   std::string *actual_name) const;
+
+  RuntimeReconfigErrorCode resolve_node(const std::string &id) const;
+
+  const P4Objects &live;
+  const P4Objects *new_objects;
+  std::unordered_map<std::string, SymbolicId> ids{};
+  std::set<std::string> removed{};
+  std::set<std::string> consumed{};
+};
+
+RuntimeReconfigErrorCode
+PlanValidator::declare(const std::string &id, const char *expected_prefix,
+                       Kind kind, std::string *actual_name) {
+  std::string prefix;
+  if (!split_id(id, &prefix, actual_name) || prefix != expected_prefix) {
+    BMLOG_ERROR("Error: inserted object should only have prefix '{}_', "
+                "but you enter {}", expected_prefix, id);
+    return RuntimeReconfigErrorCode::PREFIX_ERROR;
+  }
+  if (ids.find(id) != ids.end()) {
+    BMLOG_ERROR("Error: Duplicated id {} from id2newNodeName", id);
+    return RuntimeReconfigErrorCode::DUP_CHECK_ERROR;
+  }
+  ids[id] = {kind, *actual_name, ""};
+  return RuntimeReconfigErrorCode::SUCCESS;
+}
+
+RuntimeReconfigErrorCode
+PlanValidator::resolve(const std::string &id, const std::set<Kind> &kinds,
+                       const SymbolicId **sym,
+                       std::string *actual_name) const {
+  *sym = nullptr;
+  std::string prefix;
+  if (!split_id(id, &prefix, actual_name)) {
+    BMLOG_ERROR("Error: id {} has no prefix", id);
+    return RuntimeReconfigErrorCode::PREFIX_ERROR;
+  }
+  if (prefix == "new" || prefix == "flx") {
+    auto it = ids.find(id);
+    if (it == ids.end() || !kinds.count(it->second.kind) ||
+        (!it->second.live_name.empty() &&
+         removed.count(it->second.live_name))) {
+      BMLOG_ERROR("Error: cannot find the id {} from id2newNodeName", id);
+      return RuntimeReconfigErrorCode::UNFOUND_ID_ERROR;
+    }
+    *sym = &it->second;
+    return RuntimeReconfigErrorCode::SUCCESS;
+  } else if (prefix != "old") {
+    BMLOG_ERROR("Error: prefix {} has no match", prefix);
+    return RuntimeReconfigErrorCode::PREFIX_ERROR;
+  }
+  bool found = false;
+  if (kinds.count(Kind::TABLE))
+    found |= live.get_abstract_match_table_rt(*actual_name) != nullptr;
+  if (kinds.count(Kind::CONDITIONAL) || kinds.count(Kind::FLEX))
+    found |= live.get_conditional_rt(*actual_name) != nullptr;
+  if (kinds.count(Kind::REGISTER_ARRAY))
+    found |= live.get_register_array_rt(*actual_name) != nullptr;
+  if (!live_exists(*actual_name, found)) {
+    BMLOG_ERROR("Error: cannot find {} in the running program", *actual_name);
+    return RuntimeReconfigErrorCode::UNFOUND_ID_ERROR;
+  }
+  return RuntimeReconfigErrorCode::SUCCESS;
+}
+
+RuntimeReconfigErrorCode
+PlanValidator::resolve_node(const std::string &id) const {
+  if (id == "null") return RuntimeReconfigErrorCode::SUCCESS;
+  std::string prefix, actual_name;
+  if (split_id(id, &prefix, &actual_name) && prefix == "old") {
+    if (!live_exists(actual_name,
+                     live.get_control_node_rt(actual_name) != nullptr)) {
+      BMLOG_ERROR("Error: cannot find {} in the running program", actual_name);
+      return RuntimeReconfigErrorCode::UNFOUND_ID_ERROR;
+    }
+    return RuntimeReconfigErrorCode::SUCCESS;
+  }
+  const SymbolicId *sym;
+  return resolve(id, {Kind::TABLE, Kind::CONDITIONAL, Kind::FLEX},
+                 &sym, &actual_name);
+}
+
+RuntimeReconfigErrorCode
+PlanValidator::check(const ReconfigStep &step) {
+  RuntimeReconfigErrorCode rc = RuntimeReconfigErrorCode::SUCCESS;
+  const SymbolicId *sym = nullptr;
+  std::string actual_name;
+  switch (step.type) {
+    case Type::INSERT_TABLE:
+    case Type::INSERT_CONDITIONAL:
+      {
+        const bool is_table = step.type == Type::INSERT_TABLE;
+        rc = declare(step.ids[0], "new",
+                     is_table ? Kind::TABLE : Kind::CONDITIONAL, &actual_name);
+        if (rc != RuntimeReconfigErrorCode::SUCCESS) return rc;
+        if ((rc = check_pipeline(step)) != RuntimeReconfigErrorCode::SUCCESS)
+          return rc;
+        const bool found = is_table ?
+            new_objects->get_abstract_match_table_rt(actual_name) != nullptr :
+            new_objects->get_conditional_rt(actual_name) != nullptr;
+        if (!found) {
+          BMLOG_ERROR("Error: cannot find {} in the new program", actual_name);
+          return RuntimeReconfigErrorCode::UNFOUND_ID_ERROR;
+        }
+        // the object is moved out of the new program on insertion, so it can
+        // only be inserted once, even under different ids
+        if (!consumed.insert(step.ids[0]).second) {
+          BMLOG_ERROR("Error: {} already inserted by this plan", step.ids[0]);
+          return RuntimeReconfigErrorCode::DUP_CHECK_ERROR;
+        }
+      }
+      break;
+    case Type::INSERT_FLEX:
+      if ((rc = declare(step.ids[0], "flx", Kind::FLEX, &actual_name)) !=
+          RuntimeReconfigErrorCode::SUCCESS)
+        return rc;
+      if ((rc = resolve_node(step.ids[1])) != RuntimeReconfigErrorCode::SUCCESS)
+        return rc;
+      if ((rc = resolve_node(step.ids[2])) != RuntimeReconfigErrorCode::SUCCESS)
+        return rc;
+      return check_pipeline(step);
+    case Type::INSERT_REGISTER_ARRAY:
+      return declare(step.ids[0], "new", Kind::REGISTER_ARRAY, &actual_name);
+    case Type::CHANGE_TABLE:
+      if ((rc = resolve(step.ids[0], {Kind::TABLE}, &sym, &actual_name)) !=
+          RuntimeReconfigErrorCode::SUCCESS)
+        return rc;
+      if ((rc = resolve_node(step.ids[1])) != RuntimeReconfigErrorCode::SUCCESS)
+        return rc;
+      if ((rc = check_pipeline(step)) != RuntimeReconfigErrorCode::SUCCESS)
+        return rc;
+      if (step.args[0] != "base_default_next" && step.args[0] != "__HIT__" &&
+          step.args[0] != "__MISS__") {
+        bool found;
+        if (sym == nullptr)
+          found = live.get_action_rt(actual_name, step.args[0]) != nullptr;
+        else if (!sym->new_name.empty())
+          found = new_objects->get_action_rt(sym->new_name, step.args[0]);
+        else
+          found = live.get_action_rt(sym->live_name, step.args[0]);
+        if (!found) {
+          BMLOG_ERROR("Error: line {}: table {} has no action {}",
+                      step.line_no, step.ids[0], step.args[0]);
+          return RuntimeReconfigErrorCode::INVALID_COMMAND_ERROR;
+        }
+      }
+      break;
+    case Type::CHANGE_CONDITIONAL:
+    case Type::CHANGE_FLEX:
+      if ((rc = resolve(step.ids[0], {Kind::CONDITIONAL, Kind::FLEX}, &sym,
+                        &actual_name)) != RuntimeReconfigErrorCode::SUCCESS)
+        return rc;
+      if ((rc = resolve_node(step.ids[1])) != RuntimeReconfigErrorCode::SUCCESS)
+        return rc;
+      return check_pipeline(step);
+    case Type::CHANGE_INIT:
+      if ((rc = resolve_node(step.ids[0])) != RuntimeReconfigErrorCode::SUCCESS)
+        return rc;
+      return check_pipeline(step);
+    case Type::CHANGE_REGISTER_ARRAY_SIZE:
+    case Type::CHANGE_REGISTER_ARRAY_BITWIDTH:
+      return resolve(step.ids[0], {Kind::REGISTER_ARRAY}, &sym, &actual_name);
+    case Type::TRIGGER_ON:
+    case Type::TRIGGER_OFF:
+      if (!live.get_flex_init_state()) {
+        BMLOG_ERROR("Error: line {}: running program has no flex state",
+                    step.line_no);
+        return RuntimeReconfigErrorCode::INVALID_COMMAND_ERROR;
+      }
+      break;
+    case Type::DELETE_TABLE:
+    case Type::DELETE_CONDITIONAL:
+    case Type::DELETE_FLEX:
+    case Type::DELETE_REGISTER_ARRAY:
+      {
+        std::set<Kind> kinds;
+        if (step.type == Type::DELETE_TABLE)
+          kinds = {Kind::TABLE};
+        else if (step.type == Type::DELETE_REGISTER_ARRAY)
+          kinds = {Kind::REGISTER_ARRAY};
+        else
+          kinds = {Kind::CONDITIONAL, Kind::FLEX};
+        if ((rc = resolve(step.ids[0], kinds, &sym, &actual_name)) !=
+            RuntimeReconfigErrorCode::SUCCESS)
+          return rc;
+        if (step.type != Type::DELETE_REGISTER_ARRAY &&
+            (rc = check_pipeline(step)) != RuntimeReconfigErrorCode::SUCCESS)
+          return rc;
+        if (sym == nullptr)
+          removed.insert(actual_name);
+        else if (!sym->live_name.empty())
+          removed.insert(sym->live_name);
+        if (sym != nullptr) ids.erase(step.ids[0]);
+      }
+      break;
+  }
+  return rc;
+}
+
+}  // namespace
+
+const char *
+ReconfigStep::type_name(Type type) {
+  switch (type) {
+    case Type::INSERT_TABLE: return "insert_tabl";
+    case Type::INSERT_CONDITIONAL: return "insert_cond";
+    case Type::INSERT_FLEX: return "insert_flex";
+    case Type::INSERT_REGISTER_ARRAY: return "insert_register_array";
+    case Type::CHANGE_TABLE: return "change_tabl";
+    case Type::CHANGE_CONDITIONAL: return "change_cond";
+    case Type::CHANGE_FLEX: return "change_flex";
+    case Type::CHANGE_INIT: return "change_init";
+    case Type::CHANGE_REGISTER_ARRAY_SIZE: return "change_register_array_size";
+    case Type::CHANGE_REGISTER_ARRAY_BITWIDTH:
+      return "change_register_array_bitwidth";
+    case Type::TRIGGER_ON: return "trigger_on";
+    case Type::TRIGGER_OFF: return "trigger_off";
+    case Type::DELETE_TABLE: return "delete_tabl";
+    case Type::DELETE_CONDITIONAL: return "delete_cond";
+    case Type::DELETE_FLEX: return "delete_flex";
+    case Type::DELETE_REGISTER_ARRAY: return "delete_register_array";
+  }
+  return "unknown";
+}
+
+RuntimeReconfigErrorCode
+ReconfigPlan::parse(std::istream *is) {
+  static const std::unordered_map<std::string, Type> insert_targets = {
+    {"tabl", Type::INSERT_TABLE}, {"cond", Type::INSERT_CONDITIONAL},
+    {"flex", Type::INSERT_FLEX}, {"register_array", Type::INSERT_REGISTER_ARRAY}
+  };
+  static const std::unordered_map<std::string, Type> change_targets = {
+    {"tabl", Type::CHANGE_TABLE}, {"cond", Type::CHANGE_CONDITIONAL},
+    {"flex", Type::CHANGE_FLEX}, {"init", Type::CHANGE_INIT},
+    {"register_array_size", Type::CHANGE_REGISTER_ARRAY_SIZE},
+    {"register_array_bitwidth", Type::CHANGE_REGISTER_ARRAY_BITWIDTH}
+  };
+  static const std::unordered_map<std::string, Type> trigger_targets = {
+    {"on", Type::TRIGGER_ON}, {"off", Type::TRIGGER_OFF}
+  };
+  static const std::unordered_map<std::string, Type> delete_targets = {
+    {"tabl", Type::DELETE_TABLE}, {"cond", Type::DELETE_CONDITIONAL},
+    {"flex", Type::DELETE_FLEX}, {"register_array", Type::DELETE_REGISTER_ARRAY}
+  };
+  static const std::unordered_map<
+    std::string, const std::unordered_map<std::string, Type> *> ops = {
+    {"insert", &insert_targets}, {"change", &change_targets},
+    {"trigger", &trigger_targets}, {"delete", &delete_targets}
+  };
+
+  steps.clear();
+  std::string line;
+  size_t line_no = 0;
+  while (std::getline(*is, line)) {
+    line_no++;
+    std::stringstream ss(line);
+    std::string op, target;
+    if (!(ss >> op) || op[0] == '#') continue;
+    auto op_it = ops.find(op);
+    if (op_it == ops.end()) {
+      BMLOG_ERROR("Error: line {}: unsupported operation {}", line_no, op);
+      return RuntimeReconfigErrorCode::INVALID_COMMAND_ERROR;
+    }
+    ss >> target;
+    auto target_it = op_it->second->find(target);
+    if (target_it == op_it->second->end()) {
+      BMLOG_ERROR("Error: unsupported target for {}: {}", op, target);
+      return RuntimeReconfigErrorCode::UNSUPPORTED_TARGET_ERROR;
+    }
+
+    ReconfigStep step;
+    step.type = target_it->second;
+    step.line_no = line_no;
+    switch (step.type) {
+      case Type::INSERT_TABLE:
+      case Type::INSERT_CONDITIONAL:
+      case Type::CHANGE_INIT:
+      case Type::DELETE_TABLE:
+      case Type::DELETE_CONDITIONAL:
+      case Type::DELETE_FLEX:
+        ss >> step.pipeline >> step.ids[0];
+        break;
+      case Type::DELETE_REGISTER_ARRAY:
+        ss >> step.ids[0];
+        break;
+      case Type::INSERT_FLEX:
+        ss >> step.pipeline >> step.ids[0] >> step.ids[1] >> step.ids[2];
+        break;
+      case Type::INSERT_REGISTER_ARRAY:
+        ss >> step.ids[0] >> step.args[0] >> step.args[1];
+        break;
+      case Type::CHANGE_TABLE:
+      case Type::CHANGE_CONDITIONAL:
+      case Type::CHANGE_FLEX:
+        ss >> step.pipeline >> step.ids[0] >> step.args[0] >> step.ids[1];
+        break;
+      case Type::CHANGE_REGISTER_ARRAY_SIZE:
+      case Type::CHANGE_REGISTER_ARRAY_BITWIDTH:
+        ss >> step.ids[0] >> step.args[0];
+        break;
+      case Type::TRIGGER_ON:
+      case Type::TRIGGER_OFF:
+        // the schedule is optional
+        if (ss >> step.args[0]) ss >> step.args[1];
+        else ss.clear();
+        break;
+    }
+
+    // every operand read above must be present, and numeric ones must parse
+    if (ss.fail()) {
+      BMLOG_ERROR("Error: line {}: missing operand in '{}'", line_no, line);
+      return RuntimeReconfigErrorCode::INVALID_COMMAND_ERROR;
+    }
+    if (step.type == Type::CHANGE_CONDITIONAL ||
+        step.type == Type::CHANGE_FLEX) {
+      if (step.args[0] != "true_next" && step.args[0] != "false_next") {
+        BMLOG_ERROR("Error: line {}: unknown edge {}", line_no, step.args[0]);
+        return RuntimeReconfigErrorCode::INVALID_COMMAND_ERROR;
+      }
+    }
+    if ((step.type == Type::TRIGGER_ON || step.type == Type::TRIGGER_OFF) &&
+        !step.args[0].empty() && step.args[0] != "after_packets" &&
+        step.args[0] != "at_time_ms") {
+      BMLOG_ERROR("Error: line {}: unknown trigger schedule {}", line_no,
+                  step.args[0]);
+      return RuntimeReconfigErrorCode::INVALID_COMMAND_ERROR;
+    }
+    bool numeric_ok = true;
+    switch (step.type) {
+      case Type::INSERT_REGISTER_ARRAY:
+        numeric_ok = is_positive_number(step.args[1]);
+        // fall-through
+      case Type::CHANGE_REGISTER_ARRAY_SIZE:
+      case Type::CHANGE_REGISTER_ARRAY_BITWIDTH:
+        numeric_ok = numeric_ok && is_positive_number(step.args[0]);
+        break;
+      case Type::TRIGGER_ON:
+      case Type::TRIGGER_OFF:
+        numeric_ok = step.args[0].empty() || is_flex_threshold(step.args[1]);
+        break;
+      default:
+        break;
+    }
+    if (!numeric_ok) {
+      BMLOG_ERROR("Error: line {}: invalid number in '{}'", line_no, line);
+      return RuntimeReconfigErrorCode::INVALID_COMMAND_ERROR;
+    }
+    steps.push_back(std::move(step));
+  }
+  return RuntimeReconfigErrorCode::SUCCESS;
+}
+
+std::set<std::string>
+ReconfigPlan::get_inserted_node_names() const {
+  std::set<std::string> names;
+  std::string prefix, name;
+  for (const auto &step : steps) {
+    if (step.type != Type::INSERT_TABLE &&
+        step.type != Type::INSERT_CONDITIONAL)
+      continue;
+    if (split_id(step.ids[0], &prefix, &name) && prefix == "new")
+      names.insert(name);
+  }
+  return names;
+}
+
+RuntimeReconfigErrorCode
+ReconfigPlan::validate(
+    const P4Objects &live,
+    const std::unordered_map<std::string, std::string> &id2newNodeName) const {
+  PlanValidator validator(live, new_objects.get(), id2newNodeName);
+  for (const auto &step : steps) {
+    RuntimeReconfigErrorCode rc = validator.check(step);
+    if (rc != RuntimeReconfigErrorCode::SUCCESS) {
+      BMLOG_ERROR("Error: runtime reconfig plan rejected at line {} ({})",
+                  step.line_no, ReconfigStep::type_name(step.type));
+      return rc;
+    }
+  }
+  return resolve_commit_ids(id2newNodeName);
+}
+
+// FlexCore: replays the lookups and updates commit() makes in id2newNodeName,
+// on a copy, so that every id commit() converts to a name, and every id it
+// erases, is known to be there
+RuntimeReconfigErrorCode
+ReconfigPlan::resolve_commit_ids(
+    const std::unordered_map<std::string, std::string> &id2newNodeName) const {
+  auto ids = id2newNodeName;
+  RuntimeReconfigErrorCode rc = RuntimeReconfigErrorCode::SUCCESS;
+  std::string name;
+  std::string prefix, actual_name;
+  auto resolve = [&ids, &name](const std::string &id) {
+    return convert_id_to_name(ids, id, &name);
+  };
+  for (const auto &step : steps) {
+    split_id(step.ids[0], &prefix, &actual_name);
+    switch (step.type) {
+      case Type::INSERT_TABLE:
+      case Type::INSERT_CONDITIONAL:
+      case Type::INSERT_REGISTER_ARRAY:
+        ids[step.ids[0]] = actual_name;
+        break;
+      case Type::INSERT_FLEX:
+        if ((rc = resolve(step.ids[1])) != RuntimeReconfigErrorCode::SUCCESS ||
+            (rc = resolve(step.ids[2])) != RuntimeReconfigErrorCode::SUCCESS)
+          break;
+        ids[step.ids[0]] = actual_name;
+        break;
+      case Type::CHANGE_TABLE:
+      case Type::CHANGE_CONDITIONAL:
+      case Type::CHANGE_FLEX:
+        if ((rc = resolve(step.ids[0])) == RuntimeReconfigErrorCode::SUCCESS)
+          rc = resolve(step.ids[1]);
+        break;
+      case Type::CHANGE_INIT:
+      case Type::CHANGE_REGISTER_ARRAY_SIZE:
+      case Type::CHANGE_REGISTER_ARRAY_BITWIDTH:
+        rc = resolve(step.ids[0]);
+        break;
+      case Type::TRIGGER_ON:
+      case Type::TRIGGER_OFF:
+        break;
+      case Type::DELETE_TABLE:
+      case Type::DELETE_CONDITIONAL:
+      case Type::DELETE_FLEX:
+      case Type::DELETE_REGISTER_ARRAY:
+        if ((rc = resolve(step.ids[0])) != RuntimeReconfigErrorCode::SUCCESS)
+          break;
+        if ((prefix == "new" || prefix == "flx") && ids.erase(step.ids[0]) != 1)
+          rc = RuntimeReconfigErrorCode::DELETE_ID_FAIL;
+        break;
+    }
+    if (rc != RuntimeReconfigErrorCode::SUCCESS) {
+      BMLOG_ERROR("Error: runtime reconfig plan rejected at line {} ({})",
+                  step.line_no, ReconfigStep::type_name(step.type));
+      return rc;
+    }
+  }
+  return RuntimeReconfigErrorCode::SUCCESS;
+}
+
+bool
+ReconfigPlan::needs_quiesce() const {
+  for (const auto &step : steps) {
+    switch (step.type) {
+      case Type::DELETE_REGISTER_ARRAY:
+        return true;
+      default:
+        break;
+    }
+  }
+  return false;
+}
+
+void
+ReconfigPlan::commit(
+    P4Objects *live,
+    std::unordered_map<std::string, std::string> *id2newNodeName,
+    ReconfigStats *stats) const {
+  // validate() resolved every id the way we do here, nothing can fail once we
+  // have started modifying the live objects
+  auto resolve = [id2newNodeName](const std::string &id) {
+    std::string name;
+    const auto rc = convert_id_to_name(*id2newNodeName, id, &name);
+    _BM_ASSERT(rc == RuntimeReconfigErrorCode::SUCCESS);
+    _BM_UNUSED(rc);
+    return name;
+  };
+  std::string vals[2];
+  std::string prefix, actual_name;
+  for (const auto &step : steps) {
+    auto start = ReconfigStats::clock::now();
+    split_id(step.ids[0], &prefix, &actual_name);
+    switch (step.type) {
+      case Type::INSERT_TABLE:
+        (*id2newNodeName)[step.ids[0]] = live->insert_match_table_rt(
+            new_objects, step.pipeline, actual_name, true);
+        break;
+      case Type::INSERT_CONDITIONAL:
+        (*id2newNodeName)[step.ids[0]] = live->insert_conditional_rt(
+            new_objects, step.pipeline, actual_name, true);
+        break;
+      case Type::INSERT_FLEX:
+        for (int i = 0; i < 2; i++) vals[i] = resolve(step.ids[i + 1]);
+        (*id2newNodeName)[step.ids[0]] = live->insert_flex_rt(
+            step.pipeline, vals[0], vals[1]);
+        break;
+      case Type::INSERT_REGISTER_ARRAY:
+        (*id2newNodeName)[step.ids[0]] = live->insert_register_array_rt(
+            actual_name, step.args[0], step.args[1]);
+        break;
+      case Type::CHANGE_TABLE:
+      case Type::CHANGE_CONDITIONAL:
+      case Type::CHANGE_FLEX:
+        for (int i = 0; i < 2; i++) vals[i] = resolve(step.ids[i]);
+        if (step.type == Type::CHANGE_TABLE) {
+          live->change_table_next_node_rt(
+              step.pipeline, vals[0], step.args[0], vals[1]);
+        } else {
+          live->change_conditional_next_node_rt(
+              step.pipeline, vals[0], step.args[0], vals[1]);
+        }
+        break;
+      case Type::CHANGE_INIT:
+      case Type::CHANGE_REGISTER_ARRAY_SIZE:
+      case Type::CHANGE_REGISTER_ARRAY_BITWIDTH:
+        vals[0] = resolve(step.ids[0]);
+        if (step.type == Type::CHANGE_INIT)
+          live->change_init_node_rt(step.pipeline, vals[0]);
+        else if (step.type == Type::CHANGE_REGISTER_ARRAY_SIZE)
+          live->change_register_array_size_rt(vals[0], step.args[0]);
+        else
+          live->change_register_array_bitwidth_rt(vals[0], step.args[0]);
+        break;
+      case Type::TRIGGER_ON:
+      case Type::TRIGGER_OFF:
+        // applied by apply_triggers(), once the new graph is published
+        continue;
+      case Type::DELETE_TABLE:
+      case Type::DELETE_CONDITIONAL:
+      case Type::DELETE_FLEX:
+      case Type::DELETE_REGISTER_ARRAY:
+        vals[0] = resolve(step.ids[0]);
+        if (step.type == Type::DELETE_TABLE)
+          live->delete_match_table_rt(step.pipeline, vals[0]);
+        else if (step.type == Type::DELETE_CONDITIONAL)
+          live->delete_conditional_rt(step.pipeline, vals[0]);
+        else if (step.type == Type::DELETE_FLEX)
+          live->delete_flex_rt(step.pipeline, vals[0]);
+        else
+          live->delete_register_array_rt(vals[0]);
+        if (prefix == "new" || prefix == "flx")
+          id2newNodeName->erase(step.ids[0]);
+        break;
+    }
+    if (stats)
+      stats->record(ReconfigStep::type_name(step.type),
+                    ReconfigStats::clock::now() - start);
+  }
+}
+
+void
+ReconfigPlan::apply_triggers(P4Objects *live, ReconfigStats *stats) const {
+  for (const auto &step : steps) {
+    if (step.type != Type::TRIGGER_ON && step.type != Type::TRIGGER_OFF)
+      continue;
+    auto start = ReconfigStats::clock::now();
+    const bool on = (step.type == Type::TRIGGER_ON);
+    bool exact = true;
+    if (step.args[0].empty()) {
+      live->flex_trigger_rt(on);
+    } else if (step.args[0] == "after_packets") {
+      exact = live->flex_trigger_at_packet_rt(
+          on, std::min<uint64_t>(
+              live->get_flex_version().get_packet_count() +
+                  std::stoull(step.args[1]),
+              FlexVersion::max_threshold));
+    } else {
+      exact = live->flex_trigger_at_time_rt(on, std::stoull(step.args[1]));
+    }
+    if (!exact) {
+      Logger::get()->warn(
+          "line {}: flex switch point already reached, the packets in "
+          "flight may be processed with either version", step.line_no);
+    }
+    if (stats)
+      stats->record(ReconfigStep::type_name(step.type),
+                    ReconfigStats::clock::now() - start);
+  }
+}
+
+void
+ReconfigStats::record(const std::string &name, clock::duration latency) {
+  const uint64_t ns = static_cast<uint64_t>(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(latency).count());
+  // bucket i counts latencies in [2^(i-1), 2^i) us, bucket 0 is < 1us
+  size_t bucket = 0;
+  for (uint64_t us = ns / 1000; us > 0 && bucket < nb_buckets - 1; us >>= 1)
+    bucket++;
+  std::lock_guard<std::mutex> lock(mutex);
+  auto &histogram = histograms[name];
+  histogram.count++;
+  histogram.total_ns += ns;
+  histogram.max_ns = std::max(histogram.max_ns, ns);
+  histogram.buckets[bucket]++;
+}
+
+void
+ReconfigStats::reset() {
+  std::lock_guard<std::mutex> lock(mutex);
+  histograms.clear();
+}
+
+std::string
+ReconfigStats::to_string() const {
+  std::ostringstream ss;
+  std::lock_guard<std::mutex> lock(mutex);
+  for (const auto &p : histograms) {
+    const auto &h = p.second;
+    ss << std::left << std::setw(32) << p.first
+       << " count=" << h.count
+       << " avg_us=" << (h.count ? h.total_ns / h.count / 1000 : 0)
+       << " max_us=" << h.max_ns / 1000 << " |";
+    for (size_t i = 0; i < nb_buckets; i++) {
+      if (h.buckets[i] == 0) continue;
+      ss << " <" << (uint64_t(1) << i) << "us:" << h.buckets[i];
+    }
+    ss << "\n";
+  }
+  return ss.str();
+}
+
+}  // namespace bm
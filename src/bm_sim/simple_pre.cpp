@@ -23,7 +23,9 @@
 #include <bm/bm_sim/simple_pre.h>
 #include <bm/bm_sim/logger.h>
 
+#include <memory>
 #include <string>
+#include <utility>
 #include <vector>
 #include <sstream>
 
@@ -31,6 +33,11 @@
 
 namespace bm {
 
+McSimplePre::McSimplePre() {
+  published_groups.publish(
+      std::unique_ptr<const GroupIndex>(new GroupIndex()));
+}
+
 McSimplePre::McReturnCode
 McSimplePre::mc_mgrp_create(const mgrp_t mgid, mgrp_hdl_t *mgrp_hdl) {
   boost::unique_lock<boost::shared_mutex> lock(mutex);
@@ -42,6 +49,7 @@ McSimplePre::mc_mgrp_create(const mgrp_t mgid, mgrp_hdl_t *mgrp_hdl) {
   *mgrp_hdl = mgid;
   MgidEntry mgid_entry(mgid);
   mgid_entries.insert(std::make_pair(*mgrp_hdl, std::move(mgid_entry)));
+  update_replication_list(*mgrp_hdl);
   Logger::get()->debug("mgrp node created for mgid {}", mgid);
   return SUCCESS;
 }
@@ -50,6 +58,7 @@ McSimplePre::McReturnCode
 McSimplePre::mc_mgrp_destroy(mgrp_hdl_t mgrp_hdl) {
   boost::unique_lock<boost::shared_mutex> lock(mutex);
   mgid_entries.erase(mgrp_hdl);
+  update_replication_list(mgrp_hdl);
   Logger::get()->debug("mgrp node deleted for mgid {}", mgrp_hdl);
   return SUCCESS;
 }
@@ -108,6 +117,7 @@ McSimplePre::mc_node_associate(const mgrp_hdl_t mgrp_hdl,
   mgid_entry.l1_list.push_back(l1_hdl);
   l1_entry.mgrp_hdl = mgrp_hdl;
   l1_entry.is_associated = true;
+  update_replication_list(mgrp_hdl);
   Logger::get()->debug("node associated with mgid {}", mgrp_hdl);
   return SUCCESS;
 }
@@ -134,6 +144,7 @@ McSimplePre::mc_node_dissociate(const mgrp_hdl_t mgrp_hdl,
   }
   node_dissociate(&mgid_entry, l1_hdl);
   l1_entry.is_associated = false;
+  update_replication_list(mgrp_hdl);
   Logger::get()->debug("node dissociated with mgid {}", mgrp_hdl);
   return SUCCESS;
 }
@@ -151,6 +162,7 @@ McSimplePre::mc_node_destroy(const l1_hdl_t l1_hdl) {
     // we let users destroy a node without dissociating it first
     auto &mgid_entry = mgid_entries.at(l1_entry.mgrp_hdl);
     node_dissociate(&mgid_entry, l1_hdl);
+    update_replication_list(l1_entry.mgrp_hdl);
   }
   rid = l1_entry.rid;
   l2_entries.erase(l1_entry.l2_hdl);
@@ -177,6 +189,7 @@ McSimplePre::mc_node_update(const l1_hdl_t l1_hdl,
   auto l2_hdl = l1_entry.l2_hdl;
   auto &l2_entry = l2_entries.at(l2_hdl);
   l2_entry.port_map = port_map;
+  if (l1_entry.is_associated) update_replication_list(l1_entry.mgrp_hdl);
   Logger::get()->debug("node updated for rid {}", l1_entry.rid);
   return SUCCESS;
 }
@@ -256,6 +269,7 @@ McSimplePre::reset_state_() {
   l2_entries.clear();
   l1_handles.clear();
   l2_handles.clear();
+  update_replication_lists();
 }
 
 void
@@ -265,33 +279,106 @@ McSimplePre::reset_state() {
   reset_state_();
 }
 
+McSimplePre::ReplicationList
+McSimplePre::get_replication_list(const McSimplePre::McIn ingress_info) const {
+  ReplicaList list;
+  {
+    // the list is shared with the PRE, so that the caller does not hold up the
+    // control plane while it replicates the packet
+    auto guard = published_groups.read();
+    auto it = guard->find(ingress_info.mgid);
+    if (it != guard->end()) list = *it->second->replicas.load();
+  }
+  if (!list) {
+    Logger::get()->warn("Replication requested for mgid {}, which is not known "
+                        "to the PRE", ingress_info.mgid);
+    static const ReplicaList empty_list =
+        std::make_shared<const std::vector<McOut> >();
+    return ReplicationList(empty_list);
+  }
+  BMLOG_DEBUG("number of packets replicated : {}", list->size());
+  return ReplicationList(std::move(list));
+}
+
 std::vector<McSimplePre::McOut>
 McSimplePre::replicate(const McSimplePre::McIn ingress_info) const {
-  std::vector<McSimplePre::McOut> egress_info_list;
-  egress_port_t port_id;
-  McSimplePre::McOut egress_info;
-  boost::shared_lock<boost::shared_mutex> lock(mutex);
-  auto mgid_it = mgid_entries.find(ingress_info.mgid);
+  const auto list = get_replication_list(ingress_info);
+  return std::vector<McOut>(list.begin(), list.end());
+}
+
+void
+McSimplePre::append_replicas(const L1Entry &l1_entry, const L2Entry &l2_entry,
+                             std::vector<McOut> *list) const {
+  McOut egress_info;
+  egress_info.rid = l1_entry.rid;
+  // Port replication
+  for (egress_port_t port_id = 0; port_id < l2_entry.port_map.size();
+       port_id++) {
+    if (l2_entry.port_map[port_id]) {
+      egress_info.egress_port = port_id;
+      list->push_back(egress_info);
+    }
+  }
+}
+
+bool
+McSimplePre::rebuild_group(mgrp_hdl_t mgrp_hdl, Retired *retired) {
+  auto group_it = groups.find(mgrp_hdl);
+  auto mgid_it = mgid_entries.find(mgrp_hdl);
   if (mgid_it == mgid_entries.end()) {
-    Logger::get()->warn("Replication requested for mgid {}, which is not known "
-                        "to the PRE", ingress_info.mgid);
-    return {};
+    if (group_it == groups.end()) return false;
+    retired->groups.push_back(std::move(group_it->second));
+    groups.erase(group_it);
+    return true;
   }
-  const auto &mgid_entry = mgid_it->second;
-  for (const l1_hdl_t l1_hdl : mgid_entry.l1_list) {
+  std::vector<McOut> list;
+  for (const l1_hdl_t l1_hdl : mgid_it->second.l1_list) {
     const auto &l1_entry = l1_entries.at(l1_hdl);
-    egress_info.rid = l1_entry.rid;
-    const auto &l2_entry = l2_entries.at(l1_entry.l2_hdl);
-    // Port replication
-    for (port_id = 0; port_id < l2_entry.port_map.size(); port_id++) {
-      if (l2_entry.port_map[port_id]) {
-        egress_info.egress_port = port_id;
-        egress_info_list.push_back(egress_info);
-      }
+    append_replicas(l1_entry, l2_entries.at(l1_entry.l2_hdl), &list);
+  }
+  auto *replicas = new ReplicaList(
+      std::make_shared<const std::vector<McOut> >(std::move(list)));
+  if (group_it == groups.end()) {
+    groups.emplace(mgrp_hdl, std::unique_ptr<Group>(new Group(replicas)));
+    return true;
+  }
+  retired->lists.emplace_back(group_it->second->replicas.exchange(replicas));
+  return false;
+}
+
+void
+McSimplePre::publish_groups(bool index_changed, const Retired &retired) {
+  if (index_changed) {
+    std::unique_ptr<GroupIndex> index(new GroupIndex());
+    for (const auto &p : groups) index->emplace(p.first, p.second.get());
+    published_groups.publish(std::move(index));
+  } else if (!retired.lists.empty()) {
+    published_groups.synchronize();
+  }
+}
+
+void
+McSimplePre::update_replication_list(mgrp_hdl_t mgrp_hdl) {
+  Retired retired;
+  publish_groups(rebuild_group(mgrp_hdl, &retired), retired);
+}
+
+void
+McSimplePre::update_replication_lists() {
+  Retired retired;
+  bool index_changed = false;
+  for (auto it = groups.begin(); it != groups.end();) {
+    if (mgid_entries.count(it->first) == 0) {
+      retired.groups.push_back(std::move(it->second));
+      it = groups.erase(it);
+      index_changed = true;
+    } else {
+      ++it;
     }
   }
-  BMLOG_DEBUG("number of packets replicated : {}", egress_info_list.size());
-  return egress_info_list;
+  for (const auto &p : mgid_entries)
+    index_changed |= rebuild_group(p.first, &retired);
+  publish_groups(index_changed, retired);
 }
 
 void
@@ -77,6 +77,7 @@ McSimplePreLAG::mc_node_update(const l1_hdl_t l1_hdl,
   auto &l2_entry = l2_entries.at(l2_hdl);
   l2_entry.port_map = port_map;
   l2_entry.lag_map = lag_map;
+  if (l1_entry.is_associated) update_replication_list(l1_entry.mgrp_hdl);
   Logger::get()->debug("node updated for rid {}", l1_entry.rid);
   return SUCCESS;
 }
@@ -98,6 +99,8 @@ McSimplePreLAG::mc_set_lag_membership(const lag_id_t lag_index,
   auto &lag_entry = lag_entries[lag_index];
   lag_entry.member_count = member_count;
   lag_entry.port_map = port_map;
+  // the member ports may be used by any group
+  update_replication_lists();
   Logger::get()->debug("lag membership set for lag index {}", lag_index);
   return SUCCESS;
 }
@@ -141,66 +144,47 @@ McSimplePreLAG::reset_state() {
   lag_entries.clear();
 }
 
-std::vector<McSimplePre::McOut>
-McSimplePreLAG::replicate(const McSimplePre::McIn ingress_info) const {
-  std::vector<McSimplePre::McOut> egress_info_list;
+void
+McSimplePreLAG::append_replicas(const L1Entry &l1_entry,
+                                const L2Entry &l2_entry,
+                                std::vector<McOut> *list) const {
+  McSimplePre::append_replicas(l1_entry, l2_entry, list);
   egress_port_t port_id;
   lag_id_t lag_index;
   int lag_hash = 0xFF;  // TODO(unknown): get lag hash from metadata
   int port_count1 = 0, port_count2 = 0;
   McSimplePre::McOut egress_info;
-  boost::shared_lock<boost::shared_mutex> lock(mutex);
-  auto mgid_it = mgid_entries.find(ingress_info.mgid);
-  if (mgid_it == mgid_entries.end()) {
-    Logger::get()->warn("Replication requested for mgid {}, which is not known "
-                        "to the PRE", ingress_info.mgid);
-    return {};
-  }
-  const auto &mgid_entry = mgid_it->second;
-  for (const l1_hdl_t l1_hdl : mgid_entry.l1_list) {
-    const auto &l1_entry = l1_entries.at(l1_hdl);
-    egress_info.rid = l1_entry.rid;
-    // Port replication
-    const auto &l2_entry = l2_entries.at(l1_entry.l2_hdl);
-    for (port_id = 0; port_id < l2_entry.port_map.size(); port_id++) {
-      if (l2_entry.port_map[port_id]) {
-        egress_info.egress_port = port_id;
-        egress_info_list.push_back(egress_info);
+  egress_info.rid = l1_entry.rid;
+  // Lag replication
+  for (lag_index = 0; lag_index < l2_entry.lag_map.size(); lag_index++) {
+    if (l2_entry.lag_map[lag_index]) {
+      auto lag_entry_it = lag_entries.find(lag_index);
+      if (lag_entry_it == lag_entries.end()) {
+        Logger::get()->warn("PRE LAG membership for LAG index {} not set",
+                            lag_index);
+        continue;
       }
-    }
-    // Lag replication
-    for (lag_index = 0; lag_index < l2_entry.lag_map.size(); lag_index++) {
-      if (l2_entry.lag_map[lag_index]) {
-        auto lag_entry_it = lag_entries.find(lag_index);
-        if (lag_entry_it == lag_entries.end()) {
-          Logger::get()->warn("PRE LAG membership for LAG index {} not set",
-                              lag_index);
-          continue;
-        }
-        const auto &lag_entry = lag_entry_it->second;
-        const auto &port_map = lag_entry.port_map;
-        if (lag_entry.member_count == 0) {
-          Logger::get()->debug("PRE LAG membership is empty for LAG index {}",
-                               lag_index);
-          continue;
+      const auto &lag_entry = lag_entry_it->second;
+      const auto &port_map = lag_entry.port_map;
+      if (lag_entry.member_count == 0) {
+        Logger::get()->debug("PRE LAG membership is empty for LAG index {}",
+                             lag_index);
+        continue;
+      }
+      port_count1 = (lag_hash % lag_entry.member_count) + 1;
+      port_count2 = 0;
+      for (port_id = 0; port_id < port_map.size(); port_id++) {
+        if (port_map[port_id]) {
+          port_count2++;
         }
-        port_count1 = (lag_hash % lag_entry.member_count) + 1;
-        port_count2 = 0;
-        for (port_id = 0; port_id < port_map.size(); port_id++) {
-          if (port_map[port_id]) {
-            port_count2++;
-          }
-          if (port_count1 == port_count2) {
-            egress_info.egress_port = port_id;
-            egress_info_list.push_back(egress_info);
-            break;
-          }
+        if (port_count1 == port_count2) {
+          egress_info.egress_port = port_id;
+          list->push_back(egress_info);
+          break;
         }
       }
     }
   }
-  BMLOG_DEBUG("number of packets replicated : {}", egress_info_list.size());
-  return egress_info_list;
 }
 
 }  // namespace bm
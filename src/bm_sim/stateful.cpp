@@ -20,44 +20,172 @@
 
 #include <bm/bm_sim/stateful.h>
 
+#include <algorithm>  // std::lower_bound, std::min
 #include <iterator>  // std::distance
+#include <memory>
 #include <string>
+#include <utility>
 #include <vector>
 
 namespace bm {
 
-Register::Register(int nbits, const RegisterArray *register_array)
-    : register_array(register_array) {
-  mask <<= nbits; mask -= 1;
+constexpr size_t RegisterArray::nb_stripes;
+constexpr size_t RegisterArray::chunk_size;
+
+Register::Register(const RegisterChunk *chunk)
+    : chunk(chunk) { }
+
+void
+Register::apply_mask() {
+  if (use_u64) {
+    value_u64 &= chunk->mask_u64;
+  } else {
+    value &= chunk->mask;
+    bignum_updated();
+  }
 }
 
 void
 Register::export_bytes() {
-  value &= mask;
-  register_array->notify(*this);
+  apply_mask();
+  chunk->register_array->notify(*this);
 }
 
-RegisterArray::RegisterArray(const std::string &name, p4object_id_t id,
+RegisterChunk::RegisterChunk(const RegisterArray *register_array, size_t base,
                              size_t size, int bitwidth)
-    : NamedP4Object(name, id), bitwidth(bitwidth) {
+    : register_array(register_array), base(base) {
+  mask <<= bitwidth; mask -= 1;
+  mask_u64 = Register::u64_mask(bitwidth);
   registers.reserve(size);
   for (size_t i = 0; i < size; i++)
-    registers.emplace_back(bitwidth, this);
+    registers.emplace_back(this);
+}
+
+void
+RegisterChunk::set_bitwidth(int bitwidth) {
+  mask = 1;
+  mask <<= bitwidth;
+  mask -= 1;
+  mask_u64 = Register::u64_mask(bitwidth);
+  for (auto &r : registers) r.apply_mask();
+}
+
+RegisterArray::RegisterArray(const std::string &name, p4object_id_t id,
+                             size_t size, int bitwidth)
+    : NamedP4Object(name, id), bitwidth(bitwidth) {
+  std::unique_ptr<Table> new_table(new Table());
+  add_chunks(new_table.get(), size);
+  table.store(new_table.release());
+  nb_registers.store(size);
+}
+
+RegisterArray::~RegisterArray() {
+  delete table.load();
+}
+
+void
+RegisterArray::add_chunks(Table *new_table, size_t new_size) const {
+  auto &chunks = new_table->chunks;
+  for (size_t base = chunks.size() * chunk_size; base < new_size;
+       base += chunk_size) {
+    chunks.push_back(std::make_shared<RegisterChunk>(
+        this, base, std::min(chunk_size, new_size - base), bitwidth.load()));
+  }
+}
+
+std::unique_ptr<RegisterArray::Table>
+RegisterArray::publish(std::unique_ptr<Table> new_table, size_t new_size) {
+  std::unique_ptr<Table> old_table(table.exchange(new_table.release(),
+                                                  std::memory_order_acq_rel));
+  nb_registers.store(new_size, std::memory_order_release);
+  return old_table;
+}
+
+void
+RegisterArray::resize(size_t new_size) {
+  std::lock_guard<std::mutex> resize_lock(resize_mutex);
+  const Table *old_table = get_table();
+  const size_t old_size = size();
+  std::unique_ptr<Table> new_table(new Table());
+  auto &chunks = new_table->chunks;
+
+  // the existing chunks are shared by the old and the new table; these chunks
+  // may include registers between old_size and new_size (if the array was
+  // shrunk before), which need to be reset
+  const size_t nb_chunks = (new_size + chunk_size - 1) / chunk_size;
+  for (const auto &chunk : old_table->chunks) {
+    if (chunks.size() == nb_chunks) break;
+    const size_t end = std::min(new_size, chunk->base + chunk_size);
+    if (chunk->base + chunk->registers.size() < end) break;
+    reset_registers(chunk.get(), std::max(old_size, chunk->base), end);
+    chunks.push_back(chunk);
+  }
+  // if the last chunk which is needed is too small, it is replaced by a new
+  // chunk and its values are copied while holding the lock
+  const RegisterChunk *copied_chunk = nullptr;
+  if (chunks.size() < std::min(nb_chunks, old_table->chunks.size()))
+    copied_chunk = old_table->chunks[chunks.size()].get();
+  add_chunks(new_table.get(), new_size);
+
+  std::unique_ptr<Table> retired_table;
+  {
+    auto lock = unique_lock();
+    if (copied_chunk != nullptr) {
+      auto &new_chunk = *chunks[copied_chunk->base / chunk_size];
+      const size_t nb_copied = std::min(copied_chunk->registers.size(),
+                                        old_size - copied_chunk->base);
+      for (size_t i = 0; i < nb_copied; i++) {
+        static_cast<Data &>(new_chunk.registers[i]) =
+            copied_chunk->registers[i];
+      }
+    }
+    retired_table = publish(std::move(new_table), new_size);
+  }
+  // the old table is released here, without holding the lock
+}
+
+// a packet which started using the array before it was shrunk may still be
+// accessing these registers, so each one is reset with its stripe held; the
+// stripes are taken one at a time, so packets are not stalled for long
+void
+RegisterArray::reset_registers(RegisterChunk *chunk, size_t begin,
+                               size_t end) const {
+  if (begin >= end) return;
+  for (size_t stripe = 0; stripe < nb_stripes; stripe++) {
+    // first register in [begin, end) protected by this stripe
+    size_t first = begin + (stripe + nb_stripes - begin % nb_stripes) %
+        nb_stripes;
+    if (first >= end) continue;
+    auto lock = cell_lock(first);
+    for (size_t i = first; i < end; i += nb_stripes)
+      static_cast<Data &>(chunk->registers[i - chunk->base]) = Data(0);
+  }
+}
+
+void
+RegisterArray::set_bitwidth(int bitwidth) {
+  std::lock_guard<std::mutex> resize_lock(resize_mutex);
+  // the lock is released between chunks, which is why the chunk masks are
+  // needed: each register is always consistent with its own chunk's bitwidth
+  for (const auto &chunk : get_table()->chunks) {
+    auto lock = unique_lock();
+    chunk->set_bitwidth(bitwidth);
+  }
+  this->bitwidth.store(bitwidth);
 }
 
 void
 RegisterArray::reset_state() {
-  // we build a new vector of registers, then swap, to avoid holding the lock
-  // for too long
-  std::vector<Register> registers_new;
-  size_t s = size();
-  // TODO(antonin): is this actually better than
-  // std::vector<Register> registers_new(size, Register(bitwidth)); ?
-  registers_new.reserve(s);
-  for (size_t i = 0; i < s; i++)
-    registers_new.emplace_back(bitwidth, this);
-  auto lock = UniqueLock();
-  registers.swap(registers_new);
+  std::lock_guard<std::mutex> resize_lock(resize_mutex);
+  const size_t s = size();
+  // we build a new table, then swap, to avoid holding the lock for too long
+  std::unique_ptr<Table> new_table(new Table());
+  add_chunks(new_table.get(), s);
+  std::unique_ptr<Table> retired_table;
+  {
+    auto lock = unique_lock();
+    retired_table = publish(std::move(new_table), s);
+  }
 }
 
 void
@@ -67,14 +195,25 @@ RegisterArray::register_notifier(Notifier notifier) {
 
 void
 RegisterArray::notify(const Register &reg) const {
-  for (const auto &notifier : notifiers)
-    notifier(std::distance(&registers[0], &reg));
+  if (notifiers.empty()) return;
+  const auto *chunk = reg.chunk;
+  size_t idx = chunk->base + std::distance(&chunk->registers[0], &reg);
+  for (const auto &notifier : notifiers) notifier(idx);
 }
 
 void
 RegisterSync::add_register_array(const RegisterArray *register_array) {
-  if (register_arrays.insert(register_array).second)
-    mutexes.push_back(&register_array->m_mutex);
+  if (!register_arrays.insert(register_array).second) return;
+  std::less<const RegisterArray *> cmp;
+  sorted_arrays.insert(
+      std::lower_bound(sorted_arrays.begin(), sorted_arrays.end(),
+                       register_array, cmp),
+      register_array);
+  mutexes.clear();
+  for (auto array : sorted_arrays) {
+    for (auto &stripe : array->stripes)
+      mutexes.push_back(&stripe.mutex);
+  }
 }
 
 void
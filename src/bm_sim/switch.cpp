@@ -52,6 +52,16 @@ packet_handler(int port_num, const char *buffer, int len, void *cookie) {
   static_cast<SwitchWContexts *>(cookie)->receive(port_num, buffer, len);
 }
 
+static void
+burst_handler(const PacketDispatcherIface::BurstPacket *packets, size_t count,
+              void *cookie) {
+  static_cast<SwitchWContexts *>(cookie)->receive_burst(packets, count);
+}
+
+// maximum number of packets received from, and sent to, the device manager at
+// once when the backend supports bursts
+static constexpr size_t default_burst_size = 32;
+
 // TODO(antonin): maybe a factory method would be more appropriate for Switch
 SwitchWContexts::SwitchWContexts(size_t nb_cxts, bool enable_swap)
   : DevMgr(),
@@ -73,6 +83,26 @@ SwitchWContexts::receive(port_t port_num, const char *buffer, int len) {
   return receive_(port_num, buffer, len);
 }
 
+int
+SwitchWContexts::receive_burst(const BurstPacket *packets, size_t count) {
+  if (dump_packet_data > 0) {
+    for (size_t i = 0; i < count; i++) {
+      Logger::get()->info(
+          "Received packet of length {} on port {}: {}", packets[i].len,
+          packets[i].port_num,
+          sample_packet_data(packets[i].buffer, packets[i].len));
+    }
+  }
+  return receive_burst_(packets, count);
+}
+
+int
+SwitchWContexts::receive_burst_(const BurstPacket *packets, size_t count) {
+  for (size_t i = 0; i < count; i++)
+    receive_(packets[i].port_num, packets[i].buffer, packets[i].len);
+  return 0;
+}
+
 void
 SwitchWContexts::start_and_return() {
   {
@@ -323,6 +353,9 @@ SwitchWContexts::init_from_options_parser(
 
   // TODO(unknown): is this the right place to do this?
   set_packet_handler(packet_handler, static_cast<void *>(this));
+  // not all backends support bursts, in which case packet_handler is used
+  set_burst_handler(burst_handler, default_burst_size,
+                    static_cast<void *>(this));
 
   return status;
 }
@@ -482,6 +515,39 @@ SwitchWContexts::do_swap() {
   return rc;
 }
 
+RuntimeReconfigErrorCode
+SwitchWContexts::do_runtime_reconfig(cxt_id_t cxt_id,
+                                     std::istream *json_file_stream,
+                                     std::istream *plan_file_stream) {
+  auto &cxt = contexts.at(cxt_id);
+  auto start = ReconfigStats::clock::now();
+  ReconfigPlan plan;
+  RuntimeReconfigErrorCode rc = cxt.runtime_reconfig_prepare(
+      json_file_stream, plan_file_stream, get_lookup_factory(),
+      required_fields, arith_objects, &plan);
+  if (rc != RuntimeReconfigErrorCode::SUCCESS) return rc;
+  if (!plan.needs_quiesce()) {
+    // packets in flight finish with the previous version of the graph
+    rc = cxt.runtime_reconfig_commit(plan);
+  } else {
+    auto quiesce_start = ReconfigStats::clock::now();
+    boost::unique_lock<boost::shared_mutex> lock(process_packet_mutex);
+    // Wait until no more packets exist for this context
+    while (phv_source->phvs_in_use(cxt_id) > 0) {
+      std::this_thread::yield();
+    }
+    cxt.reconfig_stats.record("quiesce",
+                              ReconfigStats::clock::now() - quiesce_start);
+    rc = cxt.runtime_reconfig_commit(plan);
+    // targets may hold references to P4 objects (e.g. field handles) which
+    // need to be refreshed, just like for a swap
+    if (rc == RuntimeReconfigErrorCode::SUCCESS) swap_notify();
+  }
+  if (rc == RuntimeReconfigErrorCode::SUCCESS)
+    cxt.reconfig_stats.record("total", ReconfigStats::clock::now() - start);
+  return rc;
+}
+
 std::string
 SwitchWContexts::get_config() const {
   std::unique_lock<std::mutex> config_lock(config_mutex);
@@ -0,0 +1,163 @@
+/* Copyright 2013-present Barefoot Networks, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cstdint>
+#include <cstring>
+
+#include "ternary_scan.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define BM_TERNARY_SCAN_X86
+#include <immintrin.h>
+#endif
+
+namespace bm {
+
+namespace ternary_scan {
+
+namespace {
+
+size_t scan_scalar(const char *key, const char *data, const char *masks,
+                   size_t stride, size_t begin, size_t end) {
+  for (size_t i = begin; i < end; i++) {
+    const char *d = data + i * stride;
+    const char *m = masks + i * stride;
+    bool match = true;
+    for (size_t offset = 0; offset < stride && match; offset += 8) {
+      uint64_t k_w, d_w, m_w;
+      std::memcpy(&k_w, key + offset, 8);
+      std::memcpy(&d_w, d + offset, 8);
+      std::memcpy(&m_w, m + offset, 8);
+      match = ((k_w & m_w) == d_w);
+    }
+    if (match) return i;
+  }
+  return end;
+}
+
+#ifdef BM_TERNARY_SCAN_X86
+
+__attribute__((target("sse2")))
+size_t scan_sse2(const char *key, const char *data, const char *masks,
+                 size_t stride, size_t begin, size_t end) {
+  for (size_t i = begin; i < end; i++) {
+    const char *d = data + i * stride;
+    const char *m = masks + i * stride;
+    bool match = true;
+    for (size_t offset = 0; offset < stride && match; offset += 16) {
+      const __m128i k_v = _mm_loadu_si128(
+          reinterpret_cast<const __m128i *>(key + offset));
+      const __m128i d_v = _mm_load_si128(
+          reinterpret_cast<const __m128i *>(d + offset));
+      const __m128i m_v = _mm_load_si128(
+          reinterpret_cast<const __m128i *>(m + offset));
+      const __m128i eq = _mm_cmpeq_epi8(_mm_and_si128(k_v, m_v), d_v);
+      match = (_mm_movemask_epi8(eq) == 0xffff);
+    }
+    if (match) return i;
+  }
+  return end;
+}
+
+__attribute__((target("avx2")))
+size_t scan_avx2(const char *key, const char *data, const char *masks,
+                 size_t stride, size_t begin, size_t end) {
+  // most keys fit in a single block, no need for the inner loop then
+  if (stride == block_size) {
+    const __m256i k_v = _mm256_loadu_si256(
+        reinterpret_cast<const __m256i *>(key));
+    for (size_t i = begin; i < end; i++) {
+      const __m256i d_v = _mm256_load_si256(
+          reinterpret_cast<const __m256i *>(data + i * stride));
+      const __m256i m_v = _mm256_load_si256(
+          reinterpret_cast<const __m256i *>(masks + i * stride));
+      const __m256i eq = _mm256_cmpeq_epi8(_mm256_and_si256(k_v, m_v), d_v);
+      if (_mm256_movemask_epi8(eq) == -1) return i;
+    }
+    return end;
+  }
+  for (size_t i = begin; i < end; i++) {
+    const char *d = data + i * stride;
+    const char *m = masks + i * stride;
+    bool match = true;
+    for (size_t offset = 0; offset < stride && match; offset += 32) {
+      const __m256i k_v = _mm256_loadu_si256(
+          reinterpret_cast<const __m256i *>(key + offset));
+      const __m256i d_v = _mm256_load_si256(
+          reinterpret_cast<const __m256i *>(d + offset));
+      const __m256i m_v = _mm256_load_si256(
+          reinterpret_cast<const __m256i *>(m + offset));
+      const __m256i eq = _mm256_cmpeq_epi8(_mm256_and_si256(k_v, m_v), d_v);
+      match = (_mm256_movemask_epi8(eq) == -1);
+    }
+    if (match) return i;
+  }
+  return end;
+}
+
+#endif  // BM_TERNARY_SCAN_X86
+
+Impl detect_best_impl() {
+#ifdef BM_TERNARY_SCAN_X86
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2")) return Impl::AVX2;
+  if (__builtin_cpu_supports("sse2")) return Impl::SSE2;
+#endif
+  return Impl::SCALAR;
+}
+
+}  // namespace
+
+ScanFn
+get_scan_fn(Impl impl) {
+  switch (impl) {
+    case Impl::SCALAR:
+      return scan_scalar;
+#ifdef BM_TERNARY_SCAN_X86
+    case Impl::SSE2:
+      return (best_impl() != Impl::SCALAR) ? scan_sse2 : nullptr;
+    case Impl::AVX2:
+      return (best_impl() == Impl::AVX2) ? scan_avx2 : nullptr;
+#else
+    case Impl::SSE2:
+    case Impl::AVX2:
+      return nullptr;
+#endif
+  }
+  return nullptr;
+}
+
+Impl
+best_impl() {
+  static const Impl impl = detect_best_impl();
+  return impl;
+}
+
+const char *
+impl_name(Impl impl) {
+  switch (impl) {
+    case Impl::SCALAR:
+      return "scalar";
+    case Impl::SSE2:
+      return "sse2";
+    case Impl::AVX2:
+      return "avx2";
+  }
+  return "";
+}
+
+}  // namespace ternary_scan
+
+}  // namespace bm
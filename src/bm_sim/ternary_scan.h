@@ -0,0 +1,102 @@
+/* Copyright 2013-present Barefoot Networks, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef BM_SIM_TERNARY_SCAN_H_
+#define BM_SIM_TERNARY_SCAN_H_
+
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <new>
+
+namespace bm {
+
+namespace ternary_scan {
+
+// Masked key comparison used to scan the entries of ternary and range
+// tables. The entries are stored in 2 arrays (structure of arrays), one for the
+// masked key data and one for the masks, with one row per entry. Rows have a
+// fixed stride, which is a multiple of the SIMD block size, and the padding
+// bytes are 0 (in both arrays). The key being looked up has to be padded with
+// 0s to the same stride.
+
+constexpr size_t block_size = 32;
+
+inline size_t stride_for(size_t nbytes_key) {
+  // at least one block, so that empty rows can be made to never match
+  const size_t nb_blocks = (nbytes_key + block_size - 1) / block_size;
+  return (nb_blocks == 0 ? 1 : nb_blocks) * block_size;
+}
+
+// Returns the index of the first row i in [begin, end) such that
+// (key & masks[i]) == data[i], or end if there is none.
+using ScanFn = size_t (*)(const char *key, const char *data,
+                          const char *masks, size_t stride,
+                          size_t begin, size_t end);
+
+enum class Impl { SCALAR, SSE2, AVX2 };
+
+// Returns nullptr if the implementation is not supported by the CPU we are
+// running on.
+ScanFn get_scan_fn(Impl impl);
+
+// The fastest implementation supported by the CPU, determined once at runtime.
+Impl best_impl();
+
+const char *impl_name(Impl impl);
+
+// Growable byte array with cache-line-aligned storage, used for the data and
+// mask arrays. New bytes are set to 0.
+class AlignedBytes {
+ public:
+  static constexpr size_t alignment = 64;
+
+  char *data() { return storage.get(); }
+  const char *data() const { return storage.get(); }
+
+  size_t size() const { return size_; }
+
+  void resize(size_t n) {
+    if (n > capacity) {
+      size_t new_capacity = capacity == 0 ? alignment : capacity;
+      while (new_capacity < n) new_capacity *= 2;
+      void *ptr = nullptr;
+      if (posix_memalign(&ptr, alignment, new_capacity) != 0)
+        throw std::bad_alloc();
+      std::unique_ptr<char, Deleter> new_storage(static_cast<char *>(ptr));
+      if (size_ > 0) std::memcpy(new_storage.get(), storage.get(), size_);
+      storage = std::move(new_storage);
+      capacity = new_capacity;
+    }
+    if (n > size_) std::memset(storage.get() + size_, 0, n - size_);
+    size_ = n;
+  }
+
+ private:
+  struct Deleter {
+    void operator()(char *ptr) const { std::free(ptr); }
+  };
+
+  std::unique_ptr<char, Deleter> storage{nullptr};
+  size_t size_{0};
+  size_t capacity{0};
+};
+
+}  // namespace ternary_scan
+
+}  // namespace bm
+
+#endif  // BM_SIM_TERNARY_SCAN_H_
@@ -98,8 +98,10 @@ void SimpleSwitch::transmit_thread() {
     BMELOG(packet_out, *packet);
     BMLOG_DEBUG_PKT(*packet, "Transmitting packet of size {} out of port {}",
                     packet->get_data_size(), packet->get_egress_port());
-    transmit_fn(packet->get_egress_port(),
-                packet->data(), packet->get_data_size());
+    // read-only access, so that the data of a multicast replica is not
+    // copied if it is still shared with the other replicas
+    const Packet &out = *packet;
+    transmit_fn(out.get_egress_port(), out.data(), out.get_data_size());
   }
 }
 
@@ -146,7 +148,7 @@ void SimpleSwitch::pipeline_thread() {
     if (mgid != 0) {
       assert(mgid == 1);
       phv->get_field("intrinsic_metadata.mgid").set(0);
-      const auto pre_out = pre->replicate({mgid});
+      const auto pre_out = pre->get_replication_list({mgid});
       for (const auto &out : pre_out) {
         egress_port = out.egress_port;
         if (ingress_port == egress_port) continue;  // pruning
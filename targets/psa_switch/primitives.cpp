@@ -331,6 +331,11 @@ class register_read
                     "Read register '{}' at index {} read value {}",
                     src.get_name(), i, src[i]);
   }
+
+  // only the cell at idx is accessed
+  int get_register_index_param(size_t array_param) const override {
+    return (array_param == 1) ? 2 : -1;
+  }
 };
 
 REGISTER_PRIMITIVE(register_read);
@@ -354,6 +359,11 @@ class register_write
                     "Wrote register '{}' at index {} with value {}",
                     dst.get_name(), i, dst[i]);
   }
+
+  // only the cell at idx is accessed
+  int get_register_index_param(size_t array_param) const override {
+    return (array_param == 0) ? 1 : -1;
+  }
 };
 
 REGISTER_PRIMITIVE(register_write);
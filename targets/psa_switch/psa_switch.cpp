@@ -311,8 +311,11 @@ PsaSwitch::transmit_thread() {
     BMLOG_DEBUG_PKT(*packet, "Transmitting packet of size {} out of port {}",
                     packet->get_data_size(), packet->get_egress_port());
 
-    my_transmit_fn(packet->get_egress_port(), packet->get_packet_id(),
-                   packet->data(), packet->get_data_size());
+    // read-only access, so that the data of a multicast replica is not
+    // copied if it is still shared with the other replicas
+    const Packet &out = *packet;
+    my_transmit_fn(out.get_egress_port(), out.get_packet_id(),
+                   out.data(), out.get_data_size());
   }
 }
 
@@ -343,7 +346,7 @@ PsaSwitch::enqueue(port_t egress_port, std::unique_ptr<Packet> &&packet) {
 void
 PsaSwitch::multicast(Packet *packet, unsigned int mgid, PktInstanceType path, unsigned int class_of_service) {
   auto phv = packet->get_phv();
-  const auto pre_out = pre->replicate({mgid});
+  const auto pre_out = pre->get_replication_list({mgid});
   auto &f_eg_cos = phv->get_field("psa_egress_input_metadata.class_of_service");
   auto &f_instance = phv->get_field("psa_egress_input_metadata.instance");
   auto &f_packet_path = phv->get_field("psa_egress_parser_input_metadata.packet_path");
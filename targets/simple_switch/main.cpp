@@ -22,8 +22,13 @@
 
 #include <bm/config.h>
 
+#include <iostream>
+#include <memory>
+#include <string>
+
 #include <bm/SimpleSwitch.h>
 #include <bm/bm_runtime/bm_runtime.h>
+#include <bm/bm_sim/lookup_structures.h>
 #include <bm/bm_sim/options_parse.h>
 #include <bm/bm_sim/target_parser.h>
 
@@ -46,6 +51,30 @@ main(int argc, char* argv[]) {
   simple_switch_parser.add_uint_option(
       "drop-port",
       "Choose drop port number (default is 511)");
+  simple_switch_parser.add_uint_option(
+      "ingress-threads",
+      "Number of ingress pipeline threads (default is 1)");
+  simple_switch_parser.add_string_option(
+      "ingress-affinity",
+      "How packets are assigned to ingress threads, 'port' (default) or "
+      "'flow-hash'");
+  simple_switch_parser.add_string_option(
+      "queue-impl",
+      "Implementation of the packet queues, 'locked' (default, mutex and "
+      "condition variables) or 'ring' (lock-free rings)");
+  simple_switch_parser.add_uint_option(
+      "tuple-space-min-size",
+      "Use tuple space search for ternary and range tables with at least "
+      "this many entries (default is to always scan the entries)");
+  simple_switch_parser.add_uint_option(
+      "multibit-lpm-min-size",
+      "Use DIR-24-8 (32-bit keys) or a multibit trie (other key widths) for "
+      "LPM tables with at least this many entries (default is to always use "
+      "the byte trie)");
+  simple_switch_parser.add_uint_option(
+      "resilient-selector-buckets",
+      "Use resilient hashing with this many buckets per group for action "
+      "selectors (default is to pick member hash % group size)");
 
   bm::OptionsParser parser;
   parser.parse(argc, argv, &simple_switch_parser);
@@ -65,7 +94,104 @@ main(int argc, char* argv[]) {
       std::exit(1);
   }
 
-  simple_switch = new SimpleSwitch(enable_swap_flag, drop_port);
+  uint32_t nb_ingress_threads = 1;
+  {
+    auto rc = simple_switch_parser.get_uint_option("ingress-threads",
+                                                   &nb_ingress_threads);
+    if (rc == bm::TargetParserBasic::ReturnCode::OPTION_NOT_PROVIDED)
+      nb_ingress_threads = 1;
+    else if (rc != bm::TargetParserBasic::ReturnCode::SUCCESS)
+      std::exit(1);
+    if (nb_ingress_threads == 0) {
+      std::cerr << "Invalid value for --ingress-threads: '"
+                << nb_ingress_threads << "'\n";
+      std::exit(1);
+    }
+  }
+
+  auto ingress_affinity = SimpleSwitch::IngressAffinity::PORT;
+  {
+    std::string affinity_str;
+    auto rc = simple_switch_parser.get_string_option("ingress-affinity",
+                                                     &affinity_str);
+    if (rc == bm::TargetParserBasic::ReturnCode::SUCCESS) {
+      if (affinity_str == "flow-hash") {
+        ingress_affinity = SimpleSwitch::IngressAffinity::FLOW_HASH;
+      } else if (affinity_str != "port") {
+        std::cerr << "Invalid value for --ingress-affinity: '"
+                  << affinity_str << "'\n";
+        std::exit(1);
+      }
+    } else if (rc != bm::TargetParserBasic::ReturnCode::OPTION_NOT_PROVIDED) {
+      std::exit(1);
+    }
+  }
+
+  auto queue_impl = bm::QueueImpl::LOCKED;
+  {
+    std::string queue_impl_str;
+    auto rc = simple_switch_parser.get_string_option("queue-impl",
+                                                     &queue_impl_str);
+    if (rc == bm::TargetParserBasic::ReturnCode::SUCCESS) {
+      if (queue_impl_str == "ring") {
+        queue_impl = bm::QueueImpl::RING;
+      } else if (queue_impl_str != "locked") {
+        std::cerr << "Invalid value for --queue-impl: '"
+                  << queue_impl_str << "'\n";
+        std::exit(1);
+      }
+    } else if (rc != bm::TargetParserBasic::ReturnCode::OPTION_NOT_PROVIDED) {
+      std::exit(1);
+    }
+  }
+
+  uint32_t tuple_space_min_size = 0;
+  {
+    auto rc = simple_switch_parser.get_uint_option("tuple-space-min-size",
+                                                   &tuple_space_min_size);
+    if (rc == bm::TargetParserBasic::ReturnCode::OPTION_NOT_PROVIDED)
+      tuple_space_min_size = 0;
+    else if (rc != bm::TargetParserBasic::ReturnCode::SUCCESS)
+      std::exit(1);
+  }
+
+  uint32_t multibit_lpm_min_size = 0;
+  {
+    auto rc = simple_switch_parser.get_uint_option("multibit-lpm-min-size",
+                                                   &multibit_lpm_min_size);
+    if (rc == bm::TargetParserBasic::ReturnCode::OPTION_NOT_PROVIDED)
+      multibit_lpm_min_size = 0;
+    else if (rc != bm::TargetParserBasic::ReturnCode::SUCCESS)
+      std::exit(1);
+  }
+
+  uint32_t resilient_selector_buckets = 0;
+  {
+    auto rc = simple_switch_parser.get_uint_option(
+        "resilient-selector-buckets", &resilient_selector_buckets);
+    if (rc == bm::TargetParserBasic::ReturnCode::OPTION_NOT_PROVIDED)
+      resilient_selector_buckets = 0;
+    else if (rc != bm::TargetParserBasic::ReturnCode::SUCCESS)
+      std::exit(1);
+  }
+
+  simple_switch = new SimpleSwitch(enable_swap_flag, drop_port,
+                                   nb_ingress_threads, ingress_affinity,
+                                   queue_impl);
+
+  if (tuple_space_min_size > 0 || multibit_lpm_min_size > 0 ||
+      resilient_selector_buckets > 0) {
+    auto lookup_factory = std::make_shared<bm::LookupStructureFactory>();
+    if (tuple_space_min_size > 0)
+      lookup_factory->set_tuple_space_min_size(tuple_space_min_size);
+    if (multibit_lpm_min_size > 0)
+      lookup_factory->set_multibit_lpm_min_size(multibit_lpm_min_size);
+    if (resilient_selector_buckets > 0) {
+      lookup_factory->set_resilient_selector_buckets(
+          resilient_selector_buckets);
+    }
+    simple_switch->set_lookup_factory(lookup_factory);
+  }
 
   int status = simple_switch->init_from_options_parser(parser);
   if (status != 0) std::exit(status);
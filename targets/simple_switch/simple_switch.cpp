@@ -20,19 +20,25 @@
 
 #include <bm/bm_sim/_assert.h>
 #include <bm/bm_sim/parser.h>
+#include <bm/bm_sim/ring_buffer.h>
 #include <bm/bm_sim/tables.h>
 #include <bm/bm_sim/logger.h>
 
 #include <unistd.h>
 
+#include <algorithm>
 #include <condition_variable>
+#include <cstring>
 #include <deque>
 #include <fstream>
 #include <iostream>
 #include <mutex>
+#include <stdexcept>
 #include <string>
+#include <tuple>
 #include <unordered_map>
 #include <utility>
+#include <vector>
 
 #include "simple_switch.h"
 #include "register_access.h"
@@ -62,6 +68,45 @@ struct bmv2_hash {
   }
 };
 
+// Used to spread packets across ingress threads. We have not parsed the packet
+// yet, so we only look for IPv4 / IPv6 over Ethernet. Ports are not included
+// for IPv4 fragments, which do not all carry the L4 header.
+uint64_t
+flow_hash(const char *buffer, int len) {
+  static constexpr int eth_len = 14;
+  const auto *pkt = reinterpret_cast<const unsigned char *>(buffer);
+  if (len < eth_len) return bm::hash::xxh64(buffer, len);
+  const int ether_type = (pkt[12] << 8) | pkt[13];
+  const unsigned char *l3 = pkt + eth_len;
+  const int l3_len = len - eth_len;
+  // addresses + protocol + L4 ports
+  char key[37];
+  size_t key_len = 0;
+  int proto = -1;
+  const unsigned char *l4 = nullptr;
+  if (ether_type == 0x0800 && l3_len >= 20) {
+    std::memcpy(key, l3 + 12, 8);
+    key_len = 8;
+    proto = l3[9];
+    const int ihl = (l3[0] & 0x0f) * 4;
+    const bool is_fragment = (l3[6] & 0x3f) || l3[7];
+    if (!is_fragment && l3_len >= ihl + 4) l4 = l3 + ihl;
+  } else if (ether_type == 0x86dd && l3_len >= 40) {
+    std::memcpy(key, l3 + 8, 32);
+    key_len = 32;
+    proto = l3[6];
+    if (l3_len >= 44) l4 = l3 + 40;
+  } else {
+    return bm::hash::xxh64(buffer, 12);  // Ethernet addresses
+  }
+  key[key_len++] = static_cast<char>(proto);
+  if (l4 && (proto == 6 || proto == 17)) {
+    std::memcpy(key + key_len, l4, 4);
+    key_len += 4;
+  }
+  return bm::hash::xxh64(key, key_len);
+}
+
 }  // namespace
 
 // if REGISTER_HASH calls placed in the anonymous namespace, some compiler can
@@ -130,10 +175,16 @@ class SimpleSwitch::InputBuffer {
     SENTINEL  // signal for the ingress thread to terminate
   };
 
-  InputBuffer(size_t capacity_hi, size_t capacity_lo)
-      : capacity_hi(capacity_hi), capacity_lo(capacity_lo) { }
+  InputBuffer(size_t capacity_hi, size_t capacity_lo, bm::QueueImpl impl)
+      : capacity_hi(capacity_hi), capacity_lo(capacity_lo) {
+    if (impl == bm::QueueImpl::RING) {
+      ring_hi.reset(new Ring(capacity_hi));
+      ring_lo.reset(new Ring(capacity_lo));
+    }
+  }
 
   int push_front(PacketType packet_type, std::unique_ptr<Packet> &&item) {
+    if (ring_hi) return push_front_ring(packet_type, std::move(item));
     switch (packet_type) {
       case PacketType::NORMAL:
         return push_front(&queue_lo, capacity_lo, &cvar_can_push_lo,
@@ -150,7 +201,25 @@ class SimpleSwitch::InputBuffer {
     return 0;
   }
 
+  // Pushes count NORMAL packets; the lock is acquired and the ingress thread is
+  // woken up once for all of them, unless the queue becomes full.
+  void push_front_n(std::unique_ptr<Packet> *items, size_t count) {
+    if (ring_hi) return push_front_n_ring(items, count);
+    Lock lock(mutex);
+    for (size_t i = 0; i < count; i++) {
+      if (queue_lo.size() == capacity_lo) {
+        cvar_can_pop.notify_one();
+        cvar_can_push_lo.wait(
+            lock, [this] { return queue_lo.size() < capacity_lo; });
+      }
+      queue_lo.push_front(std::move(items[i]));
+    }
+    lock.unlock();
+    cvar_can_pop.notify_one();
+  }
+
   void pop_back(std::unique_ptr<Packet> *pItem) {
+    if (ring_hi) return pop_back_ring(pItem);
     Lock lock(mutex);
     cvar_can_pop.wait(
         lock, [this] { return (queue_hi.size() + queue_lo.size()) > 0; });
@@ -171,9 +240,10 @@ class SimpleSwitch::InputBuffer {
  private:
   using Mutex = std::mutex;
   using Lock = std::unique_lock<Mutex>;
-  using QueueImpl = std::deque<std::unique_ptr<Packet> >;
+  using Deque = std::deque<std::unique_ptr<Packet> >;
+  using Ring = bm::RingBuffer<std::unique_ptr<Packet> >;
 
-  int push_front(QueueImpl *queue, size_t capacity,
+  int push_front(Deque *queue, size_t capacity,
                  std::condition_variable *cvar,
                  std::unique_ptr<Packet> &&item, bool blocking) {
     Lock lock(mutex);
@@ -187,40 +257,93 @@ class SimpleSwitch::InputBuffer {
     return 1;
   }
 
+  // same semantics as above, with a lock-free ring for each priority
+  int push_front_ring(PacketType packet_type,
+                      std::unique_ptr<Packet> &&item) {
+    bool hi = (packet_type != PacketType::NORMAL);
+    bool blocking = (packet_type != PacketType::RESUBMIT &&
+                     packet_type != PacketType::RECIRCULATE);
+    auto *ring = hi ? ring_hi.get() : ring_lo.get();
+    auto *can_push = hi ? &ring_can_push_hi : &ring_can_push_lo;
+    while (!ring->try_push(std::move(item))) {
+      if (!blocking) return 0;
+      can_push->wait([ring] { return !ring->full(); });
+    }
+    ring_can_pop.notify_all();
+    return 1;
+  }
+
+  void push_front_n_ring(std::unique_ptr<Packet> *items, size_t count) {
+    auto *ring = ring_lo.get();
+    for (size_t i = 0; i < count; i++) {
+      while (!ring->try_push(std::move(items[i]))) {
+        ring_can_pop.notify_all();
+        ring_can_push_lo.wait([ring] { return !ring->full(); });
+      }
+    }
+    ring_can_pop.notify_all();
+  }
+
+  void pop_back_ring(std::unique_ptr<Packet> *pItem) {
+    // give higher priority to resubmit/recirculate queue
+    bool popped_hi = false;
+    ring_can_pop.wait([this, pItem, &popped_hi] {
+        popped_hi = ring_hi->try_pop(pItem);
+        return popped_hi || ring_lo->try_pop(pItem);
+      });
+    if (popped_hi)
+      ring_can_push_hi.notify_all();
+    else
+      ring_can_push_lo.notify_all();
+  }
+
   mutable std::mutex mutex;
   mutable std::condition_variable cvar_can_push_hi;
   mutable std::condition_variable cvar_can_push_lo;
   mutable std::condition_variable cvar_can_pop;
   size_t capacity_hi;
   size_t capacity_lo;
-  QueueImpl queue_hi;
-  QueueImpl queue_lo;
+  Deque queue_hi;
+  Deque queue_lo;
+  // only used with bm::QueueImpl::RING
+  std::unique_ptr<Ring> ring_hi{nullptr};
+  std::unique_ptr<Ring> ring_lo{nullptr};
+  bm::SpinThenBlockWaiter ring_can_push_hi{};
+  bm::SpinThenBlockWaiter ring_can_push_lo{};
+  bm::SpinThenBlockWaiter ring_can_pop{};
 };
 
-SimpleSwitch::SimpleSwitch(bool enable_swap, port_t drop_port)
+SimpleSwitch::SimpleSwitch(bool enable_swap, port_t drop_port,
+                           size_t nb_ingress_threads,
+                           IngressAffinity ingress_affinity,
+                           bm::QueueImpl queue_impl)
   : Switch(enable_swap),
     drop_port(drop_port),
-    input_buffer(new InputBuffer(
-        1024 /* normal capacity */, 1024 /* resubmit/recirc capacity */)),
+    nb_ingress_threads(std::max<size_t>(nb_ingress_threads, 1u)),
+    ingress_affinity(ingress_affinity),
+    queue_impl(queue_impl),
 #ifdef SSWITCH_PRIORITY_QUEUEING_ON
     egress_buffers(nb_egress_threads,
                    64, EgressThreadMapper(nb_egress_threads),
                    SSWITCH_PRIORITY_QUEUEING_NB_QUEUES),
 #else
     egress_buffers(nb_egress_threads,
-                   64, EgressThreadMapper(nb_egress_threads)),
+                   64, EgressThreadMapper(nb_egress_threads), queue_impl),
 #endif
-    output_buffer(128),
+    output_buffer(128, Queue<std::unique_ptr<Packet> >::WriteBlock,
+                  Queue<std::unique_ptr<Packet> >::ReadBlock, queue_impl),
     // cannot use std::bind because of a clang bug
     // https://stackoverflow.com/questions/32030141/is-this-incorrect-use-of-stdbind-or-a-compiler-bug
-    my_transmit_fn([this](port_t port_num, packet_id_t pkt_id,
-                          const char *buffer, int len) {
-        _BM_UNUSED(pkt_id);
-        this->transmit_fn(port_num, buffer, len);
-    }),
+    my_transmit_fn(),
     pre(new McSimplePreLAG()),
     start(clock::now()),
     mirroring_sessions(new MirroringSessions()) {
+  for (size_t i = 0; i < this->nb_ingress_threads; i++) {
+    input_buffers.emplace_back(new InputBuffer(
+        1024 /* normal capacity */, 1024 /* resubmit/recirc capacity */,
+        queue_impl));
+  }
+
   add_component<McSimplePreLAG>(pre);
 
   add_required_field("standard_metadata", "ingress_port");
@@ -236,8 +359,9 @@ SimpleSwitch::SimpleSwitch(bool enable_swap, port_t drop_port)
   import_primitives(this);
 }
 
-int
-SimpleSwitch::receive_(port_t port_num, const char *buffer, int len) {
+std::unique_ptr<Packet>
+SimpleSwitch::new_received_packet(port_t port_num, const char *buffer,
+                                  int len) {
   // we limit the packet buffer to original size + 512 bytes, which means we
   // cannot add more than 512 bytes of header data to the packet, which should
   // be more than enough
@@ -254,29 +378,81 @@ SimpleSwitch::receive_(port_t port_num, const char *buffer, int len) {
 
   // setting standard metadata
 
-  phv->get_field("standard_metadata.ingress_port").set(port_num);
+  fields.ingress_port.get(phv).set(port_num);
   // using packet register 0 to store length, this register will be updated for
   // each add_header / remove_header primitive call
   packet->set_register(RegisterAccess::PACKET_LENGTH_REG_IDX, len);
-  phv->get_field("standard_metadata.packet_length").set(len);
-  Field &f_instance_type = phv->get_field("standard_metadata.instance_type");
-  f_instance_type.set(PKT_INSTANCE_TYPE_NORMAL);
+  fields.packet_length.get(phv).set(len);
+  fields.instance_type.get(phv).set(PKT_INSTANCE_TYPE_NORMAL);
+
+  if (fields.ingress_global_timestamp.exists())
+    fields.ingress_global_timestamp.get(phv).set(get_ts().count());
 
-  if (phv->has_field("intrinsic_metadata.ingress_global_timestamp")) {
-    phv->get_field("intrinsic_metadata.ingress_global_timestamp")
-        .set(get_ts().count());
+  return packet;
+}
+
+int
+SimpleSwitch::receive_(port_t port_num, const char *buffer, int len) {
+  input_buffers[ingress_worker(port_num, buffer, len)]->push_front(
+      InputBuffer::PacketType::NORMAL,
+      new_received_packet(port_num, buffer, len));
+  return 0;
+}
+
+int
+SimpleSwitch::receive_burst_(const BurstPacket *packets, size_t count) {
+  std::vector<std::unique_ptr<Packet> > received;
+  received.reserve(count);
+  for (size_t i = 0; i < count; i++) {
+    received.push_back(new_received_packet(
+        packets[i].port_num, packets[i].buffer, packets[i].len));
+  }
+  if (nb_ingress_threads == 1) {
+    input_buffers[0]->push_front_n(received.data(), count);
+    return 0;
+  }
+  // the packets going to the same ingress thread are enqueued together, in
+  // their order of arrival
+  std::vector<size_t> workers(count);
+  for (size_t i = 0; i < count; i++) {
+    workers[i] = ingress_worker(packets[i].port_num, packets[i].buffer,
+                                packets[i].len);
+  }
+  std::vector<std::unique_ptr<Packet> > burst;
+  burst.reserve(count);
+  for (size_t worker = 0; worker < nb_ingress_threads; worker++) {
+    for (size_t i = 0; i < count; i++) {
+      if (workers[i] == worker) burst.push_back(std::move(received[i]));
+    }
+    if (burst.empty()) continue;
+    input_buffers[worker]->push_front_n(burst.data(), burst.size());
+    burst.clear();
   }
+  return 0;
+}
 
-  input_buffer->push_front(
-      InputBuffer::PacketType::NORMAL, std::move(packet));
+size_t
+SimpleSwitch::ingress_worker(port_t port_num, const char *buffer,
+                             int len) const {
+  if (nb_ingress_threads == 1) return 0;
+  switch (ingress_affinity) {
+    case IngressAffinity::PORT:
+      return port_num % nb_ingress_threads;
+    case IngressAffinity::FLOW_HASH:
+      return flow_hash(buffer, len) % nb_ingress_threads;
+  }
+  _BM_UNREACHABLE("Unreachable statement");
   return 0;
 }
 
 void
 SimpleSwitch::start_and_return_() {
   check_queueing_metadata();
+  resolve_field_handles();
 
-  threads_.push_back(std::thread(&SimpleSwitch::ingress_thread, this));
+  for (size_t i = 0; i < nb_ingress_threads; i++) {
+    threads_.push_back(std::thread(&SimpleSwitch::ingress_thread, this, i));
+  }
   for (size_t i = 0; i < nb_egress_threads; i++) {
     threads_.push_back(std::thread(&SimpleSwitch::egress_thread, this, i));
   }
@@ -288,16 +464,19 @@ SimpleSwitch::swap_notify_() {
   bm::Logger::get()->debug(
       "simple_switch target has been notified of a config swap");
   check_queueing_metadata();
+  resolve_field_handles();
 }
 
 SimpleSwitch::~SimpleSwitch() {
-  input_buffer->push_front(
-      InputBuffer::PacketType::SENTINEL, nullptr);
+  for (auto &input_buffer : input_buffers) {
+    input_buffer->push_front(
+        InputBuffer::PacketType::SENTINEL, nullptr);
+  }
   for (size_t i = 0; i < nb_egress_threads; i++) {
     // The push_front call is called inside a while loop because there is no
     // guarantee that the sentinel was enqueued otherwise. It should not be an
-    // issue because at this stage the ingress thread has been sent a signal to
-    // stop, and only egress clones can be sent to the buffer.
+    // issue because at this stage the ingress threads have been sent a signal
+    // to stop, and only egress clones can be sent to the buffer.
 #ifdef SSWITCH_PRIORITY_QUEUEING_ON
     while (egress_buffers.push_front(i, 0, nullptr) == 0) continue;
 #else
@@ -375,15 +554,42 @@ SimpleSwitch::set_transmit_fn(TransmitFn fn) {
 
 void
 SimpleSwitch::transmit_thread() {
-  while (1) {
-    std::unique_ptr<Packet> packet;
-    output_buffer.pop_back(&packet);
-    if (packet == nullptr) break;
-    BMELOG(packet_out, *packet);
-    BMLOG_DEBUG_PKT(*packet, "Transmitting packet of size {} out of port {}",
-                    packet->get_data_size(), packet->get_egress_port());
-    my_transmit_fn(packet->get_egress_port(), packet->get_packet_id(),
-                   packet->data(), packet->get_data_size());
+  // unless a transmit function was provided with set_transmit_fn, the packets
+  // are handed to the device manager in bursts of up to get_burst_size()
+  // packets
+  const size_t batch_size = my_transmit_fn ? 32 : get_burst_size();
+  std::vector<std::unique_ptr<Packet> > packets(batch_size);
+  std::vector<BurstPacket> burst;
+  burst.reserve(batch_size);
+  bool done = false;
+  while (!done) {
+    size_t nb_packets = output_buffer.pop_back_n(packets.data(), batch_size);
+    for (size_t i = 0; i < nb_packets; i++) {
+      auto &packet = packets[i];
+      if (packet == nullptr) {
+        done = true;
+        break;
+      }
+      BMELOG(packet_out, *packet);
+      BMLOG_DEBUG_PKT(*packet, "Transmitting packet of size {} out of port {}",
+                      packet->get_data_size(), packet->get_egress_port());
+      // read-only access, so that the data of a multicast replica is not
+      // copied if it is still shared with the other replicas
+      const Packet &out = *packet;
+      if (my_transmit_fn) {
+        my_transmit_fn(out.get_egress_port(), out.get_packet_id(),
+                       out.data(), out.get_data_size());
+      } else {
+        burst.push_back({static_cast<int>(out.get_egress_port()),
+                         out.data(),
+                         static_cast<int>(out.get_data_size())});
+      }
+    }
+    if (!burst.empty()) {
+      transmit_burst(burst.data(), burst.size());
+      burst.clear();
+    }
+    for (size_t i = 0; i < nb_packets; i++) packets[i].reset();
   }
 }
 
@@ -399,14 +605,13 @@ SimpleSwitch::enqueue(port_t egress_port, std::unique_ptr<Packet> &&packet) {
     PHV *phv = packet->get_phv();
 
     if (with_queueing_metadata) {
-      phv->get_field("queueing_metadata.enq_timestamp").set(get_ts().count());
-      phv->get_field("queueing_metadata.enq_qdepth")
-          .set(egress_buffers.size(egress_port));
+      fields.enq_timestamp.get(phv).set(get_ts().count());
+      fields.enq_qdepth.get(phv).set(egress_buffers.size(egress_port));
     }
 
 #ifdef SSWITCH_PRIORITY_QUEUEING_ON
-    size_t priority = phv->has_field(SSWITCH_PRIORITY_QUEUEING_SRC) ?
-        phv->get_field(SSWITCH_PRIORITY_QUEUEING_SRC).get<size_t>() : 0u;
+    size_t priority = fields.priority.exists() ?
+        fields.priority.get(phv).get<size_t>() : 0u;
     if (priority >= SSWITCH_PRIORITY_QUEUEING_NB_QUEUES) {
       bm::Logger::get()->error("Priority out of range, dropping packet");
       return;
@@ -429,7 +634,7 @@ SimpleSwitch::copy_field_list_and_set_type(
   phv_copy->reset_metadata();
   FieldList *field_list = this->get_field_list(field_list_id);
   field_list->copy_fields_between_phvs(phv_copy, packet->get_phv());
-  phv_copy->get_field("standard_metadata.instance_type").set(copy_type);
+  fields.instance_type.get(phv_copy).set(copy_type);
 }
 
 void
@@ -451,17 +656,63 @@ SimpleSwitch::check_queueing_metadata() {
   with_queueing_metadata = false;
 }
 
+SimpleSwitch::FieldHandle
+SimpleSwitch::resolve_field(const std::string &header_name,
+                            const std::string &field_name,
+                            bool required) const {
+  FieldHandle handle;
+  if (field_exists(header_name, field_name)) {
+    std::tie(handle.header_id, handle.offset) =
+        field_info(header_name, field_name);
+  } else if (required) {
+    throw std::out_of_range("required field " + header_name + "." +
+                            field_name + " does not exist");
+  }
+  return handle;
+}
+
+void
+SimpleSwitch::resolve_field_handles() {
+  // required fields, every config is checked against them when loaded
+  fields.ingress_port =
+      resolve_field("standard_metadata", "ingress_port", true);
+  fields.packet_length =
+      resolve_field("standard_metadata", "packet_length", true);
+  fields.instance_type =
+      resolve_field("standard_metadata", "instance_type", true);
+  fields.egress_spec = resolve_field("standard_metadata", "egress_spec", true);
+  fields.egress_port = resolve_field("standard_metadata", "egress_port", true);
+  fields.parser_error = resolve_field("standard_metadata", "parser_error");
+  fields.checksum_error = resolve_field("standard_metadata", "checksum_error");
+  fields.ingress_global_timestamp =
+      resolve_field("intrinsic_metadata", "ingress_global_timestamp");
+  fields.egress_global_timestamp =
+      resolve_field("intrinsic_metadata", "egress_global_timestamp");
+  fields.mcast_grp = resolve_field("intrinsic_metadata", "mcast_grp");
+  fields.egress_rid = resolve_field("intrinsic_metadata", "egress_rid");
+  fields.enq_timestamp = resolve_field("queueing_metadata", "enq_timestamp");
+  fields.enq_qdepth = resolve_field("queueing_metadata", "enq_qdepth");
+  fields.deq_timedelta = resolve_field("queueing_metadata", "deq_timedelta");
+  fields.deq_qdepth = resolve_field("queueing_metadata", "deq_qdepth");
+  fields.qid = resolve_field("queueing_metadata", "qid");
+#ifdef SSWITCH_PRIORITY_QUEUEING_ON
+  const std::string priority_src(SSWITCH_PRIORITY_QUEUEING_SRC);
+  const auto dot = priority_src.find('.');
+  fields.priority = resolve_field(priority_src.substr(0, dot),
+                                  priority_src.substr(dot + 1));
+#endif
+}
+
 void
 SimpleSwitch::multicast(Packet *packet, unsigned int mgid) {
   auto *phv = packet->get_phv();
-  auto &f_rid = phv->get_field("intrinsic_metadata.egress_rid");
-  const auto pre_out = pre->replicate({mgid});
+  const auto pre_out = pre->get_replication_list({mgid});
   auto packet_size =
       packet->get_register(RegisterAccess::PACKET_LENGTH_REG_IDX);
   for (const auto &out : pre_out) {
     auto egress_port = out.egress_port;
     BMLOG_DEBUG_PKT(*packet, "Replicating packet on port {}", egress_port);
-    f_rid.set(out.rid);
+    if (fields.egress_rid.exists()) fields.egress_rid.get(phv).set(out.rid);
     std::unique_ptr<Packet> packet_copy = packet->clone_with_phv_ptr();
     RegisterAccess::clear_all(packet_copy.get());
     packet_copy->set_register(RegisterAccess::PACKET_LENGTH_REG_IDX,
@@ -471,8 +722,9 @@ SimpleSwitch::multicast(Packet *packet, unsigned int mgid) {
 }
 
 void
-SimpleSwitch::ingress_thread() {
+SimpleSwitch::ingress_thread(size_t worker_id) {
   PHV *phv;
+  InputBuffer *input_buffer = input_buffers[worker_id].get();
 
   while (1) {
     std::unique_ptr<Packet> packet;
@@ -503,22 +755,19 @@ SimpleSwitch::ingress_thread() {
     const Packet::buffer_state_t packet_in_state = packet->save_buffer_state();
     parser->parse(packet.get());
 
-    if (phv->has_field("standard_metadata.parser_error")) {
-      phv->get_field("standard_metadata.parser_error").set(
-          packet->get_error_code().get());
-    }
+    if (fields.parser_error.exists())
+      fields.parser_error.get(phv).set(packet->get_error_code().get());
 
-    if (phv->has_field("standard_metadata.checksum_error")) {
-      phv->get_field("standard_metadata.checksum_error").set(
-           packet->get_checksum_error() ? 1 : 0);
+    if (fields.checksum_error.exists()) {
+      fields.checksum_error.get(phv).set(
+          packet->get_checksum_error() ? 1 : 0);
     }
 
     ingress_mau->apply(packet.get());
 
     packet->reset_exit();
 
-    Field &f_egress_spec = phv->get_field("standard_metadata.egress_spec");
-    port_t egress_spec = f_egress_spec.get_uint();
+    port_t egress_spec = fields.egress_spec.get(phv).get_uint();
 
     auto clone_mirror_session_id =
         RegisterAccess::get_clone_mirror_session_id(packet.get());
@@ -529,10 +778,8 @@ SimpleSwitch::ingress_thread() {
 
     // detect mcast support, if this is true we assume that other fields needed
     // for mcast are also defined
-    if (phv->has_field("intrinsic_metadata.mcast_grp")) {
-      Field &f_mgid = phv->get_field("intrinsic_metadata.mcast_grp");
-      mgid = f_mgid.get_uint();
-    }
+    if (fields.mcast_grp.exists())
+      mgid = fields.mcast_grp.get(phv).get_uint();
 
     // INGRESS CLONING
     if (clone_mirror_session_id) {
@@ -603,8 +850,7 @@ SimpleSwitch::ingress_thread() {
     // MULTICAST
     if (mgid != 0) {
       BMLOG_DEBUG_PKT(*packet, "Multicast requested for packet");
-      auto &f_instance_type = phv->get_field("standard_metadata.instance_type");
-      f_instance_type.set(PKT_INSTANCE_TYPE_REPLICATION);
+      fields.instance_type.get(phv).set(PKT_INSTANCE_TYPE_REPLICATION);
       multicast(packet.get(), mgid);
       // when doing multicast, we discard the original packet
       continue;
@@ -617,8 +863,7 @@ SimpleSwitch::ingress_thread() {
       BMLOG_DEBUG_PKT(*packet, "Dropping packet at the end of ingress");
       continue;
     }
-    auto &f_instance_type = phv->get_field("standard_metadata.instance_type");
-    f_instance_type.set(PKT_INSTANCE_TYPE_NORMAL);
+    fields.instance_type.get(phv).set(PKT_INSTANCE_TYPE_NORMAL);
 
     enqueue(egress_port, std::move(packet));
   }
@@ -644,20 +889,16 @@ SimpleSwitch::egress_thread(size_t worker_id) {
 
     phv = packet->get_phv();
 
-    if (phv->has_field("intrinsic_metadata.egress_global_timestamp")) {
-      phv->get_field("intrinsic_metadata.egress_global_timestamp")
-          .set(get_ts().count());
-    }
+    if (fields.egress_global_timestamp.exists())
+      fields.egress_global_timestamp.get(phv).set(get_ts().count());
 
     if (with_queueing_metadata) {
       auto enq_timestamp =
-          phv->get_field("queueing_metadata.enq_timestamp").get<ts_res::rep>();
-      phv->get_field("queueing_metadata.deq_timedelta").set(
-          get_ts().count() - enq_timestamp);
-      phv->get_field("queueing_metadata.deq_qdepth").set(
-          egress_buffers.size(port));
-      if (phv->has_field("queueing_metadata.qid")) {
-        auto &qid_f = phv->get_field("queueing_metadata.qid");
+          fields.enq_timestamp.get(phv).get<ts_res::rep>();
+      fields.deq_timedelta.get(phv).set(get_ts().count() - enq_timestamp);
+      fields.deq_qdepth.get(phv).set(egress_buffers.size(port));
+      if (fields.qid.exists()) {
+        auto &qid_f = fields.qid.get(phv);
 #ifdef SSWITCH_PRIORITY_QUEUEING_ON
         qid_f.set(SSWITCH_PRIORITY_QUEUEING_NB_QUEUES - 1 - priority);
 #else
@@ -666,12 +907,12 @@ SimpleSwitch::egress_thread(size_t worker_id) {
       }
     }
 
-    phv->get_field("standard_metadata.egress_port").set(port);
+    fields.egress_port.get(phv).set(port);
 
-    Field &f_egress_spec = phv->get_field("standard_metadata.egress_spec");
+    Field &f_egress_spec = fields.egress_spec.get(phv);
     f_egress_spec.set(0);
 
-    phv->get_field("standard_metadata.packet_length").set(
+    fields.packet_length.get(phv).set(
         packet->get_register(RegisterAccess::PACKET_LENGTH_REG_IDX));
 
     egress_mau->apply(packet.get());
@@ -698,8 +939,7 @@ SimpleSwitch::egress_thread(size_t worker_id) {
         PHV *phv_copy = packet_copy->get_phv();
         FieldList *field_list = this->get_field_list(field_list_id);
         field_list->copy_fields_between_phvs(phv_copy, phv);
-        phv_copy->get_field("standard_metadata.instance_type")
-            .set(PKT_INSTANCE_TYPE_EGRESS_CLONE);
+        fields.instance_type.get(phv_copy).set(PKT_INSTANCE_TYPE_EGRESS_CLONE);
         if (config.mgid_valid) {
           BMLOG_DEBUG_PKT(*packet, "Cloning packet to MGID {}", config.mgid);
           multicast(packet_copy.get(), config.mgid);
@@ -735,17 +975,20 @@ SimpleSwitch::egress_thread(size_t worker_id) {
       PHV *phv_copy = packet_copy->get_phv();
       phv_copy->reset_metadata();
       field_list->copy_fields_between_phvs(phv_copy, phv);
-      phv_copy->get_field("standard_metadata.instance_type")
-          .set(PKT_INSTANCE_TYPE_RECIRC);
+      fields.instance_type.get(phv_copy).set(PKT_INSTANCE_TYPE_RECIRC);
       size_t packet_size = packet_copy->get_data_size();
       RegisterAccess::clear_all(packet_copy.get());
       packet_copy->set_register(RegisterAccess::PACKET_LENGTH_REG_IDX,
                                 packet_size);
-      phv_copy->get_field("standard_metadata.packet_length").set(packet_size);
+      fields.packet_length.get(phv_copy).set(packet_size);
       // TODO(antonin): really it may be better to create a new packet here or
       // to fold this functionality into the Packet class?
       packet_copy->set_ingress_length(packet_size);
-      input_buffer->push_front(
+      // the copy shares its data with packet, read it without copying it
+      const Packet &recirc = *packet_copy;
+      auto worker_id = ingress_worker(recirc.get_ingress_port(),
+                                      recirc.data(), packet_size);
+      input_buffers[worker_id]->push_front(
           InputBuffer::PacketType::RECIRCULATE, std::move(packet_copy));
       continue;
     }
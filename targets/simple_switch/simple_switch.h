@@ -30,6 +30,7 @@
 
 #include <memory>
 #include <chrono>
+#include <string>
 #include <thread>
 #include <vector>
 #include <functional>
@@ -81,18 +82,41 @@ class SimpleSwitch : public Switch {
 
   static constexpr port_t default_drop_port = 511;
 
+  // Selects the ingress thread for each packet. In both modes, all the packets
+  // of a given flow are processed by the same thread, so their order is
+  // preserved.
+  enum class IngressAffinity {
+    // ingress port modulo the number of ingress threads
+    PORT,
+    // hash of the IP addresses, protocol and TCP / UDP ports (Ethernet
+    // addresses for non-IP traffic), computed before parsing
+    FLOW_HASH
+  };
+
  private:
   using clock = std::chrono::high_resolution_clock;
 
  public:
   // by default, swapping is off
+  // Packets are processed by nb_ingress_threads ingress threads. Stateful P4
+  // objects (registers, counters, meters) and tables are already safe to use
+  // from several threads (egress is multi-threaded too), and swap / runtime
+  // reconfiguration wait until no packet is in flight in any thread.
+  // queue_impl selects the implementation of the input, egress and output
+  // buffers (lock-free rings with bm::QueueImpl::RING).
   explicit SimpleSwitch(bool enable_swap = false,
-                        port_t drop_port = default_drop_port);
+                        port_t drop_port = default_drop_port,
+                        size_t nb_ingress_threads = 1u,
+                        IngressAffinity ingress_affinity =
+                            IngressAffinity::PORT,
+                        bm::QueueImpl queue_impl = bm::QueueImpl::LOCKED);
 
   ~SimpleSwitch();
 
   int receive_(port_t port_num, const char *buffer, int len) override;
 
+  int receive_burst_(const BurstPacket *packets, size_t count) override;
+
   void start_and_return_() override;
 
   void reset_target_state_() override;
@@ -134,12 +158,18 @@ class SimpleSwitch : public Switch {
     return get_context(0)->get_p4objects_new();
   }
 
+  // by default, packets are sent with DevMgr::transmit_burst; this overrides
+  // it with a function called for each packet
   void set_transmit_fn(TransmitFn fn);
 
   port_t get_drop_port() const {
     return drop_port;
   }
 
+  size_t get_nb_ingress_threads() const {
+    return nb_ingress_threads;
+  }
+
   SimpleSwitch(const SimpleSwitch &) = delete;
   SimpleSwitch &operator =(const SimpleSwitch &) = delete;
   SimpleSwitch(SimpleSwitch &&) = delete;
@@ -163,6 +193,43 @@ class SimpleSwitch : public Switch {
     PKT_INSTANCE_TYPE_RESUBMIT,
   };
 
+  // A field accessed for every packet, resolved to a (header id, field offset)
+  // pair when a config is loaded or swapped in (or after a runtime
+  // reconfiguration), so that the packet threads do not have to look it up by
+  // name in the PHV.
+  struct FieldHandle {
+    bm::header_id_t header_id{0};
+    int offset{-1};
+
+    bool exists() const { return offset != -1; }
+
+    Field &get(PHV *phv) const {
+      return phv->get_field(header_id, offset);
+    }
+  };
+
+  struct FieldHandles {
+    FieldHandle ingress_port{};
+    FieldHandle packet_length{};
+    FieldHandle instance_type{};
+    FieldHandle egress_spec{};
+    FieldHandle egress_port{};
+    FieldHandle parser_error{};
+    FieldHandle checksum_error{};
+    FieldHandle ingress_global_timestamp{};
+    FieldHandle egress_global_timestamp{};
+    FieldHandle mcast_grp{};
+    FieldHandle egress_rid{};
+    FieldHandle enq_timestamp{};
+    FieldHandle enq_qdepth{};
+    FieldHandle deq_timedelta{};
+    FieldHandle deq_qdepth{};
+    FieldHandle qid{};
+#ifdef SSWITCH_PRIORITY_QUEUEING_ON
+    FieldHandle priority{};
+#endif
+  };
+
   struct EgressThreadMapper {
     explicit EgressThreadMapper(size_t nb_threads)
         : nb_threads(nb_threads) { }
@@ -175,7 +242,7 @@ class SimpleSwitch : public Switch {
   };
 
  private:
-  void ingress_thread();
+  void ingress_thread(size_t worker_id);
   void egress_thread(size_t worker_id);
   void transmit_thread();
 
@@ -191,12 +258,28 @@ class SimpleSwitch : public Switch {
 
   void check_queueing_metadata();
 
+  // throws std::out_of_range if a required field does not exist, the handle of
+  // an optional field which does not exist is left unresolved (see exists())
+  FieldHandle resolve_field(const std::string &header_name,
+                            const std::string &field_name,
+                            bool required = false) const;
+  void resolve_field_handles();
+
   void multicast(Packet *packet, unsigned int mgid);
 
+  size_t ingress_worker(port_t port_num, const char *buffer, int len) const;
+
+  std::unique_ptr<Packet> new_received_packet(port_t port_num,
+                                              const char *buffer, int len);
+
  private:
   port_t drop_port;
+  size_t nb_ingress_threads;
+  IngressAffinity ingress_affinity;
+  bm::QueueImpl queue_impl;
   std::vector<std::thread> threads_;
-  std::unique_ptr<InputBuffer> input_buffer;
+  // one input buffer per ingress thread
+  std::vector<std::unique_ptr<InputBuffer> > input_buffers;
   // for these queues, the write operation is non-blocking and we drop the
   // packet if the queue is full
 #ifdef SSWITCH_PRIORITY_QUEUEING_ON
@@ -210,6 +293,7 @@ class SimpleSwitch : public Switch {
   std::shared_ptr<McSimplePreLAG> pre;
   clock::time_point start;
   bool with_queueing_metadata{false};
+  FieldHandles fields{};
   std::unique_ptr<MirroringSessions> mirroring_sessions;
 };
 
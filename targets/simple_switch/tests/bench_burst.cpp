@@ -0,0 +1,220 @@
+/* Copyright 2013-present Barefoot Networks, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Measures simple_switch's packet rate when packets are received from, and
+// transmitted to, the device manager in bursts of 1 (one handler / transmit
+// call per packet), 8 and 32 packets. The packets are replayed from a pcap
+// file with bm::PcapFilesReader (as with --use-files), spread over 64 TCP flows
+// and forwarded to 8 egress ports; transmitted packets are only counted. The
+// rate is computed between the start of the replay and the last transmitted
+// packet.
+// Usage: bench_burst [nb_packets]
+
+#include <bm/bm_sim/dev_mgr.h>
+#include <bm/bm_sim/pcap_file.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <boost/filesystem.hpp>
+
+#include "simple_switch.h"
+
+namespace fs = boost::filesystem;
+
+namespace {
+
+using clock_ = std::chrono::high_resolution_clock;
+
+constexpr int kPktSize = 54;
+constexpr int kNbFlows = 64;
+constexpr int kNbPorts = 8;
+
+std::atomic<size_t> nb_transmitted{0};
+
+// reads the packets from a pcap file, which is only replayed when replay() is
+// called, i.e. once the switch is fully configured
+class PcapReplayDevMgr : public bm::DevMgrIface {
+ public:
+  explicit PcapReplayDevMgr(const std::string &pcap_path)
+      : reader(false /* no real-time packet replay */, 0) {
+    p_monitor = bm::PortMonitorIface::make_dummy();
+    reader.addFile(0, pcap_path);
+  }
+
+  ~PcapReplayDevMgr() override {
+    if (reader_thread.joinable()) reader_thread.join();
+  }
+
+  void replay() {
+    reader_thread = std::thread(&bm::PcapFilesReader::start, &reader);
+  }
+
+ private:
+  ReturnCode port_add_(const std::string &, port_t,
+                       const PortExtras &) override {
+    return ReturnCode::SUCCESS;
+  }
+
+  ReturnCode port_remove_(port_t) override { return ReturnCode::SUCCESS; }
+
+  void transmit_fn_(port_t, const char *, int) override {
+    nb_transmitted++;
+  }
+
+  void transmit_burst_(const BurstPacket *, size_t count) override {
+    nb_transmitted += count;
+  }
+
+  void start_() override { }
+
+  ReturnCode set_packet_handler_(const PacketHandler &handler,
+                                 void *cookie) override {
+    return reader.set_packet_handler(handler, cookie);
+  }
+
+  ReturnCode set_burst_handler_(const BurstHandler &handler, size_t max_burst,
+                                void *cookie) override {
+    return reader.set_burst_handler(handler, max_burst, cookie);
+  }
+
+  bool port_is_up_(port_t) const override { return true; }
+
+  std::map<port_t, PortInfo> get_port_info_() const override { return {}; }
+
+  bm::PcapFilesReader reader;
+  std::thread reader_thread;
+};
+
+void
+packet_handler(int port_num, const char *buffer, int len, void *cookie) {
+  static_cast<SimpleSwitch *>(cookie)->receive(port_num, buffer, len);
+}
+
+void
+burst_handler(const bm::DevMgr::BurstPacket *packets, size_t count,
+              void *cookie) {
+  static_cast<SimpleSwitch *>(cookie)->receive_burst(packets, count);
+}
+
+// Ethernet / IPv4 / TCP, destination address 10.1.<flow % 8>.<flow>
+std::vector<char>
+make_tcp_packet(int flow) {
+  std::vector<char> pkt(kPktSize, 0);
+  pkt[12] = '\x08';
+  pkt[14] = '\x45';
+  pkt[17] = static_cast<char>(kPktSize - 14);
+  pkt[22] = '\x40';
+  pkt[23] = '\x06';
+  pkt[26] = '\x0a'; pkt[29] = '\x01';
+  pkt[30] = '\x0a'; pkt[31] = '\x01';
+  pkt[32] = static_cast<char>(flow % kNbPorts);
+  pkt[33] = static_cast<char>(flow);
+  pkt[34] = static_cast<char>(flow >> 8);
+  pkt[35] = static_cast<char>(flow);
+  pkt[37] = '\x50';
+  return pkt;
+}
+
+void
+write_pcap(const std::string &path, size_t nb_packets) {
+  std::vector<std::vector<char> > packets;
+  for (int flow = 0; flow < kNbFlows; flow++)
+    packets.push_back(make_tcp_packet(flow));
+  bm::PcapFileOut out(0, path);
+  for (size_t i = 0; i < nb_packets; i++)
+    out.writePacket(packets[i % kNbFlows].data(), kPktSize, false);
+}
+
+void
+add_routes(SimpleSwitch *sw) {
+  for (int port = 0; port < kNbPorts; port++) {
+    std::vector<bm::MatchKeyParam> match_key;
+    match_key.emplace_back(bm::MatchKeyParam::Type::LPM,
+                           std::string("\x0a\x01", 2) +
+                           std::string(1, static_cast<char>(port)) +
+                           std::string(1, '\x00'), 24);
+    bm::ActionData action_data;
+    action_data.push_back_action_data(0xccddeeffu);
+    action_data.push_back_action_data(static_cast<unsigned int>(port));
+    bm::entry_handle_t handle;
+    auto rc = sw->mt_add_entry(0, "MyIngress.ipv4_lpm", match_key,
+                               "MyIngress.ipv4_forward", action_data, &handle);
+    if (rc != bm::MatchErrorCode::SUCCESS) {
+      std::cerr << "Error when adding route\n";
+      std::exit(1);
+    }
+  }
+}
+
+void
+run(size_t burst_size, const std::string &pcap_path, size_t nb_packets) {
+  auto *sw = new SimpleSwitch();
+  fs::path json_path = fs::path(TESTDATADIR) /
+      fs::path("runtime_table_reconfig") /
+      fs::path("runtime_table_reconfig_init.json");
+  sw->init_objects(json_path.string());
+  auto *dev_mgr = new PcapReplayDevMgr(pcap_path);
+  sw->set_dev_mgr(std::unique_ptr<bm::DevMgrIface>(dev_mgr));
+  sw->set_packet_handler(packet_handler, static_cast<void *>(sw));
+  // with a burst size of 1, every packet goes through packet_handler and
+  // DevMgr::transmit_fn
+  if (burst_size > 1)
+    sw->set_burst_handler(burst_handler, burst_size, static_cast<void *>(sw));
+  // we do not want to measure tail drops
+  sw->set_all_egress_queue_depths(nb_packets);
+  sw->start_and_return();
+  add_routes(sw);
+
+  nb_transmitted = 0;
+  auto start_tp = clock_::now();
+  dev_mgr->replay();
+  while (nb_transmitted < nb_packets)
+    std::this_thread::sleep_for(std::chrono::microseconds(100));
+  auto end_tp = clock_::now();
+
+  auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+      end_tp - start_tp).count();
+  if (elapsed == 0) elapsed = 1;
+  std::cout << "burst size " << burst_size << ": " << elapsed << " ms, "
+            << (nb_packets * 1000) / elapsed << " packets per second.\n";
+
+  delete sw;
+}
+
+}  // namespace
+
+int main(int argc, char *argv[]) {
+  size_t nb_packets = 200000;
+  if (argc > 1) nb_packets = std::strtoul(argv[1], nullptr, 10);
+
+  fs::path pcap_path = fs::temp_directory_path() /
+      fs::unique_path("bench_burst_%%%%-%%%%.pcap");
+  write_pcap(pcap_path.string(), nb_packets);
+
+  std::cout << "Replaying " << nb_packets << " packets\n";
+  for (size_t burst_size : {1u, 8u, 32u})
+    run(burst_size, pcap_path.string(), nb_packets);
+
+  fs::remove(pcap_path);
+  return 0;
+}
@@ -0,0 +1,158 @@
+/* Copyright 2013-present Barefoot Networks, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Measures how simple_switch's packet rate scales with the number of ingress
+// threads. Packets are injected with SimpleSwitch::receive, spread over 64 TCP
+// flows and forwarded to 8 egress ports; the rate is computed between the
+// first injected packet and the last transmitted one.
+// Every configuration is run with both queue implementations.
+// Usage: bench_ingress_threads [nb_packets]
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <boost/filesystem.hpp>
+
+#include "simple_switch.h"
+
+namespace fs = boost::filesystem;
+
+namespace {
+
+using clock_ = std::chrono::high_resolution_clock;
+
+constexpr int kPktSize = 54;
+constexpr int kNbFlows = 64;
+constexpr int kNbPorts = 8;
+
+std::atomic<size_t> nb_transmitted{0};
+
+void
+packet_handler(int port_num, const char *buffer, int len, void *cookie) {
+  static_cast<SimpleSwitch *>(cookie)->receive(port_num, buffer, len);
+}
+
+void
+transmit(bm::port_t, bm::packet_id_t, const char *, int) {
+  nb_transmitted++;
+}
+
+// Ethernet / IPv4 / TCP, destination address 10.1.<flow % 8>.<flow>
+std::vector<char>
+make_tcp_packet(int flow) {
+  std::vector<char> pkt(kPktSize, 0);
+  pkt[12] = '\x08';
+  pkt[14] = '\x45';
+  pkt[17] = static_cast<char>(kPktSize - 14);
+  pkt[22] = '\x40';
+  pkt[23] = '\x06';
+  pkt[26] = '\x0a'; pkt[29] = '\x01';
+  pkt[30] = '\x0a'; pkt[31] = '\x01';
+  pkt[32] = static_cast<char>(flow % kNbPorts);
+  pkt[33] = static_cast<char>(flow);
+  pkt[34] = static_cast<char>(flow >> 8);
+  pkt[35] = static_cast<char>(flow);
+  pkt[37] = '\x50';
+  return pkt;
+}
+
+void
+add_routes(SimpleSwitch *sw) {
+  for (int port = 0; port < kNbPorts; port++) {
+    std::vector<bm::MatchKeyParam> match_key;
+    match_key.emplace_back(bm::MatchKeyParam::Type::LPM,
+                           std::string("\x0a\x01", 2) +
+                           std::string(1, static_cast<char>(port)) +
+                           std::string(1, '\x00'), 24);
+    bm::ActionData action_data;
+    action_data.push_back_action_data(0xccddeeffu);
+    action_data.push_back_action_data(static_cast<unsigned int>(port));
+    bm::entry_handle_t handle;
+    auto rc = sw->mt_add_entry(0, "MyIngress.ipv4_lpm", match_key,
+                               "MyIngress.ipv4_forward", action_data, &handle);
+    if (rc != bm::MatchErrorCode::SUCCESS) {
+      std::cerr << "Error when adding route\n";
+      std::exit(1);
+    }
+  }
+}
+
+void
+run(size_t nb_ingress_threads, bm::QueueImpl queue_impl, size_t nb_packets) {
+  auto *sw = new SimpleSwitch(false, SimpleSwitch::default_drop_port,
+                              nb_ingress_threads,
+                              SimpleSwitch::IngressAffinity::FLOW_HASH,
+                              queue_impl);
+  bool ring = (queue_impl == bm::QueueImpl::RING);
+  fs::path json_path = fs::path(TESTDATADIR) /
+      fs::path("runtime_table_reconfig") /
+      fs::path("runtime_table_reconfig_init.json");
+  sw->init_objects(json_path.string());
+  // one packet-in socket per switch instance
+  std::string addr("inproc://bench_" + std::to_string(nb_ingress_threads) +
+                   (ring ? "_ring" : "_locked"));
+  sw->set_dev_mgr_packet_in(0, addr, nullptr);
+  sw->Switch::start();
+  sw->set_packet_handler(packet_handler, static_cast<void *>(sw));
+  sw->set_transmit_fn(transmit);
+  // we do not want to measure tail drops
+  sw->set_all_egress_queue_depths(nb_packets);
+  sw->start_and_return();
+  add_routes(sw);
+
+  std::vector<std::vector<char> > packets;
+  for (int flow = 0; flow < kNbFlows; flow++)
+    packets.push_back(make_tcp_packet(flow));
+
+  nb_transmitted = 0;
+  auto start_tp = clock_::now();
+  for (size_t i = 0; i < nb_packets; i++) {
+    const auto &pkt = packets[i % kNbFlows];
+    sw->receive(0, pkt.data(), kPktSize);
+  }
+  while (nb_transmitted < nb_packets)
+    std::this_thread::sleep_for(std::chrono::microseconds(100));
+  auto end_tp = clock_::now();
+
+  auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+      end_tp - start_tp).count();
+  if (elapsed == 0) elapsed = 1;
+  std::cout << nb_ingress_threads << " ingress thread(s), "
+            << (ring ? "ring" : "locked") << " queues: " << elapsed
+            << " ms, " << (nb_packets * 1000) / elapsed
+            << " packets per second.\n";
+
+  delete sw;
+}
+
+}  // namespace
+
+int main(int argc, char *argv[]) {
+  size_t nb_packets = 200000;
+  if (argc > 1) nb_packets = std::strtoul(argv[1], nullptr, 10);
+
+  std::cout << "Processing " << nb_packets << " packets ("
+            << std::thread::hardware_concurrency() << " cores available)\n";
+  for (size_t nb_ingress_threads : {1u, 2u, 4u, 8u}) {
+    run(nb_ingress_threads, bm::QueueImpl::LOCKED, nb_packets);
+    run(nb_ingress_threads, bm::QueueImpl::RING, nb_packets);
+  }
+  return 0;
+}
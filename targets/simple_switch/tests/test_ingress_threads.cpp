@@ -0,0 +1,252 @@
+/* Copyright 2013-present Barefoot Networks, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <bm/bm_sim/phv.h>
+#include <bm/bm_sim/runtime_reconfig_error_codes.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <boost/filesystem.hpp>
+
+#include "simple_switch.h"
+
+namespace fs = boost::filesystem;
+
+using bm::ActionData;
+using bm::RuntimeReconfigErrorCode;
+
+namespace {
+
+void
+packet_handler(int port_num, const char *buffer, int len, void *cookie) {
+  static_cast<SimpleSwitch *>(cookie)->receive(port_num, buffer, len);
+}
+
+// Ethernet / IPv4 / TCP, the flow is identified by the TCP source port and the
+// packet's position in the flow is stored in the TCP sequence number
+constexpr int kPktSize = 54;
+constexpr int kTcpOffset = 34;
+
+std::vector<char>
+make_tcp_packet(int flow, uint32_t seq) {
+  std::vector<char> pkt(kPktSize, 0);
+  pkt[12] = '\x08';  // IPv4 ethertype
+  pkt[13] = '\x00';
+  pkt[14] = '\x45';  // version 4, ihl 5
+  pkt[16] = '\x00';  // total length
+  pkt[17] = static_cast<char>(kPktSize - 14);
+  pkt[22] = '\x40';  // ttl
+  pkt[23] = '\x06';  // TCP
+  // source address: 10.0.0.<flow>, destination address: 10.0.1.1
+  pkt[26] = '\x0a'; pkt[29] = static_cast<char>(flow);
+  pkt[30] = '\x0a'; pkt[32] = '\x01'; pkt[33] = '\x01';
+  pkt[kTcpOffset + 0] = static_cast<char>(flow >> 8);
+  pkt[kTcpOffset + 1] = static_cast<char>(flow);
+  pkt[kTcpOffset + 3] = '\x50';  // dst port 80
+  for (int i = 0; i < 4; i++)
+    pkt[kTcpOffset + 4 + i] = static_cast<char>(seq >> (8 * (3 - i)));
+  return pkt;
+}
+
+}  // namespace
+
+class SimpleSwitch_IngressThreadsP4 : public ::testing::Test {
+ protected:
+  static constexpr size_t kNbIngressThreads = 4;
+  static constexpr int kNbFlows = 16;
+  static constexpr uint32_t kNbPktsPerFlow = 200;
+
+  // Per-test-case set-up.
+  // We make the switch a shared resource for all tests. This is mainly because
+  // the simple_switch target detaches threads
+  static void SetUpTestCase() {
+    start_switch(bm::QueueImpl::LOCKED, "inproc://packets");
+  }
+
+  static void start_switch(bm::QueueImpl queue_impl,
+                           const std::string &packet_in_addr) {
+    test_switch = new SimpleSwitch(
+        false, SimpleSwitch::default_drop_port, kNbIngressThreads,
+        SimpleSwitch::IngressAffinity::FLOW_HASH, queue_impl);
+
+    fs::path json_path =
+        fs::path(testdata_dir) / fs::path(testdata_folder) / fs::path(test_json);
+    test_switch->init_objects(json_path.string());
+
+    test_switch->set_dev_mgr_packet_in(0, packet_in_addr, nullptr);
+    test_switch->Switch::start();  // there is a start member in SimpleSwitch
+    test_switch->set_packet_handler(packet_handler,
+                                    static_cast<void *>(test_switch));
+    test_switch->set_transmit_fn(&SimpleSwitch_IngressThreadsP4::transmit);
+    // all packets go to the same port, we do not want any tail drop
+    test_switch->set_all_egress_queue_depths(kNbFlows * kNbPktsPerFlow);
+    test_switch->start_and_return();
+  }
+
+  // Per-test-case tear-down.
+  static void TearDownTestCase() {
+    delete test_switch;
+  }
+
+  virtual void SetUp() {
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      received.clear();
+      nb_received = 0;
+    }
+    ActionData action_data;
+    action_data.push_back_action_data(0xccddeeffu);  // dst mac
+    action_data.push_back_action_data(1u);  // egress port
+    test_switch->mt_set_default_action(
+        0, "MyIngress.ipv4_lpm", "MyIngress.ipv4_forward", action_data);
+  }
+
+  static void transmit(bm::port_t, bm::packet_id_t, const char *buffer,
+                       int len) {
+    if (len < kPktSize) return;
+    const auto *pkt = reinterpret_cast<const unsigned char *>(buffer);
+    int flow = (pkt[kTcpOffset] << 8) | pkt[kTcpOffset + 1];
+    uint32_t seq = 0;
+    for (int i = 0; i < 4; i++) seq = (seq << 8) | pkt[kTcpOffset + 4 + i];
+    std::unique_lock<std::mutex> lock(mutex);
+    received[flow].push_back(seq);
+    nb_received++;
+    cv.notify_all();
+  }
+
+  bool wait_for(size_t nb_pkts) {
+    std::unique_lock<std::mutex> lock(mutex);
+    return cv.wait_for(lock, std::chrono::seconds(10),
+                       [nb_pkts] { return nb_received >= nb_pkts; });
+  }
+
+  void check_order(uint32_t nb_pkts_per_flow) {
+    std::unique_lock<std::mutex> lock(mutex);
+    ASSERT_EQ(static_cast<size_t>(kNbFlows), received.size());
+    for (const auto &p : received) {
+      const auto &seqs = p.second;
+      ASSERT_EQ(nb_pkts_per_flow, seqs.size()) << "flow " << p.first;
+      for (uint32_t i = 0; i < nb_pkts_per_flow; i++)
+        ASSERT_EQ(i, seqs[i]) << "flow " << p.first;
+    }
+  }
+
+ public:
+  void send_flows(uint32_t nb_pkts_per_flow) {
+    for (uint32_t seq = 0; seq < nb_pkts_per_flow; seq++) {
+      for (int flow = 0; flow < kNbFlows; flow++) {
+        auto pkt = make_tcp_packet(flow, seq);
+        // spread each flow over several ports, ingress thread selection only
+        // depends on the flow
+        test_switch->receive(seq % 4, pkt.data(), kPktSize);
+      }
+    }
+  }
+
+ protected:
+  static SimpleSwitch *test_switch;
+  static std::mutex mutex;
+  static std::condition_variable cv;
+  static std::map<int, std::vector<uint32_t> > received;
+  static size_t nb_received;
+  static const char testdata_dir[];
+  static const char testdata_folder[];
+  static const char test_json[];
+};
+
+SimpleSwitch *SimpleSwitch_IngressThreadsP4::test_switch = nullptr;
+std::mutex SimpleSwitch_IngressThreadsP4::mutex{};
+std::condition_variable SimpleSwitch_IngressThreadsP4::cv{};
+std::map<int, std::vector<uint32_t> >
+SimpleSwitch_IngressThreadsP4::received{};
+size_t SimpleSwitch_IngressThreadsP4::nb_received = 0;
+
+const char SimpleSwitch_IngressThreadsP4::testdata_dir[] = TESTDATADIR;
+const char SimpleSwitch_IngressThreadsP4::testdata_folder[] =
+    "runtime_table_reconfig";
+const char SimpleSwitch_IngressThreadsP4::test_json[] =
+    "runtime_table_reconfig_init.json";
+
+TEST_F(SimpleSwitch_IngressThreadsP4, NbThreads) {
+  EXPECT_EQ(kNbIngressThreads, test_switch->get_nb_ingress_threads());
+}
+
+TEST_F(SimpleSwitch_IngressThreadsP4, FlowOrder) {
+  send_flows(kNbPktsPerFlow);
+  ASSERT_TRUE(wait_for(kNbFlows * kNbPktsPerFlow));
+  check_order(kNbPktsPerFlow);
+}
+
+// the reconfiguration has to wait for all ingress threads to be idle; packets
+// must not be lost or re-ordered
+TEST_F(SimpleSwitch_IngressThreadsP4, FlowOrderDuringReconfig) {
+  std::thread sender(&SimpleSwitch_IngressThreadsP4::send_flows, this,
+                     kNbPktsPerFlow);
+
+  fs::path new_json_path = fs::path(testdata_dir) / fs::path(testdata_folder) /
+      fs::path("runtime_table_reconfig_new.json");
+  std::ifstream new_json(new_json_path.string(), std::ios::in);
+  std::istringstream plan("insert tabl ingress new_MyIngress.acl");
+  EXPECT_EQ(RuntimeReconfigErrorCode::SUCCESS,
+            static_cast<RuntimeReconfigErrorCode>(
+                test_switch->mt_runtime_reconfig_with_stream(
+                    0, &new_json, &plan)));
+
+  sender.join();
+  ASSERT_TRUE(wait_for(kNbFlows * kNbPktsPerFlow));
+  check_order(kNbPktsPerFlow);
+}
+
+// same as above, but all the packet queues use the lock-free ring
+class SimpleSwitch_IngressThreadsRingP4 : public SimpleSwitch_IngressThreadsP4 {
+ protected:
+  static void SetUpTestCase() {
+    start_switch(bm::QueueImpl::RING, "inproc://packets_ring");
+  }
+};
+
+TEST_F(SimpleSwitch_IngressThreadsRingP4, FlowOrder) {
+  send_flows(kNbPktsPerFlow);
+  ASSERT_TRUE(wait_for(kNbFlows * kNbPktsPerFlow));
+  check_order(kNbPktsPerFlow);
+}
+
+TEST_F(SimpleSwitch_IngressThreadsRingP4, FlowOrderDuringReconfig) {
+  std::thread sender(&SimpleSwitch_IngressThreadsP4::send_flows, this,
+                     kNbPktsPerFlow);
+
+  fs::path new_json_path = fs::path(testdata_dir) / fs::path(testdata_folder) /
+      fs::path("runtime_table_reconfig_new.json");
+  std::ifstream new_json(new_json_path.string(), std::ios::in);
+  std::istringstream plan("insert tabl ingress new_MyIngress.acl");
+  EXPECT_EQ(RuntimeReconfigErrorCode::SUCCESS,
+            static_cast<RuntimeReconfigErrorCode>(
+                test_switch->mt_runtime_reconfig_with_stream(
+                    0, &new_json, &plan)));
+
+  sender.join();
+  ASSERT_TRUE(wait_for(kNbFlows * kNbPktsPerFlow));
+  check_order(kNbPktsPerFlow);
+}
@@ -0,0 +1,153 @@
+/* Copyright 2013-present Barefoot Networks, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <bm/bm_sim/packet_pool.h>
+#include <bm/bm_sim/simple_pre_lag.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <boost/filesystem.hpp>
+
+#include "simple_switch.h"
+
+namespace fs = boost::filesystem;
+
+using bm::McSimplePreLAG;
+using bm::PacketPool;
+
+namespace {
+
+void
+packet_handler(int port_num, const char *buffer, int len, void *cookie) {
+  static_cast<SimpleSwitch *>(cookie)->receive(port_num, buffer, len);
+}
+
+uint64_t
+nb_buffers_allocated() {
+  const auto stats = PacketPool::get_buffer_stats();
+  return stats.hits + stats.misses;
+}
+
+}  // namespace
+
+// The program sends all packets to multicast group 1 and modifies none of the
+// headers, so the replicas can share the packet data all the way to the
+// transmit function.
+class SimpleSwitch_MulticastP4 : public ::testing::Test {
+ protected:
+  static constexpr int kNbReplicas = 6;
+
+  // Per-test-case set-up.
+  // We make the switch a shared resource for all tests. This is mainly because
+  // the simple_switch target detaches threads
+  static void SetUpTestCase() {
+    test_switch = new SimpleSwitch();
+
+    fs::path json_path = fs::path(testdata_dir) / fs::path(test_json);
+    test_switch->init_objects(json_path.string());
+
+    test_switch->set_dev_mgr_packet_in(0, "inproc://packets", nullptr);
+    test_switch->Switch::start();  // there is a start member in SimpleSwitch
+    test_switch->set_packet_handler(packet_handler,
+                                    static_cast<void *>(test_switch));
+    test_switch->set_transmit_fn(&SimpleSwitch_MulticastP4::transmit);
+    test_switch->start_and_return();
+
+    auto pre = test_switch->get_component<McSimplePreLAG>();
+    McSimplePreLAG::mgrp_hdl_t mgrp_hdl;
+    ASSERT_EQ(McSimplePreLAG::SUCCESS, pre->mc_mgrp_create(1, &mgrp_hdl));
+    for (int port = 1; port <= kNbReplicas; port++) {
+      McSimplePreLAG::PortMap port_map;
+      port_map[port] = true;
+      McSimplePreLAG::LagMap lag_map;
+      McSimplePreLAG::l1_hdl_t node_hdl;
+      ASSERT_EQ(McSimplePreLAG::SUCCESS,
+                pre->mc_node_create(port, port_map, lag_map, &node_hdl));
+      ASSERT_EQ(McSimplePreLAG::SUCCESS,
+                pre->mc_node_associate(mgrp_hdl, node_hdl));
+    }
+  }
+
+  // Per-test-case tear-down.
+  static void TearDownTestCase() {
+    delete test_switch;
+  }
+
+  // The first replica is held in the transmit function, so that the other ones
+  // are queued for transmission in the meantime and are transmitted while
+  // still sharing their data with each other.
+  static void transmit(bm::port_t port, bm::packet_id_t, const char *buffer,
+                       int len) {
+    std::unique_lock<std::mutex> lock(mutex);
+    if (received.empty()) {
+      lock.unlock();
+      std::this_thread::sleep_for(std::chrono::milliseconds(200));
+      lock.lock();
+    }
+    received.emplace_back(port, std::string(buffer, len));
+    cv.notify_all();
+  }
+
+  bool wait_for(size_t nb_pkts) {
+    std::unique_lock<std::mutex> lock(mutex);
+    return cv.wait_for(lock, std::chrono::seconds(10),
+                       [nb_pkts] { return received.size() >= nb_pkts; });
+  }
+
+ protected:
+  static SimpleSwitch *test_switch;
+  static std::mutex mutex;
+  static std::condition_variable cv;
+  static std::vector<std::pair<bm::port_t, std::string> > received;
+
+ private:
+  static const char testdata_dir[];
+  static const char test_json[];
+};
+
+SimpleSwitch *SimpleSwitch_MulticastP4::test_switch = nullptr;
+std::mutex SimpleSwitch_MulticastP4::mutex{};
+std::condition_variable SimpleSwitch_MulticastP4::cv{};
+std::vector<std::pair<bm::port_t, std::string> >
+SimpleSwitch_MulticastP4::received{};
+
+const char SimpleSwitch_MulticastP4::testdata_dir[] = TESTDATADIR;
+const char SimpleSwitch_MulticastP4::test_json[] = "multicast.json";
+
+// the data of the replicas is not copied, neither when replicating nor when
+// transmitting: the only buffer allocated is the one the packet is received in
+TEST_F(SimpleSwitch_MulticastP4, ReplicasAreNotCopied) {
+  const std::string pkt("\xab\x01\x02\x03\x04\x05\x06\x07", 8);
+  const auto nb_buffers = nb_buffers_allocated();
+  test_switch->receive(0, pkt.data(), pkt.size());
+  ASSERT_TRUE(wait_for(kNbReplicas));
+  EXPECT_EQ(1u, nb_buffers_allocated() - nb_buffers);
+
+  std::unique_lock<std::mutex> lock(mutex);
+  std::set<bm::port_t> ports;
+  for (const auto &p : received) {
+    ports.insert(p.first);
+    EXPECT_EQ(pkt, p.second);
+  }
+  EXPECT_EQ(static_cast<size_t>(kNbReplicas), ports.size());
+}
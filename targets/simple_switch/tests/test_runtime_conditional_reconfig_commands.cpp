@@ -114,9 +114,11 @@ TEST_F(RuntimeConditionalReconfigCommandTest, DuplicateInsert) {
 TEST_F(RuntimeConditionalReconfigCommandTest, UnfoundInsertConditional) {
     std::stringstream reconfig_commands_ss("insert cond ingress new_node_unfound");
 
-    ASSERT_THROW(sw->mt_runtime_reconfig_with_stream(cxt_id, 
-                                                    new_json_file_stream, 
-                                                    &reconfig_commands_ss), std::out_of_range);
+    ASSERT_EQ(RuntimeReconfigErrorCode::UNFOUND_ID_ERROR, 
+        static_cast<RuntimeReconfigErrorCode>(
+            sw->mt_runtime_reconfig_with_stream(cxt_id, 
+                                                new_json_file_stream, 
+                                                &reconfig_commands_ss)));
 }
 
 // test change
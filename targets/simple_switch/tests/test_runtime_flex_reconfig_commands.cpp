@@ -129,17 +129,21 @@ TEST_F(RuntimeFlexReconfigCommandTest, DuplicateInsert) {
 TEST_F(RuntimeFlexReconfigCommandTest, InvalidInsertCommandWithUnfoundTrueNextEdge) {
     std::istringstream reconfig_commands_ss("insert flex ingress flx_TE5 null old_MyIngress.unfound");
 
-    ASSERT_THROW(sw->mt_runtime_reconfig_with_stream(cxt_id, 
+    ASSERT_EQ(RuntimeReconfigErrorCode::UNFOUND_ID_ERROR, 
+        static_cast<RuntimeReconfigErrorCode>(
+            sw->mt_runtime_reconfig_with_stream(cxt_id, 
                                                 new_json_file_stream, 
-                                                &reconfig_commands_ss), std::exception);
+                                                &reconfig_commands_ss)));
 }
 
 TEST_F(RuntimeFlexReconfigCommandTest, InvalidInsertCommandWithUnfoundFalseNextEdge) {
     std::istringstream reconfig_commands_ss("insert flex ingress flx_TE5 old_MyIngress.unfound null");
 
-    ASSERT_THROW(sw->mt_runtime_reconfig_with_stream(cxt_id, 
+    ASSERT_EQ(RuntimeReconfigErrorCode::UNFOUND_ID_ERROR, 
+        static_cast<RuntimeReconfigErrorCode>(
+            sw->mt_runtime_reconfig_with_stream(cxt_id, 
                                                 new_json_file_stream, 
-                                                &reconfig_commands_ss), std::exception);
+                                                &reconfig_commands_ss)));
 }
 
 // test change
@@ -234,4 +238,37 @@ TEST_F(RuntimeFlexReconfigCommandTest, UnfoundDeleteTarget) {
             sw->mt_runtime_reconfig_with_stream(cxt_id, 
                                                 new_json_file_stream,
                                                 &reconfig_commands_ss)));
-}
\ No newline at end of file
+}
+// test trigger
+
+TEST_F(RuntimeFlexReconfigCommandTest, ValidScheduledTrigger) {
+    std::istringstream reconfig_commands_ss(
+        "trigger on after_packets 100\n"
+        "trigger off at_time_ms 4102444800000");
+
+    ASSERT_EQ(RuntimeReconfigErrorCode::SUCCESS, 
+        static_cast<RuntimeReconfigErrorCode>(
+            sw->mt_runtime_reconfig_with_stream(cxt_id, 
+                                                new_json_file_stream,
+                                                &reconfig_commands_ss)));
+}
+
+TEST_F(RuntimeFlexReconfigCommandTest, InvalidTriggerSchedule) {
+    std::istringstream reconfig_commands_ss("trigger on at_packet 100");
+
+    ASSERT_EQ(RuntimeReconfigErrorCode::INVALID_COMMAND_ERROR, 
+        static_cast<RuntimeReconfigErrorCode>(
+            sw->mt_runtime_reconfig_with_stream(cxt_id, 
+                                                new_json_file_stream,
+                                                &reconfig_commands_ss)));
+}
+
+TEST_F(RuntimeFlexReconfigCommandTest, MissingTriggerThreshold) {
+    std::istringstream reconfig_commands_ss("trigger on after_packets");
+
+    ASSERT_EQ(RuntimeReconfigErrorCode::INVALID_COMMAND_ERROR, 
+        static_cast<RuntimeReconfigErrorCode>(
+            sw->mt_runtime_reconfig_with_stream(cxt_id, 
+                                                new_json_file_stream,
+                                                &reconfig_commands_ss)));
+}
@@ -1,12 +1,16 @@
 #include <gtest/gtest.h>
 
 #include <bm/bm_sim/P4Objects.h>
+#include <bm/bm_sim/packet.h>
+#include <bm/bm_sim/phv_source.h>
+#include <bm/bm_sim/runtime_reconfig_plan.h>
 
 #include <ctype.h>
 
 #include <algorithm>  // std::all_of
 #include <fstream>
 #include <map>
+#include <memory>
 #include <sstream>
 #include <string>
 #include <set>
@@ -54,4 +58,56 @@ TEST_F(RuntimeFlexReconfigTriggerTest, FlexHeaderAndParserCheck) {
     ASSERT_EQ(8, p4objects.get_phv_factory().get_header_type(0).get_finfo(flex_header_offset).bitwidth);
 
     ASSERT_NE(nullptr, p4objects.get_parse_state_rt("parser", "flex_start"));
-}
\ No newline at end of file
+}
+
+TEST_F(RuntimeFlexReconfigTriggerTest, TriggerSetsPacketVersion) {
+    std::unique_ptr<PHVSourceIface> phv_source(PHVSourceIface::make_phv_source());
+    phv_source->set_phv_factory(0, &p4objects.get_phv_factory());
+    Parser *parser = p4objects.get_parser("parser");
+    const char data[64] = {0};
+    auto parse_packet = [&]() {
+        auto pkt = Packet::make_new(sizeof(data), PacketBuffer(128, data, sizeof(data)),
+                                    phv_source.get());
+        parser->parse(&pkt);
+        return pkt.get_phv()->get_field("scalars.flexMetadata.version").get<int>();
+    };
+
+    const FlexVersion &version = p4objects.get_flex_version();
+    ASSERT_EQ(0, parse_packet());
+    p4objects.flex_trigger_rt(true);
+    ASSERT_EQ(1, parse_packet());
+    p4objects.flex_trigger_rt(false);
+    ASSERT_EQ(0, parse_packet());
+
+    // the next 2 packets keep the old version
+    ASSERT_TRUE(p4objects.flex_trigger_at_packet_rt(true, version.get_packet_count() + 2));
+    ASSERT_EQ(0, parse_packet());
+    ASSERT_EQ(0, parse_packet());
+    ASSERT_EQ(1, parse_packet());
+    ASSERT_EQ(1, parse_packet());
+
+    ASSERT_EQ(7u, version.get_packet_count());
+    ASSERT_EQ(4u, version.get_packet_count(0));
+    ASSERT_EQ(3u, version.get_packet_count(1));
+}
+
+TEST_F(RuntimeFlexReconfigTriggerTest, TriggerAppliedAfterPublish) {
+    std::istringstream plan_ss("insert flex ingress flx_TE0 old_MyIngress.mark_tos old_MyIngress.ipv4_lpm\n"
+                               "change init ingress flx_TE0\n"
+                               "trigger on");
+    ReconfigPlan plan;
+    std::unordered_map<std::string, std::string> id2newNodeName;
+    ASSERT_EQ(RuntimeReconfigErrorCode::SUCCESS, plan.parse(&plan_ss));
+    ASSERT_EQ(RuntimeReconfigErrorCode::SUCCESS, plan.validate(p4objects, id2newNodeName));
+
+    const auto graph_version = p4objects.get_control_flow_graph_version_rt();
+    plan.commit(&p4objects, &id2newNodeName, nullptr);
+    // the new graph is not published yet, packets must not switch version
+    ASSERT_EQ(0, p4objects.get_flex_version().get_version());
+    ASSERT_EQ(graph_version, p4objects.get_control_flow_graph_version_rt());
+
+    p4objects.publish_control_flow_graph_rt();
+    ASSERT_NE(graph_version, p4objects.get_control_flow_graph_version_rt());
+    plan.apply_triggers(&p4objects, nullptr);
+    ASSERT_EQ(1, p4objects.get_flex_version().get_version());
+}
@@ -113,9 +113,11 @@ TEST_F(RuntimeTableReconfigCommandTest, DuplicateInsert) {
 TEST_F(RuntimeTableReconfigCommandTest, UnfoundInsertTable) {
     std::stringstream reconfig_commands_ss("insert tabl ingress new_MyIngress.unfound");
 
-    ASSERT_THROW(sw->mt_runtime_reconfig_with_stream(cxt_id, 
-                                                    new_json_file_stream, 
-                                                    &reconfig_commands_ss), std::out_of_range);
+    ASSERT_EQ(RuntimeReconfigErrorCode::UNFOUND_ID_ERROR, 
+        static_cast<RuntimeReconfigErrorCode>(
+            sw->mt_runtime_reconfig_with_stream(cxt_id, 
+                                                new_json_file_stream, 
+                                                &reconfig_commands_ss)));
 }
 
 // test change
@@ -241,4 +243,76 @@ TEST_F(RuntimeTableReconfigCommandTest, UnfoundDeleteTarget) {
             sw->mt_runtime_reconfig_with_stream(cxt_id, 
                                                 new_json_file_stream, 
                                                 &reconfig_commands_ss)));
-}
\ No newline at end of file
+}
+
+// test plan
+
+TEST_F(RuntimeTableReconfigCommandTest, InvalidPlanIsNotApplied) {
+    std::stringstream reconfig_commands_ss("delete tabl ingress old_MyIngress.mark_tos\n"
+                                           "delete tabl ingress new_MyIngress.unfound");
+
+    ASSERT_EQ(RuntimeReconfigErrorCode::UNFOUND_ID_ERROR, 
+        static_cast<RuntimeReconfigErrorCode>(
+            sw->mt_runtime_reconfig_with_stream(cxt_id, 
+                                                new_json_file_stream, 
+                                                &reconfig_commands_ss)));
+    ASSERT_NE(nullptr, sw->get_p4objects_rt()->get_abstract_match_table_rt("MyIngress.mark_tos"));
+}
+
+TEST_F(RuntimeTableReconfigCommandTest, UnknownOperationIsRejected) {
+    std::stringstream reconfig_commands_ss("delete tabl ingress old_MyIngress.mark_tos\n"
+                                           "remove tabl ingress old_MyIngress.ipv4_lpm");
+
+    ASSERT_EQ(RuntimeReconfigErrorCode::INVALID_COMMAND_ERROR, 
+        static_cast<RuntimeReconfigErrorCode>(
+            sw->mt_runtime_reconfig_with_stream(cxt_id, 
+                                                new_json_file_stream, 
+                                                &reconfig_commands_ss)));
+    ASSERT_NE(nullptr, sw->get_p4objects_rt()->get_abstract_match_table_rt("MyIngress.mark_tos"));
+}
+
+TEST_F(RuntimeTableReconfigCommandTest, StepLatencyStats) {
+    sw->mt_runtime_reconfig_reset_stats(cxt_id);
+    std::stringstream reconfig_commands_ss("insert tabl ingress new_MyIngress.ipv4_lpm\n"
+                                           "\n"
+                                           "change tabl ingress new_MyIngress.ipv4_lpm base_default_next null");
+
+    ASSERT_EQ(RuntimeReconfigErrorCode::SUCCESS, 
+        static_cast<RuntimeReconfigErrorCode>(
+            sw->mt_runtime_reconfig_with_stream(cxt_id, 
+                                                new_json_file_stream, 
+                                                &reconfig_commands_ss)));
+    const std::string stats = sw->mt_runtime_reconfig_get_stats(cxt_id);
+    for (const char *name : {"insert_tabl", "change_tabl", "prepare", "commit", "publish", "total"}) {
+        ASSERT_NE(std::string::npos, stats.find(name)) << stats;
+    }
+    // the plan only edits the control flow graph, packets are not stopped
+    ASSERT_EQ(std::string::npos, stats.find("quiesce")) << stats;
+}
+
+// test delta JSON
+
+TEST_F(RuntimeTableReconfigCommandTest, InsertFromDeltaJson) {
+    std::istringstream empty_json_ss("{}");
+    std::stringstream delete_commands_ss("delete tabl ingress new_MyIngress.acl");
+
+    ASSERT_EQ(RuntimeReconfigErrorCode::SUCCESS, 
+        static_cast<RuntimeReconfigErrorCode>(
+            sw->mt_runtime_reconfig_with_stream(cxt_id, 
+                                                &empty_json_ss, 
+                                                &delete_commands_ss)));
+
+    fs::path delta_json_path = fs::path(testdata_dir) / fs::path(testdata_folder) / fs::path("runtime_table_reconfig_delta.json");
+    std::ifstream delta_json_fs(delta_json_path.string(), std::ios::in);
+    std::stringstream reconfig_commands_ss("insert tabl ingress new_MyIngress.acl\n"
+                                           "change tabl ingress new_MyIngress.acl MyIngress.allow old_MyIngress.mark_tos");
+
+    ASSERT_EQ(RuntimeReconfigErrorCode::SUCCESS, 
+        static_cast<RuntimeReconfigErrorCode>(
+            sw->mt_runtime_reconfig_with_stream(cxt_id, 
+                                                &delta_json_fs, 
+                                                &reconfig_commands_ss)));
+    // only the inserted table is loaded from the new program
+    ASSERT_EQ(nullptr, sw->get_p4objects_new()->get_abstract_match_table_rt("MyIngress.mark_tos"));
+    ASSERT_EQ(nullptr, sw->get_p4objects_new()->get_abstract_match_table_rt("MyIngress.ipv4_lpm"));
+}
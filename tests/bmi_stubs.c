@@ -43,12 +43,25 @@ int bmi_set_packet_handler(bmi_port_mgr_t *port_mgr,
   return 0;
 }
 
+int bmi_set_burst_handler(bmi_port_mgr_t *port_mgr,
+                          bmi_burst_handler_t burst_handler,
+                          int max_burst, void *cookie) {
+  UNUSED(port_mgr); UNUSED(burst_handler); UNUSED(max_burst); UNUSED(cookie);
+  return 0;
+}
+
 int bmi_port_send(bmi_port_mgr_t *port_mgr, int port_num,
                   const char *buffer, int len) {
   UNUSED(port_mgr); UNUSED(port_num); UNUSED(buffer); UNUSED(len);
   return 0;
 }
 
+int bmi_port_send_burst(bmi_port_mgr_t *port_mgr,
+                        const bmi_packet_t *packets, int count) {
+  UNUSED(port_mgr); UNUSED(packets); UNUSED(count);
+  return 0;
+}
+
 int bmi_port_interface_add(bmi_port_mgr_t *port_mgr,
                            const char *ifname, int port_num,
                            const char *pcap_input_dump,
@@ -0,0 +1,278 @@
+/* Copyright 2013-present Barefoot Networks, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Benchmark for the LPM lookup structures, on full-sized IPv4 and IPv6 routing
+// tables. The default byte trie is compared with the structures selected by
+// LookupStructureFactory::set_multibit_lpm_min_size (DIR-24-8 for IPv4, the
+// multibit trie for IPv6): build time, memory and lookup rate (one key at a
+// time and in batches), after checking that they return the same results.
+// Usage: test_LPM_lookup_1 [ipv4_routes [ipv6_routes]]
+// where the route files have one prefix per line (e.g. "10.0.0.0/8" or
+// "2001:db8::/32"), for example a dump of a BGP table. Without them, tables
+// with 900k IPv4 and 200k IPv6 prefixes are generated, with a distribution of
+// prefix lengths close to the one observed in the global BGP tables.
+
+#include <bm/bm_sim/lookup_structures.h>
+
+#include <arpa/inet.h>
+#include <malloc.h>
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "stress_utils.h"
+
+using ::stress_tests_utils::RandomGen;
+
+namespace {
+
+using clock_ = std::chrono::high_resolution_clock;
+
+constexpr size_t nb_lookups = 1000000;
+
+struct Route {
+  bm::ByteContainer prefix;
+  int prefix_length;
+};
+
+// memory allocated with malloc, which unlike the RSS does not depend on
+// whether memory freed by a previous run gets reused
+size_t get_allocated_bytes() {
+  const auto info = mallinfo2();
+  return info.uordblks + info.hblkhd;
+}
+
+void mask_prefix(bm::ByteContainer *prefix, int prefix_length) {
+  for (size_t i = 0; i < prefix->size(); i++) {
+    const int nbits =
+        std::max(0, std::min(8, prefix_length - 8 * static_cast<int>(i)));
+    (*prefix)[i] &= static_cast<char>(0xff00 >> nbits);
+  }
+}
+
+bool read_routes(const std::string &path, int af, std::vector<Route> *routes) {
+  std::ifstream fs(path);
+  if (!fs) return false;
+  const size_t nbytes = (af == AF_INET) ? 4 : 16;
+  std::string line;
+  while (std::getline(fs, line)) {
+    const auto slash = line.find('/');
+    if (slash == std::string::npos) continue;
+    char addr[16];
+    if (inet_pton(af, line.substr(0, slash).c_str(), addr) != 1) continue;
+    Route route{bm::ByteContainer(addr, nbytes),
+                std::stoi(line.substr(slash + 1))};
+    mask_prefix(&route.prefix, route.prefix_length);
+    routes->push_back(std::move(route));
+  }
+  return true;
+}
+
+// (prefix length, weight) pairs, roughly matching the global tables; half of
+// the prefixes are more specifics of a previous one
+void generate_routes(RandomGen *rgen, size_t nbytes, size_t nb_routes,
+                     const std::vector<std::pair<int, int> > &lengths,
+                     std::vector<Route> *routes) {
+  int total_weight = 0;
+  for (const auto &p : lengths) total_weight += p.second;
+  while (routes->size() < nb_routes) {
+    int r = rgen->get_int(0, total_weight - 1);
+    size_t l = 0;
+    for (; r >= lengths[l].second; l++) r -= lengths[l].second;
+    Route route{bm::ByteContainer(nbytes), lengths[l].first};
+    for (size_t i = 0; i < nbytes; i++)
+      route.prefix[i] = static_cast<char>(rgen->get_int(0, 255));
+    if (!routes->empty() && rgen->get_bool(0.5)) {
+      const auto &parent =
+          (*routes)[rgen->get_int(0, static_cast<int>(routes->size()) - 1)];
+      if (parent.prefix_length < route.prefix_length) {
+        for (int b = 0; b < parent.prefix_length; b++) {
+          const char bit = static_cast<char>(0x80 >> (b % 8));
+          route.prefix[b / 8] = static_cast<char>(
+              (route.prefix[b / 8] & ~bit) | (parent.prefix[b / 8] & bit));
+        }
+      }
+    }
+    if (nbytes == 4) {  // unicast space
+      route.prefix[0] = static_cast<char>(rgen->get_int(1, 223));
+    } else {  // 2000::/3
+      route.prefix[0] = static_cast<char>(0x20 | (route.prefix[0] & 0x1f));
+    }
+    mask_prefix(&route.prefix, route.prefix_length);
+    routes->push_back(std::move(route));
+  }
+}
+
+// half of the keys fall under a route, the other half are random
+std::vector<bm::ByteContainer> generate_keys(RandomGen *rgen,
+                                             const std::vector<Route> &routes) {
+  std::vector<bm::ByteContainer> keys;
+  const size_t nbytes = routes.front().prefix.size();
+  for (size_t k = 0; k < nb_lookups; k++) {
+    bm::ByteContainer key(nbytes);
+    for (size_t i = 0; i < nbytes; i++)
+      key[i] = static_cast<char>(rgen->get_int(0, 255));
+    if (k % 2 == 0) {
+      const auto &route =
+          routes[rgen->get_int(0, static_cast<int>(routes.size()) - 1)];
+      for (int b = 0; b < route.prefix_length; b++) {
+        const char bit = static_cast<char>(0x80 >> (b % 8));
+        key[b / 8] = static_cast<char>(
+            (key[b / 8] & ~bit) | (route.prefix[b / 8] & bit));
+      }
+    }
+    keys.push_back(std::move(key));
+  }
+  return keys;
+}
+
+struct Results {
+  std::vector<bm::internal_handle_t> handles;
+  std::unique_ptr<bool[]> hits;
+};
+
+template <typename F>
+double measure(F f) {
+  auto start_tp = clock_::now();
+  f();
+  auto end_tp = clock_::now();
+  return std::chrono::duration<double>(end_tp - start_tp).count();
+}
+
+// returns false if the results differ from the reference ones (if any)
+bool bench(const std::string &name, bm::LookupStructureFactory *factory,
+           const std::vector<Route> &routes,
+           const std::vector<bm::ByteContainer> &keys,
+           Results *ref_results,
+           std::unique_ptr<bm::LPMLookupStructure> *lookup_structure) {
+  const size_t nbytes = routes.front().prefix.size();
+  const auto mem_before = get_allocated_bytes();
+  double build_time = measure([&] {
+      *lookup_structure = factory->create_for_LPM(routes.size(), nbytes);
+      for (size_t i = 0; i < routes.size(); i++) {
+        (*lookup_structure)->add_entry(
+            bm::LPMMatchKey(routes[i].prefix, routes[i].prefix_length, 0), i);
+      }
+    });
+  const auto mem_after = get_allocated_bytes();
+
+  Results results;
+  results.handles.resize(keys.size());
+  results.hits.reset(new bool[keys.size()]);
+  double single_time = measure([&] {
+      for (size_t i = 0; i < keys.size(); i++) {
+        results.hits[i] =
+            (*lookup_structure)->lookup(keys[i], &results.handles[i]);
+      }
+    });
+
+  Results batch_results;
+  batch_results.handles.resize(keys.size());
+  batch_results.hits.reset(new bool[keys.size()]);
+  constexpr size_t batch_size = 64;
+  double batch_time = measure([&] {
+      for (size_t i = 0; i < keys.size(); i += batch_size) {
+        const size_t n = std::min(batch_size, keys.size() - i);
+        (*lookup_structure)->lookup_batch(
+            &keys[i], n, &batch_results.handles[i], &batch_results.hits[i]);
+      }
+    });
+
+  std::cout << "  " << name << ": built in " << build_time << " s, "
+            << static_cast<double>(mem_after - mem_before) / routes.size()
+            << " bytes per prefix, "
+            << static_cast<size_t>(keys.size() / single_time)
+            << " lookups/s, "
+            << static_cast<size_t>(keys.size() / batch_time)
+            << " lookups/s in batches of " << batch_size << std::endl;
+
+  if (!ref_results->hits) {
+    *ref_results = std::move(results);
+    return true;
+  }
+  for (size_t i = 0; i < keys.size(); i++) {
+    for (const auto *r : {&results, &batch_results}) {
+      if (r->hits[i] != ref_results->hits[i] ||
+          (r->hits[i] && r->handles[i] != ref_results->handles[i])) {
+        std::cerr << name << ": results differ from the byte trie"
+                  << std::endl;
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+bool run(const std::string &title, const std::vector<Route> &routes,
+         RandomGen *rgen) {
+  std::cout << title << ", " << routes.size() << " prefixes, " << nb_lookups
+            << " lookups" << std::endl;
+  const auto keys = generate_keys(rgen, routes);
+  bm::LookupStructureFactory trie_factory;
+  bm::LookupStructureFactory multibit_factory;
+  multibit_factory.set_multibit_lpm_min_size(0);
+  Results ref_results;
+  std::unique_ptr<bm::LPMLookupStructure> trie, multibit;
+  return bench("byte trie", &trie_factory, routes, keys, &ref_results,
+               &trie) &&
+      bench(routes.front().prefix.size() == 4 ? "DIR-24-8" : "multibit trie",
+            &multibit_factory, routes, keys, &ref_results, &multibit);
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  RandomGen rgen;
+
+  std::vector<Route> routes_v4;
+  if (argc > 1) {
+    if (!read_routes(argv[1], AF_INET, &routes_v4)) {
+      std::cerr << "Cannot read " << argv[1] << std::endl;
+      return 1;
+    }
+  } else {
+    generate_routes(&rgen, 4, 900000,
+                    {{8, 1}, {12, 2}, {14, 4}, {15, 6}, {16, 130}, {17, 80},
+                     {18, 140}, {19, 250}, {20, 420}, {21, 520}, {22, 1100},
+                     {23, 950}, {24, 5800}, {25, 2}, {28, 2}, {32, 5}},
+                    &routes_v4);
+  }
+  if (!routes_v4.empty() && !run("IPv4", routes_v4, &rgen)) return 1;
+
+  std::vector<Route> routes_v6;
+  if (argc > 2) {
+    if (!read_routes(argv[2], AF_INET6, &routes_v6)) {
+      std::cerr << "Cannot read " << argv[2] << std::endl;
+      return 1;
+    }
+  } else {
+    generate_routes(&rgen, 16, 200000,
+                    {{16, 1}, {19, 1}, {20, 3}, {24, 6}, {28, 30}, {29, 380},
+                     {30, 60}, {31, 30}, {32, 1400}, {33, 100}, {34, 100},
+                     {35, 60}, {36, 300}, {40, 650}, {42, 120}, {44, 850},
+                     {45, 60}, {46, 260}, {47, 220}, {48, 4800}, {56, 80},
+                     {64, 40}},
+                    &routes_v6);
+  }
+  if (!routes_v6.empty() && !run("IPv6", routes_v6, &rgen)) return 1;
+
+  return 0;
+}
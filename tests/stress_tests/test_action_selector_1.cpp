@@ -0,0 +1,202 @@
+/* Copyright 2013-present Barefoot Networks, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// this test compares the default member selection of action selectors (hash %
+// number of members) with resilient hashing (ResilientGroupSelection), for one
+// group of n members: fraction of the flows which are remapped when a member is
+// removed from the group and when a member is added back, and average cost of a
+// lookup in the indirect table.
+
+#include <bm/bm_sim/tables.h>
+#include <bm/bm_sim/resilient_group_selection.h>
+
+#include <array>
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <cassert>
+
+#include "stress_utils.h"
+
+using ::stress_tests_utils::RandomGen;
+
+using bm::ActionProfile;
+using bm::MatchTableIndirectWS;
+
+namespace {
+
+using mbr_hdl_t = ActionProfile::mbr_hdl_t;
+using grp_hdl_t = ActionProfile::grp_hdl_t;
+using Flow = std::array<int, 3>;
+
+constexpr size_t nb_flows = 10000;
+
+void check_rc(bm::MatchErrorCode rc) {
+  _BM_UNUSED(rc);
+  assert(rc == bm::MatchErrorCode::SUCCESS);
+}
+
+class SelectorTest {
+ public:
+  SelectorTest(size_t nb_members,
+               std::shared_ptr<ActionProfile::GroupSelectionIface> selector)
+      : action_profile("act_prof", 0, true),
+        header_type("test_t", 0), action_fn("action", 0, 1),
+        phv_source(bm::PHVSourceIface::make_phv_source()) {
+    header_type.push_back_field("f16", 16);
+    header_type.push_back_field("f48", 48);
+    phv_factory.push_back_header("test1", header1, header_type);
+    phv_factory.push_back_header("test2", header2, header_type);
+    phv_source->set_phv_factory(0, &phv_factory);
+    key_builder.push_back_field(header1, 0, 16, bm::MatchKeyParam::Type::EXACT);
+
+    table = MatchTableIndirectWS::create("exact", "test_table", 0, 16,
+                                         key_builder, &lookup_factory,
+                                         false, false);
+    table->set_next_node(0, nullptr);
+    table->set_action_profile(&action_profile);
+
+    bm::BufBuilder builder;
+    builder.push_back_field(header1, 1);
+    builder.push_back_field(header2, 0);
+    builder.push_back_field(header2, 1);
+    action_profile.set_hash(std::unique_ptr<bm::Calculation>(
+        new bm::Calculation(builder, "xxh64")));
+    if (selector) action_profile.set_group_selector(selector);
+
+    check_rc(action_profile.create_group(&grp));
+    // member i has action data i, member nb_members is not in the group
+    for (size_t i = 0; i <= nb_members; i++) {
+      bm::ActionData action_data;
+      action_data.push_back_action_data(static_cast<unsigned int>(i));
+      mbr_hdl_t mbr;
+      check_rc(action_profile.add_member(&action_fn, std::move(action_data),
+                                         &mbr));
+      mbrs.push_back(mbr);
+      if (i < nb_members)
+        check_rc(action_profile.add_member_to_group(mbr, grp));
+    }
+
+    bm::entry_handle_t handle;
+    std::vector<bm::MatchKeyParam> match_key;
+    match_key.emplace_back(bm::MatchKeyParam::Type::EXACT, "\x0a\xba");
+    check_rc(table->add_entry_ws(match_key, grp, &handle));
+  }
+
+  // returns the member selected for each flow
+  std::vector<unsigned int> select(const std::vector<Flow> &flows) {
+    auto pkt = bm::Packet::make_new(64, bm::PacketBuffer(128),
+                                    phv_source.get());
+    auto phv = pkt.get_phv();
+    phv->get_header(header1).mark_valid();
+    phv->get_header(header2).mark_valid();
+    phv->get_field(header1, 0).set("0xaba");
+    std::vector<unsigned int> selected;
+    selected.reserve(flows.size());
+    bool hit;
+    bm::entry_handle_t handle;
+    const bm::ControlFlowNode *next_node;
+    for (const auto &flow : flows) {
+      phv->get_field(header1, 1).set(flow[0]);
+      phv->get_field(header2, 0).set(flow[1]);
+      phv->get_field(header2, 1).set(flow[2]);
+      const auto &entry = table->lookup(pkt, &hit, &handle, &next_node);
+      assert(hit);
+      selected.push_back(
+          entry.action_fn.get_action_data_at(0).get<unsigned int>());
+    }
+    return selected;
+  }
+
+  void remove_member(size_t i) {
+    check_rc(action_profile.remove_member_from_group(mbrs.at(i), grp));
+  }
+
+  void add_member(size_t i) {
+    check_rc(action_profile.add_member_to_group(mbrs.at(i), grp));
+  }
+
+ private:
+  bm::LookupStructureFactory lookup_factory{};
+  bm::PHVFactory phv_factory{};
+  bm::MatchKeyBuilder key_builder{};
+  ActionProfile action_profile;
+  std::unique_ptr<MatchTableIndirectWS> table{nullptr};
+  bm::HeaderType header_type;
+  bm::header_id_t header1{0}, header2{1};
+  bm::ActionFn action_fn;
+  std::unique_ptr<bm::PHVSourceIface> phv_source;
+  grp_hdl_t grp{};
+  std::vector<mbr_hdl_t> mbrs{};
+};
+
+double remapped(const std::vector<unsigned int> &before,
+                const std::vector<unsigned int> &after) {
+  size_t cnt = 0;
+  for (size_t i = 0; i < before.size(); i++)
+    if (before[i] != after[i]) cnt++;
+  return static_cast<double>(cnt) / before.size();
+}
+
+void run(const std::string &name, size_t nb_members,
+         std::shared_ptr<ActionProfile::GroupSelectionIface> selector,
+         const std::vector<Flow> &flows, size_t num_repeats) {
+  using clock = std::chrono::high_resolution_clock;
+  SelectorTest test(nb_members, selector);
+
+  const auto start_tp = clock::now();
+  std::vector<unsigned int> selected;
+  for (size_t iter = 0; iter < num_repeats; iter++)
+    selected = test.select(flows);
+  const auto end_tp = clock::now();
+  const auto elapsed_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+      end_tp - start_tp).count();
+
+  // member nb_members / 2 leaves the group, then member nb_members joins it
+  test.remove_member(nb_members / 2);
+  const auto selected_remove = test.select(flows);
+  test.add_member(nb_members);
+  const auto selected_add = test.select(flows);
+
+  std::cout << name << ", " << nb_members << " members: "
+            << elapsed_ns / static_cast<double>(flows.size() * num_repeats)
+            << " ns per lookup, "
+            << 100. * remapped(selected, selected_remove)
+            << "% of flows remapped on member removal, "
+            << 100. * remapped(selected_remove, selected_add)
+            << "% on member addition (ideal: "
+            << 100. / nb_members << "%)\n";
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  size_t num_repeats = 20;
+  if (argc > 1) num_repeats = std::stoul(argv[1]);
+
+  RandomGen rgen;
+  std::vector<Flow> flows(nb_flows);
+  for (auto &flow : flows)
+    for (auto &v : flow) v = rgen.get_int(0, 0xffff);
+
+  for (const size_t nb_members : {16, 128, 512}) {
+    run("default", nb_members, nullptr, flows, num_repeats);
+    run("resilient", nb_members,
+        std::make_shared<bm::ResilientGroupSelection>(), flows, num_repeats);
+  }
+}
@@ -0,0 +1,170 @@
+/* Copyright 2013-present Barefoot Networks, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// this test updates the IPv4 header checksum (csum16 over the IPv4 fields) of
+// parsed packets whose header was left unmodified, had its TTL decremented or
+// its TTL decremented and destination address rewritten. Reports the average
+// cost of an update when the checksum is computed from scratch and when it is
+// updated incrementally (RFC 1624) from the value verified by the parser, and
+// checks that both give the same result.
+
+#include <bm/bm_sim/calculations.h>
+#include <bm/bm_sim/checksums.h>
+#include <bm/bm_sim/packet.h>
+#include <bm/bm_sim/parser.h>
+#include <bm/bm_sim/phv.h>
+#include <bm/bm_sim/phv_source.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "stress_utils.h"
+
+using ::stress_tests_utils::RandomGen;
+
+namespace {
+
+// few enough for the PHVs to stay in cache, as they would in a pipeline
+constexpr size_t nb_packets = 16;
+
+// Ethernet + IPv4 (with a correct checksum) + 4 bytes of payload
+const unsigned char frame[] = {
+  0x00, 0x18, 0x0a, 0x05, 0x5a, 0x10, 0xa0, 0x88,
+  0x69, 0x0c, 0xc3, 0x03, 0x08, 0x00, 0x45, 0x00,
+  0x00, 0x34, 0x70, 0x90, 0x40, 0x00, 0x40, 0x06,
+  0x35, 0x08, 0x0a, 0x36, 0xc1, 0x21, 0x4e, 0x28,
+  0x7b, 0xac, 0xa2, 0x97, 0x00, 0x50
+};
+
+enum class Rewrite { NONE, TTL, TTL_AND_DST };
+
+class ChecksumTest {
+ public:
+  explicit ChecksumTest(bool incremental)
+      : ethernet_type("ethernet_t", 0), ipv4_type("ipv4_t", 1),
+        ethernet_state("parse_ethernet", 0), ipv4_state("parse_ipv4", 1),
+        error_codes(bm::ErrorCodeMap::make_with_core()),
+        parser("parser", 0, &error_codes),
+        phv_source(bm::PHVSourceIface::make_phv_source()) {
+    ethernet_type.push_back_field("dstAddr", 48);
+    ethernet_type.push_back_field("srcAddr", 48);
+    ethernet_type.push_back_field("etherType", 16);
+    for (const auto &f : {std::make_pair("version", 4), {"ihl", 4},
+                          {"diffserv", 8}, {"totalLen", 16},
+                          {"identification", 16}, {"flags", 3},
+                          {"fragOffset", 13}, {"ttl", 8}, {"protocol", 8},
+                          {"hdrChecksum", 16}, {"srcAddr", 32},
+                          {"dstAddr", 32}}) {
+      ipv4_type.push_back_field(f.first, f.second);
+    }
+    phv_factory.push_back_header("ethernet", ethernet, ethernet_type);
+    phv_factory.push_back_header("ipv4", ipv4, ipv4_type);
+    phv_source->set_phv_factory(0, &phv_factory);
+
+    bm::ParseSwitchKeyBuilder key_builder;
+    key_builder.push_back_field(ethernet, 2, 16);
+    ethernet_state.set_key_builder(key_builder);
+    ethernet_state.add_extract(ethernet);
+    ethernet_state.add_switch_case(2, "\x08\x00", &ipv4_state);
+    ipv4_state.add_extract(ipv4);
+    parser.set_init_state(&ethernet_state);
+
+    bm::BufBuilder builder;
+    for (int f : {0, 1, 2, 3, 4, 5, 6, 7, 8, 10, 11})
+      builder.push_back_field(ipv4, f);
+    calculation = std::unique_ptr<bm::NamedCalculation>(
+        new bm::NamedCalculation("ipv4_checksum_calc", 0, builder, "csum16"));
+    checksum = std::unique_ptr<bm::CalcBasedChecksum>(
+        new bm::CalcBasedChecksum("ipv4_checksum", 0, ipv4, 9,
+                                  calculation.get()));
+    if (incremental) checksum->set_verifier(checksum.get());
+    parser.add_checksum(checksum.get());
+  }
+
+  // returns the time spent updating the checksums, in ns
+  double run(Rewrite rewrite, RandomGen *rgen) {
+    std::vector<bm::Packet> packets;
+    packets.reserve(nb_packets);
+    for (size_t i = 0; i < nb_packets; i++) {
+      packets.push_back(bm::Packet::make_new(
+          sizeof(frame),
+          bm::PacketBuffer(128, reinterpret_cast<const char *>(frame),
+                           sizeof(frame)),
+          phv_source.get()));
+      auto &pkt = packets.back();
+      parser.parse(&pkt);
+      auto phv = pkt.get_phv();
+      if (rewrite != Rewrite::NONE) {
+        auto &ttl = phv->get_field(ipv4, 7);
+        ttl.set(ttl.get_uint() - 1);
+      }
+      if (rewrite == Rewrite::TTL_AND_DST)
+        phv->get_field(ipv4, 11).set(rgen->get_int(0, 0x7fffffff));
+    }
+
+    using clock = std::chrono::high_resolution_clock;
+    const auto start_tp = clock::now();
+    for (auto &pkt : packets) checksum->update(&pkt);
+    const auto end_tp = clock::now();
+
+    for (auto &pkt : packets) {
+      if (calculation->output(pkt) !=
+          pkt.get_phv()->get_field(ipv4, 9).get<uint64_t>()) {
+        std::cerr << "Incorrect checksum\n";
+        std::exit(1);
+      }
+    }
+    return std::chrono::duration<double, std::nano>(end_tp - start_tp).count();
+  }
+
+ private:
+  bm::PHVFactory phv_factory{};
+  bm::HeaderType ethernet_type, ipv4_type;
+  bm::header_id_t ethernet{0}, ipv4{1};
+  bm::ParseState ethernet_state, ipv4_state;
+  bm::ErrorCodeMap error_codes;
+  bm::Parser parser;
+  std::unique_ptr<bm::PHVSourceIface> phv_source;
+  std::unique_ptr<bm::NamedCalculation> calculation{nullptr};
+  std::unique_ptr<bm::CalcBasedChecksum> checksum{nullptr};
+};
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  size_t num_repeats = 10000;
+  if (argc > 1) num_repeats = std::stoul(argv[1]);
+
+  RandomGen rgen;
+  const std::pair<Rewrite, std::string> rewrites[] = {
+    {Rewrite::NONE, "unmodified"}, {Rewrite::TTL, "TTL decrement"},
+    {Rewrite::TTL_AND_DST, "TTL decrement + dstAddr rewrite"}};
+  for (const auto &rewrite : rewrites) {
+    for (const bool incremental : {false, true}) {
+      ChecksumTest test(incremental);
+      double elapsed_ns = 0;
+      for (size_t iter = 0; iter < num_repeats; iter++)
+        elapsed_ns += test.run(rewrite.first, &rgen);
+      std::cout << rewrite.second << ", "
+                << (incremental ? "incremental" : "full") << " update: "
+                << elapsed_ns / (num_repeats * nb_packets)
+                << " ns per packet\n";
+    }
+  }
+}
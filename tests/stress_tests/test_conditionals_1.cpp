@@ -0,0 +1,219 @@
+/* Copyright 2013-present Barefoot Networks, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Benchmark for compiled expressions, on the conditionals of the simple_switch
+// test programs (or of the programs given on the command line). Each program is
+// loaded twice, once with expression compilation disabled and once with it
+// enabled, and all the conditionals are evaluated on the same random PHVs. The
+// results are checked to be the same.
+// Usage: test_conditionals_1 [program.json ...]
+
+#include <bm/bm_sim/_assert.h>
+#include <bm/bm_sim/actions.h>
+#include <bm/bm_sim/P4Objects.h>
+
+#include <jsoncpp/json.h>
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "stress_utils.h"
+
+using ::stress_tests_utils::RandomGen;
+
+namespace {
+
+using clock_ = std::chrono::high_resolution_clock;
+
+// the programs use some simple_switch primitives; actions are never executed
+// here, so no-op versions with the same parameters are enough
+template <typename... Args>
+class NopPrimitive : public bm::ActionPrimitive<Args...> {
+  void operator ()(Args...) override { }
+};
+
+using mark_to_drop = NopPrimitive<bm::Header &>;
+using add_header = NopPrimitive<bm::Header &>;
+using recirculate = NopPrimitive<const bm::Data &>;
+using drop = NopPrimitive<>;
+using modify_field = NopPrimitive<bm::Field &, const bm::Data &>;
+using add_to_field = NopPrimitive<bm::Field &, const bm::Data &>;
+using register_read =
+    NopPrimitive<bm::Field &, const bm::RegisterArray &, const bm::Data &>;
+using register_write =
+    NopPrimitive<bm::RegisterArray &, const bm::Data &, const bm::Data &>;
+using modify_field_with_hash_based_offset =
+    NopPrimitive<bm::Field &, const bm::Data &, const bm::NamedCalculation &,
+                 const bm::Data &>;
+
+}  // namespace
+
+REGISTER_PRIMITIVE(mark_to_drop);
+REGISTER_PRIMITIVE(add_header);
+REGISTER_PRIMITIVE(recirculate);
+REGISTER_PRIMITIVE(drop);
+REGISTER_PRIMITIVE(modify_field);
+REGISTER_PRIMITIVE(add_to_field);
+REGISTER_PRIMITIVE(register_read);
+REGISTER_PRIMITIVE(register_write);
+REGISTER_PRIMITIVE(modify_field_with_hash_based_offset);
+
+namespace {
+
+constexpr size_t nb_phvs = 1024;
+constexpr size_t nb_rounds = 200;
+
+const char *const default_programs[] = {
+  "simple_switch/tests/testdata/runtime_register_reconfig/"
+  "new_SYN_flooding_protection.json",
+  "simple_switch/tests/testdata/runtime_conditional_reconfig/"
+  "runtime_conditional_reconfig_new.json",
+  "simple_switch/tests/testdata/parser_error.json",
+  "simple_switch/tests/testdata/recirc.json",
+};
+
+std::vector<std::string> get_conditional_names(const std::string &path) {
+  std::ifstream fs(path);
+  Json::Value root;
+  fs >> root;
+  std::vector<std::string> names;
+  for (const auto &pipeline : root["pipelines"])
+    for (const auto &conditional : pipeline["conditionals"])
+      names.push_back(conditional["name"].asString());
+  return names;
+}
+
+struct Program {
+  explicit Program(const std::string &path) {
+    std::ifstream fs(path);
+    bm::LookupStructureFactory factory;
+    const int rc = objects.init_objects(&fs, &factory);
+    _BM_ASSERT(rc == 0);
+    _BM_UNUSED(rc);
+  }
+
+  bm::P4Objects objects{};
+};
+
+// field values are kept small enough for the comparisons with constants to
+// go both ways
+void randomize(RandomGen *rgen, bm::PHV *phv) {
+  for (auto it = phv->header_begin(); it != phv->header_end(); ++it) {
+    for (auto &f : *it) {
+      const int nbits = std::min(f.get_nbits(), 16);
+      f.set(rgen->get_int(0, (1 << nbits) - 1));
+    }
+    if (rgen->get_bool(0.8)) it->mark_valid(); else it->mark_invalid();
+  }
+}
+
+// returns the average time per evaluation, in ns
+double run(const std::vector<const bm::Conditional *> &conditionals,
+           const std::vector<std::unique_ptr<bm::PHV> > &phvs,
+           std::vector<bool> *results) {
+  size_t nb_evals = 0;
+  size_t nb_true = 0;
+  const auto start_tp = clock_::now();
+  for (size_t round = 0; round < nb_rounds; round++) {
+    for (const auto &phv : phvs) {
+      for (const auto c : conditionals) {
+        const bool r = c->eval(*phv);
+        nb_true += r;
+        if (round == 0) results->push_back(r);
+      }
+      nb_evals += conditionals.size();
+    }
+  }
+  const auto end_tp = clock_::now();
+  // so that the evaluations cannot be optimized away
+  if (nb_true > nb_evals) std::cout << "\n";
+  return static_cast<double>(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(
+          end_tp - start_tp).count()) / nb_evals;
+}
+
+}  // namespace
+
+int main(int argc, char *argv[]) {
+  std::vector<std::string> paths;
+  for (int i = 1; i < argc; i++) paths.push_back(argv[i]);
+  if (paths.empty()) {
+    for (const auto program : default_programs)
+      paths.push_back(std::string(TARGETSDIR) + "/" + program);
+  }
+
+  size_t total_conditionals = 0, total_compiled = 0;
+  double total_interpreted_ns = 0, total_compiled_ns = 0;
+  for (const auto &path : paths) {
+    const auto names = get_conditional_names(path);
+    if (names.empty()) continue;
+
+    bm::Expression::set_compilation_enabled(false);
+    Program interpreted(path);
+    bm::Expression::set_compilation_enabled(true);
+    Program compiled(path);
+
+    std::vector<const bm::Conditional *> interpreted_conditionals;
+    std::vector<const bm::Conditional *> compiled_conditionals;
+    size_t nb_compiled = 0;
+    for (const auto &name : names) {
+      interpreted_conditionals.push_back(
+          interpreted.objects.get_conditional(name));
+      compiled_conditionals.push_back(compiled.objects.get_conditional(name));
+      if (compiled_conditionals.back()->is_compiled()) nb_compiled++;
+    }
+
+    // both programs have the same PHV layout
+    RandomGen rgen;
+    std::vector<std::unique_ptr<bm::PHV> > phvs;
+    for (size_t i = 0; i < nb_phvs; i++) {
+      phvs.push_back(compiled.objects.get_phv_factory().create());
+      randomize(&rgen, phvs.back().get());
+    }
+
+    std::vector<bool> interpreted_results, compiled_results;
+    const double interpreted_ns =
+        run(interpreted_conditionals, phvs, &interpreted_results);
+    const double compiled_ns =
+        run(compiled_conditionals, phvs, &compiled_results);
+    if (interpreted_results != compiled_results) {
+      std::cout << path << ": compiled conditionals give different results\n";
+      return 1;
+    }
+
+    std::cout << path.substr(path.find_last_of('/') + 1) << ": "
+              << nb_compiled << "/" << names.size() << " conditionals compiled"
+              << ", interpreted: " << interpreted_ns << " ns"
+              << ", compiled: " << compiled_ns << " ns per evaluation\n";
+    total_conditionals += names.size();
+    total_compiled += nb_compiled;
+    total_interpreted_ns += interpreted_ns * names.size();
+    total_compiled_ns += compiled_ns * names.size();
+  }
+
+  if (total_conditionals > 0) {
+    std::cout << "all programs: " << total_compiled << "/"
+              << total_conditionals << " conditionals compiled"
+              << ", interpreted: " << total_interpreted_ns / total_conditionals
+              << " ns, compiled: " << total_compiled_ns / total_conditionals
+              << " ns per evaluation\n";
+  }
+  return 0;
+}
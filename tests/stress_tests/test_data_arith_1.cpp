@@ -0,0 +1,138 @@
+/* Copyright 2013-present Barefoot Networks, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Micro-benchmark for Data / Field arithmetic. The same operations (decrement of
+// an 8-bit TTL, 32-bit addition, 48-bit bitwise and) are run:
+//  - on Field instances, which use the uint64_t fast path
+//  - directly on GMP numbers, the way Field used to do it (compute with
+//    Bignums, mask, export the bytes)
+//  - on 128-bit Field instances, for which only the Bignum path is available
+//    once the values no longer fit in 64 bits
+// Usage: test_data_arith_1 [nb_iterations]
+
+#include <bm/bm_sim/bignum.h>
+#include <bm/bm_sim/bytecontainer.h>
+#include <bm/bm_sim/data.h>
+#include <bm/bm_sim/fields.h>
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <string>
+
+using bm::Bignum;
+using bm::ByteContainer;
+using bm::Data;
+using bm::Field;
+
+namespace {
+
+using clock_ = std::chrono::high_resolution_clock;
+
+// reproduces what Field::export_bytes used to do for unsigned fields
+class GmpField {
+ public:
+  explicit GmpField(int nbits)
+      : nbytes((nbits + 7) / 8), bytes(nbytes) {
+    mask <<= nbits; mask -= 1;
+  }
+
+  void set(const Bignum &v) {
+    value = v;
+    export_bytes();
+  }
+
+  Bignum value{0};
+
+  void export_bytes() {
+    std::fill(bytes.begin(), bytes.end(), 0);
+    value &= mask;
+    bm::bignum::export_bytes(bytes.data(), nbytes, value);
+  }
+
+ private:
+  int nbytes;
+  ByteContainer bytes;
+  Bignum mask{1};
+};
+
+template <typename F>
+void run(const std::string &name, size_t nb_iterations, F f) {
+  auto start_tp = clock_::now();
+  for (size_t i = 0; i < nb_iterations; i++) f();
+  auto end_tp = clock_::now();
+  auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(
+      end_tp - start_tp).count();
+  std::cout << name << ": " << elapsed / nb_iterations
+            << " ns per iteration\n";
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  size_t nb_iterations = 1000000;
+  if (argc > 1) nb_iterations = std::stoul(argv[1]);
+
+  std::cout << "Running " << nb_iterations << " iterations of "
+            << "(8-bit sub, 32-bit add, 48-bit and)\n";
+
+  const Data one(1);
+  const Data inc(0x12345);
+  const Data mac_mask(0xffffff000000ull);
+  const Data mac(0x0a0b0c0d0e0full);
+
+  {
+    Field ttl(8, nullptr), ctr(32, nullptr), oui(48, nullptr);
+    ttl.set(64);
+    run("Field (uint64_t fast path)", nb_iterations, [&] {
+        ttl.sub(ttl, one);
+        ctr.add(ctr, inc);
+        oui.bit_and(mac, mac_mask);
+      });
+  }
+
+  {
+    const Bignum one_(1), inc_(0x12345), mac_mask_(0xffffff000000ull),
+        mac_(0x0a0b0c0d0e0full);
+    GmpField ttl(8), ctr(32), oui(48);
+    ttl.set(64);
+    run("GMP", nb_iterations, [&] {
+        ttl.value = ttl.value - one_;
+        ttl.export_bytes();
+        ctr.value = ctr.value + inc_;
+        ctr.export_bytes();
+        oui.value = mac_ & mac_mask_;
+        oui.export_bytes();
+      });
+  }
+
+  {
+    // the values are kept above 2^64, so that the Bignum is always used
+    const Data big("0x100000000000000000000");
+    Field ttl(128, nullptr), ctr(128, nullptr), oui(128, nullptr);
+    Data wide_mac;
+    wide_mac.add(mac, big);
+    ttl.set(big);
+    ttl.add(ttl, big);
+    ctr.set(big);
+    run("128-bit Field (Bignum path)", nb_iterations, [&] {
+        ttl.sub(ttl, one);
+        ctr.add(ctr, inc);
+        oui.bit_and(wide_mac, mac_mask);
+      });
+  }
+
+  return 0;
+}
@@ -0,0 +1,155 @@
+/* Copyright 2013-present Barefoot Networks, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// this test parses and deparses packets with a forwarding-only program (see
+// parser_deparser_1.p4), leaving the headers unmodified or decrementing the
+// IPv4 TTL, with 1 or 8 replicas (sharing the packet data) per packet. Reports
+// the number of packets deparsed per second and the number of bytes of headers
+// written and of packet data copied by the deparser per packet, when it leaves
+// the headers which were not modified in the buffer and when it prepends all of
+// them again, as it used to.
+
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include <boost/filesystem.hpp>
+
+#include "stress_utils.h"
+
+using ::stress_tests_utils::SwitchTest;
+
+namespace fs = boost::filesystem;
+
+namespace {
+
+using clock_ = std::chrono::high_resolution_clock;
+
+struct Stats {
+  size_t nb_packets{0};
+  size_t bytes_written{0};
+  size_t bytes_copied{0};
+  clock_::duration deparse_time{0};
+};
+
+// bytes of the valid headers, and of the valid headers which were modified
+std::tuple<size_t, size_t> headers_bytes(const bm::PHV &phv) {
+  size_t all = 0, modified = 0;
+  for (auto it = phv.header_begin(); it != phv.header_end(); ++it) {
+    if (!it->is_valid() || it->is_metadata()) continue;
+    all += it->get_nbytes_packet();
+    if (it->is_modified()) modified += it->get_nbytes_packet();
+  }
+  return std::make_tuple(all, modified);
+}
+
+void deparse(const bm::Deparser *deparser, bm::Packet *pkt, bool in_place,
+             Stats *stats) {
+  // any move of the data makes the deparser prepend all the headers
+  if (!in_place) pkt->remove(0);
+  // all the headers of this program are deparsed in the order in which they
+  // are extracted, so the headers stay in place if the data was not moved
+  in_place = pkt->can_restore_parsed();
+  size_t all, modified;
+  std::tie(all, modified) = headers_bytes(*pkt->get_phv());
+  const auto &buffer = pkt->get_packet_buffer();
+  const char *storage = buffer.end();
+
+  const auto start_tp = clock_::now();
+  deparser->deparse(pkt);
+  stats->deparse_time += clock_::now() - start_tp;
+
+  stats->nb_packets++;
+  stats->bytes_written += in_place ? modified : all;
+  if (buffer.end() != storage) stats->bytes_copied += buffer.get_data_size();
+}
+
+void run(SwitchTest *sw, const std::vector<std::vector<char> > &frames,
+         size_t num_repeats, bool in_place, bool ttl, size_t nb_replicas) {
+  auto parser = sw->get_parser("parser");
+  auto deparser = sw->get_deparser("deparser");
+  bm::header_id_t ipv4;
+  int ttl_offset;
+  std::tie(ipv4, ttl_offset) = sw->field_info("ipv4", "ttl");
+
+  Stats stats;
+  std::vector<std::unique_ptr<bm::Packet> > replicas;
+  for (size_t iter = 0; iter < num_repeats; iter++) {
+    for (const auto &frame : frames) {
+      auto pkt = sw->new_packet_ptr(0, 0, 0, frame.size(),
+                                    bm::PacketBuffer(frame.size() + 64,
+                                                     frame.data(),
+                                                     frame.size()));
+      parser->parse(pkt.get());
+      if (ttl) {
+        auto &f = pkt->get_phv()->get_field(ipv4, ttl_offset);
+        if (pkt->get_phv()->get_header(ipv4).is_valid())
+          f.set(f.get_uint() - 1);
+      }
+      if (nb_replicas == 1) {
+        deparse(deparser, pkt.get(), in_place, &stats);
+        continue;
+      }
+      for (size_t i = 0; i < nb_replicas; i++)
+        replicas.push_back(pkt->clone_with_phv_ptr());
+      pkt.reset();
+      for (auto &replica : replicas)
+        deparse(deparser, replica.get(), in_place, &stats);
+      replicas.clear();
+    }
+  }
+
+  const double deparse_s =
+      std::chrono::duration<double>(stats.deparse_time).count();
+  std::cout << (ttl ? "TTL decremented" : "unmodified") << ", "
+            << nb_replicas << " replica(s), "
+            << (in_place ? "headers left in place" : "all headers prepended")
+            << ": " << static_cast<size_t>(stats.nb_packets / deparse_s)
+            << " packets deparsed per second, "
+            << static_cast<double>(stats.bytes_written) / stats.nb_packets
+            << " bytes written and "
+            << static_cast<double>(stats.bytes_copied) / stats.nb_packets
+            << " bytes copied per packet\n";
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  size_t num_repeats = 1000;
+  if (argc > 1) num_repeats = std::stoul(argv[1]);
+
+  SwitchTest sw;
+  fs::path config_path =
+      fs::path(TESTDATADIR) / fs::path("parser_deparser_1.json");
+  sw.init_objects(config_path.string());
+
+  fs::path traffic_path =
+      fs::path(TESTDATADIR) / fs::path("udp_tcp_traffic.bin");
+  std::vector<std::vector<char> > frames;
+  for (const auto &pkt : sw.read_traffic(traffic_path.string())) {
+    const bm::Packet &p = *pkt;
+    frames.emplace_back(p.data(), p.data() + p.get_data_size());
+  }
+
+  for (const bool ttl : {false, true}) {
+    for (const size_t nb_replicas : {1, 8}) {
+      run(&sw, frames, num_repeats, false, ttl, nb_replicas);
+      run(&sw, frames, num_repeats, true, ttl, nb_replicas);
+    }
+  }
+}
@@ -0,0 +1,138 @@
+/* Copyright 2013-present Barefoot Networks, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// this test floods 1500-byte frames to 64 ports the way simple_switch
+// replicates multicast packets (one clone with PHV per port, deparsed in
+// egress). Reports the number of replicas per second, for the replication step
+// alone and for replication + deparsing, and the number of bytes of packet data
+// copied per replica. The replicas share the packet data, which the deparser
+// does not copy as the headers are not modified; the "eager" run copies it when
+// replicating, as clones used to.
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <boost/filesystem.hpp>
+
+#include "stress_utils.h"
+
+using ::stress_tests_utils::SwitchTest;
+
+namespace fs = boost::filesystem;
+
+namespace {
+
+constexpr size_t nb_ports = 64;
+constexpr size_t frame_size = 1500;
+
+using clock_ = std::chrono::high_resolution_clock;
+
+double elapsed_s(clock_::time_point start, clock_::time_point end) {
+  return std::chrono::duration<double>(end - start).count();
+}
+
+void run(SwitchTest *sw, const std::vector<std::vector<char> > &frames,
+         size_t num_repeats, bool eager) {
+  auto parser = sw->get_parser("parser");
+  auto deparser = sw->get_deparser("deparser");
+
+  std::vector<std::unique_ptr<bm::Packet> > replicas;
+  replicas.reserve(nb_ports);
+  size_t bytes_copied_replication = 0;
+  size_t bytes_copied_deparse = 0;
+  double replication_s = 0;
+  double deparse_s = 0;
+  for (size_t iter = 0; iter < num_repeats; iter++) {
+    for (const auto &frame : frames) {
+      auto pkt = sw->new_packet_ptr(0, 0, 0, frame.size(),
+                                    bm::PacketBuffer(frame.size() + 64,
+                                                     frame.data(),
+                                                     frame.size()));
+      parser->parse(pkt.get());
+
+      const auto start_tp = clock_::now();
+      for (size_t port = 0; port < nb_ports; port++) {
+        auto replica = pkt->clone_with_phv_ptr();
+        replica->set_egress_port(port);
+        if (eager) {
+          const auto &buffer = replica->get_packet_buffer();
+          if (buffer.is_shared())
+            bytes_copied_replication += buffer.get_data_size();
+          replica->data();  // non-const access makes the data private
+        }
+        replicas.push_back(std::move(replica));
+      }
+      // like simple_switch, discard the original packet
+      pkt.reset();
+      const auto replicated_tp = clock_::now();
+      for (auto &replica : replicas) {
+        // the deparser leaves the headers in place if they were not modified,
+        // in which case the data is not copied
+        const auto &buffer = replica->get_packet_buffer();
+        const char *storage = buffer.end();
+        deparser->deparse(replica.get());
+        if (buffer.end() != storage)
+          bytes_copied_deparse += buffer.get_data_size();
+      }
+      replicas.clear();
+      const auto end_tp = clock_::now();
+      replication_s += elapsed_s(start_tp, replicated_tp);
+      deparse_s += elapsed_s(replicated_tp, end_tp);
+    }
+  }
+
+  const double nb_replicas = frames.size() * num_repeats * nb_ports;
+  std::cout << (eager ? "eager copy" : "copy on write") << ": "
+            << static_cast<size_t>(nb_replicas / replication_s)
+            << " replicas per second (replication only), "
+            << static_cast<size_t>(nb_replicas / (replication_s + deparse_s))
+            << " replicas per second (replication + deparsing), "
+            << bytes_copied_replication / nb_replicas
+            << " bytes copied per replica when replicating, "
+            << bytes_copied_deparse / nb_replicas
+            << " when deparsing\n";
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  size_t num_repeats = 10;
+  if (argc > 1) num_repeats = std::stoul(argv[1]);
+
+  SwitchTest sw;
+  fs::path config_path =
+      fs::path(TESTDATADIR) / fs::path("parser_deparser_1.json");
+  sw.init_objects(config_path.string());
+
+  fs::path traffic_path =
+      fs::path(TESTDATADIR) / fs::path("udp_tcp_traffic.bin");
+  auto traffic = sw.read_traffic(traffic_path.string());
+
+  // the same packets, padded to frame_size bytes
+  std::vector<std::vector<char> > frames;
+  for (const auto &pkt : traffic) {
+    const bm::Packet &p = *pkt;
+    frames.emplace_back(frame_size, 0);
+    std::copy(p.data(), p.data() + std::min(p.get_data_size(), frame_size),
+              frames.back().begin());
+  }
+
+  run(&sw, frames, num_repeats, true);
+  run(&sw, frames, num_repeats, false);
+}
@@ -18,10 +18,15 @@
  *
  */
 
+// this test also reports the rate of the parser alone, which extracts the
+// Ethernet, IPv4, TCP and UDP headers with the layout precomputed by their
+// header type (see Header::extract())
+
 #include <vector>
 #include <string>
 #include <iostream>
 #include <memory>
+#include <chrono>
 
 #include <boost/filesystem.hpp>
 
@@ -48,13 +53,18 @@ int main(int argc, char* argv[]) {
   auto parser = sw.get_parser("parser");
   auto deparser = sw.get_deparser("deparser");
 
+  using clock = std::chrono::high_resolution_clock;
+  clock::duration parse_time{0};
+
   size_t packet_cnt = packets.size();
   TestChrono chrono(packet_cnt * num_repeats);
   chrono.start();
   for (size_t iter = 0; iter < num_repeats; iter++) {
     for (size_t p = 0; p < packet_cnt; p++) {
       auto pkt = packets[p].get();
+      const auto parse_start = clock::now();
       parser->parse(pkt);
+      parse_time += clock::now() - parse_start;
       deparser->deparse(pkt);
       // need to reset headers (i.e. mark them invalid) since we are re-using
       // the same Packet objects
@@ -63,4 +73,8 @@ int main(int argc, char* argv[]) {
   }
   chrono.end();
   chrono.print_summary();
+  const double parse_s = std::chrono::duration<double>(parse_time).count();
+  std::cout << "Parser alone was processing "
+            << static_cast<size_t>(packet_cnt * num_repeats / parse_s)
+            << " packets per second.\n";
 }
@@ -20,9 +20,14 @@
 
 #include <netinet/in.h>
 
+#include <bm/bm_sim/lookup_structures.h>
+
+#include <algorithm>
+#include <chrono>
 #include <vector>
 #include <string>
 #include <iostream>
+#include <limits>
 #include <memory>
 
 #include <cassert>
@@ -96,12 +101,114 @@ void check_rc(bm::MatchErrorCode rc) {
          rc == bm::MatchErrorCode::DUPLICATE_ENTRY);
 }
 
+bm::ByteContainer get_random_bytes(size_t nbytes) {
+  bm::ByteContainer bytes(nbytes);
+  for (size_t i = 0; i < nbytes; i++)
+    bytes[i] = static_cast<char>(rgen_ptr->get_int(0, 255));
+  return bytes;
+}
+
+// Runs lookups directly on the lookup structures, with the default linear scan
+// and with tuple space search, for a table with nb_entries entries. The key has
+// the same size as for ternary_3 (srcAddr + dstAddr) and the entries use a few
+// distinct masks, like a typical ACL. Returns the number of lookups for which
+// the 2 structures disagree.
+size_t bench_lookup_structures(size_t nb_entries) {
+  constexpr size_t nbytes_key = 2 * sizeof(ethernet_t::dstAddr);
+  constexpr size_t nb_masks = 16;
+  constexpr size_t nb_queries = 1024;
+  // keeps the duration of the linear scan reasonable for large tables
+  const size_t nb_lookups = std::max<size_t>(10000, 100000000 / nb_entries);
+
+  std::vector<bm::ByteContainer> masks;
+  for (size_t i = 0; i < nb_masks; i++) {
+    bm::ByteContainer mask(nbytes_key);
+    for (size_t j = 0; j < nbytes_key; j++)
+      mask[j] = rgen_ptr->get_bool(0.75) ? '\xff' : '\x00';
+    masks.push_back(std::move(mask));
+  }
+
+  // the lookup structures keep pointers to the keys
+  std::vector<bm::TernaryMatchKey> keys;
+  keys.reserve(nb_entries);
+  for (size_t i = 0; i < nb_entries; i++) {
+    const auto &mask = masks[rgen_ptr->get_int(0, nb_masks - 1)];
+    auto data = get_random_bytes(nbytes_key);
+    for (size_t j = 0; j < nbytes_key; j++) data[j] &= mask[j];
+    keys.emplace_back(std::move(data), mask, rgen_ptr->get_int(1, 1000), 0);
+  }
+
+  // half of the queries match the entry they are derived from (at least)
+  std::vector<bm::ByteContainer> queries;
+  for (size_t i = 0; i < nb_queries; i++) {
+    auto query = get_random_bytes(nbytes_key);
+    if (i % 2 == 0) {
+      const auto &key = keys[rgen_ptr->get_int(0, nb_entries - 1)];
+      for (size_t j = 0; j < nbytes_key; j++)
+        query[j] = key.data[j] | (query[j] & ~key.mask[j]);
+    }
+    queries.push_back(std::move(query));
+  }
+
+  bm::LookupStructureFactory linear_factory;
+  bm::LookupStructureFactory tuple_space_factory;
+  tuple_space_factory.set_tuple_space_min_size(0);
+  auto linear = linear_factory.create_for_ternary(nb_entries, nbytes_key);
+  auto tuple_space = tuple_space_factory.create_for_ternary(
+      nb_entries, nbytes_key);
+  for (size_t i = 0; i < nb_entries; i++) {
+    linear->add_entry(keys[i], i);
+    tuple_space->add_entry(keys[i], i);
+  }
+
+  using clock = std::chrono::high_resolution_clock;
+  auto run = [&queries, nb_lookups](const bm::TernaryLookupStructure &s,
+                                    std::vector<bm::internal_handle_t> *res) {
+    res->assign(queries.size(),
+                std::numeric_limits<bm::internal_handle_t>::max());  // miss
+    auto start_tp = clock::now();
+    for (size_t i = 0; i < nb_lookups; i++) {
+      const auto q = i % queries.size();
+      bm::internal_handle_t handle;
+      if (s.lookup(queries[q], &handle)) (*res)[q] = handle;
+    }
+    auto end_tp = clock::now();
+    auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        end_tp - start_tp).count();
+    return (nb_lookups * 1000000000.) / std::max<decltype(elapsed)>(elapsed, 1);
+  };
+
+  std::vector<bm::internal_handle_t> res_linear, res_tuple_space;
+  auto rate_linear = run(*linear, &res_linear);
+  auto rate_tuple_space = run(*tuple_space, &res_tuple_space);
+  std::cout << nb_entries << " entries: linear scan "
+            << static_cast<size_t>(rate_linear) << " lookups/s, "
+            << "tuple space search "
+            << static_cast<size_t>(rate_tuple_space) << " lookups/s"
+            << std::endl;
+
+  size_t mismatches = 0;
+  for (size_t q = 0; q < nb_queries; q++)
+    if (res_linear[q] != res_tuple_space[q]) mismatches++;
+  return mismatches;
+}
+
 }  // namespace
 
 int main(int argc, char* argv[]) {
   size_t num_repeats = 100;
   if (argc > 1) num_repeats = std::stoul(argv[1]);
 
+  RandomGen rgen;
+  rgen_ptr = &rgen;
+
+  for (const size_t nb_entries : {1000, 10000, 100000}) {
+    if (bench_lookup_structures(nb_entries) != 0) {
+      std::cerr << "Tuple space search and linear scan results differ\n";
+      return 1;
+    }
+  }
+
   SwitchTest sw;
   fs::path config_path =
       fs::path(TESTDATADIR) / fs::path("ternary_match_1.json");
@@ -112,8 +219,6 @@ int main(int argc, char* argv[]) {
   auto packets = sw.read_traffic(traffic_path.string());
 
   // populate tables
-  RandomGen rgen;
-  rgen_ptr = &rgen;
   for (const auto &pkt : packets) {
     ethernet_t *hdr = reinterpret_cast<ethernet_t *>(pkt->data());
     assert(ntohs(hdr->etherType) == 0x0800);  // check for IPv4 ethertype
@@ -0,0 +1,177 @@
+/* Copyright 2013-present Barefoot Networks, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Micro-benchmark for the masked key comparison done when scanning the entries
+// of ternary and range tables. For each key size, the same random entries are
+// scanned for the same keys:
+//  - byte by byte over TernaryMatchKey objects, the way EntryList used to do it
+//  - with each ternary_scan implementation supported by the CPU, over the
+//    structure of arrays layout now used by EntryList
+// Usage: test_ternary_scan_1 [nb_iterations]
+
+#include <bm/bm_sim/bytecontainer.h>
+#include <bm/bm_sim/match_key_types.h>
+
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "ternary_scan.h"
+#include "stress_utils.h"
+
+using ::stress_tests_utils::RandomGen;
+
+namespace ts = bm::ternary_scan;
+
+namespace {
+
+using clock_ = std::chrono::high_resolution_clock;
+
+constexpr size_t nb_entries = 1024;
+constexpr size_t nb_queries = 64;
+
+struct Entries {
+  explicit Entries(size_t nbytes_key)
+      : nbytes_key(nbytes_key), stride(ts::stride_for(nbytes_key)) { }
+
+  size_t nbytes_key;
+  size_t stride;
+  std::vector<bm::TernaryMatchKey> keys{};
+  ts::AlignedBytes data{};
+  ts::AlignedBytes masks{};
+};
+
+bm::ByteContainer get_random_bytes(RandomGen *rgen, size_t nbytes) {
+  bm::ByteContainer bytes(nbytes);
+  for (size_t i = 0; i < nbytes; i++)
+    bytes[i] = static_cast<char>(rgen->get_int(0, 255));
+  return bytes;
+}
+
+void populate(RandomGen *rgen, Entries *entries) {
+  const auto nbytes_key = entries->nbytes_key;
+  const auto stride = entries->stride;
+  entries->data.resize(nb_entries * stride);
+  entries->masks.resize(nb_entries * stride);
+  for (size_t i = 0; i < nb_entries; i++) {
+    bm::ByteContainer mask(nbytes_key);
+    for (size_t j = 0; j < nbytes_key; j++)
+      mask[j] = rgen->get_bool(0.7) ? '\xff' : '\x00';
+    auto data = get_random_bytes(rgen, nbytes_key);
+    for (size_t j = 0; j < nbytes_key; j++) data[j] &= mask[j];
+    std::memcpy(entries->data.data() + i * stride, data.data(), nbytes_key);
+    std::memcpy(entries->masks.data() + i * stride, mask.data(), nbytes_key);
+    entries->keys.emplace_back(std::move(data), std::move(mask), 0, 0);
+  }
+}
+
+// returns the sum of the indices of the matching entries, used to check that
+// all implementations agree
+template <typename F>
+size_t run(const std::string &name, size_t nb_iterations, F f) {
+  size_t res = 0;
+  auto start_tp = clock_::now();
+  for (size_t i = 0; i < nb_iterations; i++) res += f();
+  auto end_tp = clock_::now();
+  auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(
+      end_tp - start_tp).count();
+  std::cout << "  " << name << ": "
+            << static_cast<double>(elapsed) /
+               (nb_iterations * nb_queries * nb_entries)
+            << " ns per entry\n";
+  return res;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  size_t nb_iterations = 200;
+  if (argc > 1) nb_iterations = std::stoul(argv[1]);
+
+  RandomGen rgen;
+  std::cout << "Scanning " << nb_entries << " entries, best implementation is "
+            << ts::impl_name(ts::best_impl()) << "\n";
+
+  // IPv4 5-tuple, IPv6 5-tuple, 64 bytes
+  for (const size_t nbytes_key : {13, 37, 64}) {
+    Entries entries(nbytes_key);
+    populate(&rgen, &entries);
+
+    // one query out of 4 is derived from an entry, to make sure we have matches
+    std::vector<bm::ByteContainer> queries;
+    ts::AlignedBytes padded_queries;
+    padded_queries.resize(nb_queries * entries.stride);
+    for (size_t q = 0; q < nb_queries; q++) {
+      auto query = get_random_bytes(&rgen, nbytes_key);
+      if (q % 4 == 0) {
+        const auto &key = entries.keys[rgen.get_int(0, nb_entries - 1)];
+        for (size_t j = 0; j < nbytes_key; j++)
+          query[j] = key.data[j] | (query[j] & ~key.mask[j]);
+      }
+      std::memcpy(padded_queries.data() + q * entries.stride, query.data(),
+                  nbytes_key);
+      queries.push_back(std::move(query));
+    }
+
+    std::cout << nbytes_key << "-byte keys:\n";
+
+    const auto res_ref = run("byte by byte", nb_iterations, [&] {
+        size_t res = 0;
+        for (const auto &query : queries) {
+          for (size_t i = 0; i < nb_entries; i++) {
+            const auto &k = entries.keys[i];
+            bool match = true;
+            for (size_t b = 0; b < nbytes_key; b++) {
+              if (k.data[b] != (query[b] & k.mask[b])) {
+                match = false;
+                break;
+              }
+            }
+            if (match) res += i;
+          }
+        }
+        return res;
+      });
+
+    for (const auto impl : {ts::Impl::SCALAR, ts::Impl::SSE2,
+                            ts::Impl::AVX2}) {
+      auto scan_fn = ts::get_scan_fn(impl);
+      if (!scan_fn) continue;
+      const auto res = run(ts::impl_name(impl), nb_iterations, [&] {
+          size_t res = 0;
+          for (size_t q = 0; q < nb_queries; q++) {
+            const char *key = padded_queries.data() + q * entries.stride;
+            for (size_t i = scan_fn(key, entries.data.data(),
+                                    entries.masks.data(), entries.stride, 0,
+                                    nb_entries);
+                 i < nb_entries;
+                 i = scan_fn(key, entries.data.data(), entries.masks.data(),
+                             entries.stride, i + 1, nb_entries)) {
+              res += i;
+            }
+          }
+          return res;
+        });
+      if (res != res_ref) {
+        std::cerr << ts::impl_name(impl) << " results differ\n";
+        return 1;
+      }
+    }
+  }
+
+  return 0;
+}
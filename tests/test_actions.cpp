@@ -187,6 +187,36 @@ class HeaderUnionAsParameter : public ActionPrimitive<const HeaderUnion &> {
 
 REGISTER_PRIMITIVE(HeaderUnionAsParameter);
 
+// reads a register cell, and checks which stripes of the register array
+// another thread can lock while the primitive is executed
+class ProbeRegisterLocks
+    : public ActionPrimitive<Field &, const RegisterArray &, const Data &> {
+  void operator ()(Field &dst, const RegisterArray &src,
+                   const Data &idx) override {
+    auto i = idx.get<size_t>();
+    dst.set(src[i]);
+    std::thread t([this, &src, i] {
+        cell_locked = !try_lock(src.stripe_mutex(i));
+        other_cell_locked = !try_lock(src.stripe_mutex(i + 1));
+      });
+    t.join();
+  }
+
+  int get_register_index_param(size_t array_param) const override {
+    return (array_param == 1) ? 2 : -1;
+  }
+
+  static bool try_lock(std::mutex &m) {
+    if (!m.try_lock()) return false;
+    m.unlock();
+    return true;
+  }
+
+ public:
+  bool cell_locked{false};
+  bool other_cell_locked{false};
+};
+
 // Google Test fixture for actions tests
 class ActionsTest : public ::testing::Test {
  protected:
@@ -487,6 +517,93 @@ TEST_F(ActionsTest, SetRegisterGen) {
   ASSERT_EQ(value_i, register_array.at(register_idx).get_uint());
 }
 
+TEST_F(ActionsTest, RegisterCellLock) {
+  RegisterArray register_array("register_test", 0, 1024, 16);
+  const unsigned int register_idx = 68;
+  register_array.at(register_idx).set(0xaba);
+  Field &idx = phv->get_field(testHeader2, 3);  // f16
+  idx.set(register_idx);
+  Field &dst = phv->get_field(testHeader1, 3);  // f16
+  ProbeRegisterLocks primitive;
+  testActionFn.push_back_primitive(&primitive);
+  testActionFn.parameter_push_back_field(testHeader1, 3);
+  testActionFn.parameter_push_back_register_array(&register_array);
+  testActionFn.parameter_push_back_field(testHeader2, 3);
+  testActionFn.finalize_register_accesses();
+
+  testActionFnEntry(pkt.get());
+  ASSERT_EQ(0xabau, dst.get_uint());
+  // only the stripe of the accessed cell is locked
+  EXPECT_TRUE(primitive.cell_locked);
+  EXPECT_FALSE(primitive.other_cell_locked);
+}
+
+TEST_F(ActionsTest, RegisterArrayLockWithoutFinalize) {
+  RegisterArray register_array("register_test", 0, 1024, 16);
+  phv->get_field(testHeader2, 3).set(68);
+  ProbeRegisterLocks primitive;
+  testActionFn.push_back_primitive(&primitive);
+  testActionFn.parameter_push_back_field(testHeader1, 3);
+  testActionFn.parameter_push_back_register_array(&register_array);
+  testActionFn.parameter_push_back_field(testHeader2, 3);
+
+  testActionFnEntry(pkt.get());
+  EXPECT_TRUE(primitive.cell_locked);
+  EXPECT_TRUE(primitive.other_cell_locked);
+}
+
+// the index is modified between 2 accesses to the array, so the action needs to
+// lock the whole array
+TEST_F(ActionsTest, RegisterArrayLockIndexModified) {
+  RegisterArray register_array("register_test", 0, 1024, 16);
+  phv->get_field(testHeader2, 3).set(68);
+  ProbeRegisterLocks primitive1, primitive2;
+  SetField set_index;
+  testActionFn.push_back_primitive(&primitive1);
+  testActionFn.parameter_push_back_field(testHeader1, 3);
+  testActionFn.parameter_push_back_register_array(&register_array);
+  testActionFn.parameter_push_back_field(testHeader2, 3);
+  testActionFn.push_back_primitive(&set_index);
+  testActionFn.parameter_push_back_field(testHeader2, 3);
+  testActionFn.parameter_push_back_const(Data(100));
+  testActionFn.push_back_primitive(&primitive2);
+  testActionFn.parameter_push_back_field(testHeader1, 3);
+  testActionFn.parameter_push_back_register_array(&register_array);
+  testActionFn.parameter_push_back_field(testHeader2, 3);
+  testActionFn.finalize_register_accesses();
+
+  testActionFnEntry(pkt.get());
+  EXPECT_TRUE(primitive1.other_cell_locked);
+  EXPECT_TRUE(primitive2.other_cell_locked);
+}
+
+// the primitive only reads the index, so the action can still lock a single
+// stripe
+TEST_F(ActionsTest, RegisterCellLockIndexRead) {
+  RegisterArray register_array("register_test", 0, 1024, 16);
+  phv->get_field(testHeader2, 3).set(68);
+  ProbeRegisterLocks primitive1, primitive2;
+  SetField copy_index;
+  testActionFn.push_back_primitive(&primitive1);
+  testActionFn.parameter_push_back_field(testHeader1, 3);
+  testActionFn.parameter_push_back_register_array(&register_array);
+  testActionFn.parameter_push_back_field(testHeader2, 3);
+  testActionFn.push_back_primitive(&copy_index);
+  testActionFn.parameter_push_back_field(testHeader2, 0);  // f32
+  testActionFn.parameter_push_back_field(testHeader2, 3);
+  testActionFn.push_back_primitive(&primitive2);
+  testActionFn.parameter_push_back_field(testHeader1, 3);
+  testActionFn.parameter_push_back_register_array(&register_array);
+  testActionFn.parameter_push_back_field(testHeader2, 3);
+  testActionFn.finalize_register_accesses();
+
+  testActionFnEntry(pkt.get());
+  EXPECT_TRUE(primitive1.cell_locked);
+  EXPECT_FALSE(primitive1.other_cell_locked);
+  EXPECT_TRUE(primitive2.cell_locked);
+  EXPECT_FALSE(primitive2.other_cell_locked);
+}
+
 TEST_F(ActionsTest, CopyHeader) {
   Header &hdr1 = phv->get_header(testHeader1);
   ASSERT_FALSE(hdr1.is_valid());
@@ -84,7 +84,7 @@ class AgeingTest : public ::testing::Test {
 
     LookupStructureFactory factory;
 
-    std::unique_ptr<MUExact> match_unit(new MUExact(1, key_builder, &factory));
+    std::unique_ptr<MUExact> match_unit(new MUExact(16, key_builder, &factory));
 
     // counters disabled, ageing enabled
     table = std::unique_ptr<MatchTable>(
@@ -142,6 +142,24 @@ class AgeingTest : public ::testing::Test {
         device_id, cxt_id, ageing_writer, sweep_int);
     ageing_monitor->add_table(table.get());
   }
+
+  // returns the handles in the notification
+  std::vector<entry_handle_t> read_notification() {
+    using msg_hdr_t = AgeingMonitorIface::msg_hdr_t;
+    ageing_writer->read(buffer, sizeof(buffer));
+    const auto *hdr = reinterpret_cast<const msg_hdr_t *>(buffer);
+    const auto *handles =
+        reinterpret_cast<const entry_handle_t *>(buffer + sizeof(msg_hdr_t));
+    return std::vector<entry_handle_t>(handles, handles + hdr->num_entries);
+  }
+
+  // the monitor blocks when sending a notification until the previous one has
+  // been read, so we make sure that none is pending before it is destroyed
+  void drain_notifications(unsigned int sweep_int) {
+    sleep_for(milliseconds(2 * sweep_int));
+    while (ageing_writer->check_status() == MemoryAccessor::Status::CAN_READ)
+      ageing_writer->read(buffer, sizeof(buffer));
+  }
 };
 
 TEST_F(AgeingTest, OneNotification) {
@@ -203,3 +221,86 @@ TEST_F(AgeingTest, GetTableNameFromId) {
   EXPECT_EQ(ageing_monitor->get_table_name_from_id(0), "test_table");
   EXPECT_EQ(ageing_monitor->get_table_name_from_id(1), "");
 }
+
+TEST_F(AgeingTest, IncrementalNotifications) {
+  std::string key_1("\x0a\xba");
+  std::string key_2("\x0a\xbb");
+  entry_handle_t handle_1, handle_2;
+  unsigned int sweep_int = 100u;
+  init_monitor(sweep_int);
+  auto tp1 = clock::now();
+  ASSERT_EQ(MatchErrorCode::SUCCESS, add_entry(key_1, &handle_1, 200u));
+  ASSERT_EQ(MatchErrorCode::SUCCESS, add_entry(key_2, &handle_2, 600u));
+
+  // each notification only includes the entries which have just expired
+  auto handles = read_notification();
+  auto tp2 = clock::now();
+  ASSERT_EQ(std::vector<entry_handle_t>({handle_1}), handles);
+  unsigned int elapsed = duration_cast<milliseconds>(tp2 - tp1).count();
+  ASSERT_GT(elapsed, 200u - 20u);
+  ASSERT_LT(elapsed, 200u + sweep_int + 20u);
+  ASSERT_EQ(MatchErrorCode::SUCCESS, delete_entry(handle_1));
+
+  handles = read_notification();
+  auto tp3 = clock::now();
+  ASSERT_EQ(std::vector<entry_handle_t>({handle_2}), handles);
+  elapsed = duration_cast<milliseconds>(tp3 - tp1).count();
+  ASSERT_GT(elapsed, 600u - 20u);
+  ASSERT_LT(elapsed, 600u + sweep_int + 20u);
+  ASSERT_EQ(MatchErrorCode::SUCCESS, delete_entry(handle_2));
+
+  drain_notifications(sweep_int);
+}
+
+TEST_F(AgeingTest, HitsPostponeExpiry) {
+  std::string key_("\x0a\xba");
+  std::string key("0x0aba");
+  entry_handle_t handle_1;
+  entry_handle_t lookup_handle;
+  unsigned int sweep_int = 50u;
+  unsigned int ttl = 200u;
+  init_monitor(sweep_int);
+  ASSERT_EQ(MatchErrorCode::SUCCESS, add_entry(key_, &handle_1, ttl));
+
+  for (int i = 0; i < 12; i++) {
+    ASSERT_TRUE(send_pkt(key, &lookup_handle));
+    sleep_for(milliseconds(sweep_int));
+  }
+  ASSERT_NE(MemoryAccessor::Status::CAN_READ, ageing_writer->check_status());
+
+  auto tp1 = clock::now();
+  ASSERT_TRUE(send_pkt(key, &lookup_handle));
+  auto handles = read_notification();
+  auto tp2 = clock::now();
+  ASSERT_EQ(std::vector<entry_handle_t>({handle_1}), handles);
+  unsigned int elapsed = duration_cast<milliseconds>(tp2 - tp1).count();
+  ASSERT_GT(elapsed, ttl - 20u);
+  ASSERT_LT(elapsed, ttl + sweep_int + 20u);
+  ASSERT_EQ(MatchErrorCode::SUCCESS, delete_entry(handle_1));
+
+  drain_notifications(sweep_int);
+}
+
+TEST_F(AgeingTest, RemoveTable) {
+  std::string key_("\x0a\xba");
+  entry_handle_t handle_1;
+  unsigned int sweep_int = 50u;
+  init_monitor(sweep_int);
+  ASSERT_EQ(MatchErrorCode::SUCCESS, add_entry(key_, &handle_1, 100u));
+  ageing_monitor->remove_table(0);
+  EXPECT_EQ(ageing_monitor->get_table_name_from_id(0), "");
+  sleep_for(milliseconds(300u));
+  ASSERT_NE(MemoryAccessor::Status::CAN_READ, ageing_writer->check_status());
+
+  // the table can be added again, and existing entries are picked up
+  auto tp1 = clock::now();
+  ageing_monitor->add_table(table.get());
+  auto handles = read_notification();
+  auto tp2 = clock::now();
+  ASSERT_EQ(std::vector<entry_handle_t>({handle_1}), handles);
+  unsigned int elapsed = duration_cast<milliseconds>(tp2 - tp1).count();
+  ASSERT_LT(elapsed, sweep_int + 20u);
+  ASSERT_EQ(MatchErrorCode::SUCCESS, delete_entry(handle_1));
+
+  drain_notifications(sweep_int);
+}
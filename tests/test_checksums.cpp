@@ -28,6 +28,8 @@
 #include <gtest/gtest.h>
 
 #include <cstring>
+#include <random>
+#include <vector>
 
 using namespace bm;
 
@@ -318,6 +320,184 @@ TEST_F(ChecksumTest, TCPChecksumUpdate) {
 }
 
 
+// csum16 checksums updated incrementally (RFC 1624) after random
+// modifications of the fields, compared with a full computation
+class IncrementalChecksumTest : public ChecksumTest {
+ protected:
+  // IPv4 header checksum
+  std::unique_ptr<NamedCalculation> ipv4_calc{nullptr};
+  std::unique_ptr<CalcBasedChecksum> ipv4_cksum{nullptr};
+  // made-up checksum in the tcp.checksum field, over unaligned fields of both
+  // headers, with distinct checksums for verification and update
+  std::unique_ptr<NamedCalculation> mixed_verify_calc{nullptr};
+  std::unique_ptr<NamedCalculation> mixed_update_calc{nullptr};
+  std::unique_ptr<CalcBasedChecksum> mixed_verify_cksum{nullptr};
+  std::unique_ptr<CalcBasedChecksum> mixed_update_cksum{nullptr};
+  std::mt19937 gen{1};
+
+  IncrementalChecksumTest() {
+    BufBuilder ipv4_builder;
+    for (int f : {0, 1, 2, 3, 4, 5, 6, 7, 8, 10, 11})
+      ipv4_builder.push_back_field(ipv4Header, f);
+    ipv4_calc = std::unique_ptr<NamedCalculation>(
+        new NamedCalculation("ipv4_calc", 1, ipv4_builder, "csum16"));
+    ipv4_cksum = std::unique_ptr<CalcBasedChecksum>(
+        new CalcBasedChecksum("ipv4_cksum", 2, ipv4Header, 9,
+                              ipv4_calc.get()));
+    ipv4_cksum->set_verifier(ipv4_cksum.get());
+
+    BufBuilder mixed_builder;
+    mixed_builder.push_back_field(ipv4Header, 5);  // ipv4.flags (3 bits)
+    mixed_builder.push_back_field(ipv4Header, 7);  // ipv4.ttl
+    mixed_builder.push_back_constant(ByteContainer(1, '\x05'), 5);
+    mixed_builder.push_back_field(tcpHeader, 5);  // tcp.res (4 bits)
+    mixed_builder.push_back_field(tcpHeader, 7);  // tcp.window
+    mixed_builder.push_back_field(ipv4Header, 11);  // ipv4.dstAddr
+    mixed_builder.push_back_field(tcpHeader, 2);  // tcp.seqNo
+    mixed_builder.push_back_field(ethernetHeader, 0);  // ethernet.dstAddr
+    mixed_verify_calc = std::unique_ptr<NamedCalculation>(
+        new NamedCalculation("mixed_verify_calc", 2, mixed_builder, "csum16"));
+    mixed_update_calc = std::unique_ptr<NamedCalculation>(
+        new NamedCalculation("mixed_update_calc", 3, mixed_builder, "csum16"));
+    mixed_verify_cksum = std::unique_ptr<CalcBasedChecksum>(
+        new CalcBasedChecksum("mixed_verify_cksum", 3, tcpHeader, 8,
+                              mixed_verify_calc.get()));
+    mixed_update_cksum = std::unique_ptr<CalcBasedChecksum>(
+        new CalcBasedChecksum("mixed_update_cksum", 4, tcpHeader, 8,
+                              mixed_update_calc.get()));
+    mixed_update_cksum->set_verifier(mixed_verify_cksum.get());
+  }
+
+  virtual void SetUp() {
+    ChecksumTest::SetUp();
+    parser.add_checksum(ipv4_cksum.get());
+    parser.add_checksum(mixed_verify_cksum.get());
+  }
+
+  // raw_tcp_pkt with a correct value for the made-up checksum
+  std::vector<char> get_frame() {
+    std::vector<char> frame(raw_tcp_pkt, raw_tcp_pkt + sizeof(raw_tcp_pkt));
+    auto packet = make_packet(frame);
+    parser.parse(&packet);
+    const auto cksum = mixed_update_calc->output(packet);
+    frame[50] = static_cast<char>(cksum >> 8);
+    frame[51] = static_cast<char>(cksum & 0xff);
+    return frame;
+  }
+
+  Packet make_packet(const std::vector<char> &frame) {
+    return Packet::make_new(
+        frame.size(), PacketBuffer(256, frame.data(), frame.size()),
+        phv_source.get());
+  }
+
+  // sets a random field to a random value, often 0 or all ones
+  void mutate(PHV *phv) {
+    const header_id_t hdrs[] = {ethernetHeader, ipv4Header, tcpHeader};
+    auto &hdr = phv->get_header(hdrs[gen() % 3]);
+    auto &f = hdr.get_field(gen() % hdr.get_header_type().get_layout().size());
+    const int nbits = f.get_nbits();
+    const uint64_t mask = (nbits == 64) ? ~0ull : ((1ull << nbits) - 1);
+    switch (gen() % 4) {
+      case 0:
+        f.set(0);
+        break;
+      case 1:
+        f.set(mask);
+        break;
+      default:
+        f.set((static_cast<uint64_t>(gen()) << 32 | gen()) & mask);
+    }
+  }
+
+  void check(const Packet &packet, const NamedCalculation &calc,
+             header_id_t hdr, int field_offset) {
+    ASSERT_EQ(calc.output(packet),
+              packet.get_phv()->get_field(hdr, field_offset).get<uint64_t>());
+  }
+};
+
+TEST_F(IncrementalChecksumTest, Unmodified) {
+  uint16_t cksum;
+  auto packet = get_ipv4_pkt(&cksum);
+  auto phv = packet.get_phv();
+  parser.parse(&packet);
+  auto &ipv4_hdr = phv->get_header(ipv4Header);
+  ASSERT_EQ(ipv4_cksum.get(), ipv4_hdr.get_verified_checksum());
+
+  ipv4_cksum->update(&packet);
+  ASSERT_EQ(cksum, phv->get_field(ipv4Header, 9).get_uint());
+  // the checksum was not written back
+  ASSERT_FALSE(ipv4_hdr.is_modified());
+}
+
+TEST_F(IncrementalChecksumTest, TTLDecrement) {
+  uint16_t cksum;
+  auto packet = get_ipv4_pkt(&cksum);
+  auto phv = packet.get_phv();
+  parser.parse(&packet);
+  auto &ttl = phv->get_field(ipv4Header, 7);
+  ttl.set(ttl.get_uint() - 1);
+
+  ipv4_cksum->update(&packet);
+  ASSERT_EQ(cksum + 0x100u, phv->get_field(ipv4Header, 9).get_uint());
+  check(packet, *ipv4_calc, ipv4Header, 9);
+}
+
+TEST_F(IncrementalChecksumTest, NotVerified) {
+  std::vector<char> frame(raw_tcp_pkt, raw_tcp_pkt + sizeof(raw_tcp_pkt));
+  frame[24] = 0;  // incorrect ipv4.checksum
+  auto packet = make_packet(frame);
+  auto phv = packet.get_phv();
+  parser.parse(&packet);
+  ASSERT_TRUE(packet.get_checksum_error());
+  ASSERT_EQ(nullptr, phv->get_header(ipv4Header).get_verified_checksum());
+
+  // an incremental update would carry the error over
+  auto &ttl = phv->get_field(ipv4Header, 7);
+  ttl.set(ttl.get_uint() - 1);
+  ipv4_cksum->update(&packet);
+  check(packet, *ipv4_calc, ipv4Header, 9);
+}
+
+TEST_F(IncrementalChecksumTest, RandomMutations) {
+  const auto frame = get_frame();
+  for (int i = 0; i < 5000; i++) {
+    auto packet = make_packet(frame);
+    auto phv = packet.get_phv();
+    parser.parse(&packet);
+    ASSERT_FALSE(packet.get_checksum_error());
+    ASSERT_EQ(mixed_verify_cksum.get(),
+              phv->get_header(tcpHeader).get_verified_checksum());
+
+    const int nb_mutations = gen() % 5;
+    for (int j = 0; j < nb_mutations; j++) mutate(phv);
+    // the checksums need to be computed from scratch
+    if (gen() % 20 == 0) phv->get_header(tcpHeader).mark_invalid();
+
+    ipv4_cksum->update(&packet);
+    check(packet, *ipv4_calc, ipv4Header, 9);
+    mixed_update_cksum->update(&packet);
+    check(packet, *mixed_update_calc, tcpHeader, 8);
+  }
+}
+
+TEST_F(IncrementalChecksumTest, Clone) {
+  const auto frame = get_frame();
+  auto packet = make_packet(frame);
+  parser.parse(&packet);
+  auto clone = packet.clone_with_phv_ptr();
+  auto phv = clone->get_phv();
+  ASSERT_EQ(ipv4_cksum.get(),
+            phv->get_header(ipv4Header).get_verified_checksum());
+
+  for (int i = 0; i < 100; i++) mutate(phv);
+  ipv4_cksum->update(clone.get());
+  check(*clone, *ipv4_calc, ipv4Header, 9);
+  mixed_update_cksum->update(clone.get());
+  check(*clone, *mixed_update_calc, tcpHeader, 8);
+}
+
 class ChecksumConditionTest : public ::testing::Test {
  protected:
   PHVFactory phv_factory;
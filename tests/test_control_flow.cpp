@@ -22,7 +22,15 @@
 
 #include <bm/bm_sim/actions.h>
 #include <bm/bm_sim/control_action.h>
+#include <bm/bm_sim/control_flow_graph.h>
 #include <bm/bm_sim/packet.h>
+#include <bm/bm_sim/pipeline.h>
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
 
 using namespace bm;
 
@@ -82,3 +90,163 @@ TEST_F(ControlActionTest, Call) {
   EXPECT_EQ(&dummy_next_node, next_node);
   EXPECT_EQ(1u, count_primitive.get());
 }
+
+namespace {
+
+struct DestructionFlag {
+  explicit DestructionFlag(std::atomic<bool> *destroyed)
+      : destroyed(destroyed) { }
+  ~DestructionFlag() { destroyed->store(true); }
+  std::atomic<bool> *destroyed;
+};
+
+}  // namespace
+
+class ControlFlowGraphTest : public ::testing::Test {
+ protected:
+  static constexpr size_t nb_nodes = 4;
+
+  count count_primitives[nb_nodes];
+  std::vector<std::unique_ptr<ActionFn> > action_fns{};
+  std::vector<std::unique_ptr<ControlAction> > nodes{};
+  VersionedControlFlowGraph cfg{};
+  Pipeline pipeline;
+
+  PHVFactory phv_factory;
+  std::unique_ptr<PHVSourceIface> phv_source{nullptr};
+
+  ControlFlowGraphTest()
+      : pipeline("pipeline", 0, nullptr),
+        phv_source(PHVSourceIface::make_phv_source()) { }
+
+  Packet get_pkt() {
+    // dummy packet, won't be parsed
+    return Packet::make_new(64, PacketBuffer(128), phv_source.get());
+  }
+
+  virtual void SetUp() {
+    for (size_t i = 0; i < nb_nodes; i++) {
+      action_fns.emplace_back(new ActionFn("action", i, 0));
+      action_fns.back()->push_back_primitive(&count_primitives[i]);
+      nodes.emplace_back(new ControlAction("node", i));
+      nodes.back()->set_action(action_fns.back().get());
+      cfg.add_node(nodes.back().get());
+    }
+    // 0 -> 1
+    nodes[0]->set_next_node(nodes[1].get());
+    pipeline.set_first_node(nodes[0].get());
+    pipeline.set_control_flow_graph(&cfg);
+    cfg.publish();
+
+    phv_source->set_phv_factory(0, &phv_factory);
+  }
+
+  std::vector<size_t> get_counts() {
+    std::vector<size_t> counts;
+    for (auto &c : count_primitives) counts.push_back(c.get());
+    return counts;
+  }
+};
+
+TEST_F(ControlFlowGraphTest, EditsVisibleOnPublish) {
+  auto pkt = get_pkt();
+  pipeline.apply(&pkt);
+  EXPECT_EQ(std::vector<size_t>({1, 1, 0, 0}), get_counts());
+
+  // 0 -> 2 -> 3
+  nodes[0]->set_next_node(nodes[2].get());
+  nodes[2]->set_next_node(nodes[3].get());
+  pipeline.apply(&pkt);
+  EXPECT_EQ(std::vector<size_t>({2, 2, 0, 0}), get_counts());
+
+  const auto version = cfg.get_version();
+  cfg.publish();
+  EXPECT_EQ(version + 1, cfg.get_version());
+  pipeline.apply(&pkt);
+  EXPECT_EQ(std::vector<size_t>({3, 2, 1, 1}), get_counts());
+
+  // 3
+  pipeline.set_first_node(nodes[3].get());
+  pipeline.apply(&pkt);
+  EXPECT_EQ(std::vector<size_t>({4, 2, 2, 2}), get_counts());
+  cfg.publish();
+  pipeline.apply(&pkt);
+  EXPECT_EQ(std::vector<size_t>({4, 2, 2, 3}), get_counts());
+}
+
+TEST_F(ControlFlowGraphTest, RemoveNode) {
+  auto pkt = get_pkt();
+  // 0 -> 2, 1 is replaced by a new node, which takes its slot
+  nodes[0]->set_next_node(nodes[2].get());
+  cfg.remove_node(nodes[1].get());
+  std::unique_ptr<ControlAction> new_node(new ControlAction("new_node", 4));
+  new_node->set_action(action_fns[3].get());
+  cfg.add_node(new_node.get());
+  EXPECT_EQ(nodes[1]->get_cfg_slot(), new_node->get_cfg_slot());
+  nodes[2]->set_next_node(new_node.get());
+  pipeline.apply(&pkt);
+  EXPECT_EQ(std::vector<size_t>({1, 1, 0, 0}), get_counts());
+  cfg.publish();
+  pipeline.apply(&pkt);
+  EXPECT_EQ(std::vector<size_t>({2, 1, 1, 1}), get_counts());
+}
+
+TEST_F(ControlFlowGraphTest, RetireWaitsForReaders) {
+  std::atomic<bool> destroyed(false);
+  std::atomic<bool> published(false);
+  std::unique_ptr<VersionedControlFlowGraph::ReadGuard> guard(
+      new VersionedControlFlowGraph::ReadGuard(cfg.read()));
+  const auto version = (*guard)->get_version();
+  cfg.retire(std::unique_ptr<DestructionFlag>(new DestructionFlag(&destroyed)));
+  std::thread publisher([this, &published]() {
+    cfg.publish();
+    published.store(true);
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  EXPECT_FALSE(published.load());
+  EXPECT_FALSE(destroyed.load());
+  // the reader still sees the snapshot it started with
+  EXPECT_EQ(version, (*guard)->get_version());
+  guard.reset();
+  publisher.join();
+  EXPECT_TRUE(destroyed.load());
+  EXPECT_EQ(version + 1, cfg.get_version());
+}
+
+// a packet never sees a graph with only some of the edits of a publish
+TEST_F(ControlFlowGraphTest, ConcurrentPublish) {
+  constexpr int nb_publish = 200;
+  std::atomic<bool> done(false);
+  std::thread writer([this, &done]() {
+    for (int i = 0; i < nb_publish; i++) {
+      if (i % 2 == 0) {
+        // 0 -> 2 -> 3
+        nodes[0]->set_next_node(nodes[2].get());
+        std::this_thread::yield();
+        nodes[2]->set_next_node(nodes[3].get());
+      } else {
+        // 0 -> 1
+        nodes[2]->set_next_node(nullptr);
+        std::this_thread::yield();
+        nodes[0]->set_next_node(nodes[1].get());
+      }
+      cfg.publish();
+    }
+    done.store(true);
+  });
+  auto pkt = get_pkt();
+  auto prev = get_counts();
+  size_t nb_bad = 0;
+  while (!done.load()) {
+    pipeline.apply(&pkt);
+    const auto counts = get_counts();
+    const bool path_1 = (counts[1] == prev[1] + 1) && (counts[2] == prev[2]) &&
+        (counts[3] == prev[3]);
+    const bool path_2 = (counts[1] == prev[1]) && (counts[2] == prev[2] + 1) &&
+        (counts[3] == prev[3] + 1);
+    if (!path_1 && !path_2) nb_bad++;
+    prev = counts;
+  }
+  writer.join();
+  EXPECT_EQ(0u, nb_bad);
+}
@@ -204,3 +204,79 @@ TEST(Data, GetString) {
   Data d(s.data(), s.size());
   ASSERT_EQ(s, d.get_string());
 }
+
+// non-negative values which fit in 64 bits use a different representation; the
+// following tests check the transitions between the 2 representations
+
+TEST(Data, AddOverflow64) {
+  const Data d1(0xffffffffffffffffull);
+  const Data d2(1);
+  Data d3;
+  d3.add(d1, d2);
+  ASSERT_EQ(Data("0x10000000000000000"), d3);
+  d3.sub(d3, d2);
+  ASSERT_EQ(d1, d3);
+  ASSERT_EQ(0xffffffffffffffffull, d3.get_uint64());
+}
+
+TEST(Data, SubNegative) {
+  const Data d1(10);
+  const Data d2(22);
+  Data d3;
+  d3.sub(d1, d2);
+  ASSERT_EQ(-12, d3.get_int());
+  ASSERT_GT(0, d3.sign());
+  d3.add(d3, d2);
+  ASSERT_EQ(d1, d3);
+}
+
+TEST(Data, MultiplyWide) {
+  const Data d1(0x100000000ull);
+  const Data d2(0x100000001ull);
+  Data d3;
+  d3.multiply(d1, d2);
+  ASSERT_EQ(Data("0x10000000100000000"), d3);
+  d3.shift_right(d3, 32);
+  ASSERT_EQ(d2, d3);
+}
+
+TEST(Data, ShiftWide) {
+  const Data d1(0xabc);
+  Data d2;
+  d2.shift_left(d1, 52);
+  ASSERT_EQ(0xabc0000000000000ull, d2.get_uint64());
+  d2.shift_left(d1, 60);
+  ASSERT_EQ(Data("0xabc000000000000000"), d2);
+  d2.shift_right(d2, 60);
+  ASSERT_EQ(d1, d2);
+  d2.shift_right(d1, 64);
+  ASSERT_EQ(0, d2.sign());
+}
+
+TEST(Data, CompareWide) {
+  const Data small(0xffffffffffffffffull);
+  const Data wide("0x10000000000000000");
+  const Data neg(-1);
+  ASSERT_NE(small, wide);
+  ASSERT_LT(small, wide);
+  ASSERT_GT(wide, small);
+  ASSERT_LT(neg, small);
+  ASSERT_FALSE(neg.test_eq(0xffffffffffffffffull));
+  ASSERT_TRUE(neg.test_eq(-1));
+}
+
+TEST(Data, GetStringZero) {
+  const Data d(0);
+  ASSERT_EQ(std::string(1, '\x00'), d.get_string());
+}
+
+TEST(Data, ConstructorFromWideBytes) {
+  // leading zeros are ignored
+  const std::string s1("\x00\x00\x01\x02\x03\x04\x05\x06\x07\x08", 10);
+  const Data d1(s1.data(), s1.size());
+  ASSERT_EQ(0x0102030405060708ull, d1.get_uint64());
+  const std::string s2("\x01\x02\x03\x04\x05\x06\x07\x08\x09", 9);
+  const Data d2(s2.data(), s2.size());
+  ASSERT_EQ(s2, d2.get_string());
+  ASSERT_LT(d1, d2);
+}
@@ -330,6 +330,58 @@ TEST_F(PacketInDevMgrTest, PacketInTest) {
   ASSERT_TRUE(check_recv(&recv_switch, port, pkt, sizeof(pkt)));
 }
 
+TEST_F(PacketInDevMgrTest, BurstTest) {
+  constexpr int port = 2;
+  constexpr size_t max_burst = 4;
+  constexpr size_t nb_packets = 20;
+  std::mutex mutex;
+  std::condition_variable cv;
+  std::vector<std::pair<int, std::string> > received;
+  size_t largest_burst = 0;
+  auto cb_burst = [&](const DevMgr::BurstPacket *packets, size_t count,
+                      void *cookie) {
+    (void) cookie;
+    std::lock_guard<std::mutex> lock(mutex);
+    largest_burst = std::max(largest_burst, count);
+    for (size_t i = 0; i < count; i++) {
+      received.emplace_back(packets[i].port_num,
+                            std::string(packets[i].buffer, packets[i].len));
+    }
+    cv.notify_one();
+  };
+  ASSERT_EQ(DevMgr::ReturnCode::SUCCESS,
+            sw.set_burst_handler(cb_burst, max_burst, nullptr));
+  ASSERT_EQ(max_burst, sw.get_burst_size());
+
+  // lib -> switch
+  for (size_t i = 0; i < nb_packets; i++) {
+    const char pkt[] = {'\x0a', static_cast<char>(i)};
+    packet_inject.send(port, pkt, sizeof(pkt));
+  }
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    ASSERT_TRUE(cv.wait_for(lock, std::chrono::seconds(2), [&] {
+          return received.size() == nb_packets; }));
+  }
+  ASSERT_LE(largest_burst, max_burst);
+  for (size_t i = 0; i < nb_packets; i++) {
+    EXPECT_EQ(port, received[i].first);
+    EXPECT_EQ(std::string({'\x0a', static_cast<char>(i)}),
+              received[i].second);
+  }
+  // the packet handler is not used when a burst handler is set
+  ASSERT_EQ(PacketInReceiver::Status::CAN_RECEIVE, recv_switch.check_status());
+
+  // switch -> lib
+  const char pkt_1[] = {'\x01'};
+  const char pkt_2[] = {'\x02', '\x03'};
+  const DevMgr::BurstPacket burst[] = {{port, pkt_1, sizeof(pkt_1)},
+                                       {port + 1, pkt_2, sizeof(pkt_2)}};
+  sw.transmit_burst(burst, 2);
+  ASSERT_TRUE(check_recv(&recv_lib, port, pkt_1, sizeof(pkt_1)));
+  ASSERT_TRUE(check_recv(&recv_lib, port + 1, pkt_2, sizeof(pkt_2)));
+}
+
 TEST_F(PacketInDevMgrTest, InfoRequestTest) {
   constexpr int port = 2;
   // using info_type 0 and 1, but can be any integer value at the moment
@@ -24,8 +24,11 @@
 #include <bm/bm_sim/expressions.h>
 #include <bm/bm_sim/phv.h>
 
+#include <functional>
 #include <memory>
+#include <random>
 #include <stdexcept>
+#include <vector>
 
 // expressions are mostly tested in test_conditionals.cpp. This file is only
 // used for some edge case testing.
@@ -124,3 +127,222 @@ TEST_F(ExpressionsTest, OutOfBoundsStackAccess) {
   // future, we may log an error message as well.
   EXPECT_THROW(expr.eval_header(phv.get()), std::out_of_range);
 }
+
+// compiled expressions (see expression_compiler.h)
+
+namespace {
+
+using ExprBuilder = std::function<void(Expression *)>;
+
+struct CompilableExpr {
+  bool is_bool;
+  ExprBuilder build;
+};
+
+// f32, f48, f8, f16 and f128 have offsets 0 to 4
+std::vector<CompilableExpr> compilable_exprs(header_id_t h1, header_id_t h2) {
+  return {
+    // h1.f16 == 0xaba
+    {true, [h1](Expression *e) {
+      e->push_back_load_field(h1, 3);
+      e->push_back_load_const(Data(0xaba));
+      e->push_back_op(ExprOpcode::EQ_DATA);
+    }},
+    // 7 < h1.f8
+    {true, [h1](Expression *e) {
+      e->push_back_load_const(Data(7));
+      e->push_back_load_field(h1, 2);
+      e->push_back_op(ExprOpcode::LT_DATA);
+    }},
+    // h1.f48 >= h2.f48
+    {true, [h1, h2](Expression *e) {
+      e->push_back_load_field(h1, 1);
+      e->push_back_load_field(h2, 1);
+      e->push_back_op(ExprOpcode::GET_DATA);
+    }},
+    // (h1.f32 & 0xff) != 3
+    {true, [h1](Expression *e) {
+      e->push_back_load_field(h1, 0);
+      e->push_back_load_const(Data(0xff));
+      e->push_back_op(ExprOpcode::BIT_AND);
+      e->push_back_load_const(Data(3));
+      e->push_back_op(ExprOpcode::NEQ_DATA);
+    }},
+    // (((h1.f16 & 0x1ffff) + 1) & 0x1ffff) < 0xffff
+    {true, [h1](Expression *e) {
+      e->push_back_load_field(h1, 3);
+      e->push_back_load_const(Data(0x1ffff));
+      e->push_back_op(ExprOpcode::BIT_AND);
+      e->push_back_load_const(Data(1));
+      e->push_back_op(ExprOpcode::ADD);
+      e->push_back_load_const(Data(0x1ffff));
+      e->push_back_op(ExprOpcode::BIT_AND);
+      e->push_back_load_const(Data(0xffff));
+      e->push_back_op(ExprOpcode::LT_DATA);
+    }},
+    // ((h1.f48 - h2.f48) & 0xffffffffffff) > 100
+    {true, [h1, h2](Expression *e) {
+      e->push_back_load_field(h1, 1);
+      e->push_back_load_field(h2, 1);
+      e->push_back_op(ExprOpcode::SUB);
+      e->push_back_load_const(Data(0xffffffffffffULL));
+      e->push_back_op(ExprOpcode::BIT_AND);
+      e->push_back_load_const(Data(100));
+      e->push_back_op(ExprOpcode::GT_DATA);
+    }},
+    // valid(h1) and not (h2.f8 <= 10 or d2b(h2.f8))
+    {true, [h1, h2](Expression *e) {
+      e->push_back_load_header(h1);
+      e->push_back_op(ExprOpcode::VALID_HEADER);
+      e->push_back_load_field(h2, 2);
+      e->push_back_load_const(Data(10));
+      e->push_back_op(ExprOpcode::LET_DATA);
+      e->push_back_load_field(h2, 2);
+      e->push_back_op(ExprOpcode::DATA_TO_BOOL);
+      e->push_back_op(ExprOpcode::OR);
+      e->push_back_op(ExprOpcode::NOT);
+      e->push_back_op(ExprOpcode::AND);
+    }},
+    // false or h1.f128 == 5
+    {true, [h1](Expression *e) {
+      e->push_back_load_bool(false);
+      e->push_back_load_field(h1, 4);
+      e->push_back_load_const(Data(5));
+      e->push_back_op(ExprOpcode::EQ_DATA);
+      e->push_back_op(ExprOpcode::OR);
+    }},
+    // h1.f16 - h2.f16, can be negative
+    {false, [h1, h2](Expression *e) {
+      e->push_back_load_field(h1, 3);
+      e->push_back_load_field(h2, 3);
+      e->push_back_op(ExprOpcode::SUB);
+    }},
+    // h1.f128 + 1, can exceed 64 bits
+    {false, [h1](Expression *e) {
+      e->push_back_load_field(h1, 4);
+      e->push_back_load_const(Data(1));
+      e->push_back_op(ExprOpcode::ADD);
+    }},
+    // (local0 + h1.f8) & 0xff
+    {false, [h1](Expression *e) {
+      e->push_back_load_local(0);
+      e->push_back_load_field(h1, 2);
+      e->push_back_op(ExprOpcode::ADD);
+      e->push_back_load_const(Data(0xff));
+      e->push_back_op(ExprOpcode::BIT_AND);
+    }},
+    // 0xf0 & (h1.f8 ^ local0)
+    {false, [h1](Expression *e) {
+      e->push_back_load_const(Data(0xf0));
+      e->push_back_load_field(h1, 2);
+      e->push_back_load_local(0);
+      e->push_back_op(ExprOpcode::BIT_XOR);
+      e->push_back_op(ExprOpcode::BIT_AND);
+    }},
+  };
+}
+
+}  // namespace
+
+TEST_F(ExpressionsTest, CompiledShapes) {
+  for (const auto &e : compilable_exprs(testHeader1, testHeader2)) {
+    Expression expr;
+    e.build(&expr);
+    expr.build();
+    EXPECT_TRUE(expr.is_compiled());
+  }
+
+  std::vector<ExprBuilder> not_compilable = {
+    [this](Expression *e) {  // h1.f16 * 2
+      e->push_back_load_field(testHeader1, 3);
+      e->push_back_load_const(Data(2));
+      e->push_back_op(ExprOpcode::MUL);
+    },
+    [this](Expression *e) {  // h1.f16 == -1
+      e->push_back_load_field(testHeader1, 3);
+      e->push_back_load_const(Data(-1));
+      e->push_back_op(ExprOpcode::EQ_DATA);
+    },
+    [this](Expression *e) {  // (h1.f8 + h2.f8) + 1, nested without a mask
+      e->push_back_load_field(testHeader1, 2);
+      e->push_back_load_field(testHeader2, 2);
+      e->push_back_op(ExprOpcode::ADD);
+      e->push_back_load_const(Data(1));
+      e->push_back_op(ExprOpcode::ADD);
+    },
+    [this](Expression *e) {  // (valid(h1) and valid(h2)) or d2b(h1.f8)
+      e->push_back_load_header(testHeader1);
+      e->push_back_op(ExprOpcode::VALID_HEADER);
+      e->push_back_load_header(testHeader2);
+      e->push_back_op(ExprOpcode::VALID_HEADER);
+      e->push_back_op(ExprOpcode::AND);
+      e->push_back_load_field(testHeader1, 2);
+      e->push_back_op(ExprOpcode::DATA_TO_BOOL);
+      e->push_back_op(ExprOpcode::OR);
+    },
+  };
+  for (const auto &builder : not_compilable) {
+    Expression expr;
+    builder(&expr);
+    expr.build();
+    EXPECT_FALSE(expr.is_compiled());
+  }
+
+  Expression expr;
+  compilable_exprs(testHeader1, testHeader2).front().build(&expr);
+  Expression::set_compilation_enabled(false);
+  expr.build();
+  Expression::set_compilation_enabled(true);
+  EXPECT_FALSE(expr.is_compiled());
+}
+
+// the operands include values which do not fit in 64 bits and subtractions
+// which go negative, for which the interpreter is used
+TEST_F(ExpressionsTest, CompiledMatchesInterpreter) {
+  std::mt19937_64 gen(42);
+  std::uniform_int_distribution<uint64_t> dis;
+  auto random_bytes = [&gen, &dis](size_t nbytes) {
+    ByteContainer bytes(nbytes);
+    for (size_t i = 0; i < nbytes; i++)
+      bytes[i] = static_cast<char>(dis(gen) & 0xff);
+    // small values are more interesting
+    if (dis(gen) % 2 == 0) std::fill(bytes.begin(), bytes.end() - 1, 0);
+    return bytes;
+  };
+  const int nbytes[] = {4, 6, 1, 2, 16};
+
+  for (const auto &e : compilable_exprs(testHeader1, testHeader2)) {
+    Expression compiled, interpreted;
+    e.build(&compiled);
+    e.build(&interpreted);
+    compiled.build();
+    Expression::set_compilation_enabled(false);
+    interpreted.build();
+    Expression::set_compilation_enabled(true);
+    ASSERT_TRUE(compiled.is_compiled());
+    ASSERT_FALSE(interpreted.is_compiled());
+
+    for (int i = 0; i < 10000; i++) {
+      for (auto h : {testHeader1, testHeader2}) {
+        auto &hdr = phv->get_header(h);
+        if (dis(gen) % 2) hdr.mark_valid(); else hdr.mark_invalid();
+        for (int f = 0; f < 5; f++) {
+          const auto bytes = random_bytes(nbytes[f]);
+          hdr.get_field(f).set(bytes);
+        }
+      }
+      const std::vector<Data> locals = {Data(dis(gen) % 512)};
+      if (e.is_bool) {
+        ASSERT_EQ(interpreted.eval_bool(*phv, locals),
+                  compiled.eval_bool(*phv, locals));
+      } else {
+        ASSERT_EQ(interpreted.eval_arith(*phv, locals),
+                  compiled.eval_arith(*phv, locals));
+        Data d1, d2;
+        interpreted.eval_arith(*phv, &d1, locals);
+        compiled.eval_arith(*phv, &d2, locals);
+        ASSERT_EQ(d1, d2);
+      }
+    }
+  }
+}
@@ -301,3 +301,27 @@ TEST(FieldTest, ExportBytesVLLarge) {
   f.export_bytes();
   EXPECT_NE(0u, f.get<uint64_t>());
 }
+
+TEST(FieldTest, UnsignedWrapAround) {
+  Field f(16, nullptr  /* parent hdr */);
+  f.set(0);
+  f.sub(f, Data(1));
+  EXPECT_EQ(0xffffu, f.get_uint());
+  EXPECT_EQ("ffff", f.get_bytes().to_hex());
+  f.add(f, Data(1));
+  EXPECT_EQ(0u, f.get_uint());
+  f.bit_neg(f);
+  EXPECT_EQ(0xffffu, f.get_uint());
+}
+
+// values in fields wider than 64 bits may or may not fit in 64 bits
+TEST(FieldTest, WideUnsigned) {
+  Field f(72, nullptr  /* parent hdr */);
+  f.set(Data("0xff0000000000000001"));
+  EXPECT_EQ("ff0000000000000001", f.get_bytes().to_hex());
+  f.sub(f, Data("0xff0000000000000000"));
+  EXPECT_EQ(1u, f.get_uint());
+  EXPECT_EQ("000000000000000001", f.get_bytes().to_hex());
+  f.sub(f, Data(2));
+  EXPECT_EQ("ffffffffffffffffff", f.get_bytes().to_hex());
+}
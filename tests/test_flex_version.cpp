@@ -0,0 +1,155 @@
+/* Copyright 2013-present Barefoot Networks, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <bm/bm_sim/flex_version.h>
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+using namespace bm;
+
+namespace {
+
+uint64_t now_ms() {
+  return std::chrono::duration_cast<std::chrono::milliseconds>(
+      std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+}  // namespace
+
+TEST(FlexVersion, Set) {
+  FlexVersion version;
+  EXPECT_EQ(0u, version.get_version());
+  EXPECT_EQ(0u, version.assign(0));
+  version.set(1);
+  EXPECT_EQ(1u, version.get_version());
+  EXPECT_EQ(1u, version.assign(0));
+  EXPECT_EQ(1u, version.assign(0));
+  EXPECT_FALSE(version.has_pending_switch());
+  EXPECT_EQ(3u, version.get_packet_count());
+  EXPECT_EQ(1u, version.get_packet_count(0));
+  EXPECT_EQ(2u, version.get_packet_count(1));
+}
+
+TEST(FlexVersion, ScheduleAtPacket) {
+  FlexVersion version;
+  for (int i = 0; i < 5; i++) version.assign(0);
+  EXPECT_TRUE(version.schedule_at_packet(1, 10));
+  EXPECT_TRUE(version.has_pending_switch());
+  for (int i = 5; i < 10; i++) EXPECT_EQ(0u, version.assign(0));
+  EXPECT_FALSE(version.has_pending_switch());
+  EXPECT_EQ(1u, version.get_version());
+  for (int i = 10; i < 15; i++) EXPECT_EQ(1u, version.assign(0));
+  EXPECT_EQ(10u, version.get_packet_count(0));
+  EXPECT_EQ(5u, version.get_packet_count(1));
+
+  // the switch which was reached is kept when scheduling the next one
+  EXPECT_TRUE(version.schedule_at_packet(0, 20));
+  EXPECT_EQ(1u, version.get_version());
+  for (int i = 15; i < 20; i++) EXPECT_EQ(1u, version.assign(0));
+  EXPECT_EQ(0u, version.assign(0));
+}
+
+TEST(FlexVersion, ScheduleAtPacketReached) {
+  FlexVersion version;
+  for (int i = 0; i < 5; i++) version.assign(0);
+  EXPECT_FALSE(version.schedule_at_packet(1, 3));
+  EXPECT_EQ(1u, version.assign(0));
+}
+
+TEST(FlexVersion, CancelScheduled) {
+  FlexVersion version;
+  EXPECT_TRUE(version.schedule_at_packet(1, 10));
+  version.set(0);
+  EXPECT_FALSE(version.has_pending_switch());
+  for (int i = 0; i < 20; i++) EXPECT_EQ(0u, version.assign(0));
+}
+
+TEST(FlexVersion, ScheduleAtTime) {
+  FlexVersion version;
+  const uint64_t ts_ms = now_ms() + 3600 * 1000;
+  EXPECT_TRUE(version.schedule_at_time(1, ts_ms));
+  EXPECT_TRUE(version.has_pending_switch());
+  EXPECT_EQ(0u, version.get_version());
+  EXPECT_EQ(0u, version.assign(ts_ms - 1));
+  EXPECT_EQ(1u, version.assign(ts_ms));
+  EXPECT_EQ(1u, version.assign(ts_ms + 1));
+  // packets are not necessarily parsed in timestamp order
+  EXPECT_EQ(0u, version.assign(ts_ms - 1));
+  EXPECT_EQ(2u, version.get_packet_count(0));
+  EXPECT_EQ(2u, version.get_packet_count(1));
+
+  EXPECT_FALSE(version.schedule_at_time(0, now_ms() - 1000));
+  EXPECT_EQ(0u, version.get_version());
+}
+
+// the counters are sharded between the threads, nothing should be lost when
+// summing them
+TEST(FlexVersion, ConcurrentCounts) {
+  constexpr int nb_threads = 4;
+  constexpr uint64_t nb_packets = 100000;
+  FlexVersion version;
+  version.set(1);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < nb_threads; t++) {
+    threads.emplace_back([&version]() {
+      for (uint64_t i = 0; i < nb_packets; i++) version.assign(0);
+    });
+  }
+  for (auto &thread : threads) thread.join();
+  EXPECT_EQ(nb_threads * nb_packets, version.get_packet_count());
+  EXPECT_EQ(nb_threads * nb_packets, version.get_packet_count(1));
+}
+
+// the switch is scheduled while several threads assign versions: the packets
+// numbered before the threshold are processed with the old version, as well as
+// at most one packet in flight per thread when the switch is published
+TEST(FlexVersion, ConcurrentScheduleAtPacket) {
+  constexpr int nb_threads = 4;
+  constexpr uint64_t nb_packets_after = 1000000;
+  FlexVersion version;
+  std::atomic<bool> stop(false);
+  std::vector<uint64_t> nb_bad(nb_threads, 0);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < nb_threads; t++) {
+    threads.emplace_back([&version, &stop, &nb_bad, t]() {
+      // packet numbers only increase in a given thread, so once a thread has
+      // seen the new version, it should never see the old one again
+      bool switched = false;
+      while (!stop.load()) {
+        const auto v = version.assign(0);
+        if (switched && v == 0) nb_bad[t]++;
+        switched = switched || (v == 1);
+      }
+    });
+  }
+  while (version.get_packet_count() < 1000) std::this_thread::yield();
+  const uint64_t threshold = version.get_packet_count() + nb_packets_after;
+  EXPECT_TRUE(version.schedule_at_packet(1, threshold));
+  while (version.get_packet_count() < threshold + nb_packets_after)
+    std::this_thread::yield();
+  stop.store(true);
+  for (auto &thread : threads) thread.join();
+
+  for (int t = 0; t < nb_threads; t++) EXPECT_EQ(0u, nb_bad[t]);
+  EXPECT_LE(threshold, version.get_packet_count(0));
+  EXPECT_GE(threshold + nb_threads, version.get_packet_count(0));
+  EXPECT_EQ(version.get_packet_count() - version.get_packet_count(0),
+            version.get_packet_count(1));
+}
@@ -22,7 +22,9 @@
 
 #include <bm/bm_sim/phv.h>
 
+#include <random>
 #include <string>
+#include <vector>
 
 using namespace bm;
 
@@ -80,6 +82,83 @@ TEST_F(HeaderTest, CmpDiffType) {
 }
 
 
+// fields which do not start on a byte boundary, fields which do not fit in 64
+// bits, and a signed field
+class HeaderExtractTest : public ::testing::Test {
+ protected:
+  PHVFactory phv_factory;
+  std::unique_ptr<PHV> phv;
+
+  HeaderType testHeaderType;
+  header_id_t testHeader{0};
+  const std::vector<int> bitwidths{3, 13, 1, 70, 7, 64, 2, 4, 60, 8, 16, 8};
+
+  HeaderExtractTest()
+      : testHeaderType("test_t", 0) {
+    for (size_t i = 0; i < bitwidths.size(); i++) {
+      testHeaderType.push_back_field("f" + std::to_string(i), bitwidths[i],
+                                     i == 4  /* is_signed */);
+    }
+    phv_factory.push_back_header("test", testHeader, testHeaderType);
+    phv_factory.enable_all_field_arith(testHeader);
+  }
+
+  virtual void SetUp() {
+    phv = phv_factory.create();
+  }
+
+  // reference implementation, one bit at a time
+  static ByteContainer read_bits(const std::string &data, int offset,
+                                 int nbits) {
+    ByteContainer res((nbits + 7) / 8);
+    const int pad = static_cast<int>(res.size()) * 8 - nbits;
+    for (int i = 0; i < nbits; i++) {
+      const int src = offset + i;
+      if ((data[src / 8] >> (7 - src % 8)) & 1) {
+        const int dst = pad + i;
+        res[dst / 8] |= static_cast<char>(1 << (7 - dst % 8));
+      }
+    }
+    return res;
+  }
+};
+
+TEST_F(HeaderExtractTest, Extract) {
+  auto &hdr = phv->get_header(testHeader);
+  const int nbytes = hdr.get_nbytes_packet();
+  ASSERT_EQ(32, nbytes);
+  std::mt19937 gen(1);
+  std::uniform_int_distribution<int> dis(0, 255);
+  for (int iter = 0; iter < 100; iter++) {
+    std::string data(nbytes, '\0');
+    for (auto &c : data) c = static_cast<char>(dis(gen));
+    hdr.extract(data.data(), *phv);
+    EXPECT_TRUE(hdr.is_valid());
+    EXPECT_EQ(data, std::string(hdr.get_packet_image(), nbytes));
+
+    int offset = 0;
+    for (size_t i = 0; i < bitwidths.size(); i++) {
+      const auto expected = read_bits(data, offset, bitwidths[i]);
+      const auto &f = hdr.get_field(i);
+      EXPECT_EQ(expected, f.get_bytes()) << "field " << i;
+      if (i == 4) {
+        int expected_value = static_cast<unsigned char>(expected[0]);
+        if (expected_value & 0x40) expected_value -= 0x80;
+        EXPECT_EQ(expected_value, f.get<int>()) << "field " << i;
+      } else {
+        Data expected_value;
+        expected_value.set(expected);
+        EXPECT_EQ(expected_value, f) << "field " << i;
+      }
+      offset += bitwidths[i];
+    }
+
+    std::string deparsed(nbytes, '\0');
+    hdr.deparse(&deparsed[0]);
+    EXPECT_EQ(data, deparsed);
+  }
+}
+
 class HeaderVLTest : public ::testing::Test {
  protected:
   PHVFactory phv_factory;
@@ -21,6 +21,10 @@
 #include <gtest/gtest.h>
 
 #include <bm/bm_sim/P4Objects.h>
+#include <bm/bm_sim/deparser.h>
+#include <bm/bm_sim/packet.h>
+#include <bm/bm_sim/parser.h>
+#include <bm/bm_sim/phv_source.h>
 
 #include <ctype.h>
 
@@ -101,6 +105,19 @@ TEST(P4Objects, LoadFromJSON2) {
   ASSERT_NE(nullptr, dynamic_cast<MatchTableIndirectWS *>(table));
 }
 
+TEST(P4Objects, FlexVersionWithoutScalars) {
+  // JSON_TEST_STRING_2 was produced by the legacy P4_14 compiler and has no
+  // "scalars" header: one is added for the version set by the flex parser
+  // state
+  std::istringstream is(JSON_TEST_STRING_2);
+  P4Objects objects;
+  LookupStructureFactory factory;
+  ASSERT_EQ(0, objects.init_objects(&is, &factory));
+
+  ASSERT_TRUE(objects.header_exists("scalars"));
+  ASSERT_TRUE(objects.field_exists("scalars", "flexMetadata.version"));
+}
+
 TEST(P4Objects, Empty) {
   std::istringstream is("{}");
   P4Objects objects;
@@ -1094,3 +1111,70 @@ TEST(P4Objects, InvalidReference) {
   ASSERT_NE(0, objects.init_objects(&is, &factory));
   EXPECT_EQ(expected_error_msg, os.str());
 }
+
+// P4_16 programs have distinct checksums for verification and update,
+// which are matched so that the update can be incremental
+TEST(P4Objects, ChecksumVerifier) {
+  const std::vector<std::pair<std::string, int> > ipv4_fields = {
+    {"version", 4}, {"ihl", 4}, {"diffserv", 8}, {"totalLen", 16},
+    {"identification", 16}, {"flags", 3}, {"fragOffset", 13}, {"ttl", 8},
+    {"protocol", 8}, {"hdrChecksum", 16}, {"srcAddr", 32}, {"dstAddr", 32}};
+  std::stringstream is;
+  is << "{\"header_types\":[{\"name\":\"ipv4_t\",\"id\":0,\"fields\":[";
+  for (size_t i = 0; i < ipv4_fields.size(); i++) {
+    is << (i ? "," : "") << "[\"" << ipv4_fields[i].first << "\","
+       << ipv4_fields[i].second << "]";
+  }
+  is << "]}],\"headers\":[{\"name\":\"ipv4\",\"id\":0,"
+     << "\"header_type\":\"ipv4_t\",\"metadata\":false}],"
+     << "\"parsers\":[{\"name\":\"parser\",\"id\":0,\"init_state\":"
+     << "\"start\",\"parse_states\":[{\"name\":\"start\",\"id\":0,"
+     << "\"parser_ops\":[{\"op\":\"extract\",\"parameters\":"
+     << "[{\"type\":\"regular\",\"value\":\"ipv4\"}]}],"
+     << "\"transition_key\":[],\"transitions\":[]}]}],"
+     << "\"deparsers\":[{\"name\":\"deparser\",\"id\":0,"
+     << "\"order\":[\"ipv4\"]}],\"calculations\":[";
+  for (int c = 0; c < 2; c++) {
+    is << (c ? "," : "") << "{\"name\":\"calc_" << c << "\",\"id\":" << c
+       << ",\"algo\":\"csum16\",\"input\":[";
+    for (size_t i = 0; i < ipv4_fields.size(); i++) {
+      if (ipv4_fields[i].first == "hdrChecksum") continue;
+      is << (i ? "," : "") << "{\"type\":\"field\",\"value\":[\"ipv4\",\""
+         << ipv4_fields[i].first << "\"]}";
+    }
+    is << "]}";
+  }
+  is << "],\"checksums\":["
+     << "{\"name\":\"cksum_verify\",\"id\":0,\"type\":\"generic\","
+     << "\"target\":[\"ipv4\",\"hdrChecksum\"],\"calculation\":\"calc_0\","
+     << "\"verify\":true,\"update\":false},"
+     << "{\"name\":\"cksum_update\",\"id\":1,\"type\":\"generic\","
+     << "\"target\":[\"ipv4\",\"hdrChecksum\"],\"calculation\":\"calc_1\","
+     << "\"verify\":false,\"update\":true}]}";
+  P4Objects objects;
+  LookupStructureFactory factory;
+  ASSERT_EQ(0, objects.init_objects(&is, &factory));
+
+  auto phv_source = PHVSourceIface::make_phv_source();
+  phv_source->set_phv_factory(0, &objects.get_phv_factory());
+  const char ipv4_hdr[] = "\x45\x00\x00\x34\x70\x90\x40\x00\x40\x06\x35\x08"
+                          "\x0a\x36\xc1\x21\x4e\x28\x7b\xac";
+  auto run = [&](bool decrement_ttl) {
+    auto pkt = Packet::make_new(20, PacketBuffer(64, ipv4_hdr, 20),
+                                phv_source.get());
+    objects.get_parser("parser")->parse(&pkt);
+    EXPECT_FALSE(pkt.get_checksum_error());
+    auto &hdr = pkt.get_phv()->get_header(0);
+    EXPECT_NE(nullptr, hdr.get_verified_checksum());
+    if (decrement_ttl) hdr.get_field(7).set(0x3f);
+    objects.get_deparser("deparser")->deparse(&pkt);
+    // the checksum is only written if it changed
+    EXPECT_EQ(decrement_ttl, hdr.is_modified());
+    return std::string(pkt.data(), pkt.get_data_size());
+  };
+  EXPECT_EQ(std::string(ipv4_hdr, 20), run(false));
+  std::string expected(ipv4_hdr, 20);
+  expected[8] = '\x3f';
+  expected[10] = '\x36';
+  EXPECT_EQ(expected, run(true));
+}
@@ -21,9 +21,12 @@
 #include <gtest/gtest.h>
 
 #include <bm/bm_sim/packet.h>
+#include <bm/bm_sim/packet_pool.h>
 #include <bm/bm_sim/phv.h>
 #include <bm/bm_sim/phv_source.h>
 
+#include <algorithm>
+#include <thread>
 #include <vector>
 #include <memory>
 
@@ -209,3 +212,118 @@ TEST_F(PacketTest, CopyId) {
   auto packet_1_new = packet_0_new->clone_with_phv_ptr();
   ASSERT_EQ(1u, packet_1_new->get_copy_id());
 }
+
+TEST_F(PacketTest, Pool) {
+  auto packet_0 = std::unique_ptr<Packet>(new Packet(get_packet(0)));
+  auto packet_1 = packet_0->clone_with_phv_ptr();
+  const Packet *storage = packet_1.get();
+  packet_1.reset(nullptr);
+  const auto stats = PacketPool::get_packet_stats();
+  auto packet_2 = packet_0->clone_no_phv_ptr();
+  // the storage released by the calling thread is reused first
+  ASSERT_EQ(storage, packet_2.get());
+  ASSERT_EQ(stats.hits + 1, PacketPool::get_packet_stats().hits);
+  ASSERT_EQ(stats.misses, PacketPool::get_packet_stats().misses);
+}
+
+// the clones share the packet data until they modify it
+TEST_F(PacketTest, SharedData) {
+  const cxt_id_t cxt = 0;
+  const size_t length = 128;
+  std::vector<char> data;
+  for (size_t i = 0; i < length; i++) data.push_back(static_cast<char>(i));
+
+  auto packet = std::unique_ptr<Packet>(new Packet(Packet::make_new(
+      cxt, 0, 0, 0, 0, PacketBuffer(length + 64, data.data(), length),
+      phv_source.get())));
+  const auto state = packet->save_buffer_state();
+  packet->remove(16);  // parsed headers
+  auto clone_1 = packet->clone_with_phv_ptr();
+  auto clone_2 = packet->clone_no_phv_ptr();
+  // read-only access, which never copies the data
+  auto cdata = [](const Packet &pkt) { return pkt.data(); };
+  ASSERT_TRUE(packet->get_packet_buffer().is_shared());
+  ASSERT_EQ(cdata(*packet), cdata(*clone_1));
+  ASSERT_EQ(cdata(*packet), cdata(*clone_2));
+  ASSERT_EQ(length - 16, clone_1->get_data_size());
+
+  // new headers for clone_1
+  std::fill_n(clone_1->prepend(8), 8, 'x');
+  ASSERT_NE(cdata(*packet), cdata(*clone_1) + 8);
+  ASSERT_EQ(length - 8, clone_1->get_data_size());
+  ASSERT_TRUE(std::all_of(cdata(*clone_1), cdata(*clone_1) + 8,
+                          [](char c) { return c == 'x'; }));
+  ASSERT_TRUE(std::equal(data.begin() + 16, data.end(),
+                         cdata(*clone_1) + 8));
+  ASSERT_TRUE(std::equal(data.begin() + 16, data.end(), cdata(*packet)));
+  ASSERT_FALSE(clone_1->get_packet_buffer().is_shared());
+  ASSERT_TRUE(packet->get_packet_buffer().is_shared());
+
+  // the original packet is the last one to write, it does not need a copy
+  clone_2.reset();
+  ASSERT_FALSE(packet->get_packet_buffer().is_shared());
+  const char *storage = cdata(*packet);
+  ASSERT_EQ(storage, packet->data());
+
+  // the headers which were removed can still be restored
+  clone_2 = packet->clone_no_phv_ptr();
+  packet->data()[0] = 'y';
+  ASSERT_EQ('y', packet->data()[0]);
+  ASSERT_EQ(data[16], cdata(*clone_2)[0]);
+  packet->restore_buffer_state(state);
+  ASSERT_EQ(length, packet->get_data_size());
+  ASSERT_TRUE(std::equal(data.begin(), data.begin() + 16, cdata(*packet)));
+  ASSERT_EQ('y', cdata(*packet)[16]);
+
+  // remove() returns writable data, so it makes it private first, unlike
+  // remove_shared()
+  clone_1 = packet->clone_no_phv_ptr();
+  ASSERT_EQ(cdata(*packet) + 4, clone_1->remove_shared(4));
+  ASSERT_TRUE(clone_1->get_packet_buffer().is_shared());
+  char *removed = clone_1->remove(4);
+  ASSERT_FALSE(clone_1->get_packet_buffer().is_shared());
+  ASSERT_NE(cdata(*packet) + 8, removed);
+  ASSERT_EQ(data[8], removed[0]);
+}
+
+TEST(PacketPool, Buffers) {
+  const size_t size = 1000;
+  const char data[] = "abcd";
+  auto stats = PacketPool::get_buffer_stats();
+  {
+    PacketBuffer buffer(size, data, sizeof(data));
+  }
+  {
+    // same size class, the buffer is recycled
+    PacketBuffer buffer(size + 10, data, sizeof(data));
+    ASSERT_EQ(sizeof(data), buffer.get_data_size());
+    ASSERT_TRUE(std::equal(data, data + sizeof(data), buffer.start()));
+  }
+  auto new_stats = PacketPool::get_buffer_stats();
+  ASSERT_LE(stats.hits + 1, new_stats.hits);
+
+  // too large to be pooled
+  stats = new_stats;
+  {
+    PacketBuffer buffer(PacketPool::max_buffer_size + 1);
+  }
+  new_stats = PacketPool::get_buffer_stats();
+  ASSERT_EQ(stats.hits, new_stats.hits);
+  ASSERT_EQ(stats.misses + 1, new_stats.misses);
+}
+
+// buffers released by another thread (e.g. transmit thread) are made available
+// to the allocating thread (e.g. ingress thread)
+TEST(PacketPool, CrossThread) {
+  const size_t size = 4000;
+  const size_t nb_buffers = 100;
+  std::vector<PacketBuffer> buffers;
+  for (size_t i = 0; i < nb_buffers; i++) buffers.emplace_back(size);
+  std::thread releaser([&buffers] { buffers.clear(); });
+  releaser.join();
+  const auto stats = PacketPool::get_buffer_stats();
+  for (size_t i = 0; i < nb_buffers; i++) buffers.emplace_back(size);
+  const auto new_stats = PacketPool::get_buffer_stats();
+  ASSERT_EQ(stats.hits + nb_buffers, new_stats.hits);
+  ASSERT_EQ(stats.misses, new_stats.misses);
+}
@@ -336,6 +336,52 @@ TEST_F(ParserTest, DeparseEthernetIPv4_Stress) {
   }
 }
 
+TEST_F(ParserTest, DeparseInPlace) {
+  auto packet = get_tcp_pkt();
+  const auto &buffer = packet.get_packet_buffer();
+  const char *data = buffer.start();
+  parse_and_check_no_error(&packet);
+  // shares the packet data
+  auto clone = packet.clone_with_phv();
+  ASSERT_TRUE(buffer.is_shared());
+
+  // no header was modified: the headers are left in the buffer, and the data
+  // is not copied
+  deparser.deparse(&packet);
+  ASSERT_EQ(data, buffer.start());
+  ASSERT_TRUE(buffer.is_shared());
+  ASSERT_EQ(sizeof(raw_tcp_pkt), packet.get_data_size());
+  ASSERT_EQ(0, memcmp(raw_tcp_pkt, buffer.start(), sizeof(raw_tcp_pkt)));
+
+  // only the modified header is deparsed, in a private copy of the data
+  auto phv = clone.get_phv();
+  phv->get_field(ipv4Header, 7).set(0x3f);  // ttl
+  ASSERT_TRUE(phv->get_header(ipv4Header).is_modified());
+  ASSERT_FALSE(phv->get_header(tcpHeader).is_modified());
+  deparser.deparse(&clone);
+  ASSERT_FALSE(clone.get_packet_buffer().is_shared());
+  ASSERT_EQ(sizeof(raw_tcp_pkt), clone.get_data_size());
+  std::vector<char> expected(raw_tcp_pkt, raw_tcp_pkt + sizeof(raw_tcp_pkt));
+  expected.at(14 + 8) = 0x3f;
+  ASSERT_EQ(0, memcmp(expected.data(), clone.data(), expected.size()));
+  // the original packet is unchanged
+  ASSERT_EQ(0, memcmp(raw_tcp_pkt, buffer.start(), sizeof(raw_tcp_pkt)));
+}
+
+TEST_F(ParserTest, DeparseRemovedHeader) {
+  auto packet = get_tcp_pkt();
+  parse_and_check_no_error(&packet);
+  // the other headers are not where they need to be anymore
+  packet.get_phv()->get_header(ipv4Header).mark_invalid();
+  deparser.deparse(&packet);
+  const size_t ipv4_size = 20;
+  ASSERT_EQ(sizeof(raw_tcp_pkt) - ipv4_size, packet.get_data_size());
+  std::vector<char> expected(raw_tcp_pkt, raw_tcp_pkt + 14);
+  expected.insert(expected.end(), raw_tcp_pkt + 14 + ipv4_size,
+                  raw_tcp_pkt + sizeof(raw_tcp_pkt));
+  ASSERT_EQ(0, memcmp(expected.data(), packet.data(), expected.size()));
+}
+
 TEST(LookAhead, Peek) {
   ByteContainer res;
   // 1011 0101, 1001 1101, 1111 1101, 0001 0111, 1101 0101, 1101 0111
@@ -23,7 +23,10 @@
 #include <bm/bm_sim/simple_pre.h>
 #include <bm/bm_sim/simple_pre_lag.h>
 
+#include <atomic>
 #include <bitset>
+#include <thread>
+#include <utility>
 #include <vector>
 
 using namespace bm;
@@ -163,6 +166,107 @@ TEST(McSimplePre, DestroyWithoutDissociate) {
   EXPECT_TRUE(egress_info_2.empty());
 }
 
+TEST(McSimplePre, ReplicationList) {
+  McSimplePre pre;
+  McSimplePre::mgrp_t mgid = 0x400;
+  McSimplePre::mgrp_hdl_t mgrp_hdl;
+  McSimplePre::l1_hdl_t l1_hdl_1, l1_hdl_2;
+  McSimplePre::PortMap port_map_1, port_map_2;
+  port_map_1[1] = 1;
+  port_map_1[4] = 1;
+  port_map_2[7] = 1;
+
+  // unknown mgid
+  EXPECT_TRUE(pre.get_replication_list({mgid}).empty());
+
+  EXPECT_EQ(McSimplePre::SUCCESS, pre.mc_mgrp_create(mgid, &mgrp_hdl));
+  EXPECT_TRUE(pre.get_replication_list({mgid}).empty());
+  EXPECT_EQ(McSimplePre::SUCCESS,
+            pre.mc_node_create(0x200, port_map_1, &l1_hdl_1));
+  EXPECT_EQ(McSimplePre::SUCCESS,
+            pre.mc_node_create(0x201, port_map_2, &l1_hdl_2));
+  EXPECT_EQ(McSimplePre::SUCCESS, pre.mc_node_associate(mgrp_hdl, l1_hdl_1));
+  EXPECT_EQ(McSimplePre::SUCCESS, pre.mc_node_associate(mgrp_hdl, l1_hdl_2));
+
+  auto check = [&pre, mgid](
+      const std::vector<std::pair<McSimplePre::rid_t,
+                                  McSimplePre::egress_port_t> > &expected) {
+    const auto list = pre.get_replication_list({mgid});
+    ASSERT_EQ(expected.size(), list.size());
+    size_t i = 0;
+    for (const auto &out : list) {
+      EXPECT_EQ(expected.at(i).first, out.rid);
+      EXPECT_EQ(expected.at(i).second, out.egress_port);
+      i++;
+    }
+    const auto egress_info = pre.replicate({mgid});
+    ASSERT_EQ(expected.size(), egress_info.size());
+  };
+
+  check({{0x200, 1}, {0x200, 4}, {0x201, 7}});
+
+  port_map_2[2] = 1;
+  EXPECT_EQ(McSimplePre::SUCCESS, pre.mc_node_update(l1_hdl_2, port_map_2));
+  check({{0x200, 1}, {0x200, 4}, {0x201, 2}, {0x201, 7}});
+
+  EXPECT_EQ(McSimplePre::SUCCESS, pre.mc_node_dissociate(mgrp_hdl, l1_hdl_1));
+  check({{0x201, 2}, {0x201, 7}});
+
+  // a node which is not associated does not affect the list
+  EXPECT_EQ(McSimplePre::SUCCESS, pre.mc_node_update(l1_hdl_1, port_map_2));
+  check({{0x201, 2}, {0x201, 7}});
+
+  EXPECT_EQ(McSimplePre::SUCCESS, pre.mc_node_destroy(l1_hdl_2));
+  check({});
+
+  EXPECT_EQ(McSimplePre::SUCCESS, pre.mc_node_associate(mgrp_hdl, l1_hdl_1));
+  check({{0x200, 2}, {0x200, 7}});
+
+  EXPECT_EQ(McSimplePre::SUCCESS, pre.mc_mgrp_destroy(mgrp_hdl));
+  EXPECT_TRUE(pre.get_replication_list({mgid}).empty());
+}
+
+// the lists can be read while the control plane modifies the group
+TEST(McSimplePre, ReplicationListConcurrent) {
+  McSimplePre pre;
+  McSimplePre::mgrp_t mgid = 0x400;
+  McSimplePre::mgrp_hdl_t mgrp_hdl;
+  McSimplePre::l1_hdl_t l1_hdl_1, l1_hdl_2;
+  McSimplePre::PortMap port_map_1, port_map_2;
+  for (size_t i = 0; i < 8; i++) port_map_1[i] = 1;
+  for (size_t i = 8; i < 12; i++) port_map_2[i] = 1;
+
+  ASSERT_EQ(McSimplePre::SUCCESS, pre.mc_mgrp_create(mgid, &mgrp_hdl));
+  ASSERT_EQ(McSimplePre::SUCCESS,
+            pre.mc_node_create(0x200, port_map_1, &l1_hdl_1));
+  ASSERT_EQ(McSimplePre::SUCCESS,
+            pre.mc_node_create(0x201, port_map_2, &l1_hdl_2));
+  ASSERT_EQ(McSimplePre::SUCCESS, pre.mc_node_associate(mgrp_hdl, l1_hdl_1));
+
+  std::atomic<bool> stop{false};
+  std::atomic<size_t> bad_lists{0};
+  std::thread reader([&pre, &stop, &bad_lists, mgid]() {
+    while (!stop) {
+      const auto list = pre.get_replication_list({mgid});
+      size_t port_sum = 0;
+      for (const auto &out : list) port_sum += out.egress_port;
+      // every version of the list is either node 1 or nodes 1 + 2
+      const bool good = (list.size() == 8 && port_sum == 28) ||
+          (list.size() == 12 && port_sum == 28 + 38);
+      if (!good) bad_lists++;
+    }
+  });
+
+  for (int i = 0; i < 1000; i++) {
+    EXPECT_EQ(McSimplePre::SUCCESS, pre.mc_node_associate(mgrp_hdl, l1_hdl_2));
+    EXPECT_EQ(McSimplePre::SUCCESS,
+              pre.mc_node_dissociate(mgrp_hdl, l1_hdl_2));
+  }
+  stop = true;
+  reader.join();
+  EXPECT_EQ(0u, bad_lists);
+}
+
 
 TEST(McSimplePreLAG, Replicate) {
   McSimplePreLAG pre;
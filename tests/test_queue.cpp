@@ -21,22 +21,29 @@
 #include <gtest/gtest.h>
 
 #include <bm/bm_sim/queue.h>
+#include <bm/bm_sim/ring_buffer.h>
 
+#include <algorithm>
+#include <atomic>
 #include <thread>
 #include <random>
 #include <tuple>
+#include <vector>
 
 using std::unique_ptr;
 
 using std::thread;
 
 using bm::Queue;
+using bm::QueueImpl;
+using bm::RingBuffer;
 
 using ::testing::TestWithParam;
 using ::testing::Values;
 using ::testing::Combine;
 
-class QueueTest : public TestWithParam< std::tuple<size_t, int> > {
+class QueueTest
+    : public TestWithParam< std::tuple<size_t, int, QueueImpl> > {
  protected:
   int iterations;
   size_t queue_size;
@@ -48,7 +55,9 @@ class QueueTest : public TestWithParam< std::tuple<size_t, int> > {
     queue_size = std::get<0>(GetParam());
     iterations = std::get<1>(GetParam());
 
-    queue = unique_ptr<Queue<int> >(new Queue<int>(queue_size));
+    queue = unique_ptr<Queue<int> >(new Queue<int>(
+        queue_size, Queue<int>::WriteBlock, Queue<int>::ReadBlock,
+        std::get<2>(GetParam())));
     values = unique_ptr<int[]>(new int[iterations]);
 
     std::mt19937 generator;
@@ -85,8 +94,114 @@ TEST_P(QueueTest, ProducerConsumer) {
   producer_thread.join();
 }
 
+TEST_P(QueueTest, ProducerConsumerBatch) {
+  thread producer_thread(producer, this);
+
+  std::vector<int> batch(32);
+  for (int i = 0; i < iterations;) {
+    size_t n = queue->pop_back_n(batch.data(), batch.size());
+    ASSERT_LT(0u, n);
+    ASSERT_GE(batch.size(), n);
+    for (size_t j = 0; j < n; j++) ASSERT_EQ(values[i++], batch[j]);
+  }
+
+  producer_thread.join();
+}
+
 
 INSTANTIATE_TEST_CASE_P(TestParameters,
                         QueueTest,
                         Combine(Values(16, 1024, 20000),
-                                Values(1000, 200000)));
+                                Values(1000, 200000),
+                                Values(QueueImpl::LOCKED, QueueImpl::RING)));
+
+
+TEST(RingBuffer, Capacity) {
+  RingBuffer<int> ring(100);
+  ASSERT_EQ(128u, ring.nb_slots());
+  ASSERT_EQ(128u, ring.capacity());
+  ring.set_capacity(10);
+  for (int i = 0; i < 10; i++) ASSERT_TRUE(ring.try_push(int(i)));
+  ASSERT_FALSE(ring.try_push(10));
+  ASSERT_EQ(10u, ring.size());
+  ASSERT_TRUE(ring.full());
+  int v;
+  ASSERT_TRUE(ring.try_pop(&v));
+  ASSERT_EQ(0, v);
+  ASSERT_TRUE(ring.try_push(10));
+  // cannot go over the number of slots
+  ring.set_capacity(1000);
+  ASSERT_EQ(128u, ring.capacity());
+}
+
+TEST(RingBuffer, Batch) {
+  RingBuffer<int> ring(8);
+  std::vector<int> in = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9};
+  // only 8 slots
+  ASSERT_EQ(8u, ring.try_push_n(in.data(), in.size()));
+  ASSERT_EQ(0u, ring.try_push_n(in.data() + 8, 2));
+  std::vector<int> out(10);
+  ASSERT_EQ(5u, ring.try_pop_n(out.data(), 5));
+  ASSERT_EQ(2u, ring.try_push_n(in.data() + 8, 2));
+  ASSERT_EQ(5u, ring.try_pop_n(out.data() + 5, 10));
+  ASSERT_EQ(0u, ring.try_pop_n(out.data(), 10));
+  ASSERT_TRUE(ring.empty());
+  ASSERT_EQ(in, out);
+}
+
+// several producers and consumers, each item has to be popped exactly once and
+// the order of the items of a given producer has to be preserved
+TEST(RingBuffer, MultiProducerMultiConsumer) {
+  constexpr int nb_producers = 4;
+  constexpr int nb_consumers = 4;
+  constexpr int iterations = 50000;
+  RingBuffer<int> ring(64);
+
+  std::vector<thread> producers;
+  for (int p = 0; p < nb_producers; p++) {
+    producers.emplace_back([&ring, p]() {
+        std::vector<int> batch;
+        for (int i = 0; i < iterations; i++) {
+          batch.push_back(p * iterations + i);
+          // alternate between single and batched pushes
+          if (batch.size() == static_cast<size_t>(1 + i % 8)) {
+            ring.push_n(batch.data(), batch.size());
+            batch.clear();
+          }
+        }
+        ring.push_n(batch.data(), batch.size());
+      });
+  }
+
+  std::vector<std::vector<int> > received(nb_consumers);
+  std::atomic<int> nb_received{0};
+  std::vector<thread> consumers;
+  for (int c = 0; c < nb_consumers; c++) {
+    consumers.emplace_back([&ring, &received, &nb_received, c]() {
+        int batch[16];
+        while (nb_received < nb_producers * iterations) {
+          size_t n = ring.try_pop_n(batch, 1 + c * 5);
+          if (n == 0) std::this_thread::yield();
+          received[c].insert(received[c].end(), batch, batch + n);
+          nb_received += n;
+        }
+      });
+  }
+
+  for (auto &t : producers) t.join();
+  for (auto &t : consumers) t.join();
+
+  std::vector<int> all;
+  for (const auto &r : received) {
+    std::vector<int> last(nb_producers, -1);
+    for (int v : r) {
+      int p = v / iterations;
+      ASSERT_LT(last[p], v);
+      last[p] = v;
+    }
+    all.insert(all.end(), r.begin(), r.end());
+  }
+  std::sort(all.begin(), all.end());
+  ASSERT_EQ(static_cast<size_t>(nb_producers * iterations), all.size());
+  for (int i = 0; i < nb_producers * iterations; i++) ASSERT_EQ(i, all[i]);
+}
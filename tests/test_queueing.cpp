@@ -35,6 +35,7 @@ using std::thread;
 using bm::QueueingLogic;
 using bm::QueueingLogicRL;
 using bm::QueueingLogicPriRL;
+using bm::QueueImpl;
 
 struct WorkerMapper {
   WorkerMapper(size_t nb_workers)
@@ -81,6 +82,13 @@ class QueueingTest : public ::testing::Test {
 
 using QEm = std::unique_ptr<int>;
 
+// same queueing logic, backed by lock-free rings
+template <typename Q>
+struct RingQ : public Q {
+  RingQ(size_t nb_workers, size_t capacity, WorkerMapper map_to_worker)
+      : Q(nb_workers, capacity, map_to_worker, QueueImpl::RING) { }
+};
+
 template <typename QType>
 void QueueingTest<QType>::produce() {
   for (size_t i = 0; i < iterations; i++) {
@@ -118,11 +126,18 @@ void QueueingTest<QueueingLogicPriRL<QEm, WorkerMapper> >::produce() {
   produce_if_dropping(queue, iterations, values);
 }
 
+template <>
+void QueueingTest<RingQ<QueueingLogicRL<QEm, WorkerMapper> > >::produce() {
+  produce_if_dropping(queue, iterations, values);
+}
+
 using testing::Types;
 
 using QueueingTypes = Types<QueueingLogic<QEm, WorkerMapper>,
                             QueueingLogicRL<QEm, WorkerMapper>,
-                            QueueingLogicPriRL<QEm, WorkerMapper> >;
+                            QueueingLogicPriRL<QEm, WorkerMapper>,
+                            RingQ<QueueingLogic<QEm, WorkerMapper> >,
+                            RingQ<QueueingLogicRL<QEm, WorkerMapper> > >;
 
 TYPED_TEST_CASE(QueueingTest, QueueingTypes);
 
@@ -145,7 +160,7 @@ TYPED_TEST(QueueingTest, ProducerConsummer) {
 }
 
 
-class QueueingRLTest : public ::testing::Test {
+class QueueingRLTest : public ::testing::TestWithParam<QueueImpl> {
  protected:
   using T = std::unique_ptr<int>;
   static constexpr size_t nb_queues = 1u;
@@ -160,7 +175,7 @@ class QueueingRLTest : public ::testing::Test {
                 "for RL test, capacity needs to be greater or equal to # pkts");
 
   QueueingRLTest()
-      : queue(nb_workers, capacity, WorkerMapper(nb_workers)),
+      : queue(nb_workers, capacity, WorkerMapper(nb_workers), GetParam()),
         values(iterations) { }
 
   virtual void SetUp() {
@@ -182,7 +197,7 @@ class QueueingRLTest : public ::testing::Test {
   // virtual void TearDown() {}
 };
 
-TEST_F(QueueingRLTest, RateLimiter) {
+TEST_P(QueueingRLTest, RateLimiter) {
   thread producer_thread(&QueueingRLTest::produce, this);
 
   using std::chrono::duration_cast;
@@ -216,6 +231,35 @@ TEST_F(QueueingRLTest, RateLimiter) {
   // TODO(antonin): better check of times vector?
 }
 
+INSTANTIATE_TEST_CASE_P(QueueImpls, QueueingRLTest,
+                        ::testing::Values(QueueImpl::LOCKED, QueueImpl::RING));
+
+// the queue can hold more elements than the ring of its worker: once the ring
+// is full, push_front() drops elements instead of waiting for the worker
+TEST(QueueingRLRing, PushFrontDoesNotBlock) {
+  using T = std::unique_ptr<int>;
+  const size_t capacity = 4096u;
+  QueueingLogicRL<T, WorkerMapper> queue(
+      1u, capacity, WorkerMapper(1u), QueueImpl::RING);
+
+  size_t accepted = 0;
+  for (size_t i = 0; i < capacity; i++)
+    accepted += queue.push_front(0u, T(new int(i)));
+  ASSERT_GT(accepted, 0u);
+  ASSERT_LT(accepted, capacity);
+  // dropped elements are not counted in the queue
+  ASSERT_EQ(accepted, queue.size(0u));
+
+  for (size_t i = 0; i < accepted; i++) {
+    size_t queue_id;
+    T v;
+    queue.pop_back(0u, &queue_id, &v);
+    ASSERT_EQ(static_cast<int>(i), *v);
+  }
+  ASSERT_EQ(0u, queue.size(0u));
+  ASSERT_EQ(1, queue.push_front(0u, T(new int(0))));
+}
+
 struct RndInputPri {
   size_t queue_id;
   int v;
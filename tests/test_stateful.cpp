@@ -22,6 +22,13 @@
 
 #include <bm/bm_sim/stateful.h>
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <mutex>
+#include <thread>
+
 using bm::RegisterArray;
 
 // Google Test fixture for Stateful tests
@@ -70,3 +77,141 @@ TEST_F(StatefulTest, Notifier) {
     ASSERT_EQ(index_test_v, index);
   }
 }
+
+namespace {
+
+// try to lock the mutex from a different thread
+bool can_lock(std::mutex *m) {
+  bool rv = false;
+  std::thread t([m, &rv] {
+      if (m->try_lock()) {
+        rv = true;
+        m->unlock();
+      }
+    });
+  t.join();
+  return rv;
+}
+
+}  // namespace
+
+TEST_F(StatefulTest, CellLock) {
+  auto lock = reg_array.cell_lock(3);
+  EXPECT_FALSE(can_lock(&reg_array.stripe_mutex(3)));
+  // same stripe
+  const size_t same_stripe_idx = 3 + RegisterArray::nb_stripes;
+  EXPECT_FALSE(can_lock(&reg_array.stripe_mutex(same_stripe_idx)));
+  EXPECT_TRUE(can_lock(&reg_array.stripe_mutex(4)));
+  lock.unlock();
+  EXPECT_TRUE(can_lock(&reg_array.stripe_mutex(3)));
+}
+
+TEST_F(StatefulTest, UniqueLock) {
+  auto lock = reg_array.unique_lock();
+  for (size_t i = 0; i < RegisterArray::nb_stripes; i++)
+    EXPECT_FALSE(can_lock(&reg_array.stripe_mutex(i)));
+  reg_array.unlock(lock);
+  for (size_t i = 0; i < RegisterArray::nb_stripes; i++)
+    EXPECT_TRUE(can_lock(&reg_array.stripe_mutex(i)));
+}
+
+TEST_F(StatefulTest, Resize) {
+  for (size_t i = 0; i < size; i++) reg_array[i].set(i);
+  // shrink, the remaining values are preserved
+  reg_array.resize(size / 2);
+  ASSERT_EQ(size / 2, reg_array.size());
+  for (size_t i = 0; i < size / 2; i++)
+    ASSERT_EQ(i, reg_array[i].get<size_t>());
+  // grow again, the new registers are initialized to 0
+  reg_array.resize(3 * RegisterArray::chunk_size + 1);
+  ASSERT_EQ(3 * RegisterArray::chunk_size + 1, reg_array.size());
+  for (size_t i = 0; i < reg_array.size(); i++)
+    ASSERT_EQ((i < size / 2) ? i : 0u, reg_array[i].get<size_t>());
+  size_t idx = 0;
+  for (const auto &r : reg_array)
+    ASSERT_EQ(reg_array[idx++].get<size_t>(), r.get<size_t>());
+  ASSERT_EQ(reg_array.size(), idx);
+  ASSERT_THROW(reg_array.at(reg_array.size()), std::out_of_range);
+}
+
+TEST_F(StatefulTest, ResizeNotifier) {
+  size_t index(0);
+  reg_array.register_notifier([&index](size_t idx) { index = idx; });
+  const size_t new_size = 2 * RegisterArray::chunk_size;
+  reg_array.resize(new_size);
+  reg_array[new_size - 1].set(1);
+  ASSERT_EQ(new_size - 1, index);
+}
+
+TEST_F(StatefulTest, SetBitwidth) {
+  for (auto &r : reg_array) r.set(0xabcd);
+  reg_array.set_bitwidth(8);
+  ASSERT_EQ(8, reg_array.get_bitwidth());
+  for (const auto &r : reg_array) ASSERT_EQ(0xcdu, r.get<unsigned int>());
+  reg_array[0].set(0x1ff);
+  ASSERT_EQ(0xffu, reg_array[0].get<unsigned int>());
+  reg_array.set_bitwidth(16);
+  reg_array[0].set(0x1ff);
+  ASSERT_EQ(0x1ffu, reg_array[0].get<unsigned int>());
+}
+
+// Measures how long a "packet" thread, which keeps reading and writing cells of
+// a 1M-entry register array, can be stalled while the array is resized and its
+// bitwidth is changed. Only the last chunk is copied while holding the lock,
+// so the stall has to be much shorter than the time needed to copy the whole
+// array.
+TEST(StatefulStallTest, Resize1M) {
+  using clock = std::chrono::steady_clock;
+  constexpr size_t size = 1 << 20;
+  RegisterArray reg_array("test", 0, size, 32);
+  std::atomic<bool> stop(false);
+  std::atomic<size_t> nb_accesses(0);
+  clock::duration max_stall(0);
+
+  std::thread packet_thread([&] {
+      size_t idx = 0;
+      while (!stop.load()) {
+        auto start = clock::now();
+        {
+          auto lock = reg_array.cell_lock(idx);
+          auto &r = reg_array[idx];
+          r.set(r.get<uint32_t>() + 1);
+        }
+        max_stall = std::max(max_stall, clock::now() - start);
+        nb_accesses++;
+        idx = (idx + 4093) % size;
+      }
+    });
+
+  auto wait_for_accesses = [&nb_accesses] {
+    auto target = nb_accesses.load() + 1000;
+    while (nb_accesses.load() < target) std::this_thread::yield();
+  };
+
+  wait_for_accesses();
+  auto start = clock::now();
+  reg_array.resize(2 * size);
+  auto resize_time = clock::now() - start;
+  wait_for_accesses();
+  reg_array.resize(size + 1);
+  wait_for_accesses();
+  reg_array.set_bitwidth(16);
+  wait_for_accesses();
+  stop = true;
+  packet_thread.join();
+
+  using std::chrono::duration_cast;
+  using std::chrono::microseconds;
+  std::cout << "Resizing 1M registers took "
+            << duration_cast<microseconds>(resize_time).count()
+            << " us, max stall for packet thread: "
+            << duration_cast<microseconds>(max_stall).count() << " us\n";
+  // very conservative, mostly accounts for the scheduler when the test is run
+  // on a single core
+  EXPECT_LT(max_stall, std::chrono::milliseconds(50));
+
+  // no increment was lost
+  size_t total = 0;
+  for (size_t i = 0; i < size; i++) total += reg_array[i].get<size_t>();
+  ASSERT_EQ(nb_accesses.load(), total);
+}
@@ -21,7 +21,9 @@
 #include <gtest/gtest.h>
 
 #include <bm/bm_sim/tables.h>
+#include <bm/bm_sim/resilient_group_selection.h>
 
+#include <array>
 #include <atomic>
 #include <memory>
 #include <random>
@@ -31,6 +33,7 @@
 #include <string>
 #include <vector>
 #include <set>
+#include <unordered_map>
 
 using namespace bm;
 
@@ -2008,6 +2011,89 @@ TEST_F(TableIndirectWS, CustomGroupSelection) {
   ASSERT_TRUE(mbrs.empty());
 }
 
+TEST_F(TableIndirectWS, ResilientGroupSelection) {
+  constexpr size_t nb_buckets = 1024;
+  constexpr size_t nb_flows = 2000;
+  auto selector = std::make_shared<ResilientGroupSelection>(nb_buckets);
+  action_profile.set_group_selector(selector);
+
+  MatchErrorCode rc;
+  grp_hdl_t grp;
+  rc = action_profile.create_group(&grp);
+  ASSERT_EQ(MatchErrorCode::SUCCESS, rc);
+  // member i has action data i
+  std::vector<mbr_hdl_t> mbrs(5);
+  for (unsigned int i = 0; i < mbrs.size(); i++) {
+    rc = add_member(i, &mbrs[i]);
+    ASSERT_EQ(MatchErrorCode::SUCCESS, rc);
+  }
+  for (unsigned int i = 0; i < 4; i++) {
+    rc = action_profile.add_member_to_group(mbrs[i], grp);
+    ASSERT_EQ(MatchErrorCode::SUCCESS, rc);
+  }
+  for (unsigned int i = 0; i < 4; i++)
+    ASSERT_EQ(nb_buckets / 4, selector->get_nb_buckets(grp, mbrs[i]));
+
+  entry_handle_t handle, lookup_handle;
+  bool hit;
+  rc = add_entry_ws("\x0a\xba", grp, &handle);
+  ASSERT_EQ(MatchErrorCode::SUCCESS, rc);
+
+  auto pkt = get_pkt(64);
+  pkt.get_phv()->get_field(testHeader1, 0).set("0xaba");
+  std::vector<std::array<unsigned int, 3> > flows;
+  for (size_t i = 0; i < nb_flows; i++)
+    flows.push_back({{dis(gen), dis(gen), dis(gen)}});
+  auto select_members = [&]() {
+    std::vector<unsigned int> selected;
+    for (const auto &flow : flows) {
+      pkt.get_phv()->get_field(testHeader1, 1).set(flow[0]);
+      pkt.get_phv()->get_field(testHeader2, 0).set(flow[1]);
+      pkt.get_phv()->get_field(testHeader2, 1).set(flow[2]);
+      const auto &entry = lookup(pkt, &hit, &lookup_handle);
+      EXPECT_TRUE(hit);
+      selected.push_back(entry.action_fn.get_action_data_at(0).get<uint>());
+    }
+    return selected;
+  };
+
+  // removing member 1 only remaps its flows, evenly over the other members
+  const auto selected_1 = select_members();
+  rc = action_profile.remove_member_from_group(mbrs[1], grp);
+  ASSERT_EQ(MatchErrorCode::SUCCESS, rc);
+  const auto selected_2 = select_members();
+  std::vector<size_t> counts(mbrs.size(), 0);
+  for (size_t i = 0; i < nb_flows; i++) {
+    if (selected_1[i] != 1u) ASSERT_EQ(selected_1[i], selected_2[i]);
+    counts[selected_2[i]]++;
+  }
+  EXPECT_EQ(0u, counts[1]);
+  for (const auto i : {0u, 2u, 3u}) {
+    EXPECT_GE(selector->get_nb_buckets(grp, mbrs[i]), nb_buckets / 3);
+    EXPECT_LE(selector->get_nb_buckets(grp, mbrs[i]), nb_buckets / 3 + 1);
+    EXPECT_NEAR(nb_flows / 3, counts[i], nb_flows / 10);
+  }
+
+  // adding member 4 only remaps the flows it takes over
+  rc = action_profile.add_member_to_group(mbrs[4], grp);
+  ASSERT_EQ(MatchErrorCode::SUCCESS, rc);
+  EXPECT_EQ(nb_buckets / 4, selector->get_nb_buckets(grp, mbrs[4]));
+  const auto selected_3 = select_members();
+  size_t nb_remapped = 0;
+  for (size_t i = 0; i < nb_flows; i++) {
+    if (selected_3[i] == selected_2[i]) continue;
+    ASSERT_EQ(4u, selected_3[i]);
+    nb_remapped++;
+  }
+  EXPECT_NEAR(nb_flows / 4, nb_remapped, nb_flows / 10);
+
+  rc = table->delete_entry(handle);
+  ASSERT_EQ(MatchErrorCode::SUCCESS, rc);
+  rc = action_profile.delete_group(grp);
+  ASSERT_EQ(MatchErrorCode::SUCCESS, rc);
+  EXPECT_EQ(0u, selector->get_nb_buckets(grp, mbrs[0]));
+}
+
 
 template <typename MUType>
 class TableBigMask : public ::testing::Test {
@@ -3472,6 +3558,534 @@ TEST_F(TableTernaryCache, CacheUpdate) {
     ASSERT_EQ(h, lookup_handle);
 }
 
+TEST_F(TableTernaryCache, CacheStats) {
+  LookupStructureFactory factory(true  /* with cache */);
+  auto table = create_table(&factory);
+
+  constexpr size_t nbytes = 128 / 8;
+  const std::string binary_key(nbytes, '\xff');
+  entry_handle_t h;
+  add_base_entries(table.get(), binary_key, &h);
+
+  constexpr size_t num_packets = 10;
+  for (size_t i = 0; i < num_packets; i++) {
+    entry_handle_t lookup_handle;
+    lookup(table.get(), binary_key, &lookup_handle);
+    ASSERT_EQ(h, lookup_handle);
+  }
+
+  LookupCacheStats stats;
+  ASSERT_EQ(MatchErrorCode::SUCCESS, table->get_cache_stats(&stats));
+  EXPECT_LT(0u, stats.size);
+  EXPECT_EQ(num_packets - 1, stats.hits);
+  EXPECT_EQ(1u, stats.misses);
+  EXPECT_EQ(0u, stats.evictions);
+
+  // resizing the cache clears it and resets the stats
+  ASSERT_EQ(MatchErrorCode::SUCCESS, table->set_cache_size(16));
+  ASSERT_EQ(MatchErrorCode::SUCCESS, table->get_cache_stats(&stats));
+  EXPECT_EQ(16u, stats.size);
+  EXPECT_EQ(0u, stats.hits);
+  entry_handle_t lookup_handle;
+  lookup(table.get(), binary_key, &lookup_handle);
+  ASSERT_EQ(h, lookup_handle);
+  ASSERT_EQ(MatchErrorCode::SUCCESS, table->get_cache_stats(&stats));
+  EXPECT_EQ(0u, stats.hits);
+  EXPECT_EQ(1u, stats.misses);
+
+  // size 0 disables the cache
+  ASSERT_EQ(MatchErrorCode::SUCCESS, table->set_cache_size(0));
+  lookup(table.get(), binary_key, &lookup_handle);
+  ASSERT_EQ(h, lookup_handle);
+  ASSERT_EQ(MatchErrorCode::SUCCESS, table->get_cache_stats(&stats));
+  EXPECT_EQ(0u, stats.size);
+  EXPECT_EQ(0u, stats.hits + stats.misses);
+
+  LookupStructureFactory factory_no_cache(false  /* without cache */);
+  auto table_no_cache = create_table(&factory_no_cache);
+  EXPECT_EQ(MatchErrorCode::CACHE_DISABLED,
+            table_no_cache->get_cache_stats(&stats));
+  EXPECT_EQ(MatchErrorCode::CACHE_DISABLED,
+            table_no_cache->set_cache_size(16));
+}
+
+// lookups are done concurrently, with a cache too small to hold all the keys
+// (so there are evictions); every lookup must return the right entry
+TEST_F(TableTernaryCache, ConcurrentLookups) {
+  LookupStructureFactory factory(true  /* with cache */);
+  auto table = create_table(&factory);
+  ASSERT_EQ(MatchErrorCode::SUCCESS, table->set_cache_size(16));
+
+  // same entries as add_base_entries, but we keep all the handles: key
+  // <prefix_len 1s><0s> is matched by entry prefix_len - 1
+  constexpr size_t nbytes = 128 / 8;
+  const std::string binary_key(nbytes, '\xff');
+  std::vector<entry_handle_t> handles;
+  std::vector<std::string> keys;
+  MaskBitBuilder mask_builder(nbytes);
+  for (size_t i = 0; i < nbytes * 8; i++) {
+    entry_handle_t h;
+    mask_builder.append_one(true);
+    ASSERT_EQ(MatchErrorCode::SUCCESS,
+              add_entry(table.get(), binary_key, mask_builder.bytes(),
+                        nbytes * 8 - i, &h));
+    handles.push_back(h);
+    keys.push_back(mask_builder.bytes());
+  }
+
+  constexpr int num_threads = 4;
+  constexpr size_t num_lookups = 10000;
+  std::atomic<size_t> errors{0};
+  auto run = [&](int thread_id) {
+    for (size_t i = 0; i < num_lookups; i++) {
+      const size_t k = (i * (thread_id + 1)) % keys.size();
+      auto pkt = get_pkt(keys[k]);
+      bool hit;
+      entry_handle_t lookup_handle;
+      const ControlFlowNode *next_node;
+      table->lookup(pkt, &hit, &lookup_handle, &next_node);
+      if (!hit || lookup_handle != handles[k]) errors++;
+    }
+  };
+  std::vector<std::thread> threads;
+  for (int t = 0; t < num_threads; t++) threads.emplace_back(run, t);
+  for (auto &t : threads) t.join();
+  ASSERT_EQ(0u, errors.load());
+
+  LookupCacheStats stats;
+  ASSERT_EQ(MatchErrorCode::SUCCESS, table->get_cache_stats(&stats));
+  EXPECT_EQ(num_threads * num_lookups, stats.hits + stats.misses);
+  EXPECT_LT(0u, stats.evictions);
+}
+
+
+// checks that tuple space search returns the same results as the default
+// linear scan, using the same random entries for both
+class TableTupleSpace : public ::testing::Test {
+ protected:
+  static constexpr size_t t_size = 1024u;
+  static constexpr size_t nb_entries = 512u;
+  static constexpr size_t nb_lookups = 4096u;
+
+  PHVFactory phv_factory;
+
+  HeaderType testHeaderType;
+  header_id_t testHeader{0};
+  ActionFn action_fn;
+
+  std::unique_ptr<PHVSourceIface> phv_source{nullptr};
+
+  // fixed seed, we want the test to be deterministic
+  std::mt19937 gen{0};
+
+  TableTupleSpace()
+      : testHeaderType("test_t", 0), action_fn("actionA", 0, 0),
+        phv_source(PHVSourceIface::make_phv_source()) {
+    testHeaderType.push_back_field("f16", 16);
+    testHeaderType.push_back_field("f32", 32);
+    phv_factory.push_back_header("testHdr", testHeader, testHeaderType);
+  }
+
+  std::unique_ptr<MatchTable> create_table(MatchKeyParam::Type f16_type,
+                                           LookupStructureFactory *factory) {
+    MatchKeyBuilder key_builder;
+    key_builder.push_back_field(testHeader, 0, 16, f16_type);
+    key_builder.push_back_field(testHeader, 1, 32,
+                                MatchKeyParam::Type::TERNARY);
+    std::unique_ptr<MatchTable> table;
+    if (f16_type == MatchKeyParam::Type::RANGE) {
+      std::unique_ptr<MURange> match_unit(
+          new MURange(t_size, key_builder, factory));
+      table.reset(new MatchTable("test_table", 0, std::move(match_unit),
+                                 false));
+    } else {
+      std::unique_ptr<MUTernary> match_unit(
+          new MUTernary(t_size, key_builder, factory));
+      table.reset(new MatchTable("test_table", 0, std::move(match_unit),
+                                 false));
+    }
+    table->set_next_node(0, nullptr);
+    return table;
+  }
+
+  // small value space so that most lookups are hits
+  unsigned int get_value(size_t nbytes) {
+    std::uniform_int_distribution<unsigned int> dis(0, 3);
+    unsigned int v = 0;
+    for (size_t i = 0; i < nbytes; i++) v = (v << 8) | dis(gen);
+    return v;
+  }
+
+  template <typename T>
+  const T &pick(const std::vector<T> &v) {
+    std::uniform_int_distribution<size_t> dis(0, v.size() - 1);
+    return v[dis(gen)];
+  }
+
+  static std::string to_bytes(unsigned int v, size_t nbytes) {
+    std::string s(nbytes, '\x00');
+    for (size_t i = 0; i < nbytes; i++)
+      s[nbytes - 1 - i] = static_cast<char>((v >> (8 * i)) & 0xff);
+    return s;
+  }
+
+  std::vector<MatchKeyParam> gen_match_key(MatchKeyParam::Type f16_type) {
+    // only a few distinct masks, like in a typical ACL
+    const std::vector<unsigned int> masks_16 = {0xffff, 0xff00, 0x0000};
+    const std::vector<unsigned int> masks_32 = {
+      0xffffffff, 0xffffff00, 0xffff0000, 0x00000000};
+    std::vector<MatchKeyParam> match_key;
+    if (f16_type == MatchKeyParam::Type::RANGE) {
+      std::uniform_int_distribution<unsigned int> dis(0, 64);
+      const auto start = get_value(2);
+      match_key.emplace_back(MatchKeyParam::Type::RANGE, to_bytes(start, 2),
+                             to_bytes(start + dis(gen), 2));
+    } else {
+      const auto mask = pick(masks_16);
+      match_key.emplace_back(MatchKeyParam::Type::TERNARY,
+                             to_bytes(get_value(2) & mask, 2),
+                             to_bytes(mask, 2));
+    }
+    const auto mask = pick(masks_32);
+    match_key.emplace_back(MatchKeyParam::Type::TERNARY,
+                           to_bytes(get_value(4) & mask, 4),
+                           to_bytes(mask, 4));
+    return match_key;
+  }
+
+  void check_lookups(MatchTable *linear_table,
+                     MatchTable *tuple_space_table) {
+    for (size_t i = 0; i < nb_lookups; i++) {
+      Packet pkt = Packet::make_new(128, PacketBuffer(256), phv_source.get());
+      auto &hdr = pkt.get_phv()->get_header(testHeader);
+      hdr.mark_valid();
+      hdr.get_field(0).set(get_value(2));
+      hdr.get_field(1).set(get_value(4));
+      bool hit_1, hit_2;
+      entry_handle_t h_1, h_2;
+      const ControlFlowNode *next_node;
+      linear_table->lookup(pkt, &hit_1, &h_1, &next_node);
+      tuple_space_table->lookup(pkt, &hit_2, &h_2, &next_node);
+      ASSERT_EQ(hit_1, hit_2);
+      if (hit_1) {
+        ASSERT_EQ(h_1, h_2);
+      }
+    }
+  }
+
+  void run_test(MatchKeyParam::Type f16_type) {
+    LookupStructureFactory linear_factory;
+    LookupStructureFactory tuple_space_factory;
+    tuple_space_factory.set_tuple_space_min_size(t_size);
+    auto linear_table = create_table(f16_type, &linear_factory);
+    auto tuple_space_table = create_table(f16_type, &tuple_space_factory);
+
+    std::vector<entry_handle_t> handles;
+    std::uniform_int_distribution<int> priority_dis(1, 64);
+    for (size_t i = 0; i < nb_entries; i++) {
+      const auto match_key = gen_match_key(f16_type);
+      const int priority = priority_dis(gen);
+      entry_handle_t h_1, h_2;
+      auto rc_1 = linear_table->add_entry(match_key, &action_fn, ActionData(),
+                                          &h_1, priority);
+      auto rc_2 = tuple_space_table->add_entry(match_key, &action_fn,
+                                               ActionData(), &h_2, priority);
+      ASSERT_EQ(rc_1, rc_2);
+      if (rc_1 != MatchErrorCode::SUCCESS) continue;
+      ASSERT_EQ(h_1, h_2);
+      handles.push_back(h_1);
+    }
+    check_lookups(linear_table.get(), tuple_space_table.get());
+
+    for (size_t i = 0; i < handles.size(); i += 2) {
+      ASSERT_EQ(MatchErrorCode::SUCCESS, linear_table->delete_entry(handles[i]));
+      ASSERT_EQ(MatchErrorCode::SUCCESS,
+                tuple_space_table->delete_entry(handles[i]));
+    }
+    check_lookups(linear_table.get(), tuple_space_table.get());
+  }
+
+  virtual void SetUp() {
+    phv_source->set_phv_factory(0, &phv_factory);
+  }
+
+  // virtual void TearDown() { }
+};
+
+TEST_F(TableTupleSpace, Ternary) {
+  run_test(MatchKeyParam::Type::TERNARY);
+}
+
+TEST_F(TableTupleSpace, Range) {
+  run_test(MatchKeyParam::Type::RANGE);
+}
+
+
+// checks that DIR-24-8 and the multibit trie return the same results as the
+// default LPM trie, using the same random entries for all of them
+class TableMultibitLPM : public ::testing::Test {
+ protected:
+  static constexpr size_t t_size = 1024u;
+  static constexpr size_t nb_entries = 512u;
+  static constexpr size_t nb_lookups = 4096u;
+
+  PHVFactory phv_factory;
+
+  HeaderType testHeaderType;
+  header_id_t testHeader{0};
+  ActionFn action_fn;
+
+  std::unique_ptr<PHVSourceIface> phv_source{nullptr};
+
+  // fixed seed, we want the test to be deterministic
+  std::mt19937 gen{0};
+
+  TableMultibitLPM()
+      : testHeaderType("test_t", 0), action_fn("actionA", 0, 0),
+        phv_source(PHVSourceIface::make_phv_source()) {
+    testHeaderType.push_back_field("f8", 8);
+    testHeaderType.push_back_field("f32", 32);
+    phv_factory.push_back_header("testHdr", testHeader, testHeaderType);
+  }
+
+  // with_exact_field: the key is 5 bytes wide and the multibit trie is used
+  // (the last 6-bit chunk of the key is incomplete), otherwise it is 4 bytes
+  // wide and DIR-24-8 is used
+  std::unique_ptr<MatchTable> create_table(bool with_exact_field,
+                                           LookupStructureFactory *factory) {
+    MatchKeyBuilder key_builder;
+    if (with_exact_field) {
+      key_builder.push_back_field(testHeader, 0, 8,
+                                  MatchKeyParam::Type::EXACT);
+    }
+    key_builder.push_back_field(testHeader, 1, 32, MatchKeyParam::Type::LPM);
+    std::unique_ptr<MULPM> match_unit(new MULPM(t_size, key_builder, factory));
+    std::unique_ptr<MatchTable> table(
+        new MatchTable("test_table", 0, std::move(match_unit), false));
+    table->set_next_node(0, nullptr);
+    return table;
+  }
+
+  // addresses are drawn from a few /8s so that prefixes overlap
+  unsigned int get_addr() {
+    std::uniform_int_distribution<unsigned int> dis_first(0, 3);
+    std::uniform_int_distribution<unsigned int> dis_rest(0, 0xffffff);
+    return (dis_first(gen) << 24) | dis_rest(gen);
+  }
+
+  unsigned int get_exact() {
+    std::uniform_int_distribution<unsigned int> dis(0, 1);
+    return dis(gen);
+  }
+
+  static std::string to_bytes(unsigned int v, size_t nbytes) {
+    std::string s(nbytes, '\x00');
+    for (size_t i = 0; i < nbytes; i++)
+      s[nbytes - 1 - i] = static_cast<char>((v >> (8 * i)) & 0xff);
+    return s;
+  }
+
+  std::vector<MatchKeyParam> gen_match_key(bool with_exact_field) {
+    std::uniform_int_distribution<int> dis_len(0, 32);
+    std::vector<MatchKeyParam> match_key;
+    if (with_exact_field) {
+      match_key.emplace_back(MatchKeyParam::Type::EXACT,
+                             to_bytes(get_exact(), 1));
+    }
+    const int prefix_length = dis_len(gen);
+    const unsigned int mask = (prefix_length == 0) ?
+        0 : (0xffffffffu << (32 - prefix_length));
+    match_key.emplace_back(MatchKeyParam::Type::LPM,
+                           to_bytes(get_addr() & mask, 4), prefix_length);
+    return match_key;
+  }
+
+  void check_lookups(MatchTable *trie_table, MatchTable *multibit_table) {
+    for (size_t i = 0; i < nb_lookups; i++) {
+      Packet pkt = Packet::make_new(128, PacketBuffer(256), phv_source.get());
+      auto &hdr = pkt.get_phv()->get_header(testHeader);
+      hdr.mark_valid();
+      hdr.get_field(0).set(get_exact());
+      hdr.get_field(1).set(get_addr());
+      bool hit_1, hit_2;
+      entry_handle_t h_1, h_2;
+      const ControlFlowNode *next_node;
+      trie_table->lookup(pkt, &hit_1, &h_1, &next_node);
+      multibit_table->lookup(pkt, &hit_2, &h_2, &next_node);
+      ASSERT_EQ(hit_1, hit_2);
+      if (hit_1) {
+        ASSERT_EQ(h_1, h_2);
+      }
+    }
+  }
+
+  void run_test(bool with_exact_field) {
+    LookupStructureFactory trie_factory;
+    LookupStructureFactory multibit_factory;
+    multibit_factory.set_multibit_lpm_min_size(t_size);
+    auto trie_table = create_table(with_exact_field, &trie_factory);
+    auto multibit_table = create_table(with_exact_field, &multibit_factory);
+
+    std::vector<entry_handle_t> handles;
+    for (size_t i = 0; i < nb_entries; i++) {
+      const auto match_key = gen_match_key(with_exact_field);
+      entry_handle_t h_1, h_2;
+      auto rc_1 = trie_table->add_entry(match_key, &action_fn, ActionData(),
+                                        &h_1);
+      auto rc_2 = multibit_table->add_entry(match_key, &action_fn,
+                                            ActionData(), &h_2);
+      ASSERT_EQ(rc_1, rc_2);
+      if (rc_1 != MatchErrorCode::SUCCESS) continue;
+      ASSERT_EQ(h_1, h_2);
+      handles.push_back(h_1);
+    }
+    check_lookups(trie_table.get(), multibit_table.get());
+
+    for (size_t i = 0; i < handles.size(); i += 2) {
+      ASSERT_EQ(MatchErrorCode::SUCCESS, trie_table->delete_entry(handles[i]));
+      ASSERT_EQ(MatchErrorCode::SUCCESS,
+                multibit_table->delete_entry(handles[i]));
+    }
+    check_lookups(trie_table.get(), multibit_table.get());
+  }
+
+  virtual void SetUp() {
+    phv_source->set_phv_factory(0, &phv_factory);
+  }
+
+  // virtual void TearDown() { }
+};
+
+TEST_F(TableMultibitLPM, Dir24_8) {
+  run_test(false);
+}
+
+TEST_F(TableMultibitLPM, MultibitTrie) {
+  run_test(true);
+}
+
+TEST_F(TableMultibitLPM, LookupBatch) {
+  LookupStructureFactory factory;
+  factory.set_multibit_lpm_min_size(0);
+  for (const size_t nbytes_key : {4u, 5u}) {
+    auto lookup_structure = factory.create_for_LPM(t_size, nbytes_key);
+    for (size_t i = 0; i < nb_entries; i++) {
+      const auto match_key = gen_match_key(nbytes_key == 5);
+      ByteContainer data;
+      int prefix_length = match_key.back().prefix_length;
+      if (nbytes_key == 5) {
+        data.append(match_key.front().key);
+        prefix_length += 8;
+      }
+      data.append(match_key.back().key);
+      lookup_structure->add_entry(LPMMatchKey(data, prefix_length, 0), i);
+    }
+
+    std::vector<ByteContainer> keys;
+    for (size_t i = 0; i < nb_lookups; i++) {
+      ByteContainer key;
+      if (nbytes_key == 5) key.append(to_bytes(get_exact(), 1));
+      key.append(to_bytes(get_addr(), 4));
+      keys.push_back(std::move(key));
+    }
+    std::vector<internal_handle_t> handles(nb_lookups);
+    std::unique_ptr<bool[]> hits(new bool[nb_lookups]);
+    lookup_structure->lookup_batch(keys.data(), keys.size(), handles.data(),
+                                   hits.get());
+    for (size_t i = 0; i < nb_lookups; i++) {
+      internal_handle_t handle;
+      const bool hit = lookup_structure->lookup(keys[i], &handle);
+      ASSERT_EQ(hit, hits[i]);
+      if (hit) {
+        ASSERT_EQ(handle, handles[i]);
+      }
+    }
+  }
+}
+
+// The table is created with a smaller size than the number of entries, to
+// exercise rehashing, and half of the entries are deleted and re-inserted, to
+// exercise the reuse of deleted slots. A std::unordered_map is used as the
+// reference.
+TEST(ExactLookupStructure, HashTable) {
+  constexpr size_t nbytes_key = 6;
+  constexpr size_t nb_keys = 2000;
+  std::mt19937 gen(0);
+  // keys are drawn from a small range so that lookups also hit
+  std::uniform_int_distribution<int> dis(0, 2 * nb_keys);
+  auto get_key = [&gen, &dis]() {
+    ByteContainer key(nbytes_key);
+    const int v = dis(gen);
+    key[4] = static_cast<char>(v >> 8);
+    key[5] = static_cast<char>(v & 0xff);
+    return key;
+  };
+
+  LookupStructureFactory factory;
+  auto lookup_structure = factory.create_for_exact(100, nbytes_key);
+  std::unordered_map<ByteContainer, internal_handle_t, ByteContainerKeyHash>
+      ref;
+  auto match_key = [](const ByteContainer &key) {
+    ExactMatchKey match_key;
+    match_key.data = key;
+    return match_key;
+  };
+
+  auto check = [&]() {
+    std::vector<ByteContainer> keys;
+    for (size_t i = 0; i < 1000; i++) keys.push_back(get_key());
+    std::vector<internal_handle_t> handles(keys.size());
+    std::unique_ptr<bool[]> hits(new bool[keys.size()]);
+    lookup_structure->lookup_batch(keys.data(), keys.size(), handles.data(),
+                                   hits.get());
+    for (size_t i = 0; i < keys.size(); i++) {
+      const auto it = ref.find(keys[i]);
+      internal_handle_t handle;
+      const bool hit = lookup_structure->lookup(keys[i], &handle);
+      ASSERT_EQ(it != ref.end(), hit);
+      ASSERT_EQ(hit, hits[i]);
+      if (hit) {
+        ASSERT_EQ(it->second, handle);
+        ASSERT_EQ(it->second, handles[i]);
+      }
+    }
+  };
+
+  for (internal_handle_t h = 0; h < nb_keys; h++) {
+    const auto key = get_key();
+    if (ref.find(key) != ref.end()) continue;
+    ref[key] = h;
+    lookup_structure->add_entry(match_key(key), h);
+  }
+  check();
+
+  size_t i = 0;
+  for (auto it = ref.begin(); it != ref.end(); i++) {
+    if (i % 2 == 0) {
+      it++;
+      continue;
+    }
+    lookup_structure->delete_entry(match_key(it->first));
+    it = ref.erase(it);
+  }
+  check();
+
+  for (internal_handle_t h = nb_keys; h < 2 * nb_keys; h++) {
+    const auto key = get_key();
+    if (ref.find(key) != ref.end()) continue;
+    ref[key] = h;
+    lookup_structure->add_entry(match_key(key), h);
+  }
+  check();
+
+  for (const auto &p : ref) {
+    ASSERT_TRUE(lookup_structure->entry_exists(match_key(p.first)));
+  }
+  lookup_structure->clear();
+  ref.clear();
+  check();
+}
+
 
 template <typename MTType>
 class TableDefaultDefaultEntryTest : public ::testing::Test {
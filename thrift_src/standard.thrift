@@ -84,6 +84,13 @@ struct BmCounterValue {
   2:i64 packets;
 }
 
+struct BmMtCacheStats {
+  1:i64 size;
+  2:i64 hits;
+  3:i64 misses;
+  4:i64 evictions;
+}
+
 struct BmMeterRateConfig {
   1:double units_per_micros;
   2:i32 burst_size;
@@ -123,6 +130,7 @@ enum TableOperationErrorCode {
   NO_ACTION_PROFILE_SELECTION = 24,
   IMMUTABLE_TABLE_ENTRIES = 25,
   BAD_ACTION_DATA = 26,
+  CACHE_DISABLED = 27,
   ERROR = 100,
 }
 
@@ -324,6 +332,19 @@ service Standard {
     3:bool reset_default_entry
   ) throws (1:InvalidTableOperation ouch),
 
+  // only for tables with a lookup cache (ternary and range by default)
+  BmMtCacheStats bm_mt_get_cache_stats(
+    1:i32 cxt_id,
+    2:string table_name
+  ) throws (1:InvalidTableOperation ouch),
+
+  // also clears the cache and its statistics, 0 disables the cache
+  void bm_mt_set_cache_size(
+    1:i32 cxt_id,
+    2:string table_name,
+    3:i32 size
+  ) throws (1:InvalidTableOperation ouch),
+
   // direct tables
 
   BmEntryHandle bm_mt_add_entry(
@@ -341,6 +362,14 @@ service Standard {
     3:string plan_file
   ) throws (1:InvalidRuntimeReconfigOperation ouch),
 
+  string bm_mt_runtime_reconfig_get_stats(
+    1:i32 cxt_id
+  )
+
+  void bm_mt_runtime_reconfig_reset_stats(
+    1:i32 cxt_id
+  )
+
   void bm_mt_set_default_action(
     1:i32 cxt_id,
     2:string table_name,
@@ -1123,6 +1123,46 @@ class RuntimeAPI(cmd.Cmd):
     def complete_table_num_entries(self, text, line, start_index, end_index):
         return self._complete_tables(text)
 
+    @handle_bad_input
+    def do_table_cache_stats(self, line):
+        "Show the lookup cache statistics of a match table (ternary and range tables): table_cache_stats <table name>"
+        args = line.split()
+
+        self.exactly_n_args(args, 1)
+
+        table_name = args[0]
+        table = self.get_res("table", table_name, ResType.table)
+
+        stats = self.client.bm_mt_get_cache_stats(0, table.name)
+        print("size:", stats.size)
+        print("hits:", stats.hits)
+        print("misses:", stats.misses)
+        print("evictions:", stats.evictions)
+
+    def complete_table_cache_stats(self, text, line, start_index, end_index):
+        return self._complete_tables(text)
+
+    @handle_bad_input
+    def do_table_set_cache_size(self, line):
+        "Resize (and clear) the lookup cache of a match table, 0 disables it: table_set_cache_size <table name> <size>"
+        args = line.split()
+
+        self.exactly_n_args(args, 2)
+
+        table_name = args[0]
+        table = self.get_res("table", table_name, ResType.table)
+
+        try:
+            size = int(args[1])
+            assert(size >= 0)
+        except:
+            raise UIn_Error("Bad format for size")
+
+        self.client.bm_mt_set_cache_size(0, table.name, size)
+
+    def complete_table_set_cache_size(self, text, line, start_index, end_index):
+        return self._complete_tables(text)
+
     @handle_bad_input
     def do_table_clear(self, line):
         "Clear all entries in a match table (direct or indirect), but not the default entry: table_clear <table name>"
@@ -2268,6 +2308,26 @@ class RuntimeAPI(cmd.Cmd):
     def complete_runtime_reconfig(self, text, line, start_index, end_index):
         return self._complete_tables(text)
 
+    @handle_bad_input
+    def do_runtime_reconfig_stats(self, line):
+        "Display the latency histograms of FlexCore runtime reconfigurations: runtime_reconfig_stats [cxt_id]"
+        args = line.split()
+        cxt_id = 0
+        if len(args) > 0:
+            self.exactly_n_args(args, 1)
+            cxt_id = self.parse_int(args[0], "cxt_id")
+        print(self.client.bm_mt_runtime_reconfig_get_stats(cxt_id))
+
+    @handle_bad_input
+    def do_runtime_reconfig_reset_stats(self, line):
+        "Reset the latency histograms of FlexCore runtime reconfigurations: runtime_reconfig_reset_stats [cxt_id]"
+        args = line.split()
+        cxt_id = 0
+        if len(args) > 0:
+            self.exactly_n_args(args, 1)
+            cxt_id = self.parse_int(args[0], "cxt_id")
+        self.client.bm_mt_runtime_reconfig_reset_stats(cxt_id)
+
     @handle_bad_input
     def do_act_prof_dump_member(self, line):
         "Display some information about a member: act_prof_dump_member <action profile name> <member handle>"